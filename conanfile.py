@@ -15,13 +15,10 @@ class InfluxdbCxxConan(ConanFile):
     generators = ("cmake_find_package", "cmake_paths")
     options = {"shared": [True, False],
                "tests": [True, False],
-               "system": [True, False],
-               "boost": [True, False]}
+               "system": [True, False]}
     default_options = {"shared": False,
                        "tests": False,
                        "system": False,
-                       "boost": True,
-                       "boost:shared": True,
                        "libcurl:shared": True}
     exports = ["LICENSE"]
     exports_sources = ("CMakeLists.txt", "src/*", "include/*", "test/*", "cmake/*", "3rd-party/*")
@@ -46,8 +43,7 @@ class InfluxdbCxxConan(ConanFile):
     def requirements(self):
         if not self.options.system:
             self.requires("libcurl/7.80.0")
-            if self.options.boost:
-                self.requires("boost/1.78.0")
+            self.requires("zlib/1.2.12")
         if self.options.tests:
             self.requires("catch2/2.13.9")
             self.requires("trompeloeil/42")
@@ -70,6 +66,5 @@ class InfluxdbCxxConan(ConanFile):
     def _configure_cmake(self):
         cmake = CMake(self)
         cmake.definitions["INFLUXCXX_TESTING"] = self.options.tests
-        cmake.definitions["INFLUXCXX_WITH_BOOST"] = self.options.boost
         cmake.configure(build_folder="build")
         return cmake
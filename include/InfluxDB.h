@@ -30,19 +30,142 @@
 #define INFLUXDATA_INFLUXDB_H
 
 #include <chrono>
+#include <cstdint>
+#include <exception>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
-#include <deque>
 
 #include "Transport.h"
 #include "Point.h"
 #include "InfluxDBTable.h"
+#include "InfluxDBColumnarTable.h"
+#include "InfluxDBQueryCursor.h"
 #include "influxdb_export.h"
 
 namespace influxdb
 {
 
+namespace internal
+{
+  class AsyncWriter;
+  class DeadlineTimer;
+  class MemoryBudget;
+  class QueryCache;
+  class Retrier;
+  class Spool;
+}
+
+/// \brief Counters of the query cache
+struct QueryCacheStatistics
+{
+  /// Queries answered from the cache
+  std::uint64_t hits;
+  /// Queries sent to the server
+  std::uint64_t misses;
+  /// Queries waiting for the result of an identical query in flight
+  std::uint64_t coalesced;
+  /// Results dropped to stay within the memory limit
+  std::uint64_t evictions;
+  /// Number of cached results
+  std::size_t entries;
+  /// Estimated memory of the cached results
+  std::size_t bytes;
+};
+
+/// \brief Counters of the spool of batches which couldn't be sent
+struct SpoolStatistics
+{
+  /// Batches appended to the spool
+  std::uint64_t spooled;
+  /// Spooled batches sent after the server recovered
+  std::uint64_t replayed;
+  /// Spooled batches dropped to stay within the disk quota
+  std::uint64_t evicted;
+  /// Number of batches waiting to be sent
+  std::size_t pending;
+  /// Size of the segment files
+  std::size_t bytes;
+};
+
+/// \brief Retries of writes failing as the server is unavailable or rate limited
+struct RetryPolicy
+{
+  /// Maximum number of retries of a batch, zero disables retries
+  std::size_t maxRetries{5};
+  /// Delay before the first retry
+  std::chrono::milliseconds initialBackoff{100};
+  /// Upper limit of the delay between retries
+  std::chrono::milliseconds maxBackoff{10000};
+  /// Factor the delay grows by with each retry
+  double multiplier{2.0};
+  /// Randomized fraction of the delay, 1 spreads retries between zero and the delay, 0 disables jitter
+  double jitter{1.0};
+  /// Maximum time from the first attempt of a batch until it's given up
+  std::chrono::milliseconds maxElapsed{30000};
+};
+
+/// \brief Counters of retried writes
+struct RetryStatistics
+{
+  /// Retries made
+  std::uint64_t retries;
+  /// Batches sent after at least one retry
+  std::uint64_t recovered;
+  /// Batches given up after the retries or the time of the policy were exhausted
+  std::uint64_t exhausted;
+  /// Batches failing with errors which aren't retried, e.g. bad requests
+  std::uint64_t rejected;
+};
+
+/// \brief Handling of points written while the memory limit of buffered points is exhausted
+enum class OverflowPolicy
+{
+  /// The writer waits for buffered points to be sent, the point is dropped after the block timeout
+  Block,
+  /// The written point is dropped
+  DropNewest,
+  /// The oldest batched points are dropped to make room
+  DropOldest,
+  /// One of every sampleInterval written points is kept by dropping the oldest batched points, the others are dropped
+  Sample
+};
+
+/// \brief Memory limit of points buffered by batches and asynchronous writes
+struct BackpressurePolicy
+{
+  /// Memory of batched lines and (estimated) queued points, zero disables the limit
+  std::size_t maxBytes{0};
+  /// Handling of points exceeding the limit
+  OverflowPolicy overflow{OverflowPolicy::Block};
+  /// Maximum time a writer waits for memory (Block only)
+  std::chrono::milliseconds blockTimeout{1000};
+  /// Keeps one of this number of points written while the memory is exhausted (Sample only)
+  std::size_t sampleInterval{10};
+};
+
+/// \brief Counters of points affected by the memory limit, by overflow policy
+struct BackpressureStatistics
+{
+  /// Writes which waited for memory (Block)
+  std::uint64_t blocked;
+  /// Points dropped as no memory was released within the block timeout (Block)
+  std::uint64_t timedOut;
+  /// Written points dropped (DropNewest, or if no batched points can be dropped)
+  std::uint64_t droppedNewest;
+  /// Batched points dropped to make room (DropOldest and Sample)
+  std::uint64_t droppedOldest;
+  /// Written points dropped by sampling (Sample)
+  std::uint64_t sampledOut;
+  /// Memory of the buffered points
+  std::size_t bytes;
+};
+
+/// \brief InfluxDB client
+///
+/// Writes, flushes and queries may be called concurrently from multiple threads;
+/// configuration (batchOf(), enableAsyncWrites(), close()) must not race with writes.
 class INFLUXDB_EXPORT InfluxDB
 {
   public:
@@ -55,6 +178,9 @@ class INFLUXDB_EXPORT InfluxDB
     /// Constructor required valid transport
     explicit InfluxDB(std::unique_ptr<Transport> transport);
 
+    /// Sends points still queued for asynchronous writes
+    ~InfluxDB();
+
     /// Writes a point
     /// \param point
     void write(Point&& point);
@@ -63,13 +189,44 @@ class INFLUXDB_EXPORT InfluxDB
     /// \param point
     void write(std::vector<Point> &&points);
 
-    /// Queries InfluxDB database
+    /// Queries InfluxDB database, answered from the cache if enabled by enableQueryCache()
     std::vector<InfluxDBTable> query(const std::string& query, const InfluxDBParams &params = InfluxDBParams());
 
+    /// Queries InfluxDB database, values are returned in typed columns instead of strings. Columns holding
+    /// values a double can't represent exactly next to floats, or integers beyond int64, are returned as strings
+    std::vector<InfluxDBColumnarTable> queryColumnar(const std::string& query, const InfluxDBParams &params = InfluxDBParams());
+
+    /// Queries InfluxDB for a CSV response (HTTP and InfluxDB 1.8+ only), which is cheaper to produce and parse
+    /// than JSON for wide results. Each block of rows with the same columns is returned as a result, numbered
+    /// in order, since CSV carries neither statement ids nor errors of single statements.
+    /// \throw InfluxDBException   if the transport doesn't support CSV or the query fails
+    std::vector<InfluxDBTable> queryCsv(const std::string& query, const InfluxDBParams &params = InfluxDBParams());
+
+    /// Queries a time range split into parts of equal length, which are queried concurrently (over multiple
+    /// connections with HTTP), at most 8 parts at once. The query selects the range of a part by the parameters $start (inclusive) and
+    /// $end (exclusive), e.g. "SELECT * FROM cpu WHERE time >= $start AND time < $end". Rows of the same series
+    /// are merged in the order of the parts, i.e. in time order for queries ordered by ascending time.
+    /// Aggregates of GROUP BY time() intervals are only exact if the parts are multiples of the interval.
+    /// \param parts   maximum number of parts, at most one per nanosecond of the range
+    /// \throw InfluxDBException   if the range is empty, parts is 0 or the query of any part fails
+    std::vector<InfluxDBTable> queryTimeRange(const std::string& query, std::chrono::system_clock::time_point start,
+                                              std::chrono::system_clock::time_point end, std::size_t parts,
+                                              const InfluxDBParams &params = InfluxDBParams());
+
+    /// Queries InfluxDB database for a chunked response, rows are fetched from the cursor while received.
+    /// The cursor must not outlive this instance.
+    /// Parameters passed as const char* must remain valid until the cursor is destroyed.
+    /// \param chunkSize   number of rows per chunk, also the maximum number of rows buffered by the cursor
+    /// \throw InfluxDBException   if chunkSize is 0
+    std::unique_ptr<InfluxDBQueryCursor> openQuery(const std::string& query, const InfluxDBParams &params = InfluxDBParams(), std::size_t chunkSize = 10000);
+
     /// Create InfluxDB database if does not exists
     void createDatabaseIfNotExists();
 
     /// Flushes points batched (this can also happens when buffer is full)
+    /// If asynchronous or concurrent writes are enabled, waits until all points are sent
+    /// \throw InfluxDBException   the first error of the background thread since the last flush,
+    ///                            or the error of the oldest failed concurrent write
     void flushBatch();
 
     /// \deprecated use \ref flushBatch() instead
@@ -80,13 +237,123 @@ class INFLUXDB_EXPORT InfluxDB
     }
 
     /// Enables points batching
-    /// \param size
-    void batchOf(std::size_t size = 32);
+    /// \param size        number of points sending a batch
+    /// \param maxLinger   maximum age of the oldest batched point after which the batch
+    ///                    is sent by a background thread, zero (default) disables it;
+    ///                    errors are reported by the next flushBatch()
+    void batchOf(std::size_t size = 32, std::chrono::milliseconds maxLinger = std::chrono::milliseconds::zero());
+
+    /// Enables compression of written points (HTTP only, gzip encoded)
+    /// \param level         compression level from 0 (none) to 9 (best)
+    /// \param minimumSize   messages smaller than this number of bytes are sent uncompressed
+    /// \throw InfluxDBException   if the transport doesn't support compression or the level is invalid
+    void enableCompression(int level = 6, std::size_t minimumSize = 1024);
+
+    /// Requests query responses encoded as MessagePack instead of JSON (HTTP and InfluxDB 1.x only),
+    /// which are smaller and decoded without converting numbers from text
+    /// \throw InfluxDBException   if the transport doesn't support MessagePack
+    void enableMessagePack();
+
+    /// Enables concurrent writes, up to maxInFlight batches are sent at the same time over
+    /// multiple connections (HTTP only). Errors of batches are reported by flushBatch().
+    /// \throw InfluxDBException   if the transport doesn't support concurrent writes
+    void enableConcurrentWrites(std::size_t maxInFlight = 8);
+
+    /// Caches results of query() by the query and its parameters, until they are older than ttl or
+    /// evicted as least recently used to stay within maxBytes. Identical queries issued while one is in
+    /// flight wait for its result instead of querying the server as well; failed queries are not cached.
+    /// \param ttl        maximum age of cached results, zero only coalesces concurrent identical queries
+    /// \param maxBytes   estimated memory of all cached results
+    void enableQueryCache(std::chrono::milliseconds ttl, std::size_t maxBytes = 64 * 1024 * 1024);
+
+    /// Drops all results of the query cache, e.g. after writing points they would not contain
+    void clearQueryCache();
+
+    /// Returns the counters of the query cache, all zero if it's disabled
+    QueryCacheStatistics queryCacheStatistics() const;
+
+    /// Spools batches which couldn't be sent as the server is unavailable (connection, 5xx or 429 errors) to
+    /// memory mapped files in the directory, instead of throwing. Spooled batches are sent in order before
+    /// newer ones once the server recovers, retried by writes at most once per second and by flushBatch().
+    /// Batches still spooled are sent after a restart with the same directory. If the spool exceeds maxBytes,
+    /// the oldest batches are dropped. Batches sent by concurrent writes are not spooled.
+    /// \throw InfluxDBException   if the directory can't be used or is in use by another instance
+    void enableSpool(const std::string& directory, std::size_t maxBytes = 1024 * 1024 * 1024);
+
+    /// Returns the counters of the spool, all zero if it's disabled
+    SpoolStatistics spoolStatistics() const;
+
+    /// Retries writes failing with connection errors, server errors (5xx) or rate limiting (429) with
+    /// exponential backoff and jitter, waiting at least the delay requested by Retry-After. Other errors,
+    /// e.g. bad requests (400), are never retried. With the spool enabled, batches are spooled once the
+    /// retries are exhausted. Writers are blocked while a batch is retried. Concurrent writes fail
+    /// asynchronously and are not retried.
+    /// \throw InfluxDBException   if the policy is invalid
+    void setRetryPolicy(const RetryPolicy& policy);
+
+    /// Returns the counters of retried writes, all zero if retries are disabled
+    RetryStatistics retryStatistics() const;
 
-    /// Returns current batch size
+    /// Recovers writes the server rejected for some of their lines (HTTP only), e.g. for field type conflicts
+    /// or parse errors, instead of throwing BadRequest for the whole batch. The rejected lines, identified by
+    /// the error message of the server, are passed to handler (e.g. to quarantine them), the other lines are
+    /// sent again unless the server wrote them already (partial write). Batches whose rejected lines can't be
+    /// identified, or which dropped more lines than identified, still throw. The handler is called by the writing thread, the background thread of
+    /// asynchronous writes included. Concurrent writes are not recovered.
+    /// \throw InfluxDBException   if the transport doesn't support the recovery
+    void setRejectedLineHandler(RejectedLineHandler handler);
+
+    /// Sets the maximum size of datagrams (UDP only), the lines of a batch are packed into datagrams
+    /// of up to maxSize bytes. By default datagrams fit the MTU of the route to the host.
+    /// \throw InfluxDBException   if the transport doesn't send datagrams or the size is invalid
+    void setMaxDatagramSize(std::size_t maxSize);
+
+    /// Lets the kernel split sends into datagrams (UDP on Linux 4.18+ only), which are padded with empty
+    /// lines to the maximum datagram size. Saves system calls if datagrams are much smaller than 64 kB.
+    /// \throw InfluxDBException   if unsupported by the transport or system
+    void enableSegmentationOffload();
+
+    /// Sets the size of the send buffer of the socket (UDP and Unix socket only). The socket doesn't block,
+    /// datagrams which don't fit into the send buffer are dropped and counted by datagramStatistics().
+    /// \throw InfluxDBException   if the transport doesn't send datagrams or the size is rejected
+    void setSendBufferSize(std::size_t bytes);
+
+    /// Returns the counters of sent and dropped datagrams (UDP and Unix socket only), all zero for other transports
+    DatagramStatistics datagramStatistics() const;
+
+    /// Returns the counters of the connection (TCP only), all zero for other transports
+    StreamStatistics streamStatistics() const;
+
+    /// Limits the serialized size of batches, a batch is sent before a point would
+    /// exceed the limit; applies once batching is enabled by batchOf()
+    /// \param maxBytes    maximum line protocol bytes of a batch, zero (default) disables the limit
+    void setMaxBatchBytes(std::size_t maxBytes);
+
+    /// Enables asynchronous writes, points are queued and serialized and sent
+    /// by a background thread. Errors are reported by flushBatch() and close().
+    /// \param queueCapacity maximum number of queued points, write() blocks while the queue is full
+    void enableAsyncWrites(std::size_t queueCapacity = 1024);
+
+    /// Sends all queued and batched points and stops asynchronous writes,
+    /// further writes are sent synchronously
+    /// \throw InfluxDBException   the first error of the background thread since the last flush
+    void close();
+
+    /// Limits the memory of points buffered by the batch, also if it's kept as sending fails, and by the queue of
+    /// asynchronous writes. The policy selects what happens to points written while the limit is exhausted.
+    /// Without asynchronous writes, blocked writers send the batch themselves instead of waiting. Queued points
+    /// aren't dropped, so if the batch doesn't hold enough points to drop, the written point is dropped instead.
+    /// Must be set before points are written and before asynchronous writes are enabled.
+    /// \throw InfluxDBException   if the sample interval is 0 or asynchronous writes are enabled
+    void setBackpressurePolicy(const BackpressurePolicy& policy);
+
+    /// Returns the counters of points affected by the memory limit, all zero if it's disabled
+    BackpressureStatistics backpressureStatistics() const;
+
+    /// Returns current batch size (including points queued for asynchronous writes)
     std::size_t batchSize() const;
 
-    /// Clears the point batch
+    /// Clears the point batch (and the queue of asynchronous writes)
     void clearBatch();
 
     /// Adds a global tag
@@ -95,10 +362,47 @@ class INFLUXDB_EXPORT InfluxDB
     void addGlobalTag(std::string_view name, std::string_view value);
 
   private:
-    void addPointToBatch(Point &&point);
+    /// Adds the point to the batch; the memory of queued points is reserved without applying the overflow policy
+    void addPointToBatch(Point &&point, bool queued = false);
+
+    /// Adds the formatted point to the batch if its memory is reserved, returns false if it's dropped
+    bool addPendingLine(bool queued);
+
+    /// Separates the next line from the batched ones, or starts the linger time of a new batch
+    void startLine();
+
+    /// Writes points to the batch or transmits them
+    void writePoints(std::vector<Point> &&points);
+
+    /// Writes points taken from the queue of asynchronous writes, handing their reserved memory over to the batch.
+    /// Sends the batch if there are none, as the background thread was woken by writers blocked on its memory
+    void writeQueuedPoints(std::vector<Point> &&points);
+
+    /// Transmits the batched points
+    void transmitBatch();
+
+    /// Discards the batched points
+    void clearPendingBatch();
+
+    /// Reserves memory for a line added to the batch, applying the overflow policy if it's exhausted;
+    /// returns false if the line must be dropped
+    bool reserveBatchMemory(std::size_t bytes);
+
+    /// Reserves memory for a point queued for asynchronous writes, applying the overflow policy if
+    /// it's exhausted; returns false if the point must be dropped
+    bool reserveQueueMemory(const Point& point);
+
+    /// Drops the oldest batched points until the bytes can be reserved, returns false if not enough are batched
+    bool dropOldestPoints(std::size_t bytes);
 
-    /// line protocol batch to be written
-    std::deque<Point> mPointBatch;
+    /// Transmits the batch if its oldest point exceeds the maximum linger time
+    void flushLingeringBatch();
+
+    /// Line protocol of the batched points, serialized when they are written
+    std::string mLineProtocolBatch;
+
+    /// Number of points in the line protocol batch
+    std::size_t mBatchPointCount;
 
     /// Flag stating whether point buffering is enabled
     bool mIsBatchingActivated;
@@ -106,16 +410,68 @@ class INFLUXDB_EXPORT InfluxDB
     /// Points batch size
     std::size_t mBatchSize;
 
+    /// Maximum line protocol bytes of a batch, zero if unlimited
+    std::size_t mMaxBatchBytes;
+
+    /// Memory of the batch reserved from the memory budget
+    std::size_t mBatchReservedBytes;
+
+    /// Serialized point before it's added to a byte limited batch
+    std::string mPendingLine;
+
     /// Underlying transport UDP/HTTP/Unix socket
     std::unique_ptr<Transport> mTransport;
 
     /// Transmits string over transport
     void transmit(std::string&& point);
 
+    /// Sends the lines, retried as configured by setRetryPolicy()
+    void send(std::string& lines);
+
+    /// Returns the query cache, nullptr if disabled
+    std::shared_ptr<internal::QueryCache> queryCache() const;
+
+    /// Sends spooled batches in order, unless retried too recently; returns whether all were sent
+    bool replaySpool(bool force);
+
     /// List of global tags
     std::string mGlobalTags;
 
-    std::string joinLineProtocolBatch() const;
+    /// Guards batch and global tags
+    mutable std::mutex mMutex;
+
+    /// Maximum age of the oldest batched point
+    std::chrono::milliseconds mMaxLinger;
+
+    /// Time the oldest batched point was added
+    std::chrono::steady_clock::time_point mBatchStart;
+
+    /// First error of flushes triggered by the linger time
+    std::exception_ptr mLingerError;
+
+    /// Guards the query cache, which is kept by queries in flight if it's replaced
+    mutable std::mutex mQueryCacheMutex;
+
+    /// Cache of query results, nullptr if disabled
+    std::shared_ptr<internal::QueryCache> mQueryCache;
+
+    /// Batches which couldn't be sent, nullptr if disabled
+    std::unique_ptr<internal::Spool> mSpool;
+
+    /// Retries of failed writes, nullptr if disabled
+    std::unique_ptr<internal::Retrier> mRetrier;
+
+    /// Earliest time spooled batches are sent again after a failure
+    std::chrono::steady_clock::time_point mNextReplay;
+
+    /// Limit of the memory of buffered points, nullptr if disabled
+    std::unique_ptr<internal::MemoryBudget> mBudget;
+
+    /// Flushes batches exceeding the linger time, destroyed before the spool, retrier and budget its flushes use
+    std::unique_ptr<internal::DeadlineTimer> mLingerTimer;
+
+    /// Queue of asynchronous writes, destroyed first to send the pending points
+    std::unique_ptr<internal::AsyncWriter> mAsyncWriter;
 };
 
 } // namespace influxdb
@@ -0,0 +1,103 @@
+// MIT License
+//
+// Copyright (c) 2022 TOSHIBA CORPORATION
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "influxdb_export.h"
+
+namespace influxdb
+{
+    /// \brief Represents a column of a series, values of a type are stored contiguously
+    class INFLUXDB_EXPORT InfluxDBColumn
+    {
+    public:
+        /// Type of the values
+        enum class Type
+        {
+            /// All values are null
+            Null,
+            Boolean,
+            Integer,
+            Float,
+            String,
+            /// Timestamps in nanoseconds since epoch
+            Time
+        };
+
+        /// column name
+        std::string name;
+        /// type of the values
+        Type type{Type::Null};
+        /// values of Integer and Time columns
+        std::vector<std::int64_t> integers;
+        /// values of Float columns
+        std::vector<double> floats;
+        /// values of Boolean columns (0 or 1)
+        std::vector<std::uint8_t> booleans;
+        /// values of String columns, referring to the string storage of the table
+        std::vector<std::string_view> strings;
+        /// validity bitmap, bit (row % 64) of word (row / 64) is set if the value isn't null
+        std::vector<std::uint64_t> validity;
+
+        /// Returns whether the value of a row is null, null values are zero or empty in the value vectors
+        bool isNull(std::size_t row) const
+        {
+            return ((validity[row / 64] >> (row % 64)) & 1U) == 0;
+        }
+    };
+
+    /// \brief Represents a series with typed columns
+    class INFLUXDB_EXPORT InfluxDBColumnarSeries
+    {
+    public:
+        /// series name
+        std::string name;
+        /// tag names list
+        std::vector<std::string> tagKeys;
+        /// tag value list
+        std::vector<std::string> tagValues;
+        /// columns, each holding a value of every row
+        std::vector<InfluxDBColumn> columns;
+        /// number of rows
+        std::size_t rowCount{0};
+    };
+
+    /// \brief Represents a query result with typed columns
+    class INFLUXDB_EXPORT InfluxDBColumnarTable
+    {
+    public:
+        /// statement id
+        int statementId{-1};
+        /// series
+        std::vector<InfluxDBColumnarSeries> series;
+        /// statement error message (default is {})
+        std::string error;
+        /// storage of the string values, shared by copies of the table
+        std::vector<std::shared_ptr<char[]>> stringStorage;
+    };
+}
@@ -28,6 +28,7 @@
 #ifndef INFLUXDATA_EXCEPTION_H
 #define INFLUXDATA_EXCEPTION_H
 
+#include <chrono>
 #include <stdexcept>
 #include <string>
 
@@ -51,6 +52,22 @@ public:
   BadRequest(const std::string &source, const std::string &message) : InfluxDBException(source, message) {}
 };
 
+class PayloadTooLarge : public BadRequest {
+public:
+  PayloadTooLarge(const std::string &source, const std::string &message) : BadRequest(source, message) {}
+};
+
+class TooManyRequests : public BadRequest {
+public:
+  TooManyRequests(const std::string &source, const std::string &message, std::chrono::seconds retryAfter) : BadRequest(source, message), mRetryAfter(retryAfter) {}
+
+  /// Delay requested by the server (Retry-After header), zero if none
+  std::chrono::seconds retryAfter() const { return mRetryAfter; }
+
+private:
+  std::chrono::seconds mRetryAfter;
+};
+
 class ServerError : public InfluxDBException {
 public:
   ServerError(const std::string &source, const std::string &message) : InfluxDBException(source, message) {}
@@ -0,0 +1,76 @@
+// MIT License
+//
+// Copyright (c) 2022 TOSHIBA CORPORATION
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "InfluxDBParams.h"
+#include "InfluxDBTable.h"
+#include "Transport.h"
+#include "influxdb_export.h"
+
+namespace influxdb
+{
+    namespace internal
+    {
+        class CursorResultBuilder;
+    }
+
+    /// \brief Cursor over the rows of a query, fetched while the response is received
+    ///
+    /// The query is sent for a chunked response by a background thread, which parses
+    /// it as far as the buffered rows permit. Memory use is therefore bounded by the
+    /// chunk size regardless of the size of the result.
+    class INFLUXDB_EXPORT InfluxDBQueryCursor
+    {
+    public:
+        /// Sends the query, the transport must outlive the cursor
+        /// \param chunkSize   number of rows per chunk of the response, also the number
+        ///                    of rows buffered ahead of fetch()
+        /// \throw InfluxDBException   if chunkSize is 0
+        InfluxDBQueryCursor(Transport& transport, const std::string& query, const InfluxDBParams& params, std::size_t chunkSize);
+
+        /// Aborts the query if the response isn't received completely
+        ~InfluxDBQueryCursor();
+
+        InfluxDBQueryCursor(const InfluxDBQueryCursor&) = delete;
+        InfluxDBQueryCursor& operator=(const InfluxDBQueryCursor&) = delete;
+
+        /// Returns the next rows, blocks until maxRows rows are received or the response ends
+        ///
+        /// Rows are grouped by statement and series like the results of InfluxDB::query(),
+        /// a series continued by the next fetch appears again in its results. Results without
+        /// rows, e.g. errors of statements, are returned along with the rows.
+        /// \return results of up to maxRows rows, empty at the end of the response
+        /// \throw InfluxDBException   if the query fails or maxRows is 0
+        std::vector<InfluxDBTable> fetch(std::size_t maxRows);
+
+    private:
+        std::unique_ptr<internal::CursorResultBuilder> mBuilder;
+        std::thread mThread;
+    };
+}
@@ -33,14 +33,63 @@
 #include <string_view>
 #include <chrono>
 #include <variant>
-#include <deque>
+#include <vector>
+#include <array>
+#include <cstdint>
 
 #include "influxdb_export.h"
 
 namespace influxdb
 {
 
-static inline constexpr int defaultFloatsPrecision{18};
+class LineProtocol;
+
+namespace detail
+{
+    /// \brief Sequence keeping the first N elements inline, further ones on the heap
+    template <class T, std::size_t N>
+    class InlineVector
+    {
+      public:
+        void push_back(const T& value)
+        {
+            if (mSize < N)
+            {
+                mInline[mSize] = value;
+            }
+            else
+            {
+                mOverflow.push_back(value);
+            }
+            ++mSize;
+        }
+
+        const T& operator[](std::size_t index) const
+        {
+            return index < N ? mInline[index] : mOverflow[index - N];
+        }
+
+        std::size_t size() const
+        {
+            return mSize;
+        }
+
+        bool empty() const
+        {
+            return mSize == 0;
+        }
+
+      private:
+        std::array<T, N> mInline{};
+        std::vector<T> mOverflow;
+        std::size_t mSize{0};
+    };
+}
+
+/// Floats precision selecting the shortest representation which round-trips
+static inline constexpr int shortestFloatsPrecision{-1};
+
+static inline constexpr int defaultFloatsPrecision{shortestFloatsPrecision};
 
 /// \brief Represents a point
 class INFLUXDB_EXPORT Point
@@ -81,21 +130,70 @@ class INFLUXDB_EXPORT Point
     /// Tags getter
     std::string getTags() const;
 
-    /// Precision for float fields
+    /// Precision for float fields, a negative value (default) selects the
+    /// shortest round-trip representation instead of a fixed number of digits
     static inline int floatsPrecision{defaultFloatsPrecision};
 
 protected:
+    friend class LineProtocol;
+
     /// A name
     std::string mMeasurement;
 
     /// A timestamp
     std::chrono::time_point<std::chrono::system_clock> mTimestamp;
 
+    /// Number of tags and fields stored without additional allocation
+    static constexpr std::size_t inlineCapacity{8};
+
+    /// Tag, key and value are stored consecutively in the arena
+    struct Tag
+    {
+        std::uint32_t offset;
+        std::uint32_t keyLength;
+        std::uint32_t valueLength;
+    };
+
+    /// Field, the key (and a string value) are stored consecutively in the arena
+    struct Field
+    {
+        enum class Type : std::uint8_t
+        {
+            Boolean,
+            Integer,
+            Double,
+            String
+        };
+
+        std::uint32_t offset;
+        std::uint32_t keyLength;
+        Type type;
+        union
+        {
+            bool boolean;
+            long long int integer;
+            double floating;
+            std::uint32_t stringLength;
+        } value;
+    };
+
+    /// Appends data to the arena and returns its offset
+    std::uint32_t appendToArena(std::string_view data);
+
+    /// Returns a view of arena data
+    std::string_view fromArena(std::uint32_t offset, std::uint32_t length) const
+    {
+        return std::string_view{mArena}.substr(offset, length);
+    }
+
+    /// Keys and values of tags and fields
+    std::string mArena;
+
     //// Tags
-    std::deque<std::pair<std::string, std::string>> mTags;
+    detail::InlineVector<Tag, inlineCapacity> mTags;
 
     //// Fields
-    std::deque<std::pair<std::string, std::variant<bool, int, long long int, const char *, std::string, double>>> mFields;
+    detail::InlineVector<Field, inlineCapacity> mFields;
 };
 
 } // namespace influxdb
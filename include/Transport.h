@@ -32,10 +32,42 @@
 #include "InfluxDBException.h"
 #include "influxdb_export.h"
 #include "InfluxDBParams.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
 
 namespace influxdb
 {
 
+/// \brief Counters of datagram transports
+struct DatagramStatistics
+{
+  /// Datagrams sent
+  std::uint64_t datagrams;
+  /// Lines exceeding the maximum datagram size, sent in a datagram of their own
+  std::uint64_t oversizeLines;
+  /// System calls sending datagrams, each may send many of them
+  std::uint64_t sendCalls;
+  /// Datagrams dropped as the send buffer of the socket was full
+  std::uint64_t droppedDatagrams;
+};
+
+/// \brief Counters of stream transports
+struct StreamStatistics
+{
+  /// Bytes written to connections
+  std::uint64_t bytesSent;
+  /// Connections established
+  std::uint64_t connects;
+  /// Connections lost, closed by the peer or failed
+  std::uint64_t connectionResets;
+};
+
+/// \brief Receives a line the server rejected, along with the error message of the server
+using RejectedLineHandler = std::function<void(std::string_view line, const std::string& error)>;
+
 /// \brief Transport interface
 class INFLUXDB_EXPORT Transport
 {
@@ -44,7 +76,8 @@ class INFLUXDB_EXPORT Transport
 
     virtual ~Transport() = default;
 
-    /// Sends string blob
+    /// Sends string blob. The message is taken only once it's accepted, it's left unchanged if sending fails,
+    /// so callers are able to retry or spool it
     virtual void send(std::string&& message) = 0;
 
     /// Sends request
@@ -52,10 +85,78 @@ class INFLUXDB_EXPORT Transport
       throw InfluxDBException{"Transport", "Queries are not supported by the selected transport"};
     }
 
+    /// Sends request, the response is passed to onData in chunks as it is received
+    virtual void streamQuery(const std::string& query, const InfluxDBParams &params, const std::function<void(std::string_view)>& onData) {
+      onData(this->query(query, params));
+    }
+
+    /// Sends request for a response split into results of up to chunkSize rows, passed to onData
+    /// as it is received; transports not supporting chunked responses send a single result
+    virtual void streamChunkedQuery(const std::string& query, const InfluxDBParams &params, [[maybe_unused]] std::size_t chunkSize,
+                                    const std::function<void(std::string_view)>& onData) {
+      streamQuery(query, params, onData);
+    }
+
+    /// Sends request for a CSV encoded response, passed to onData as it is received
+    virtual void streamCsvQuery([[maybe_unused]] const std::string& query, [[maybe_unused]] const InfluxDBParams &params,
+                                [[maybe_unused]] const std::function<void(std::string_view)>& onData) {
+      throw InfluxDBException{"Transport", "CSV responses are not supported by the selected transport"};
+    }
+
     /// Sends request
     virtual void createDatabase() {
       throw InfluxDBException{"Transport", "Creation of database is not supported by the selected transport"};
     }
+
+    /// Sends up to maxInFlight messages concurrently, errors are reported by flush()
+    virtual void enableConcurrentWrites([[maybe_unused]] std::size_t maxInFlight) {
+      throw InfluxDBException{"Transport", "Concurrent writes are not supported by the selected transport"};
+    }
+
+    /// Waits until messages sent concurrently are delivered
+    virtual void flush() {
+    }
+
+    /// Compresses messages at least minimumSize bytes large
+    virtual void enableCompression([[maybe_unused]] int level, [[maybe_unused]] std::size_t minimumSize) {
+      throw InfluxDBException{"Transport", "Compression is not supported by the selected transport"};
+    }
+
+    /// Requests query responses encoded as MessagePack instead of JSON
+    virtual void enableMessagePack() {
+      throw InfluxDBException{"Transport", "MessagePack is not supported by the selected transport"};
+    }
+
+    /// Recovers writes rejected by the server for some of their lines: the rejected lines are passed to
+    /// handler and the other lines are sent again, unless the server wrote them already
+    virtual void setRejectedLineHandler([[maybe_unused]] RejectedLineHandler handler) {
+      throw InfluxDBException{"Transport", "Recovery of rejected lines is not supported by the selected transport"};
+    }
+
+    /// Packs the lines of messages into datagrams of up to maxSize bytes
+    virtual void setMaxDatagramSize([[maybe_unused]] std::size_t maxSize) {
+      throw InfluxDBException{"Transport", "Datagram size is not supported by the selected transport"};
+    }
+
+    /// Lets the kernel split large sends into datagrams of the maximum size (generic segmentation offload)
+    virtual void enableSegmentationOffload() {
+      throw InfluxDBException{"Transport", "Segmentation offload is not supported by the selected transport"};
+    }
+
+    /// Sets the size of the send buffer of the socket, which absorbs bursts of datagrams
+    virtual void setSendBufferSize([[maybe_unused]] std::size_t bytes) {
+      throw InfluxDBException{"Transport", "Send buffer size is not supported by the selected transport"};
+    }
+
+    /// Returns the counters of sent datagrams, all zero for other transports
+    virtual DatagramStatistics datagramStatistics() const {
+      return DatagramStatistics{};
+    }
+
+    /// Returns the counters of the connection, all zero for other transports
+    virtual StreamStatistics streamStatistics() const {
+      return StreamStatistics{};
+    }
 };
 
 } // namespace influxdb
@@ -0,0 +1,294 @@
+// MIT License
+//
+// Copyright (c) 2022 TOSHIBA CORPORATION
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "AsyncWriter.h"
+#include "InfluxDBException.h"
+#include <utility>
+
+namespace influxdb::internal
+{
+    AsyncWriter::AsyncWriter(std::size_t capacity, WriteHandler write, FlushHandler flush, DiscardHandler discard)
+        : mCapacity(capacity),
+          mWrite(std::move(write)),
+          mFlush(std::move(flush)),
+          mDiscard(std::move(discard)),
+          mQueue{},
+          mSize{0},
+          mStopping{false},
+          mWorkerWaiting{false},
+          mBlockedProducers{0},
+          mClearRequested{0},
+          mWakeRequested{false},
+          mClearCompleted{0},
+          mFlushRequested{0},
+          mFlushCompleted{0},
+          mError{},
+          mThread{}
+    {
+        if (mCapacity == 0)
+        {
+            throw InfluxDBException{"AsyncWriter", "Queue capacity must not be 0"};
+        }
+        mThread = std::thread{&AsyncWriter::run, this};
+    }
+
+    AsyncWriter::~AsyncWriter()
+    {
+        try
+        {
+            close();
+        }
+        catch (...)
+        {
+            /// Nothing left to report errors to
+        }
+    }
+
+    void AsyncWriter::enqueue(Point&& point)
+    {
+        reserve();
+        mQueue.push(std::move(point));
+        notifyWorker();
+    }
+
+    void AsyncWriter::enqueue(std::vector<Point>&& points)
+    {
+        for (auto& point : points)
+        {
+            enqueue(std::move(point));
+        }
+    }
+
+    void AsyncWriter::flush()
+    {
+        std::unique_lock lock{mMutex};
+        /// A closed writer has a final flush pending or completed already
+        const auto requested = mStopping ? mFlushRequested : ++mFlushRequested;
+        mWorkAvailable.notify_one();
+        mCompleted.wait(lock, [this, requested] { return mFlushCompleted >= requested; });
+        rethrowError();
+    }
+
+    void AsyncWriter::close()
+    {
+        {
+            std::lock_guard lock{mMutex};
+            if (mStopping)
+            {
+                return;
+            }
+            ++mFlushRequested;
+            mStopping = true;
+        }
+        mWorkAvailable.notify_one();
+        mSpaceAvailable.notify_all();
+        mThread.join();
+
+        std::lock_guard lock{mMutex};
+        rethrowError();
+    }
+
+    void AsyncWriter::clear()
+    {
+        std::unique_lock lock{mMutex};
+        if (mStopping)
+        {
+            return;
+        }
+        const auto requested = ++mClearRequested;
+        mWorkAvailable.notify_one();
+        mCompleted.wait(lock, [this, requested] { return mClearCompleted >= requested; });
+    }
+
+    void AsyncWriter::wake()
+    {
+        mWakeRequested = true;
+        /// The worker evaluates the requests while holding the mutex
+        {
+            std::lock_guard lock{mMutex};
+        }
+        mWorkAvailable.notify_one();
+    }
+
+    std::size_t AsyncWriter::size() const
+    {
+        return mSize.load();
+    }
+
+    void AsyncWriter::reserve()
+    {
+        while (true)
+        {
+            if (mStopping)
+            {
+                throw InfluxDBException{"AsyncWriter", "Writer is closed"};
+            }
+            if (mSize.fetch_add(1) < mCapacity)
+            {
+                return;
+            }
+
+            /// Queue is full, undo the reservation and wait for the background thread
+            release(1);
+            std::unique_lock lock{mMutex};
+            ++mBlockedProducers;
+            mSpaceAvailable.wait(lock, [this] { return mSize.load() < mCapacity || mStopping; });
+            --mBlockedProducers;
+        }
+    }
+
+    void AsyncWriter::release(std::size_t count)
+    {
+        mSize.fetch_sub(count);
+
+        if (mBlockedProducers.load() > 0)
+        {
+            /// Producers evaluate the queue size while holding the mutex
+            {
+                std::lock_guard lock{mMutex};
+            }
+            mSpaceAvailable.notify_all();
+        }
+    }
+
+    void AsyncWriter::notifyWorker()
+    {
+        if (mWorkerWaiting.load())
+        {
+            /// The worker evaluates the queue state while holding the mutex
+            {
+                std::lock_guard lock{mMutex};
+            }
+            mWorkAvailable.notify_one();
+        }
+    }
+
+    bool AsyncWriter::hasRequest() const
+    {
+        return mFlushRequested != mFlushCompleted || mClearRequested.load() != mClearCompleted || mWakeRequested || mStopping;
+    }
+
+    void AsyncWriter::run()
+    {
+        std::vector<Point> points;
+        std::uint64_t pendingFlush{0};
+
+        while (true)
+        {
+            if (const auto clearRequested = mClearRequested.load(); clearRequested != mClearCompleted)
+            {
+                std::size_t discarded{0};
+                while (const auto point = mQueue.pop())
+                {
+                    if (mDiscard)
+                    {
+                        mDiscard(*point);
+                    }
+                    ++discarded;
+                }
+                release(discarded);
+
+                std::lock_guard lock{mMutex};
+                mClearCompleted = clearRequested;
+                mCompleted.notify_all();
+                continue;
+            }
+
+            while (points.size() < mCapacity)
+            {
+                auto point = mQueue.pop();
+                if (!point)
+                {
+                    break;
+                }
+                points.push_back(std::move(*point));
+            }
+
+            if (!points.empty())
+            {
+                release(points.size());
+                invoke([this, &points] { mWrite(std::move(points)); });
+                points.clear();
+                continue;
+            }
+
+            if (mWakeRequested.exchange(false))
+            {
+                invoke([this] { mWrite({}); });
+                continue;
+            }
+
+            /// Queued points are written before a pending flush is executed
+            if (pendingFlush != 0)
+            {
+                invoke(mFlush);
+                std::lock_guard lock{mMutex};
+                mFlushCompleted = std::exchange(pendingFlush, 0);
+                mCompleted.notify_all();
+                continue;
+            }
+
+            std::unique_lock lock{mMutex};
+            if (mFlushRequested != mFlushCompleted)
+            {
+                /// Points queued before the request are visible now, drain them first
+                pendingFlush = mFlushRequested;
+                continue;
+            }
+            if (mStopping && mQueue.empty())
+            {
+                return;
+            }
+
+            mWorkerWaiting = true;
+            mWorkAvailable.wait(lock, [this] { return !mQueue.empty() || hasRequest(); });
+            mWorkerWaiting = false;
+        }
+    }
+
+    template <class Handler>
+    void AsyncWriter::invoke(Handler&& handler)
+    {
+        try
+        {
+            handler();
+        }
+        catch (...)
+        {
+            std::lock_guard lock{mMutex};
+            if (!mError)
+            {
+                mError = std::current_exception();
+            }
+        }
+    }
+
+    void AsyncWriter::rethrowError()
+    {
+        if (mError)
+        {
+            auto error = std::exchange(mError, nullptr);
+            std::rethrow_exception(error);
+        }
+    }
+}
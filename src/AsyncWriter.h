@@ -0,0 +1,132 @@
+// MIT License
+//
+// Copyright (c) 2022 TOSHIBA CORPORATION
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+
+#include "Point.h"
+#include "MpscQueue.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace influxdb::internal
+{
+    /// \brief Bounded point queue drained by a background thread
+    ///
+    /// Producers enqueue through a lock-free queue and only take the mutex
+    /// while the queue is full or the background thread is idle.
+    class AsyncWriter
+    {
+    public:
+        /// Writes a chunk of queued points
+        using WriteHandler = std::function<void(std::vector<Point>&&)>;
+        /// Flushes points written before
+        using FlushHandler = std::function<void()>;
+        /// Receives a queued point discarded by clear()
+        using DiscardHandler = std::function<void(const Point&)>;
+
+        /// Starts the background thread
+        /// \param capacity maximum number of queued points
+        AsyncWriter(std::size_t capacity, WriteHandler write, FlushHandler flush, DiscardHandler discard = nullptr);
+
+        /// Drains the queue and stops the background thread, errors are discarded
+        ~AsyncWriter();
+
+        AsyncWriter(const AsyncWriter&) = delete;
+        AsyncWriter& operator=(const AsyncWriter&) = delete;
+
+        /// Queues a point, blocks while the queue is full; safe to call from any thread
+        void enqueue(Point&& point);
+
+        /// Queues points, blocks while the queue is full
+        void enqueue(std::vector<Point>&& points);
+
+        /// Waits until all points queued before are written and flushed
+        /// \throw the first error raised by the handlers since the last flush
+        void flush();
+
+        /// Drains the queue and stops the background thread
+        /// \throw the first error raised by the handlers since the last flush
+        void close();
+
+        /// Discards all queued points, waits until the background thread dropped them
+        void clear();
+
+        /// Has the background thread call the write handler even if no points are queued, without waiting
+        void wake();
+
+        /// Number of queued points
+        std::size_t size() const;
+
+    private:
+        void run();
+
+        /// Takes a queue slot, blocks while the queue is full
+        void reserve();
+
+        /// Returns queue slots of points taken by the background thread
+        void release(std::size_t count);
+
+        /// Wakes the background thread if it's waiting for work
+        void notifyWorker();
+
+        /// Whether a flush, clear, wake or stop request is pending, requires the mutex
+        bool hasRequest() const;
+
+        /// Runs a handler, keeping its error for the next flush
+        template <class Handler>
+        void invoke(Handler&& handler);
+
+        void rethrowError();
+
+        const std::size_t mCapacity;
+        const WriteHandler mWrite;
+        const FlushHandler mFlush;
+        const DiscardHandler mDiscard;
+
+        MpscQueue<Point> mQueue;
+        std::atomic<std::size_t> mSize;
+        std::atomic<bool> mStopping;
+        std::atomic<bool> mWorkerWaiting;
+        std::atomic<std::size_t> mBlockedProducers;
+        std::atomic<std::uint64_t> mClearRequested;
+        std::atomic<bool> mWakeRequested;
+
+        mutable std::mutex mMutex;
+        std::condition_variable mWorkAvailable;
+        std::condition_variable mSpaceAvailable;
+        std::condition_variable mCompleted;
+
+        std::uint64_t mClearCompleted;
+        std::uint64_t mFlushRequested;
+        std::uint64_t mFlushCompleted;
+        std::exception_ptr mError;
+
+        std::thread mThread;
+    };
+}
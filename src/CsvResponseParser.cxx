@@ -0,0 +1,392 @@
+// MIT License
+//
+// Copyright (c) 2022 TOSHIBA CORPORATION
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "CsvResponseParser.h"
+#include "InfluxDBException.h"
+#include <charconv>
+#include <cstdint>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace influxdb::internal
+{
+    namespace
+    {
+        [[noreturn]] void throwParseError(const std::string& reason)
+        {
+            throw InfluxDBException("Query", "Parse csv error: " + reason);
+        }
+
+#if defined(__SSE2__)
+        template <char C, char... Cs>
+        __m128i matches(__m128i block)
+        {
+            const __m128i match = _mm_cmpeq_epi8(block, _mm_set1_epi8(C));
+            if constexpr (sizeof...(Cs) == 0)
+            {
+                return match;
+            }
+            else
+            {
+                return _mm_or_si128(match, matches<Cs...>(block));
+            }
+        }
+#endif
+
+        /// Returns the first of the characters in [begin, end), end if none is found
+        template <char... Cs>
+        const char* findFirstOf(const char* begin, const char* end)
+        {
+#if defined(__SSE2__)
+            for (; end - begin >= 16; begin += 16)
+            {
+                const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+                if (const int mask = _mm_movemask_epi8(matches<Cs...>(block)); mask != 0)
+                {
+                    return begin + __builtin_ctz(static_cast<unsigned>(mask));
+                }
+            }
+#endif
+            for (; begin != end; ++begin)
+            {
+                if (((*begin == Cs) || ...))
+                {
+                    return begin;
+                }
+            }
+            return end;
+        }
+
+        /// Numbers are written without exponent, like -12.5
+        bool isNumber(std::string_view text)
+        {
+            std::size_t i = (text.front() == '-' ? 1 : 0);
+            bool hasDigits{false};
+            bool hasPoint{false};
+            for (; i < text.size(); ++i)
+            {
+                if (text[i] >= '0' && text[i] <= '9')
+                {
+                    hasDigits = true;
+                }
+                else if (text[i] == '.' && hasDigits && !hasPoint)
+                {
+                    hasPoint = true;
+                    hasDigits = false;
+                }
+                else
+                {
+                    return false;
+                }
+            }
+            return hasDigits;
+        }
+    }
+
+    CsvResponseParser::CsvResponseParser(QueryResultBuilder& builder) : mBuilder(builder)
+    {
+    }
+
+    void CsvResponseParser::feed(std::string_view chunk)
+    {
+        if (mPending.empty())
+        {
+            /// Records are parsed in place, only an incomplete one at the end is copied
+            const auto consumed = parseRecords(chunk, false);
+            mPending.assign(chunk.substr(consumed));
+            return;
+        }
+
+        mPending.append(chunk);
+        const auto consumed = parseRecords(mPending, false);
+        mPending.erase(0, consumed);
+    }
+
+    void CsvResponseParser::finish()
+    {
+        if (parseRecords(mPending, true) < mPending.size())
+        {
+            throwParseError("Unterminated quoted field");
+        }
+        mPending.clear();
+
+        if (mState == State::Error)
+        {
+            throwParseError("Missing error message");
+        }
+        endBlock();
+    }
+
+    std::size_t CsvResponseParser::parseRecords(std::string_view data, bool atEnd)
+    {
+        std::size_t position{0};
+        while (position < data.size())
+        {
+            /// Blocks are separated by empty lines
+            if (data[position] == '\n' || (data[position] == '\r' && position + 1 < data.size() && data[position + 1] == '\n'))
+            {
+                endBlock();
+                position += (data[position] == '\r' ? 2 : 1);
+                continue;
+            }
+
+            const auto next = splitRecord(data, position, atEnd);
+            if (next == std::string_view::npos)
+            {
+                break;
+            }
+            handleRecord();
+            position = next;
+        }
+        return position;
+    }
+
+    std::size_t CsvResponseParser::splitRecord(std::string_view data, std::size_t position, bool atEnd)
+    {
+        mFields.clear();
+        mUnescapedFields.clear();
+        const char* current = data.data() + position;
+        const char* const end = data.data() + data.size();
+
+        for (;;)
+        {
+            if (current != end && *current == '"')
+            {
+                const char* const begin = ++current;
+                std::string* unescaped{nullptr};
+                for (;;)
+                {
+                    const char* const quote = findFirstOf<'"'>(current, end);
+                    if (quote == end || (quote + 1 == end && !atEnd))
+                    {
+                        return std::string_view::npos;
+                    }
+                    if (quote + 1 != end && quote[1] == '"')
+                    {
+                        /// Escaped quote, the field is copied without the escape
+                        if (unescaped == nullptr)
+                        {
+                            unescaped = &mUnescapedFields.emplace_back(begin, quote + 1);
+                        }
+                        else
+                        {
+                            unescaped->append(current, quote + 1);
+                        }
+                        current = quote + 2;
+                        continue;
+                    }
+
+                    if (unescaped == nullptr)
+                    {
+                        mFields.emplace_back(begin, static_cast<std::size_t>(quote - begin));
+                    }
+                    else
+                    {
+                        unescaped->append(current, quote);
+                        mFields.emplace_back(*unescaped);
+                    }
+                    current = quote + 1;
+                    break;
+                }
+            }
+            else
+            {
+                const char* const delimiter = findFirstOf<',', '\n'>(current, end);
+                if (delimiter == end && !atEnd)
+                {
+                    return std::string_view::npos;
+                }
+                std::string_view field{current, static_cast<std::size_t>(delimiter - current)};
+                if (!field.empty() && field.back() == '\r' && delimiter != end)
+                {
+                    field.remove_suffix(1);
+                }
+                mFields.push_back(field);
+                current = delimiter;
+            }
+
+            if (current != end && *current == '\r')
+            {
+                ++current;
+            }
+            if (current == end)
+            {
+                return atEnd ? data.size() : std::string_view::npos;
+            }
+            if (*current == '\n')
+            {
+                return static_cast<std::size_t>(current + 1 - data.data());
+            }
+            if (*current != ',')
+            {
+                throwParseError("Unexpected character after quoted field");
+            }
+            ++current;
+        }
+    }
+
+    void CsvResponseParser::handleRecord()
+    {
+        switch (mState)
+        {
+            case State::Header:
+                handleHeader();
+                break;
+            case State::Rows:
+                handleRow();
+                break;
+            case State::Error:
+                /// Errors of the query are reported as a block of a single column
+                throw InfluxDBException("Query", "ERROR: " + std::string{mFields.front()});
+        }
+    }
+
+    void CsvResponseParser::handleHeader()
+    {
+        if (mFields.size() == 1 && mFields.front() == "error")
+        {
+            mState = State::Error;
+            return;
+        }
+        if (mFields.size() < 2 || mFields[0] != "name" || mFields[1] != "tags")
+        {
+            throw InfluxDBException("Query", "Unsupported csv structure");
+        }
+
+        mColumns.assign(mFields.begin() + 2, mFields.end());
+        mTimeColumn = mColumns.size();
+        for (std::size_t i = 0; i < mColumns.size(); ++i)
+        {
+            if (mColumns[i] == "time")
+            {
+                mTimeColumn = i;
+                break;
+            }
+        }
+
+        mBuilder.beginResult();
+        mBuilder.setStatementId(mBlockCount++);
+        mHasSeries = false;
+        mState = State::Rows;
+    }
+
+    void CsvResponseParser::handleRow()
+    {
+        if (mFields.size() != mColumns.size() + 2)
+        {
+            throw InfluxDBException("Query", "Unsupported csv structure");
+        }
+
+        if (!mHasSeries || mFields[0] != mSeriesName || mFields[1] != mSeriesTags)
+        {
+            mBuilder.beginSeries();
+            mBuilder.setName(mFields[0]);
+            addTags(mFields[1]);
+            for (const auto& column : mColumns)
+            {
+                mBuilder.addColumn(column);
+            }
+            mSeriesName = mFields[0];
+            mSeriesTags = mFields[1];
+            mHasSeries = true;
+        }
+
+        mBuilder.beginRow();
+        for (std::size_t i = 2; i < mFields.size(); ++i)
+        {
+            addValue(mFields[i], i - 2 == mTimeColumn);
+        }
+        mBuilder.endRow();
+    }
+
+    void CsvResponseParser::addValue(std::string_view text, bool isTime)
+    {
+        using ValueType = QueryResultBuilder::ValueType;
+
+        if (text.empty())
+        {
+            mBuilder.addValue(ValueType::Null, {});
+        }
+        else if (std::int64_t nanoseconds{0};
+                 isTime && std::from_chars(text.data(), text.data() + text.size(), nanoseconds).ptr == text.data() + text.size())
+        {
+            mBuilder.addTime(nanoseconds);
+        }
+        else if (text == "true" || text == "false")
+        {
+            mBuilder.addValue(ValueType::Boolean, text);
+        }
+        else
+        {
+            mBuilder.addValue(isNumber(text) ? ValueType::Number : ValueType::String, text);
+        }
+    }
+
+    void CsvResponseParser::addTags(std::string_view tags)
+    {
+        /// Tags are written like the series key of line protocol, host=a,region=eu
+        std::string key;
+        std::string value;
+        std::string* current = &key;
+        for (std::size_t i = 0; i < tags.size(); ++i)
+        {
+            const char c = tags[i];
+            if (c == '\\' && i + 1 < tags.size() && (tags[i + 1] == ',' || tags[i + 1] == '=' || tags[i + 1] == ' '))
+            {
+                current->push_back(tags[++i]);
+            }
+            else if (c == '=' && current == &key)
+            {
+                current = &value;
+            }
+            else if (c == ',')
+            {
+                mBuilder.addTag(key, value);
+                key.clear();
+                value.clear();
+                current = &key;
+            }
+            else
+            {
+                current->push_back(c);
+            }
+        }
+        if (!key.empty())
+        {
+            mBuilder.addTag(key, value);
+        }
+    }
+
+    void CsvResponseParser::endBlock()
+    {
+        if (mState == State::Rows)
+        {
+            mBuilder.endResult(false);
+        }
+        if (mState != State::Error)
+        {
+            mState = State::Header;
+        }
+    }
+}
@@ -0,0 +1,97 @@
+// MIT License
+//
+// Copyright (c) 2022 TOSHIBA CORPORATION
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "QueryResultBuilder.h"
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace influxdb::internal
+{
+    /// \brief Incremental parser of InfluxQL CSV responses
+    ///
+    /// Records are split while the chunks are received, the delimiters of a
+    /// record are searched 16 bytes at once where SSE2 is available. Each block
+    /// of rows below a header is passed as a result, numbered in the order of the
+    /// response, as CSV carries neither statement ids nor errors of statements.
+    /// Values are typed by their text, empty values are null; the time column
+    /// holds nanoseconds since epoch and is passed as timestamp.
+    class CsvResponseParser
+    {
+    public:
+        /// \param builder   receives the elements of the response
+        explicit CsvResponseParser(QueryResultBuilder& builder);
+
+        /// Passes the next chunk of the response
+        /// \throw InfluxDBException   if the response received so far is invalid or reports an error
+        void feed(std::string_view chunk);
+
+        /// Ends the response
+        /// \throw InfluxDBException   if the response is invalid
+        void finish();
+
+    private:
+        enum class State
+        {
+            Header,
+            Rows,
+            Error
+        };
+
+        /// Parses the complete records of the data, returns the number of bytes consumed
+        std::size_t parseRecords(std::string_view data, bool atEnd);
+
+        /// Splits the record starting at position into fields, returns the position
+        /// after it or npos if the record is incomplete
+        std::size_t splitRecord(std::string_view data, std::size_t position, bool atEnd);
+
+        void handleRecord();
+        void handleHeader();
+        void handleRow();
+        void addValue(std::string_view text, bool isTime);
+        void addTags(std::string_view tags);
+        void endBlock();
+
+        QueryResultBuilder& mBuilder;
+        State mState{State::Header};
+
+        /// Incomplete record of the previous chunks
+        std::string mPending;
+
+        /// Fields of the current record
+        std::vector<std::string_view> mFields;
+
+        /// Fields of the current record with escaped quotes removed
+        std::deque<std::string> mUnescapedFields;
+
+        std::vector<std::string> mColumns;
+        std::size_t mTimeColumn{0};
+        int mBlockCount{0};
+        bool mHasSeries{false};
+        std::string mSeriesName;
+        std::string mSeriesTags;
+    };
+}
@@ -0,0 +1,277 @@
+// MIT License
+//
+// Copyright (c) 2022 TOSHIBA CORPORATION
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "CurlMultiWriter.h"
+#include "InfluxDBException.h"
+#include <algorithm>
+#include <utility>
+
+namespace influxdb::internal
+{
+    namespace
+    {
+        /// Upper bound of waiting for socket activity, new requests wake the thread earlier
+        constexpr int pollTimeoutMs{1000};
+    }
+
+    struct CurlMultiWriter::Request
+    {
+        std::string lines;
+        std::string body;
+        std::string response;
+        curl_slist* headers{nullptr};
+        CURL* handle{nullptr};
+    };
+
+    std::size_t findMiddleLineBreak(std::string_view lines)
+    {
+        const auto position = lines.rfind('\n', lines.size() / 2);
+        return position != std::string_view::npos ? position : lines.find('\n', lines.size() / 2);
+    }
+
+    CurlMultiWriter::CurlMultiWriter(CURL* prototype, std::size_t maxInFlight, Encoder encoder, ResponseHandler responseHandler)
+        : mPrototype(prototype),
+          mMaxInFlight(maxInFlight),
+          mEncoder(std::move(encoder)),
+          mResponseHandler(std::move(responseHandler)),
+          mMulti{nullptr},
+          mSubmitted{},
+          mDeferred{},
+          mErrors{},
+          mInFlight{0},
+          mStopping{false},
+          mActive{},
+          mIdleHandles{},
+          mThread{}
+    {
+        if (mMaxInFlight == 0)
+        {
+            throw InfluxDBException{"CurlMultiWriter", "Maximum number of requests in flight must not be 0"};
+        }
+        mMulti = curl_multi_init();
+        if (mMulti == nullptr)
+        {
+            throw InfluxDBException{"CurlMultiWriter", "Failed to initialize multi handle"};
+        }
+        curl_multi_setopt(mMulti, CURLMOPT_MAX_HOST_CONNECTIONS, static_cast<long>(mMaxInFlight));
+        mThread = std::thread{&CurlMultiWriter::run, this};
+    }
+
+    CurlMultiWriter::~CurlMultiWriter()
+    {
+        {
+            std::lock_guard lock{mMutex};
+            mStopping = true;
+        }
+        curl_multi_wakeup(mMulti);
+        mThread.join();
+
+        for (CURL* handle : mIdleHandles)
+        {
+            curl_easy_cleanup(handle);
+        }
+        curl_multi_cleanup(mMulti);
+    }
+
+    void CurlMultiWriter::send(std::string&& lines)
+    {
+        auto request = createRequest(std::move(lines));
+
+        std::unique_lock lock{mMutex};
+        mSlotAvailable.wait(lock, [this] { return mInFlight < mMaxInFlight; });
+        ++mInFlight;
+        mSubmitted.push_back(std::move(request));
+        lock.unlock();
+        curl_multi_wakeup(mMulti);
+    }
+
+    void CurlMultiWriter::flush()
+    {
+        std::unique_lock lock{mMutex};
+        mCompleted.wait(lock, [this] { return mInFlight == 0 && mDeferred.empty(); });
+
+        if (!mErrors.empty())
+        {
+            auto error = std::move(mErrors.front());
+            mErrors.pop_front();
+            std::rethrow_exception(error);
+        }
+    }
+
+    std::unique_ptr<CurlMultiWriter::Request> CurlMultiWriter::createRequest(std::string&& lines) const
+    {
+        auto request = std::make_unique<Request>();
+        request->headers = mEncoder(lines, request->body);
+        request->lines = std::move(lines);
+        return request;
+    }
+
+    void CurlMultiWriter::run()
+    {
+        while (true)
+        {
+            {
+                std::lock_guard lock{mMutex};
+                startSubmitted();
+
+                if (mStopping && mActive.empty())
+                {
+                    return;
+                }
+            }
+
+            int running{0};
+            curl_multi_perform(mMulti, &running);
+
+            int queued{0};
+            while (CURLMsg* message = curl_multi_info_read(mMulti, &queued))
+            {
+                if (message->msg == CURLMSG_DONE)
+                {
+                    complete(message->easy_handle, message->data.result);
+                }
+            }
+
+            std::unique_lock lock{mMutex};
+            if (mSubmitted.empty())
+            {
+                lock.unlock();
+                curl_multi_poll(mMulti, nullptr, 0, pollTimeoutMs, nullptr);
+            }
+        }
+    }
+
+    void CurlMultiWriter::startSubmitted()
+    {
+        bool failed{false};
+
+        for (auto& request : mSubmitted)
+        {
+            CURL* handle{nullptr};
+            if (mIdleHandles.empty())
+            {
+                handle = curl_easy_duphandle(mPrototype);
+            }
+            else
+            {
+                handle = mIdleHandles.back();
+                mIdleHandles.pop_back();
+            }
+
+            if (handle == nullptr)
+            {
+                mErrors.push_back(std::make_exception_ptr(InfluxDBException{"CurlMultiWriter", "Failed to initialize write handle"}));
+                --mInFlight;
+                failed = true;
+                continue;
+            }
+
+            const std::string& body = (request->body.empty() ? request->lines : request->body);
+            curl_easy_setopt(handle, CURLOPT_HTTPHEADER, request->headers);
+            curl_easy_setopt(handle, CURLOPT_WRITEDATA, &request->response);
+            curl_easy_setopt(handle, CURLOPT_POSTFIELDS, body.data());
+            curl_easy_setopt(handle, CURLOPT_POSTFIELDSIZE, static_cast<long>(body.size()));
+            request->handle = handle;
+            curl_multi_add_handle(mMulti, handle);
+            mActive.push_back(std::move(request));
+        }
+
+        mSubmitted.clear();
+
+        if (failed)
+        {
+            submitDeferred();
+            mSlotAvailable.notify_all();
+            mCompleted.notify_all();
+        }
+    }
+
+    void CurlMultiWriter::complete(CURL* handle, CURLcode result)
+    {
+        long responseCode{0};
+        curl_easy_getinfo(handle, CURLINFO_RESPONSE_CODE, &responseCode);
+        curl_multi_remove_handle(mMulti, handle);
+        mIdleHandles.push_back(handle);
+
+        const auto active = std::find_if(mActive.begin(), mActive.end(), [handle](const auto& request) { return request->handle == handle; });
+        if (active == mActive.end())
+        {
+            return;
+        }
+        auto request = std::move(*active);
+        mActive.erase(active);
+
+        std::exception_ptr error;
+        try
+        {
+            if (result != CURLE_OK || responseCode != 413 || !split(*request))
+            {
+                mResponseHandler(result, responseCode, request->response);
+            }
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+
+        std::lock_guard lock{mMutex};
+        if (error)
+        {
+            mErrors.push_back(error);
+        }
+        --mInFlight;
+        submitDeferred();
+        mSlotAvailable.notify_one();
+        mCompleted.notify_all();
+    }
+
+    void CurlMultiWriter::submitDeferred()
+    {
+        while (!mDeferred.empty() && mInFlight < mMaxInFlight)
+        {
+            ++mInFlight;
+            mSubmitted.push_back(std::move(mDeferred.front()));
+            mDeferred.pop_front();
+        }
+    }
+
+    bool CurlMultiWriter::split(Request& request)
+    {
+        const std::string_view lines{request.lines};
+        const auto position = findMiddleLineBreak(lines);
+        if (position == std::string_view::npos)
+        {
+            return false;
+        }
+
+        auto first = createRequest(std::string{lines.substr(0, position)});
+        auto second = createRequest(std::string{lines.substr(position + 1)});
+
+        /// The halves take the slot of the rejected request once it's completed, and
+        /// further slots as they become available, before new requests of writers
+        std::lock_guard lock{mMutex};
+        mDeferred.push_back(std::move(first));
+        mDeferred.push_back(std::move(second));
+        return true;
+    }
+}
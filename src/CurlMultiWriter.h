@@ -0,0 +1,116 @@
+// MIT License
+//
+// Copyright (c) 2022 TOSHIBA CORPORATION
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#pragma once
+
+#include <curl/curl.h>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace influxdb::internal
+{
+    /// Returns the position of the line break closest to the middle, npos for a single line
+    std::size_t findMiddleLineBreak(std::string_view lines);
+
+    /// \brief Sends write requests concurrently using the CURL multi interface
+    ///
+    /// Requests are performed by a background thread, up to a maximum number
+    /// are in flight at the same time. Errors are reported per request by flush().
+    class CurlMultiWriter
+    {
+    public:
+        /// Encodes the lines into the request body, returns the headers to send;
+        /// the lines are sent as they are if the body is left empty
+        using Encoder = std::function<curl_slist*(std::string_view lines, std::string& body)>;
+        /// Validates the result of a request, throws on failure
+        using ResponseHandler = std::function<void(CURLcode result, long responseCode, const std::string& response)>;
+
+        /// Starts the background thread
+        /// \param prototype    handle configured for writing, requests are performed on duplicates
+        /// \param maxInFlight  maximum number of concurrent requests
+        /// \throw InfluxDBException if maxInFlight is 0 or CURL fails to initialize
+        CurlMultiWriter(CURL* prototype, std::size_t maxInFlight, Encoder encoder, ResponseHandler responseHandler);
+
+        /// Completes requests in flight and stops the background thread
+        ~CurlMultiWriter();
+
+        CurlMultiWriter(const CurlMultiWriter&) = delete;
+        CurlMultiWriter& operator=(const CurlMultiWriter&) = delete;
+
+        /// Starts a request sending the lines, blocks while the maximum number of requests is in flight
+        void send(std::string&& lines);
+
+        /// Waits until all requests are completed
+        /// \throw the error of the oldest failed request not reported yet
+        void flush();
+
+    private:
+        struct Request;
+
+        void run();
+
+        /// Starts requests submitted by send(), requires the mutex
+        void startSubmitted();
+
+        void complete(CURL* handle, CURLcode result);
+
+        /// Submits deferred requests while slots are available, requires the mutex
+        void submitDeferred();
+
+        /// Resends both halves of lines rejected as too large, false if not splittable
+        bool split(Request& request);
+
+        std::unique_ptr<Request> createRequest(std::string&& lines) const;
+
+        CURL* const mPrototype;
+        const std::size_t mMaxInFlight;
+        const Encoder mEncoder;
+        const ResponseHandler mResponseHandler;
+        CURLM* mMulti;
+
+        std::mutex mMutex;
+        std::condition_variable mSlotAvailable;
+        std::condition_variable mCompleted;
+        std::deque<std::unique_ptr<Request>> mSubmitted;
+        /// Halves of split requests waiting for a slot
+        std::deque<std::unique_ptr<Request>> mDeferred;
+        std::deque<std::exception_ptr> mErrors;
+        std::size_t mInFlight;
+        bool mStopping;
+
+        /// Owned by the background thread
+        std::vector<std::unique_ptr<Request>> mActive;
+        std::vector<CURL*> mIdleHandles;
+
+        std::thread mThread;
+    };
+}
@@ -0,0 +1,255 @@
+// MIT License
+//
+// Copyright (c) 2022 TOSHIBA CORPORATION
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "CursorResultBuilder.h"
+#include "InfluxDBException.h"
+#include <algorithm>
+#include <utility>
+
+namespace influxdb::internal
+{
+    namespace
+    {
+        /// Whether consecutive results belong to the same statement, as results of chunks do
+        bool isSameResult(const InfluxDBTable& lhs, const InfluxDBTable& rhs)
+        {
+            return lhs.statementId == rhs.statementId && lhs.error.empty() && rhs.error.empty();
+        }
+
+        bool isSameSeries(const InfluxDBSeries& lhs, const InfluxDBSeries& rhs)
+        {
+            return lhs.name == rhs.name && lhs.tagKeys == rhs.tagKeys && lhs.tagValues == rhs.tagValues
+                && lhs.columnNames == rhs.columnNames;
+        }
+    }
+
+    CursorResultBuilder::CursorResultBuilder(std::size_t maxBufferedRows) : mMaxBufferedRows(maxBufferedRows)
+    {
+    }
+
+    void CursorResultBuilder::beginResult()
+    {
+        mResult = InfluxDBTable{};
+        mSharedResult.reset();
+        mResultBuffered = false;
+    }
+
+    void CursorResultBuilder::setStatementId(int statementId)
+    {
+        mResult.statementId = statementId;
+        mSharedResult.reset();
+    }
+
+    void CursorResultBuilder::setError(std::string_view error)
+    {
+        mResult.error = error;
+        mSharedResult.reset();
+    }
+
+    void CursorResultBuilder::endResult(bool failed)
+    {
+        if (failed)
+        {
+            /// Results of failed statements only consist of the error message
+            mResult.statementId = -1;
+            mResult.series.clear();
+            mSharedResult.reset();
+            push(std::nullopt);
+            return;
+        }
+
+        pushSeriesWithoutRows();
+        if (!mResultBuffered)
+        {
+            push(std::nullopt);
+        }
+    }
+
+    void CursorResultBuilder::beginSeries()
+    {
+        pushSeriesWithoutRows();
+        mResult.series.assign(1, InfluxDBSeries{});
+        mSharedResult.reset();
+        mSeriesBuffered = false;
+    }
+
+    void CursorResultBuilder::setName(std::string_view name)
+    {
+        series().name = name;
+    }
+
+    void CursorResultBuilder::addTag(std::string_view key, std::string_view value)
+    {
+        auto& current = series();
+        current.tagKeys.emplace_back(key);
+        current.tagValues.emplace_back(value);
+    }
+
+    void CursorResultBuilder::addColumn(std::string_view name)
+    {
+        series().columnNames.emplace_back(name);
+    }
+
+    void CursorResultBuilder::beginRow()
+    {
+        mRow.tuple.clear();
+    }
+
+    void CursorResultBuilder::addValue([[maybe_unused]] ValueType type, std::string_view text)
+    {
+        mRow.tuple.emplace_back(text);
+    }
+
+    void CursorResultBuilder::endRow()
+    {
+        push(std::move(mRow));
+        mRow = InfluxDBRow{};
+    }
+
+    void CursorResultBuilder::finish(std::exception_ptr error)
+    {
+        {
+            std::lock_guard lock{mMutex};
+            mEnd = true;
+            mError = std::move(error);
+        }
+        mChanged.notify_all();
+    }
+
+    void CursorResultBuilder::cancel()
+    {
+        {
+            std::lock_guard lock{mMutex};
+            mCancelled = true;
+            mEntries.clear();
+            mBufferedRows = 0;
+        }
+        mChanged.notify_all();
+    }
+
+    bool CursorResultBuilder::isCancelled() const
+    {
+        std::lock_guard lock{mMutex};
+        return mCancelled;
+    }
+
+    std::vector<InfluxDBTable> CursorResultBuilder::fetch(std::size_t maxRows)
+    {
+        if (maxRows == 0)
+        {
+            throw InfluxDBException{__func__, "Number of rows must not be 0"};
+        }
+
+        std::unique_lock lock{mMutex};
+        mRequestedRows = maxRows;
+        mChanged.notify_all();
+        mChanged.wait(lock, [this, maxRows] { return mBufferedRows >= maxRows || mEnd; });
+        mRequestedRows = 0;
+
+        if (mEntries.empty() && mError)
+        {
+            std::rethrow_exception(mError);
+        }
+
+        std::vector<InfluxDBTable> results;
+        const InfluxDBTable* lastResult{nullptr};
+        std::size_t rows{0};
+        while (!mEntries.empty() && rows < maxRows)
+        {
+            auto& entry = mEntries.front();
+            const auto& result = *entry.result;
+
+            /// Entries of the same result share it, others are only compared if of another chunk
+            if (&result != lastResult)
+            {
+                if (results.empty() || !isSameResult(results.back(), result))
+                {
+                    auto& table = results.emplace_back();
+                    table.statementId = result.statementId;
+                    table.error = result.error;
+                }
+                auto& series = results.back().series;
+                if (!result.series.empty() && (series.empty() || !isSameSeries(series.back(), result.series.front())))
+                {
+                    series.push_back(result.series.front());
+                }
+                lastResult = &result;
+            }
+
+            if (entry.row)
+            {
+                results.back().series.back().rows.push_back(std::move(*entry.row));
+                ++rows;
+            }
+            mEntries.pop_front();
+        }
+        mBufferedRows -= rows;
+        lock.unlock();
+        mChanged.notify_all();
+        return results;
+    }
+
+    void CursorResultBuilder::push(std::optional<InfluxDBRow> row)
+    {
+        if (!mSharedResult)
+        {
+            mSharedResult = std::make_shared<const InfluxDBTable>(mResult);
+        }
+        mResultBuffered = true;
+        mSeriesBuffered = true;
+
+        bool isFetchable{false};
+        {
+            std::unique_lock lock{mMutex};
+            if (row)
+            {
+                mChanged.wait(lock, [this] { return mBufferedRows < std::max(mMaxBufferedRows, mRequestedRows) || mCancelled; });
+            }
+            if (mCancelled)
+            {
+                throw InfluxDBException{"Query", "Query cancelled"};
+            }
+
+            mBufferedRows += (row ? 1 : 0);
+            mEntries.push_back(Entry{mSharedResult, std::move(row)});
+            isFetchable = (mRequestedRows > 0 && mBufferedRows >= mRequestedRows);
+        }
+        if (isFetchable)
+        {
+            mChanged.notify_all();
+        }
+    }
+
+    void CursorResultBuilder::pushSeriesWithoutRows()
+    {
+        if (!mResult.series.empty() && !mSeriesBuffered)
+        {
+            push(std::nullopt);
+        }
+    }
+
+    InfluxDBSeries& CursorResultBuilder::series()
+    {
+        mSharedResult.reset();
+        return mResult.series.back();
+    }
+}
@@ -0,0 +1,110 @@
+// MIT License
+//
+// Copyright (c) 2022 TOSHIBA CORPORATION
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "QueryResultBuilder.h"
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace influxdb::internal
+{
+    /// \brief Buffers rows of a response until they are fetched by another thread
+    ///
+    /// Row events block while the maximum number of rows is buffered, which stalls
+    /// the parser and eventually the transfer of the response.
+    class CursorResultBuilder : public QueryResultBuilder
+    {
+    public:
+        /// \param maxBufferedRows   rows buffered ahead of fetch(), raised to the rows requested by it
+        explicit CursorResultBuilder(std::size_t maxBufferedRows);
+
+        void beginResult() override;
+        void setStatementId(int statementId) override;
+        void setError(std::string_view error) override;
+        void endResult(bool failed) override;
+        void beginSeries() override;
+        void setName(std::string_view name) override;
+        void addTag(std::string_view key, std::string_view value) override;
+        void addColumn(std::string_view name) override;
+        void beginRow() override;
+        void addValue(ValueType type, std::string_view text) override;
+        void endRow() override;
+
+        /// Ends the response, an error is thrown by fetch() once the buffered rows are taken
+        void finish(std::exception_ptr error);
+
+        /// Discards the buffered rows, further row events throw
+        void cancel();
+
+        bool isCancelled() const;
+
+        /// Takes up to maxRows rows, blocks until they are buffered or the response ends
+        /// \return results of the rows, empty at the end of the response
+        /// \throw InfluxDBException   if the response failed or maxRows is 0
+        std::vector<InfluxDBTable> fetch(std::size_t maxRows);
+
+    private:
+        /// \brief Buffered row, or a series or result without rows
+        struct Entry
+        {
+            /// Result and at most one series without rows the entry belongs to
+            std::shared_ptr<const InfluxDBTable> result;
+            std::optional<InfluxDBRow> row;
+        };
+
+        /// Buffers an entry of the current result and series
+        void push(std::optional<InfluxDBRow> row);
+
+        /// Buffers the current series if it has no rows
+        void pushSeriesWithoutRows();
+
+        /// Current series, modifications invalidate the shared copy of the result
+        InfluxDBSeries& series();
+
+        const std::size_t mMaxBufferedRows;
+
+        /// State of the parsing thread: the current result without rows, its copy
+        /// shared by the buffered entries, and the current row
+        InfluxDBTable mResult;
+        std::shared_ptr<const InfluxDBTable> mSharedResult;
+        InfluxDBRow mRow;
+        bool mResultBuffered{false};
+        bool mSeriesBuffered{false};
+
+        mutable std::mutex mMutex;
+        std::condition_variable mChanged;
+        std::deque<Entry> mEntries;
+        std::size_t mBufferedRows{0};
+        std::size_t mRequestedRows{0};
+        bool mEnd{false};
+        bool mCancelled{false};
+        std::exception_ptr mError;
+    };
+}
@@ -0,0 +1,66 @@
+// MIT License
+//
+// Copyright (c) 2022 TOSHIBA CORPORATION
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+namespace influxdb::internal
+{
+    /// Splits line protocol into datagrams of up to maxSize bytes on line boundaries, which are passed to
+    /// send(std::string_view). A line exceeding maxSize is passed as a datagram of its own.
+    /// \return number of lines exceeding maxSize
+    template <class Send>
+    std::size_t packDatagrams(std::string_view lines, std::size_t maxSize, Send&& send)
+    {
+        std::size_t oversizeLines{0};
+        while (!lines.empty())
+        {
+            if (lines.front() == '\n')
+            {
+                lines.remove_prefix(1);
+                continue;
+            }
+            if (lines.size() <= maxSize)
+            {
+                send(lines);
+                break;
+            }
+
+            /// The datagram ends before the last newline within maxSize, which is dropped
+            std::size_t end = lines.rfind('\n', maxSize);
+            if (end == std::string_view::npos)
+            {
+                end = lines.find('\n');
+                ++oversizeLines;
+            }
+            if (end > 0)
+            {
+                send(lines.substr(0, end));
+            }
+            lines.remove_prefix(end == std::string_view::npos ? lines.size() : end + 1);
+        }
+        return oversizeLines;
+    }
+}
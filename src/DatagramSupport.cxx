@@ -22,7 +22,7 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
-#include "BoostSupport.h"
+#include "DatagramSupport.h"
 #include "UDP.h"
 #include "UnixSocket.h"
 
@@ -0,0 +1,90 @@
+// MIT License
+//
+// Copyright (c) 2022 TOSHIBA CORPORATION
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "DeadlineTimer.h"
+
+namespace influxdb::internal
+{
+    DeadlineTimer::DeadlineTimer(std::function<void()> callback)
+        : mCallback(std::move(callback)),
+          mDeadline{},
+          mStopping{false},
+          mThread{}
+    {
+        mThread = std::thread{&DeadlineTimer::run, this};
+    }
+
+    DeadlineTimer::~DeadlineTimer()
+    {
+        {
+            std::lock_guard lock{mMutex};
+            mStopping = true;
+        }
+        mChanged.notify_one();
+        mThread.join();
+    }
+
+    void DeadlineTimer::arm(Clock::time_point deadline)
+    {
+        {
+            std::lock_guard lock{mMutex};
+            if (mDeadline && *mDeadline <= deadline)
+            {
+                return;
+            }
+            mDeadline = deadline;
+        }
+        mChanged.notify_one();
+    }
+
+    void DeadlineTimer::disarm()
+    {
+        std::lock_guard lock{mMutex};
+        mDeadline.reset();
+    }
+
+    void DeadlineTimer::run()
+    {
+        std::unique_lock lock{mMutex};
+
+        while (!mStopping)
+        {
+            if (!mDeadline)
+            {
+                mChanged.wait(lock);
+            }
+            else if (Clock::now() < *mDeadline)
+            {
+                mChanged.wait_until(lock, *mDeadline);
+            }
+            else
+            {
+                /// The callback may arm the timer again
+                mDeadline.reset();
+                lock.unlock();
+                mCallback();
+                lock.lock();
+            }
+        }
+    }
+}
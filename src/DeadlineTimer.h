@@ -0,0 +1,66 @@
+// MIT License
+//
+// Copyright (c) 2022 TOSHIBA CORPORATION
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+namespace influxdb::internal
+{
+    /// \brief Runs a callback on a background thread once a deadline is reached
+    class DeadlineTimer
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        /// Starts the background thread
+        explicit DeadlineTimer(std::function<void()> callback);
+
+        /// Stops the background thread, pending deadlines are dropped
+        ~DeadlineTimer();
+
+        DeadlineTimer(const DeadlineTimer&) = delete;
+        DeadlineTimer& operator=(const DeadlineTimer&) = delete;
+
+        /// Schedules the callback, an earlier pending deadline is kept
+        void arm(Clock::time_point deadline);
+
+        /// Drops the pending deadline
+        void disarm();
+
+    private:
+        void run();
+
+        const std::function<void()> mCallback;
+        std::mutex mMutex;
+        std::condition_variable mChanged;
+        std::optional<Clock::time_point> mDeadline;
+        bool mStopping;
+        std::thread mThread;
+    };
+}
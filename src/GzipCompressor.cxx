@@ -0,0 +1,77 @@
+// MIT License
+//
+// Copyright (c) 2022 TOSHIBA CORPORATION
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "GzipCompressor.h"
+#include "InfluxDBException.h"
+#include <zlib.h>
+
+namespace influxdb::internal
+{
+    namespace
+    {
+        /// Window bits selecting the gzip format
+        constexpr int gzipWindowBits{15 + 16};
+        constexpr int memoryLevel{8};
+    }
+
+    struct GzipCompressor::Stream
+    {
+        z_stream zstream{};
+    };
+
+    GzipCompressor::GzipCompressor(int level)
+        : mStream{std::make_unique<Stream>()}
+    {
+        if (level < Z_NO_COMPRESSION || level > Z_BEST_COMPRESSION)
+        {
+            throw InfluxDBException{"GzipCompressor", "Invalid compression level: " + std::to_string(level)};
+        }
+        if (deflateInit2(&mStream->zstream, level, Z_DEFLATED, gzipWindowBits, memoryLevel, Z_DEFAULT_STRATEGY) != Z_OK)
+        {
+            throw InfluxDBException{"GzipCompressor", "Failed to initialize zlib"};
+        }
+    }
+
+    GzipCompressor::~GzipCompressor()
+    {
+        deflateEnd(&mStream->zstream);
+    }
+
+    void GzipCompressor::compress(std::string_view data, std::string& out)
+    {
+        auto& zstream = mStream->zstream;
+        deflateReset(&zstream);
+
+        out.resize(deflateBound(&zstream, static_cast<uLong>(data.size())));
+        zstream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+        zstream.avail_in = static_cast<uInt>(data.size());
+        zstream.next_out = reinterpret_cast<Bytef*>(out.data());
+        zstream.avail_out = static_cast<uInt>(out.size());
+
+        if (deflate(&zstream, Z_FINISH) != Z_STREAM_END)
+        {
+            throw InfluxDBException{"GzipCompressor", "Failed to compress data"};
+        }
+        out.resize(zstream.total_out);
+    }
+}
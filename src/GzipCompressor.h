@@ -0,0 +1,57 @@
+// MIT License
+//
+// Copyright (c) 2022 TOSHIBA CORPORATION
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace influxdb::internal
+{
+    /// \brief Compresses data into gzip format, reusing its zlib state
+    class GzipCompressor
+    {
+    public:
+        /// Default zlib compression level
+        static constexpr int defaultLevel{6};
+
+        /// \param level compression level from 0 (none) to 9 (best)
+        /// \throw InfluxDBException if the level is invalid or zlib fails to initialize
+        explicit GzipCompressor(int level = defaultLevel);
+
+        ~GzipCompressor();
+
+        GzipCompressor(const GzipCompressor&) = delete;
+        GzipCompressor& operator=(const GzipCompressor&) = delete;
+
+        /// Replaces the content of out by the gzip compressed data
+        /// \throw InfluxDBException if compression fails
+        void compress(std::string_view data, std::string& out);
+
+    private:
+        struct Stream;
+        std::unique_ptr<Stream> mStream;
+    };
+}
@@ -29,18 +29,64 @@
 #include "HTTP.h"
 #include "InfluxDBException.h"
 #include "Query.h"
+#include "RejectedLines.h"
+#include <exception>
+#include <utility>
 
 
 namespace influxdb::transports
 {
     namespace
     {
+        constexpr const char* gzipEncodingHeader{"Content-Encoding: gzip"};
+        constexpr const char* messagePackAcceptHeader{"Accept: application/x-msgpack"};
+        constexpr const char* csvAcceptHeader{"Accept: application/csv"};
+
         size_t WriteCallback(void* contents, size_t size, size_t nmemb, void* userp)
         {
             static_cast<std::string*>(userp)->append(static_cast<char*>(contents), size * nmemb);
             return size * nmemb;
         }
 
+        /// Response of a streamed query
+        struct StreamedResponse
+        {
+            CURL* handle;
+            const std::function<void(std::string_view)>& onData;
+            long responseCode{0};
+            /// Body of error responses, which are not streamed
+            std::string errorBody{};
+            std::exception_ptr error{};
+        };
+
+        size_t StreamCallback(void* contents, size_t size, size_t nmemb, void* userp)
+        {
+            auto* response = static_cast<StreamedResponse*>(userp);
+            const std::string_view data{static_cast<char*>(contents), size * nmemb};
+
+            if (response->responseCode == 0)
+            {
+                curl_easy_getinfo(response->handle, CURLINFO_RESPONSE_CODE, &response->responseCode);
+            }
+            if (response->responseCode >= 400)
+            {
+                response->errorBody.append(data);
+                return data.size();
+            }
+
+            try
+            {
+                response->onData(data);
+            }
+            catch (...)
+            {
+                /// Aborts the transfer, exceptions must not pass through curl
+                response->error = std::current_exception();
+                return 0;
+            }
+            return data.size();
+        }
+
         void setConnectionOptions(CURL* handle)
         {
             curl_easy_setopt(handle, CURLOPT_TCP_KEEPIDLE, 120L);
@@ -79,7 +125,77 @@ namespace influxdb::transports
           curl_free(escapedStr);
           return res;
         }
+
+        /// Returns the delay requested by the Retry-After header of the response, zero if none
+        std::chrono::seconds retryAfterOf(CURL* handle)
+        {
+#if LIBCURL_VERSION_NUM >= 0x074200
+            curl_off_t seconds{0};
+            if (curl_easy_getinfo(handle, CURLINFO_RETRY_AFTER, &seconds) == CURLE_OK && seconds > 0)
+            {
+                return std::chrono::seconds{seconds};
+            }
+#else
+            static_cast<void>(handle);
+#endif
+            return std::chrono::seconds::zero();
+        }
+    }
+
+class HTTP::ReadHandle
+{
+public:
+  /// Acquires the primary read handle if it is idle, an additional one otherwise
+  explicit ReadHandle(HTTP &http) : mHttp(http)
+  {
+    std::lock_guard lock{mHttp.mReadMutex};
+    mGeneration = mHttp.mReadHandleGeneration;
+    if (!mHttp.mReadHandleInUse)
+    {
+      mHttp.mReadHandleInUse = true;
+      mHandle = mHttp.readHandle;
+    }
+    else if (!mHttp.mIdleReadHandles.empty())
+    {
+      mHandle = mHttp.mIdleReadHandles.back();
+      mHttp.mIdleReadHandles.pop_back();
     }
+    else
+    {
+      mHandle = mHttp.createConfiguredReadHandle();
+    }
+  }
+
+  ~ReadHandle()
+  {
+    std::lock_guard lock{mHttp.mReadMutex};
+    if (mHandle == mHttp.readHandle)
+    {
+      mHttp.mReadHandleInUse = false;
+    }
+    else if (mGeneration == mHttp.mReadHandleGeneration)
+    {
+      mHttp.mIdleReadHandles.push_back(mHandle);
+    }
+    else
+    {
+      curl_easy_cleanup(mHandle);
+    }
+  }
+
+  ReadHandle(const ReadHandle &) = delete;
+  ReadHandle &operator=(const ReadHandle &) = delete;
+
+  CURL *get() const
+  {
+    return mHandle;
+  }
+
+private:
+  HTTP &mHttp;
+  CURL *mHandle{nullptr};
+  std::uint64_t mGeneration{0};
+};
 
 HTTP::HTTP(const internal::ConnectionInfo &conn)
 {
@@ -92,6 +208,27 @@ HTTP::HTTP(const internal::ConnectionInfo &conn)
 
 HTTP::~HTTP()
 {
+  mMultiWriter.reset();
+  for (CURL *idleHandle : mIdleReadHandles)
+  {
+    curl_easy_cleanup(idleHandle);
+  }
+  if (mWriteHeaders != nullptr)
+  {
+    curl_slist_free_all(mWriteHeaders);
+  }
+  if (mCompressedWriteHeaders != nullptr)
+  {
+    curl_slist_free_all(mCompressedWriteHeaders);
+  }
+  if (mMessagePackReadHeaders != nullptr)
+  {
+    curl_slist_free_all(mMessagePackReadHeaders);
+  }
+  if (mCsvReadHeaders != nullptr)
+  {
+    curl_slist_free_all(mCsvReadHeaders);
+  }
   curl_easy_cleanup(writeHandle);
   curl_easy_cleanup(readHandle);
   curl_global_cleanup();
@@ -137,53 +274,351 @@ void HTTP::initCurlRead(internal::ConnectionInfo conn)
   readHandle = createReadHandle();
 }
 
-std::string HTTP::query(const std::string &query, const InfluxDBParams &params)
+std::string HTTP::queryUrl(const std::string &query, const InfluxDBParams &params) const
 {
-  std::string buffer;
   auto fullUrl = mReadUrl + "&q=" + curl_easy_escape_wrapper(query);
   if (params.size() > 0)
   {
     fullUrl += "&params=" + curl_easy_escape_wrapper(params.toJSON());
   }
-  curl_easy_setopt(readHandle, CURLOPT_URL, fullUrl.c_str());
-  curl_easy_setopt(readHandle, CURLOPT_WRITEDATA, &buffer);
-  const CURLcode response = curl_easy_perform(readHandle);
+  return fullUrl;
+}
+
+CURL *HTTP::createConfiguredReadHandle() const
+{
+  CURL *handle = createReadHandle();
+  if (!mBasicAuth.empty())
+  {
+    curl_easy_setopt(handle, CURLOPT_HTTPAUTH, CURLAUTH_BASIC);
+    curl_easy_setopt(handle, CURLOPT_USERPWD, mBasicAuth.c_str());
+  }
+  if (curl_slist *headers = readHeaders(); headers != nullptr)
+  {
+    curl_easy_setopt(handle, CURLOPT_HTTPHEADER, headers);
+  }
+  return handle;
+}
+
+curl_slist *HTTP::readHeaders() const
+{
+  return mMessagePackReadHeaders != nullptr ? mMessagePackReadHeaders : mWriteHeaders;
+}
+
+curl_slist *HTTP::createHeaders(const char *header) const
+{
+  curl_slist *headers{nullptr};
+  if (!mAuthorizationHeader.empty())
+  {
+    headers = curl_slist_append(headers, mAuthorizationHeader.c_str());
+  }
+  if (header != nullptr)
+  {
+    headers = curl_slist_append(headers, header);
+  }
+  return headers;
+}
+
+void HTTP::replaceHeaders(curl_slist *&headers, const char *header)
+{
+  curl_slist *replaced = std::exchange(headers, createHeaders(header));
+  if (replaced != nullptr)
+  {
+    curl_slist_free_all(replaced);
+  }
+}
+
+void HTTP::discardReadHandles()
+{
+  for (CURL *idleHandle : mIdleReadHandles)
+  {
+    curl_easy_cleanup(idleHandle);
+  }
+  mIdleReadHandles.clear();
+  ++mReadHandleGeneration;
+}
+
+std::string HTTP::query(const std::string &query, const InfluxDBParams &params)
+{
+  std::string buffer;
+  const auto fullUrl = queryUrl(query, params);
+  const ReadHandle handle{*this};
+  curl_easy_setopt(handle.get(), CURLOPT_URL, fullUrl.c_str());
+  curl_easy_setopt(handle.get(), CURLOPT_WRITEDATA, &buffer);
+  const CURLcode response = curl_easy_perform(handle.get());
   long responseCode{0};
-  curl_easy_getinfo(readHandle, CURLINFO_RESPONSE_CODE, &responseCode);
+  curl_easy_getinfo(handle.get(), CURLINFO_RESPONSE_CODE, &responseCode);
   treatCurlResponse(response, responseCode, buffer);
   return buffer;
 }
 
+void HTTP::streamQuery(const std::string &query, const InfluxDBParams &params, const std::function<void(std::string_view)> &onData)
+{
+  performStreamedQuery(queryUrl(query, params), onData);
+}
+
+void HTTP::streamChunkedQuery(const std::string &query, const InfluxDBParams &params, std::size_t chunkSize,
+                              const std::function<void(std::string_view)> &onData)
+{
+  if (chunkSize == 0)
+  {
+    throw InfluxDBException{__func__, "Chunk size must not be 0"};
+  }
+  performStreamedQuery(queryUrl(query, params) + "&chunked=true&chunk_size=" + std::to_string(chunkSize), onData);
+}
+
+void HTTP::streamCsvQuery(const std::string &query, const InfluxDBParams &params, const std::function<void(std::string_view)> &onData)
+{
+  {
+    std::lock_guard lock{mReadMutex};
+    if (mCsvReadHeaders == nullptr)
+    {
+      mCsvReadHeaders = createHeaders(csvAcceptHeader);
+    }
+  }
+  performStreamedQuery(queryUrl(query, params), onData, mCsvReadHeaders);
+}
+
+void HTTP::performStreamedQuery(const std::string &url, const std::function<void(std::string_view)> &onData, curl_slist *headers)
+{
+  const ReadHandle handle{*this};
+  StreamedResponse streamedResponse{handle.get(), onData};
+  curl_easy_setopt(handle.get(), CURLOPT_URL, url.c_str());
+  curl_easy_setopt(handle.get(), CURLOPT_WRITEFUNCTION, StreamCallback);
+  curl_easy_setopt(handle.get(), CURLOPT_WRITEDATA, &streamedResponse);
+  if (headers != nullptr)
+  {
+    curl_easy_setopt(handle.get(), CURLOPT_HTTPHEADER, headers);
+  }
+  const CURLcode response = curl_easy_perform(handle.get());
+  curl_easy_setopt(handle.get(), CURLOPT_WRITEFUNCTION, WriteCallback);
+  if (headers != nullptr)
+  {
+    std::lock_guard lock{mReadMutex};
+    curl_easy_setopt(handle.get(), CURLOPT_HTTPHEADER, readHeaders());
+  }
+
+  if (streamedResponse.error)
+  {
+    std::rethrow_exception(streamedResponse.error);
+  }
+  long responseCode{0};
+  curl_easy_getinfo(handle.get(), CURLINFO_RESPONSE_CODE, &responseCode);
+  treatCurlResponse(response, responseCode, streamedResponse.errorBody);
+}
+
 void HTTP::enableBasicAuth(const std::string &auth)
 {
+  std::scoped_lock lock{mWriteMutex, mReadMutex};
+  /// Concurrent writes duplicate the write handle
+  const auto maxInFlight = stopConcurrentWrites();
   curl_easy_setopt(writeHandle, CURLOPT_HTTPAUTH, CURLAUTH_BASIC);
   curl_easy_setopt(writeHandle, CURLOPT_USERPWD, auth.c_str());
+  startConcurrentWrites(maxInFlight);
+
+  mBasicAuth = auth;
   curl_easy_setopt(readHandle, CURLOPT_HTTPAUTH, CURLAUTH_BASIC);
   curl_easy_setopt(readHandle, CURLOPT_USERPWD, auth.c_str());
+  discardReadHandles();
 }
 
 void HTTP::enableTokenAuth(const std::string &token)
 {
-  struct curl_slist *list = NULL;
-  std::string auth = "Authorization: Token " + token;
-  list = curl_slist_append(list, auth.c_str());
-  curl_easy_setopt(readHandle, CURLOPT_HTTPHEADER, list);
-  curl_easy_setopt(writeHandle, CURLOPT_HTTPHEADER, list);
+  std::scoped_lock lock{mWriteMutex, mReadMutex};
+  /// Requests of concurrent writes use the headers replaced below
+  const auto maxInFlight = stopConcurrentWrites();
+  mAuthorizationHeader = "Authorization: Token " + token;
+
+  /// Headers enabled before are created again to include the token
+  replaceHeaders(mWriteHeaders, nullptr);
+  if (mCompressedWriteHeaders != nullptr)
+  {
+    replaceHeaders(mCompressedWriteHeaders, gzipEncodingHeader);
+  }
+  if (mMessagePackReadHeaders != nullptr)
+  {
+    replaceHeaders(mMessagePackReadHeaders, messagePackAcceptHeader);
+  }
+  if (mCsvReadHeaders != nullptr)
+  {
+    replaceHeaders(mCsvReadHeaders, csvAcceptHeader);
+  }
+  curl_easy_setopt(writeHandle, CURLOPT_HTTPHEADER, mWriteHeaders);
+  startConcurrentWrites(maxInFlight);
+  curl_easy_setopt(readHandle, CURLOPT_HTTPHEADER, readHeaders());
+  discardReadHandles();
+}
+
+void HTTP::enableCompression(int level, std::size_t minimumSize)
+{
+  std::scoped_lock lock{mWriteMutex, mCompressorMutex};
+  mCompressor = std::make_unique<internal::GzipCompressor>(level);
+  mCompressionMinimumSize = minimumSize;
+
+  if (mCompressedWriteHeaders == nullptr)
+  {
+    mCompressedWriteHeaders = createHeaders(gzipEncodingHeader);
+  }
+}
+
+void HTTP::enableMessagePack()
+{
+  std::lock_guard lock{mReadMutex};
+  if (mMessagePackReadHeaders == nullptr)
+  {
+    mMessagePackReadHeaders = createHeaders(messagePackAcceptHeader);
+    curl_easy_setopt(readHandle, CURLOPT_HTTPHEADER, mMessagePackReadHeaders);
+    discardReadHandles();
+  }
+}
+
+void HTTP::setRejectedLineHandler(RejectedLineHandler handler)
+{
+  std::lock_guard lock{mWriteMutex};
+  mRejectedLineHandler = std::move(handler);
+}
+
+void HTTP::enableConcurrentWrites(std::size_t maxInFlight)
+{
+  if (maxInFlight == 0)
+  {
+    throw InfluxDBException{__func__, "Maximum number of requests in flight must not be 0"};
+  }
+  std::lock_guard lock{mWriteMutex};
+  mMultiWriter.reset();
+  startConcurrentWrites(maxInFlight);
+}
+
+std::size_t HTTP::stopConcurrentWrites()
+{
+  if (!mMultiWriter)
+  {
+    return 0;
+  }
+  mMultiWriter->flush();
+  mMultiWriter.reset();
+  return mMaxInFlight;
+}
+
+void HTTP::startConcurrentWrites(std::size_t maxInFlight)
+{
+  if (maxInFlight == 0)
+  {
+    return;
+  }
+  mMultiWriter = std::make_unique<internal::CurlMultiWriter>(
+      writeHandle, maxInFlight,
+      [this](std::string_view lines, std::string &body) { return encode(lines, body); },
+      [this](CURLcode response, long responseCode, const std::string &buffer) { treatCurlResponse(response, responseCode, buffer); });
+  mMaxInFlight = maxInFlight;
+}
+
+void HTTP::flush()
+{
+  std::lock_guard lock{mWriteMutex};
+  if (mMultiWriter)
+  {
+    mMultiWriter->flush();
+  }
 }
 
 void HTTP::send(std::string &&lineprotocol)
 {
+  std::lock_guard lock{mWriteMutex};
+  if (mMultiWriter)
+  {
+    mMultiWriter->send(std::move(lineprotocol));
+    return;
+  }
+  sendLines(lineprotocol);
+}
+
+curl_slist *HTTP::encode(std::string_view lines, std::string &body)
+{
+  std::lock_guard lock{mCompressorMutex};
+  body.clear();
+
+  if (mCompressor && lines.size() >= mCompressionMinimumSize)
+  {
+    mCompressor->compress(lines, body);
+    return mCompressedWriteHeaders;
+  }
+  return mWriteHeaders;
+}
+
+void HTTP::sendLines(std::string_view lines)
+{
+  std::string_view body{lines};
+  if (mCompressor)
+  {
+    curl_easy_setopt(writeHandle, CURLOPT_HTTPHEADER, encode(lines, mCompressedBody));
+    if (!mCompressedBody.empty())
+    {
+      body = mCompressedBody;
+    }
+  }
+
   std::string buffer;
   curl_easy_setopt(writeHandle, CURLOPT_WRITEDATA, &buffer);
-  curl_easy_setopt(writeHandle, CURLOPT_POSTFIELDS, lineprotocol.c_str());
-  curl_easy_setopt(writeHandle, CURLOPT_POSTFIELDSIZE, static_cast<long>(lineprotocol.length()));
+  curl_easy_setopt(writeHandle, CURLOPT_POSTFIELDS, body.data());
+  curl_easy_setopt(writeHandle, CURLOPT_POSTFIELDSIZE, static_cast<long>(body.length()));
   const CURLcode response = curl_easy_perform(writeHandle);
   long responseCode{0};
   curl_easy_getinfo(writeHandle, CURLINFO_RESPONSE_CODE, &responseCode);
-  treatCurlResponse(response, responseCode, buffer);
+
+  if (response == CURLE_OK && responseCode == 413)
+  {
+    /// Body exceeds the server limit, resend both halves split on a line boundary.
+    /// Points are idempotent, so a half sent twice after a failure is harmless.
+    if (const auto split = internal::findMiddleLineBreak(lines); split != std::string_view::npos)
+    {
+      sendLines(lines.substr(0, split));
+      sendLines(lines.substr(split + 1));
+      return;
+    }
+  }
+  if (response == CURLE_OK && (responseCode == 400 || responseCode == 422) && mRejectedLineHandler && recoverRejectedLines(lines, buffer))
+  {
+    return;
+  }
+  const auto retryAfter = (response == CURLE_OK && responseCode == 429) ? retryAfterOf(writeHandle) : std::chrono::seconds::zero();
+  treatCurlResponse(response, responseCode, buffer, retryAfter);
+}
+
+bool HTTP::recoverRejectedLines(std::string_view lines, const std::string &response)
+{
+  const auto error = internal::tryParseErrorMessage(response);
+  const auto split = internal::splitLines(lines);
+  const auto rejected = internal::findRejectedLines(split, error);
+  /// Dropped lines which can't be identified would be lost silently, so the write fails instead
+  if (rejected.lines.empty() || rejected.dropped > rejected.lines.size())
+  {
+    return false;
+  }
+
+  /// Lines of a partial write which weren't rejected are written already
+  std::string remainder;
+  auto next = rejected.lines.begin();
+  for (std::size_t i = 0; i < split.size(); ++i)
+  {
+    if (next != rejected.lines.end() && *next == i)
+    {
+      mRejectedLineHandler(split[i], error);
+      ++next;
+    }
+    else if (!rejected.partialWrite && !split[i].empty())
+    {
+      remainder.append(split[i]).push_back('\n');
+    }
+  }
+  if (!remainder.empty())
+  {
+    remainder.pop_back();
+    sendLines(remainder);
+  }
+  return true;
 }
 
-void HTTP::treatCurlResponse(const CURLcode &response, long responseCode, std::string buffer) const
+void HTTP::treatCurlResponse(const CURLcode &response, long responseCode, std::string buffer, std::chrono::seconds retryAfter) const
 {
   if (response != CURLE_OK)
   {
@@ -195,15 +630,23 @@ void HTTP::treatCurlResponse(const CURLcode &response, long responseCode, std::s
   //
   if (responseCode == 404)
   {
-    throw NonExistentDatabase(__func__, "Nonexistent database: " + internal::parseErrorMessage(buffer));
+    throw NonExistentDatabase(__func__, "Nonexistent database: " + internal::tryParseErrorMessage(buffer));
+  }
+  if (responseCode == 413)
+  {
+    throw PayloadTooLarge(__func__, "Payload too large: " + internal::tryParseErrorMessage(buffer));
+  }
+  if (responseCode == 429)
+  {
+    throw TooManyRequests(__func__, "Too many requests: " + internal::tryParseErrorMessage(buffer), retryAfter);
   }
   if ((responseCode >= 400) && (responseCode < 500))
   {
-    throw BadRequest(__func__, "Bad request: " + internal::parseErrorMessage(buffer));
+    throw BadRequest(__func__, "Bad request: " + internal::tryParseErrorMessage(buffer));
   }
   if (responseCode >= 500)
   {
-    throw ServerError(__func__, "Influx server error: " + internal::parseErrorMessage(buffer));
+    throw ServerError(__func__, "Influx server error: " + internal::tryParseErrorMessage(buffer));
   }
 }
 
@@ -31,14 +31,24 @@
 
 #include "Transport.h"
 #include "ConnectionInfo.h"
+#include "CurlMultiWriter.h"
+#include "GzipCompressor.h"
 #include <curl/curl.h>
+#include <chrono>
+#include <cstdint>
+#include <functional>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <string_view>
+#include <vector>
 
 namespace influxdb::transports
 {
 
-/// \brief HTTP transport
+/// \brief HTTP transport, writes and queries may be issued from different threads
+///
+/// Concurrent queries are performed on additional connections, which are kept for reuse.
 class HTTP : public Transport
 {
 public:
@@ -48,25 +58,62 @@ public:
   /// Default destructor
   ~HTTP() override;
 
-  /// Sends point via HTTP POST
+  /// Sends point via HTTP POST, bodies rejected as too large are split and sent in parts
   ///  \throw InfluxDBException	when CURL fails on POSTing or response code != 200
+  ///  \throw PayloadTooLarge	when a single line exceeds the maximum body size of the server
   void send(std::string &&lineprotocol) override;
 
   /// Queries database
   /// \throw InfluxDBException	when CURL GET fails
   std::string query(const std::string &query, const InfluxDBParams &params = InfluxDBParams()) override;
 
+  /// Queries database, the response is passed to onData while it is received
+  /// \throw InfluxDBException	when CURL GET fails or onData throws
+  void streamQuery(const std::string &query, const InfluxDBParams &params, const std::function<void(std::string_view)> &onData) override;
+
+  /// Queries database for a chunked response, a JSON object of up to chunkSize rows per chunk
+  /// \throw InfluxDBException	when CURL GET fails, onData throws or chunkSize is 0
+  void streamChunkedQuery(const std::string &query, const InfluxDBParams &params, std::size_t chunkSize,
+                          const std::function<void(std::string_view)> &onData) override;
+
+  /// Queries database for a CSV response, supported by InfluxDB 1.8 and later
+  /// \throw InfluxDBException	when CURL GET fails or onData throws
+  void streamCsvQuery(const std::string &query, const InfluxDBParams &params, const std::function<void(std::string_view)> &onData) override;
+
   /// Creates database used at url if it does not exists
   /// \throw InfluxDBException	when CURL POST fails
   void createDatabase() override;
 
-  /// Enable Basic Auth
+  /// Enable Basic Auth, concurrent writes sent before are completed first
   /// \param auth <username>:<password>
+  /// \throw the first error of concurrent writes sent before
   void enableBasicAuth(const std::string &auth);
 
-  /// Enable Token Auth
+  /// Enable Token Auth, concurrent writes sent before are completed first
+  /// \throw the first error of concurrent writes sent before
   void enableTokenAuth(const std::string &token);
 
+  /// Sends up to maxInFlight write requests concurrently on a background thread
+  /// \throw InfluxDBException	if maxInFlight is 0
+  void enableConcurrentWrites(std::size_t maxInFlight) override;
+
+  /// Waits until concurrent write requests are completed
+  /// \throw InfluxDBException	the error of the oldest failed request not reported yet
+  void flush() override;
+
+  /// Enables gzip compression of write requests
+  /// \param level         compression level from 0 (none) to 9 (best)
+  /// \param minimumSize   bodies smaller than this number of bytes are sent uncompressed
+  /// \throw InfluxDBException	if the level is invalid
+  void enableCompression(int level, std::size_t minimumSize) override;
+
+  /// Requests query responses encoded as MessagePack, supported by InfluxDB 1.x
+  void enableMessagePack() override;
+
+  /// Recovers write requests rejected for some of their lines (400 and 422), identified by the error message
+  /// of the server; not applied to concurrent writes
+  void setRejectedLineHandler(RejectedLineHandler handler) override;
+
   /// Get the database name managed by this transport
   [[nodiscard]] std::string databaseName() const;
 
@@ -75,6 +122,9 @@ public:
 
 private:
 
+  /// Read handle acquired for the duration of a query
+  class ReadHandle;
+
   /// Obtain InfluxDB service url from the url passed
   void obtainInfluxServiceUrl(internal::ConnectionInfo conn);
 
@@ -89,18 +139,115 @@ private:
   /// \throw InfluxDBException	if database not specified
   void initCurlRead(internal::ConnectionInfo conn);
 
+  /// Returns the URL of a query
+  std::string queryUrl(const std::string &query, const InfluxDBParams &params) const;
+
+  /// Creates an additional read handle with the authentication and headers of the primary one
+  /// \throw InfluxDBException	if the handle can't be initialized
+  CURL* createConfiguredReadHandle() const;
+
+  /// Returns the headers of query requests
+  curl_slist* readHeaders() const;
+
+  /// Creates a header list of the authorization header of token auth, if enabled, and the header, unless nullptr
+  curl_slist* createHeaders(const char *header) const;
+
+  /// Replaces a header list by a newly created one, freeing the previous list
+  void replaceHeaders(curl_slist *&headers, const char *header);
+
+  /// Cleans up idle additional read handles, busy ones are cleaned up when released
+  void discardReadHandles();
+
+  /// Completes and stops concurrent writes before the write handle or headers they use change,
+  /// returns their maximum number of requests in flight, 0 if disabled; requires the write mutex
+  /// \throw the first error of the completed writes, which are kept running then
+  std::size_t stopConcurrentWrites();
+
+  /// Starts concurrent writes with up to maxInFlight requests, none if 0; requires the write mutex
+  void startConcurrentWrites(std::size_t maxInFlight);
+
+  /// Performs a query, passing the response to onData while it is received
+  /// \param headers   replace the headers of the read handle for this request, unless nullptr
+  void performStreamedQuery(const std::string &url, const std::function<void(std::string_view)> &onData, curl_slist *headers = nullptr);
+
+  /// Sends line protocol, bisecting it on line boundaries if too large
+  void sendLines(std::string_view lines);
+
+  /// Passes the lines rejected by the server to the handler and sends the others again if they weren't written,
+  /// returns false if no line could be identified
+  bool recoverRejectedLines(std::string_view lines, const std::string &response);
+
+  /// Compresses lines into body if enabled and large enough, returns the headers of the request
+  curl_slist* encode(std::string_view lines, std::string &body);
+
   /// treats responses of CURL requests
-  void treatCurlResponse(const CURLcode &response, long responseCode, std::string buffer) const;
+  /// \param retryAfter   delay requested by the server along with 429 responses
+  void treatCurlResponse(const CURLcode &response, long responseCode, std::string buffer,
+                         std::chrono::seconds retryAfter = std::chrono::seconds::zero()) const;
 
   /// CURL pointer configured for writing points
   CURL *writeHandle;
 
+  /// Serializes requests on the write handle
+  std::mutex mWriteMutex;
+
+  /// Authorization header of token auth, empty if disabled
+  std::string mAuthorizationHeader;
+
+  /// Headers of uncompressed write requests, nullptr unless token auth is enabled
+  curl_slist *mWriteHeaders{nullptr};
+
+  /// Headers of compressed write requests
+  curl_slist *mCompressedWriteHeaders{nullptr};
+
+  /// Guards the compression state, which is also used by concurrent writes
+  std::mutex mCompressorMutex;
+
+  /// Compresses write requests, nullptr if compression is disabled
+  std::unique_ptr<internal::GzipCompressor> mCompressor;
+
+  /// Minimum body size of compressed write requests
+  std::size_t mCompressionMinimumSize{0};
+
+  /// Body of the current compressed write request
+  std::string mCompressedBody;
+
+  /// Receives lines rejected by the server, empty if recovery is disabled
+  RejectedLineHandler mRejectedLineHandler;
+
+  /// Performs concurrent write requests, nullptr if disabled
+  std::unique_ptr<internal::CurlMultiWriter> mMultiWriter;
+
+  /// Maximum number of concurrent write requests in flight
+  std::size_t mMaxInFlight{0};
+
   /// InfluxDB write URL
   std::string mWriteUrl;
 
   /// CURL pointer configured for querying
   CURL *readHandle;
 
+  /// Guards the read handles and their configuration
+  std::mutex mReadMutex;
+
+  /// Whether a query is performed on the primary read handle
+  bool mReadHandleInUse{false};
+
+  /// Additional read handles of concurrent queries not in use
+  std::vector<CURL*> mIdleReadHandles;
+
+  /// Incremented on configuration changes, handles of previous generations are not reused
+  std::uint64_t mReadHandleGeneration{0};
+
+  /// Credentials of basic auth, empty if disabled
+  std::string mBasicAuth;
+
+  /// Headers of query requests accepting MessagePack, nullptr if disabled
+  curl_slist *mMessagePackReadHeaders{nullptr};
+
+  /// Headers of query requests accepting CSV, created by the first CSV query
+  curl_slist *mCsvReadHeaders{nullptr};
+
   /// InfluxDB read URL
   std::string mReadUrl;
 
@@ -29,21 +29,92 @@
 #include "InfluxDB.h"
 #include "InfluxDBException.h"
 #include "LineProtocol.h"
-#include "BoostSupport.h"
+#include "DatagramSupport.h"
 #include "Query.h"
+#include "AsyncWriter.h"
+#include "DeadlineTimer.h"
+#include "MemoryBudget.h"
+#include "QueryCache.h"
+#include "Retrier.h"
+#include "Spool.h"
+#include <algorithm>
 #include <iostream>
 #include <memory>
 #include <string>
+#include <utility>
 
 namespace influxdb
 {
+  namespace
+  {
+    /// Serializes points into one newline separated line protocol buffer
+    template <class PointContainer>
+    std::string joinLineProtocol(const std::string &globalTags, const PointContainer &points)
+    {
+      std::string joined;
+
+      for (const auto &point : points)
+      {
+        LineProtocol::formatTo(joined, point, globalTags);
+        joined += '\n';
+      }
+
+      if (!joined.empty())
+      {
+        joined.pop_back();
+      }
+      return joined;
+    }
+
+    /// Minimum time between attempts to send spooled batches, unless flushed
+    constexpr std::chrono::seconds replayInterval{1};
+
+    /// Sends by the function, returns false if the server is unavailable and sending should be retried later
+    template <class Send>
+    bool sendOrDefer(Send &&send)
+    {
+      try
+      {
+        send();
+        return true;
+      }
+      catch (const TooManyRequests &)
+      {
+        return false;
+      }
+      catch (const ConnectionError &)
+      {
+        return false;
+      }
+      catch (const ServerError &)
+      {
+        return false;
+      }
+    }
+  }
 
 InfluxDB::InfluxDB(std::unique_ptr<Transport> transport) :
-  mPointBatch{},
+  mLineProtocolBatch{},
+  mBatchPointCount{0},
   mIsBatchingActivated{false},
   mBatchSize{0},
+  mMaxBatchBytes{0},
+  mBatchReservedBytes{0},
+  mPendingLine{},
   mTransport(std::move(transport)),
-  mGlobalTags{}
+  mGlobalTags{},
+  mMutex{},
+  mMaxLinger{std::chrono::milliseconds::zero()},
+  mBatchStart{},
+  mLingerError{},
+  mQueryCacheMutex{},
+  mQueryCache{},
+  mSpool{},
+  mRetrier{},
+  mNextReplay{},
+  mBudget{},
+  mLingerTimer{},
+  mAsyncWriter{}
 {
   if (mTransport == nullptr)
   {
@@ -51,48 +122,267 @@ InfluxDB::InfluxDB(std::unique_ptr<Transport> transport) :
   }
 }
 
-void InfluxDB::batchOf(std::size_t size)
+InfluxDB::~InfluxDB() = default;
+
+void InfluxDB::batchOf(std::size_t size, std::chrono::milliseconds maxLinger)
 {
+  std::lock_guard lock{mMutex};
   mBatchSize = size;
+  mMaxLinger = maxLinger;
   mIsBatchingActivated = true;
+
+  if (mMaxLinger > std::chrono::milliseconds::zero())
+  {
+    if (!mLingerTimer)
+    {
+      mLingerTimer = std::make_unique<internal::DeadlineTimer>([this] { flushLingeringBatch(); });
+    }
+    if (mBatchPointCount > 0)
+    {
+      mLingerTimer->arm(mBatchStart + mMaxLinger);
+    }
+  }
+}
+
+void InfluxDB::setMaxBatchBytes(std::size_t maxBytes)
+{
+  std::lock_guard lock{mMutex};
+  mMaxBatchBytes = maxBytes;
+}
+
+void InfluxDB::enableQueryCache(std::chrono::milliseconds ttl, std::size_t maxBytes)
+{
+  auto cache = std::make_shared<internal::QueryCache>(ttl, maxBytes);
+  std::lock_guard lock{mQueryCacheMutex};
+  mQueryCache = std::move(cache);
+}
+
+void InfluxDB::clearQueryCache()
+{
+  if (const auto cache = queryCache())
+  {
+    cache->clear();
+  }
+}
+
+QueryCacheStatistics InfluxDB::queryCacheStatistics() const
+{
+  const auto cache = queryCache();
+  return cache ? cache->statistics() : QueryCacheStatistics{};
+}
+
+std::shared_ptr<internal::QueryCache> InfluxDB::queryCache() const
+{
+  std::lock_guard lock{mQueryCacheMutex};
+  return mQueryCache;
+}
+
+void InfluxDB::enableSpool(const std::string &directory, std::size_t maxBytes)
+{
+  std::lock_guard lock{mMutex};
+  mSpool = std::make_unique<internal::Spool>(directory, maxBytes);
+}
+
+SpoolStatistics InfluxDB::spoolStatistics() const
+{
+  std::lock_guard lock{mMutex};
+  return mSpool ? mSpool->statistics() : SpoolStatistics{};
+}
+
+void InfluxDB::setRetryPolicy(const RetryPolicy &policy)
+{
+  std::lock_guard lock{mMutex};
+  mRetrier = policy.maxRetries > 0 ? std::make_unique<internal::Retrier>(policy) : nullptr;
+}
+
+RetryStatistics InfluxDB::retryStatistics() const
+{
+  /// Not locked, as writers hold the lock while waiting for retries
+  return mRetrier ? mRetrier->statistics() : RetryStatistics{};
+}
+
+void InfluxDB::enableCompression(int level, std::size_t minimumSize)
+{
+  std::lock_guard lock{mMutex};
+  mTransport->enableCompression(level, minimumSize);
+}
+
+void InfluxDB::setRejectedLineHandler(RejectedLineHandler handler)
+{
+  std::lock_guard lock{mMutex};
+  mTransport->setRejectedLineHandler(std::move(handler));
+}
+
+void InfluxDB::enableMessagePack()
+{
+  std::lock_guard lock{mMutex};
+  mTransport->enableMessagePack();
+}
+
+void InfluxDB::setMaxDatagramSize(std::size_t maxSize)
+{
+  std::lock_guard lock{mMutex};
+  mTransport->setMaxDatagramSize(maxSize);
+}
+
+void InfluxDB::enableSegmentationOffload()
+{
+  std::lock_guard lock{mMutex};
+  mTransport->enableSegmentationOffload();
+}
+
+void InfluxDB::setSendBufferSize(std::size_t bytes)
+{
+  std::lock_guard lock{mMutex};
+  mTransport->setSendBufferSize(bytes);
+}
+
+DatagramStatistics InfluxDB::datagramStatistics() const
+{
+  return mTransport->datagramStatistics();
+}
+
+StreamStatistics InfluxDB::streamStatistics() const
+{
+  return mTransport->streamStatistics();
+}
+
+void InfluxDB::enableConcurrentWrites(std::size_t maxInFlight)
+{
+  std::lock_guard lock{mMutex};
+  mTransport->enableConcurrentWrites(maxInFlight);
+}
+
+void InfluxDB::enableAsyncWrites(std::size_t queueCapacity)
+{
+  close();
+  mAsyncWriter = std::make_unique<internal::AsyncWriter>(
+      queueCapacity,
+      [this](std::vector<Point> &&points) {
+        std::lock_guard lock{mMutex};
+        writeQueuedPoints(std::move(points));
+      },
+      [this] {
+        std::lock_guard lock{mMutex};
+        transmitBatch();
+        if (mSpool)
+        {
+          replaySpool(true);
+        }
+        mTransport->flush();
+      },
+      [this](const Point &point) {
+        if (mBudget)
+        {
+          mBudget->release(LineProtocol::estimateSize(point));
+        }
+      });
+}
+
+void InfluxDB::close()
+{
+  if (mAsyncWriter)
+  {
+    auto asyncWriter = std::move(mAsyncWriter);
+    asyncWriter->close();
+  }
+}
+
+void InfluxDB::setBackpressurePolicy(const BackpressurePolicy &policy)
+{
+  std::lock_guard lock{mMutex};
+  if (mAsyncWriter)
+  {
+    /// Writers and the queue use the budget without the lock
+    throw InfluxDBException{__func__, "Backpressure policy must be set before asynchronous writes are enabled"};
+  }
+  mBudget = policy.maxBytes > 0 ? std::make_unique<internal::MemoryBudget>(policy) : nullptr;
+  mBatchReservedBytes = 0;
+  if (mBudget && mBatchPointCount > 0 && mBudget->tryReserve(mLineProtocolBatch.size() + 1))
+  {
+    mBatchReservedBytes = mLineProtocolBatch.size() + 1;
+  }
+}
+
+BackpressureStatistics InfluxDB::backpressureStatistics() const
+{
+  /// Not locked, as writers hold the lock while sending; the budget isn't replaced while asynchronous writes are enabled
+  return mBudget ? mBudget->statistics() : BackpressureStatistics{};
 }
 
 std::size_t InfluxDB::batchSize() const
 {
-  return mPointBatch.size();
+  const std::size_t queued = (mAsyncWriter ? mAsyncWriter->size() : 0);
+  std::lock_guard lock{mMutex};
+  return queued + mBatchPointCount;
 }
 
 void InfluxDB::clearBatch()
 {
-    mPointBatch.clear();
+  if (mAsyncWriter)
+  {
+    mAsyncWriter->clear();
+  }
+  std::lock_guard lock{mMutex};
+  clearPendingBatch();
 }
 
 void InfluxDB::flushBatch()
 {
-  if (mIsBatchingActivated && !mPointBatch.empty())
+  if (mAsyncWriter)
+  {
+    mAsyncWriter->flush();
+  }
+
+  std::lock_guard lock{mMutex};
+  if (!mAsyncWriter)
+  {
+    transmitBatch();
+    if (mSpool)
+    {
+      replaySpool(true);
+    }
+    mTransport->flush();
+  }
+  if (mLingerError)
   {
-    transmit(joinLineProtocolBatch());
-    mPointBatch.clear();
+    std::rethrow_exception(std::exchange(mLingerError, nullptr));
   }
 }
 
-std::string InfluxDB::joinLineProtocolBatch() const
+void InfluxDB::flushLingeringBatch()
 {
-  std::string joinedBatch;
+  std::lock_guard lock{mMutex};
+  if (mBatchPointCount == 0 || mMaxLinger <= std::chrono::milliseconds::zero())
+  {
+    return;
+  }
 
-  LineProtocol formatter{mGlobalTags};
-  for (const auto &point : mPointBatch)
+  const auto now = internal::DeadlineTimer::Clock::now();
+  if (now - mBatchStart < mMaxLinger)
   {
-    joinedBatch += formatter.format(point) + "\n";
+    mLingerTimer->arm(mBatchStart + mMaxLinger);
+    return;
   }
 
-  joinedBatch.erase(std::prev(joinedBatch.end()));
-  return joinedBatch;
+  try
+  {
+    transmitBatch();
+  }
+  catch (...)
+  {
+    /// The batch is kept, retry after another linger period
+    if (!mLingerError)
+    {
+      mLingerError = std::current_exception();
+    }
+    mLingerTimer->arm(now + mMaxLinger);
+  }
 }
 
-
 void InfluxDB::addGlobalTag(std::string_view name, std::string_view value)
 {
+  std::lock_guard lock{mMutex};
   if (!mGlobalTags.empty())
   {
       mGlobalTags += ",";
@@ -104,23 +394,105 @@ void InfluxDB::addGlobalTag(std::string_view name, std::string_view value)
 
 void InfluxDB::transmit(std::string &&point)
 {
-  mTransport->send(std::move(point));
+  if (!mSpool)
+  {
+    send(point);
+    return;
+  }
+
+  /// Spooled batches are sent first to keep the order
+  if (!replaySpool(false) || !sendOrDefer([this, &point] { send(point); }))
+  {
+    mSpool->append(point);
+  }
+}
+
+void InfluxDB::send(std::string &lines)
+{
+  if (!mRetrier)
+  {
+    mTransport->send(std::move(lines));
+    return;
+  }
+
+  /// Transports take the lines only once they're accepted, so failed attempts send them again
+  mRetrier->run([this, &lines] { mTransport->send(std::move(lines)); });
+}
+
+bool InfluxDB::replaySpool(bool force)
+{
+  const auto now = std::chrono::steady_clock::now();
+  if (!mSpool->empty() && !force && now < mNextReplay)
+  {
+    return false;
+  }
+
+  while (!mSpool->empty())
+  {
+    std::string batch{mSpool->front()};
+    bool sent{false};
+    try
+    {
+      /// Spooled batches aren't retried, the spool retries them itself
+      sent = sendOrDefer([this, &batch] { mTransport->send(std::move(batch)); });
+    }
+    catch (const BadRequest &)
+    {
+      /// A rejected batch would block the spool forever
+      mSpool->pop();
+      throw;
+    }
+    if (!sent)
+    {
+      mNextReplay = now + replayInterval;
+      return false;
+    }
+    mSpool->pop();
+  }
+  return true;
 }
 
 void InfluxDB::write(Point &&point)
 {
+  if (mAsyncWriter)
+  {
+    if (!mBudget || reserveQueueMemory(point))
+    {
+      mAsyncWriter->enqueue(std::move(point));
+    }
+    return;
+  }
+
+  std::lock_guard lock{mMutex};
   if (mIsBatchingActivated)
   {
     addPointToBatch(std::move(point));
   }
   else
   {
-    LineProtocol formatter{mGlobalTags};
-    transmit(formatter.format(point));
+    std::string lineProtocol;
+    LineProtocol::formatTo(lineProtocol, point, mGlobalTags);
+    transmit(std::move(lineProtocol));
   }
 }
 
 void InfluxDB::write(std::vector<Point> &&points)
+{
+  if (mAsyncWriter)
+  {
+    if (mBudget)
+    {
+      points.erase(std::remove_if(points.begin(), points.end(), [this](const Point &point) { return !reserveQueueMemory(point); }), points.end());
+    }
+    mAsyncWriter->enqueue(std::move(points));
+    return;
+  }
+
+  std::lock_guard lock{mMutex};
+  writePoints(std::move(points));
+}
+
+void InfluxDB::writePoints(std::vector<Point> &&points)
 {
   if (mIsBatchingActivated)
   {
@@ -129,36 +501,305 @@ void InfluxDB::write(std::vector<Point> &&points)
       addPointToBatch(std::move(point));
     }
   }
+  else if (!points.empty())
+  {
+    transmit(joinLineProtocol(mGlobalTags, points));
+  }
+}
+
+void InfluxDB::writeQueuedPoints(std::vector<Point> &&points)
+{
+  if (!mBudget)
+  {
+    writePoints(std::move(points));
+    return;
+  }
+  if (points.empty())
+  {
+    /// Woken by writers waiting for the memory held by the batch
+    transmitBatch();
+    return;
+  }
+
+  /// Queued points keep their memory until their lines are reserved, otherwise
+  /// blocked writers could take it and the points would be dropped
+  std::size_t queuedBytes{0};
+  for (const auto &point : points)
+  {
+    queuedBytes += LineProtocol::estimateSize(point);
+  }
+  try
+  {
+    if (mIsBatchingActivated)
+    {
+      for (auto &&point : points)
+      {
+        const std::size_t bytes = LineProtocol::estimateSize(point);
+        addPointToBatch(std::move(point), true);
+        queuedBytes -= bytes;
+        mBudget->release(bytes);
+      }
+    }
+    else
+    {
+      writePoints(std::move(points));
+    }
+  }
+  catch (...)
+  {
+    mBudget->release(queuedBytes);
+    throw;
+  }
+  mBudget->release(queuedBytes);
+}
+
+void InfluxDB::addPointToBatch(Point &&point, bool queued)
+{
+  if (mMaxBatchBytes == 0 && !mBudget)
+  {
+    startLine();
+    LineProtocol::formatTo(mLineProtocolBatch, point, mGlobalTags);
+    ++mBatchPointCount;
+  }
   else
   {
-    std::string lineProtocol;
-    LineProtocol formatter{mGlobalTags};
+    mPendingLine.clear();
+    LineProtocol::formatTo(mPendingLine, point, mGlobalTags);
 
-    for (const auto &point : points)
+    if (mMaxBatchBytes > 0 && mBatchPointCount > 0 && mLineProtocolBatch.size() + 1 + mPendingLine.size() > mMaxBatchBytes)
     {
-      lineProtocol += formatter.format(point) + "\n";
+      try
+      {
+        transmitBatch();
+      }
+      catch (...)
+      {
+        /// The batch is kept if sending fails, the point is kept along with it
+        addPendingLine(queued);
+        throw;
+      }
     }
+    if (!addPendingLine(queued))
+    {
+      return;
+    }
+  }
 
-    lineProtocol.erase(std::prev(lineProtocol.end()));
-    transmit(std::move(lineProtocol));
+  if (mBatchPointCount >= mBatchSize || (mMaxBatchBytes > 0 && mLineProtocolBatch.size() >= mMaxBatchBytes))
+  {
+    transmitBatch();
+  }
+}
+
+bool InfluxDB::addPendingLine(bool queued)
+{
+  if (mBudget)
+  {
+    /// Lines are reserved with their separator
+    const std::size_t bytes = mPendingLine.size() + 1;
+    if (queued)
+    {
+      mBudget->reserve(bytes);
+    }
+    else if (!reserveBatchMemory(bytes))
+    {
+      return false;
+    }
+    mBatchReservedBytes += bytes;
+  }
+
+  startLine();
+  mLineProtocolBatch += mPendingLine;
+  ++mBatchPointCount;
+  return true;
+}
+
+void InfluxDB::startLine()
+{
+  if (mBatchPointCount > 0)
+  {
+    mLineProtocolBatch += '\n';
+  }
+  else if (mLingerTimer)
+  {
+    mBatchStart = internal::DeadlineTimer::Clock::now();
+    mLingerTimer->arm(mBatchStart + mMaxLinger);
+  }
+}
+
+void InfluxDB::transmitBatch()
+{
+  if (mIsBatchingActivated && mBatchPointCount > 0)
+  {
+    /// Transports take the message only once they've accepted it, so the
+    /// batch is kept if sending fails and cleared once it's sent
+    transmit(std::move(mLineProtocolBatch));
+    clearPendingBatch();
+  }
+}
+
+void InfluxDB::clearPendingBatch()
+{
+  /// Keeps the capacity for the next batch
+  mLineProtocolBatch.clear();
+  mBatchPointCount = 0;
+  if (mBudget)
+  {
+    mBudget->release(std::exchange(mBatchReservedBytes, 0));
+  }
+}
+
+bool InfluxDB::reserveBatchMemory(std::size_t bytes)
+{
+  if (mBudget->tryReserve(bytes))
+  {
+    return true;
+  }
+
+  switch (mBudget->policy().overflow)
+  {
+    case OverflowPolicy::Block:
+      /// Nothing else releases the memory of the batch, so the writer sends it itself
+      mBudget->countBlocked();
+      try
+      {
+        transmitBatch();
+      }
+      catch (...)
+      {
+        mBudget->countTimedOut();
+        throw;
+      }
+      if (mBudget->tryReserve(bytes))
+      {
+        return true;
+      }
+      mBudget->countTimedOut();
+      return false;
+    case OverflowPolicy::Sample:
+      if (!mBudget->sample())
+      {
+        return false;
+      }
+      [[fallthrough]];
+    case OverflowPolicy::DropOldest:
+      if (dropOldestPoints(bytes))
+      {
+        return true;
+      }
+      break;
+    case OverflowPolicy::DropNewest:
+      break;
   }
+  mBudget->countDroppedNewest();
+  return false;
 }
 
-void InfluxDB::addPointToBatch(Point &&point)
+bool InfluxDB::reserveQueueMemory(const Point &point)
 {
-  mPointBatch.emplace_back(std::move(point));
+  const std::size_t bytes = LineProtocol::estimateSize(point);
+  if (mBudget->tryReserve(bytes))
+  {
+    return true;
+  }
 
-  if (mPointBatch.size() >= mBatchSize)
+  switch (mBudget->policy().overflow)
   {
-    flushBatch();
+    case OverflowPolicy::Block:
+      /// Only sending the batch releases its memory, the background thread is woken to send it
+      mAsyncWriter->wake();
+      return mBudget->reserveWithin(bytes);
+    case OverflowPolicy::Sample:
+      if (!mBudget->sample())
+      {
+        return false;
+      }
+      [[fallthrough]];
+    case OverflowPolicy::DropOldest:
+    {
+      /// Writers don't wait for the batch while it's sent
+      std::unique_lock lock{mMutex, std::try_to_lock};
+      if (lock.owns_lock() && dropOldestPoints(bytes))
+      {
+        return true;
+      }
+      break;
+    }
+    case OverflowPolicy::DropNewest:
+      break;
   }
+  mBudget->countDroppedNewest();
+  return false;
+}
+
+bool InfluxDB::dropOldestPoints(std::size_t bytes)
+{
+  while (!mBudget->tryReserve(bytes))
+  {
+    const auto excess = mBudget->excess(bytes);
+    if (excess == 0)
+    {
+      /// Memory was released concurrently
+      continue;
+    }
+    if (mBatchPointCount == 0 || excess > mBatchReservedBytes)
+    {
+      return false;
+    }
+
+    /// Whole lines are dropped, each one reserved with its separator
+    const auto end = mLineProtocolBatch.find('\n', excess - 1);
+    if (end == std::string::npos)
+    {
+      mBudget->countDroppedOldest(mBatchPointCount);
+      clearPendingBatch();
+      continue;
+    }
+    const auto dropped = static_cast<std::size_t>(std::count(mLineProtocolBatch.begin(), mLineProtocolBatch.begin() + static_cast<std::ptrdiff_t>(end) + 1, '\n'));
+    mLineProtocolBatch.erase(0, end + 1);
+    mBatchPointCount -= dropped;
+    mBatchReservedBytes -= end + 1;
+    mBudget->release(end + 1);
+    mBudget->countDroppedOldest(dropped);
+  }
+  return true;
 }
 
 std::vector<InfluxDBTable> InfluxDB::query(const std::string &query, const InfluxDBParams &params)
 {
+    if (const auto cache = queryCache())
+    {
+        std::string key{query};
+        key.append(1, '\0').append(params.toJSON());
+        return cache->get(key, [this, &query, &params] { return internal::queryImpl(mTransport.get(), query, params); });
+    }
     return internal::queryImpl(mTransport.get(), query, params);
 }
 
+std::vector<InfluxDBColumnarTable> InfluxDB::queryColumnar(const std::string &query, const InfluxDBParams &params)
+{
+    return internal::queryColumnarImpl(mTransport.get(), query, params);
+}
+
+std::vector<InfluxDBTable> InfluxDB::queryCsv(const std::string &query, const InfluxDBParams &params)
+{
+    return internal::queryCsvImpl(mTransport.get(), query, params);
+}
+
+std::vector<InfluxDBTable> InfluxDB::queryTimeRange(const std::string &query, std::chrono::system_clock::time_point start,
+                                                    std::chrono::system_clock::time_point end, std::size_t parts, const InfluxDBParams &params)
+{
+    using std::chrono::duration_cast;
+    using std::chrono::nanoseconds;
+    return internal::queryTimeRangeImpl(mTransport.get(), query, duration_cast<nanoseconds>(start.time_since_epoch()).count(),
+                                        duration_cast<nanoseconds>(end.time_since_epoch()).count(), parts, params);
+}
+
+std::unique_ptr<InfluxDBQueryCursor> InfluxDB::openQuery(const std::string &query, const InfluxDBParams &params, std::size_t chunkSize)
+{
+    return std::make_unique<InfluxDBQueryCursor>(*mTransport, query, params, chunkSize);
+}
+
 void InfluxDB::createDatabaseIfNotExists()
 {
   try
@@ -33,8 +33,9 @@
 #include <map>
 #include "UriParser.h"
 #include "HTTP.h"
+#include "TCP.h"
 #include "InfluxDBException.h"
-#include "BoostSupport.h"
+#include "DatagramSupport.h"
 #include "ConnectionInfo.h"
 
 namespace influxdb
@@ -57,6 +58,11 @@ namespace influxdb
             return transport;
         }
 
+        std::unique_ptr<Transport> withTcpTransport(const std::string &hostname, int port)
+        {
+            return std::make_unique<transports::TCP>(hostname, port);
+        }
+
         std::unique_ptr<Transport> GetTransport(const ConnectionInfo &conn)
         {
             auto urlCopy = conn.host;
@@ -77,6 +83,11 @@ namespace influxdb
                 /// Support InfluxDB v1 only
                 return withUdpTransport(parsedUrl.path, conn.port);
             }
+            else if (conn.dbVersion == 1 && parsedUrl.protocol == "tcp")
+            {
+                /// Support InfluxDB v1 only
+                return withTcpTransport(parsedUrl.host, conn.port);
+            }
             else if (conn.dbVersion == 1 && parsedUrl.protocol == "unix")
             {
                 /// Support InfluxDB v1 only
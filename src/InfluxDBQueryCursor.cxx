@@ -0,0 +1,72 @@
+// MIT License
+//
+// Copyright (c) 2022 TOSHIBA CORPORATION
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "InfluxDBQueryCursor.h"
+#include "CursorResultBuilder.h"
+#include "InfluxDBException.h"
+#include "QueryResponseParser.h"
+#include <exception>
+
+namespace influxdb
+{
+    InfluxDBQueryCursor::InfluxDBQueryCursor(Transport& transport, const std::string& query, const InfluxDBParams& params, std::size_t chunkSize)
+        : mBuilder(std::make_unique<internal::CursorResultBuilder>(chunkSize))
+    {
+        if (chunkSize == 0)
+        {
+            throw InfluxDBException{__func__, "Chunk size must not be 0"};
+        }
+
+        mThread = std::thread{[this, &transport, query, params, chunkSize] {
+            std::exception_ptr error;
+            try
+            {
+                internal::QueryResponseParser parser{*mBuilder};
+                auto onData = [this, &parser](std::string_view chunk) {
+                    if (mBuilder->isCancelled())
+                    {
+                        throw InfluxDBException{"Query", "Query cancelled"};
+                    }
+                    parser.feed(chunk);
+                };
+                transport.streamChunkedQuery(query, params, chunkSize, onData);
+                parser.finish();
+            }
+            catch (...)
+            {
+                error = std::current_exception();
+            }
+            mBuilder->finish(error);
+        }};
+    }
+
+    InfluxDBQueryCursor::~InfluxDBQueryCursor()
+    {
+        mBuilder->cancel();
+        mThread.join();
+    }
+
+    std::vector<InfluxDBTable> InfluxDBQueryCursor::fetch(std::size_t maxRows)
+    {
+        return mBuilder->fetch(maxRows);
+    }
+}
@@ -21,19 +21,129 @@
 // SOFTWARE.
 
 #include "LineProtocol.h"
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
 
 namespace influxdb
 {
     namespace
     {
-        void appendIfNotEmpty(std::string& dest, const std::string& value, char separator)
+        /// Escape for tag keys, tag values and field keys
+        void appendEscapedKey(std::string& out, std::string_view key)
         {
-            if (!value.empty())
+            for (char c : key)
             {
-                dest.append(std::string{separator}).append(value);
+                switch (c)
+                {
+                    case ',':
+                    case '=':
+                    case ' ':
+                        out += '\\';
+                        break;
+                }
+                out += c;
+            }
+        }
+
+        /// Escape for measurement name
+        void appendEscapedMeasurement(std::string& out, std::string_view name)
+        {
+            for (char c : name)
+            {
+                switch (c)
+                {
+                    case ',':
+                    case ' ':
+                        out += '\\';
+                        break;
+                }
+                out += c;
+            }
+        }
+
+        /// Escape for string field, string field must be in double quotes
+        void appendEscapedStringValue(std::string& out, std::string_view value)
+        {
+            out += '"';
+            for (char c : value)
+            {
+                switch (c)
+                {
+                    case '\\':
+                    case '"':
+                        out += '\\';
+                        break;
+                }
+                out += c;
+            }
+            out += '"';
+        }
+
+        void appendInteger(std::string& out, long long value)
+        {
+            char buffer[24];
+            const auto result = std::to_chars(std::begin(buffer), std::end(buffer), value);
+            out.append(buffer, result.ptr);
+        }
+
+        /// Appends the shortest representation which parses back to the same value
+        void appendShortestDouble(std::string& out, double value)
+        {
+            char buffer[32];
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+            const auto result = std::to_chars(std::begin(buffer), std::end(buffer), value);
+            out.append(buffer, result.ptr);
+#else
+            /// No floating point to_chars() available, find the lowest round-trip precision
+            for (int precision = std::numeric_limits<double>::digits10; precision <= std::numeric_limits<double>::max_digits10; ++precision)
+            {
+                const int length = std::snprintf(buffer, sizeof(buffer), "%.*g", precision, value);
+                if (precision == std::numeric_limits<double>::max_digits10 || std::strtod(buffer, nullptr) == value)
+                {
+                    out.append(buffer, static_cast<std::size_t>(length));
+                    return;
+                }
+            }
+#endif
+        }
+
+        void appendFixedDouble(std::string& out, double value, int precision)
+        {
+            char buffer[128];
+            const int length = std::snprintf(buffer, sizeof(buffer), "%.*f", precision, value);
+
+            if (length < 0)
+            {
+                return;
+            }
+            if (static_cast<std::size_t>(length) < sizeof(buffer))
+            {
+                out.append(buffer, static_cast<std::size_t>(length));
+                return;
+            }
+
+            /// Large magnitudes don't fit into the stack buffer, print directly into the output
+            const auto offset = out.size();
+            out.resize(offset + static_cast<std::size_t>(length) + 1);
+            std::snprintf(&out[offset], static_cast<std::size_t>(length) + 1, "%.*f", precision, value);
+            out.resize(offset + static_cast<std::size_t>(length));
+        }
+
+        void appendDouble(std::string& out, double value)
+        {
+            if (Point::floatsPrecision < 0)
+            {
+                appendShortestDouble(out, value);
+            }
+            else
+            {
+                appendFixedDouble(out, value, Point::floatsPrecision);
             }
         }
     }
+
     LineProtocol::LineProtocol()
         : LineProtocol(std::string{})
     {
@@ -46,12 +156,91 @@ namespace influxdb
 
     std::string LineProtocol::format(const Point& point) const
     {
-        std::string line{point.getName()};
-        appendIfNotEmpty(line, globalTags, ',');
-        appendIfNotEmpty(line, point.getTags(), ',');
-        appendIfNotEmpty(line, point.getFields(), ' ');
+        std::string line;
+        formatTo(line, point);
+        return line;
+    }
+
+    void LineProtocol::formatTo(std::string& out, const Point& point) const
+    {
+        formatTo(out, point, globalTags);
+    }
+
+    void LineProtocol::formatTo(std::string& out, const Point& point, std::string_view globalTags)
+    {
+        appendName(out, point);
+
+        if (!globalTags.empty())
+        {
+            out += ',';
+            out += globalTags;
+        }
+        appendTags(out, point);
+
+        if (!point.mFields.empty())
+        {
+            out += ' ';
+            appendFields(out, point);
+        }
+
+        out += ' ';
+        appendInteger(out, std::chrono::duration_cast<std::chrono::nanoseconds>(point.getTimestamp().time_since_epoch()).count());
+    }
+
+    std::size_t LineProtocol::estimateSize(const Point& point)
+    {
+        constexpr std::size_t inlineCapacity{Point::inlineCapacity};
+        const std::size_t overflowTags = point.mTags.size() > inlineCapacity ? point.mTags.size() - inlineCapacity : 0;
+        const std::size_t overflowFields = point.mFields.size() > inlineCapacity ? point.mFields.size() - inlineCapacity : 0;
+        return sizeof(Point) + point.mMeasurement.capacity() + point.mArena.capacity()
+               + overflowTags * sizeof(Point::Tag) + overflowFields * sizeof(Point::Field);
+    }
+
+    void LineProtocol::appendName(std::string& out, const Point& point)
+    {
+        appendEscapedMeasurement(out, point.mMeasurement);
+    }
+
+    void LineProtocol::appendTags(std::string& out, const Point& point)
+    {
+        for (std::size_t i = 0; i < point.mTags.size(); ++i)
+        {
+            const auto& tag = point.mTags[i];
+            out += ',';
+            appendEscapedKey(out, point.fromArena(tag.offset, tag.keyLength));
+            out += '=';
+            appendEscapedKey(out, point.fromArena(tag.offset + tag.keyLength, tag.valueLength));
+        }
+    }
 
-        return line.append(" ")
-            .append(std::to_string(std::chrono::duration_cast<std::chrono::nanoseconds>(point.getTimestamp().time_since_epoch()).count()));
+    void LineProtocol::appendFields(std::string& out, const Point& point)
+    {
+        for (std::size_t i = 0; i < point.mFields.size(); ++i)
+        {
+            const auto& field = point.mFields[i];
+            if (i > 0)
+            {
+                out += ',';
+            }
+
+            appendEscapedKey(out, point.fromArena(field.offset, field.keyLength));
+            out += '=';
+            switch (field.type)
+            {
+                case Point::Field::Type::Boolean:
+                    out += (field.value.boolean ? "true" : "false");
+                    break;
+                case Point::Field::Type::Integer:
+                    appendInteger(out, field.value.integer);
+                    out += 'i';
+                    break;
+                case Point::Field::Type::Double:
+                    appendDouble(out, field.value.floating);
+                    break;
+                case Point::Field::Type::String:
+                    appendEscapedStringValue(out, point.fromArena(field.offset + field.keyLength, field.value.stringLength));
+                    break;
+            }
+        }
     }
 }
@@ -23,6 +23,9 @@
 #pragma once
 
 #include "Point.h"
+#include <cstddef>
+#include <string>
+#include <string_view>
 
 namespace influxdb
 {
@@ -34,6 +37,24 @@ namespace influxdb
 
         std::string format(const Point& point) const;
 
+        /// Appends the line of the point to out (without trailing newline)
+        void formatTo(std::string& out, const Point& point) const;
+
+        /// Appends the line of the point with the given global tags to out (without trailing newline)
+        static void formatTo(std::string& out, const Point& point, std::string_view globalTags);
+
+        /// Appends the escaped measurement name of the point
+        static void appendName(std::string& out, const Point& point);
+
+        /// Appends the escaped tags of the point, each one prefixed by ','
+        static void appendTags(std::string& out, const Point& point);
+
+        /// Appends the escaped, comma separated fields of the point
+        static void appendFields(std::string& out, const Point& point);
+
+        /// Returns the estimated memory of a point, including its heap allocations
+        static std::size_t estimateSize(const Point& point);
+
     private:
         std::string globalTags;
     };
@@ -0,0 +1,134 @@
+// MIT License
+//
+// Copyright (c) 2022 TOSHIBA CORPORATION
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "MemoryBudget.h"
+#include "InfluxDBException.h"
+#include <algorithm>
+
+namespace influxdb::internal
+{
+    MemoryBudget::MemoryBudget(const BackpressurePolicy& policy)
+        : mPolicy(policy)
+    {
+        if (policy.maxBytes == 0 || policy.sampleInterval == 0)
+        {
+            throw InfluxDBException{"MemoryBudget", "Memory limit and sample interval must not be 0"};
+        }
+    }
+
+    const BackpressurePolicy& MemoryBudget::policy() const
+    {
+        return mPolicy;
+    }
+
+    bool MemoryBudget::tryReserve(std::size_t bytes)
+    {
+        auto reserved = mReserved.load();
+        do
+        {
+            if (bytes > mPolicy.maxBytes - std::min(reserved, mPolicy.maxBytes))
+            {
+                return false;
+            }
+        } while (!mReserved.compare_exchange_weak(reserved, reserved + bytes));
+        return true;
+    }
+
+    bool MemoryBudget::reserveWithin(std::size_t bytes)
+    {
+        countBlocked();
+        std::unique_lock lock{mMutex};
+        ++mWaiting;
+        const bool reserved = mReleased.wait_for(lock, mPolicy.blockTimeout, [this, bytes] { return tryReserve(bytes); });
+        --mWaiting;
+        if (!reserved)
+        {
+            countTimedOut();
+        }
+        return reserved;
+    }
+
+    void MemoryBudget::reserve(std::size_t bytes)
+    {
+        mReserved += bytes;
+    }
+
+    void MemoryBudget::release(std::size_t bytes)
+    {
+        /// Memory buffered before the limit was set isn't reserved
+        auto reserved = mReserved.load();
+        while (!mReserved.compare_exchange_weak(reserved, reserved - std::min(reserved, bytes)))
+        {
+        }
+
+        if (mWaiting.load() > 0)
+        {
+            /// Waiting writers evaluate the reserved memory while holding the mutex
+            {
+                std::lock_guard lock{mMutex};
+            }
+            mReleased.notify_all();
+        }
+    }
+
+    std::size_t MemoryBudget::excess(std::size_t bytes) const
+    {
+        const auto required = mReserved.load() + bytes;
+        return required > mPolicy.maxBytes ? required - mPolicy.maxBytes : 0;
+    }
+
+    bool MemoryBudget::sample()
+    {
+        if (mSamples.fetch_add(1) % mPolicy.sampleInterval == 0)
+        {
+            return true;
+        }
+        ++mSampledOut;
+        return false;
+    }
+
+    void MemoryBudget::countBlocked()
+    {
+        ++mBlocked;
+    }
+
+    void MemoryBudget::countTimedOut()
+    {
+        ++mTimedOut;
+    }
+
+    void MemoryBudget::countDroppedNewest()
+    {
+        ++mDroppedNewest;
+    }
+
+    void MemoryBudget::countDroppedOldest(std::size_t points)
+    {
+        mDroppedOldest += points;
+    }
+
+    BackpressureStatistics MemoryBudget::statistics() const
+    {
+        return BackpressureStatistics{mBlocked, mTimedOut, mDroppedNewest, mDroppedOldest, mSampledOut, mReserved};
+    }
+}
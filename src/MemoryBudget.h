@@ -0,0 +1,90 @@
+// MIT License
+//
+// Copyright (c) 2022 TOSHIBA CORPORATION
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+
+#include "InfluxDB.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+namespace influxdb::internal
+{
+    /// \brief Memory limit shared by all buffers of points, with counters of the overflow policy
+    ///
+    /// Memory is reserved before data is buffered and released once it's sent or dropped.
+    /// The overflow policy is applied by the owners of the buffers, which are able to drop data.
+    class MemoryBudget
+    {
+    public:
+        /// \throw InfluxDBException   if the limit or the sample interval is 0
+        explicit MemoryBudget(const BackpressurePolicy& policy);
+
+        MemoryBudget(const MemoryBudget&) = delete;
+        MemoryBudget& operator=(const MemoryBudget&) = delete;
+
+        const BackpressurePolicy& policy() const;
+
+        /// Reserves the bytes if they fit into the limit
+        bool tryReserve(std::size_t bytes);
+
+        /// Waits up to the block timeout until the bytes fit into the limit and reserves them
+        bool reserveWithin(std::size_t bytes);
+
+        /// Reserves the bytes even if they exceed the limit, for data that must not be dropped
+        void reserve(std::size_t bytes);
+
+        /// Releases reserved bytes, waking waiting writers
+        void release(std::size_t bytes);
+
+        /// Returns the number of bytes exceeding the limit if the given bytes were reserved
+        std::size_t excess(std::size_t bytes) const;
+
+        /// Returns whether a point written while the memory is exhausted is kept, counts it otherwise
+        bool sample();
+
+        void countBlocked();
+        void countTimedOut();
+        void countDroppedNewest();
+        void countDroppedOldest(std::size_t points);
+
+        BackpressureStatistics statistics() const;
+
+    private:
+        const BackpressurePolicy mPolicy;
+        std::atomic<std::size_t> mReserved{0};
+
+        std::mutex mMutex;
+        std::condition_variable mReleased;
+        std::atomic<std::size_t> mWaiting{0};
+
+        std::atomic<std::uint64_t> mSamples{0};
+        std::atomic<std::uint64_t> mBlocked{0};
+        std::atomic<std::uint64_t> mTimedOut{0};
+        std::atomic<std::uint64_t> mDroppedNewest{0};
+        std::atomic<std::uint64_t> mDroppedOldest{0};
+        std::atomic<std::uint64_t> mSampledOut{0};
+    };
+}
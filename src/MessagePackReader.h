@@ -0,0 +1,341 @@
+// MIT License
+//
+// Copyright (c) 2022 TOSHIBA CORPORATION
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "InfluxDBException.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <string_view>
+
+namespace influxdb::internal
+{
+    /// Returns whether a response starting with the byte is MessagePack, responses are maps
+    inline bool isMessagePack(char first)
+    {
+        const auto byte = static_cast<std::uint8_t>(first);
+        return (byte & 0xf0U) == 0x80U || byte == 0xde || byte == 0xdf;
+    }
+
+    /// \brief Stream of a MessagePackReader over data held in memory
+    class MessagePackStringStream
+    {
+    public:
+        explicit MessagePackStringStream(std::string_view data) : mData(data)
+        {
+        }
+
+        char Take()
+        {
+            return mData[mPosition++];
+        }
+
+        bool AtEnd() const
+        {
+            return mPosition >= mData.size();
+        }
+
+    private:
+        std::string_view mData;
+        std::size_t mPosition{0};
+    };
+
+    /// \brief Decoder of MessagePack values, passed to a SAX handler like the one of rapidjson
+    ///
+    /// Besides the rapidjson events, the handler receives Time(nanoseconds) for timestamps,
+    /// encoded as extension type -1 of the specification or 5 as written by InfluxDB.
+    /// Binary data is passed as string. The stream provides Take() and AtEnd().
+    template <class Stream>
+    class MessagePackReader
+    {
+    public:
+        /// Maximum nesting of arrays and maps
+        static constexpr int maxDepth{64};
+
+        explicit MessagePackReader(Stream& stream) : mStream(stream)
+        {
+        }
+
+        /// Reads a single value
+        /// \throw InfluxDBException   if the value is invalid or the handler returns false
+        template <class Handler>
+        void read(Handler& handler)
+        {
+            readValue(handler, 0);
+        }
+
+    private:
+        [[noreturn]] static void fail(const std::string& reason)
+        {
+            throw InfluxDBException("Query", "Parse msgpack error: " + reason);
+        }
+
+        static void check(bool handled)
+        {
+            if (!handled)
+            {
+                fail("Terminated by handler");
+            }
+        }
+
+        std::uint8_t byte()
+        {
+            if (mStream.AtEnd())
+            {
+                fail("Unexpected end of data");
+            }
+            return static_cast<std::uint8_t>(mStream.Take());
+        }
+
+        /// Reads a big endian unsigned integer of the size
+        std::uint64_t readUnsigned(std::size_t size)
+        {
+            std::uint64_t value{0};
+            for (std::size_t i = 0; i < size; ++i)
+            {
+                value = (value << 8U) | byte();
+            }
+            return value;
+        }
+
+        std::int64_t readSigned(std::size_t size)
+        {
+            const auto value = readUnsigned(size);
+            const unsigned shift = 64U - 8U * static_cast<unsigned>(size);
+            /// Sign extension of the two's complement value
+            return static_cast<std::int64_t>(value << shift) >> shift;
+        }
+
+        std::string_view readBytes(std::size_t size)
+        {
+            mBuffer.resize(size);
+            for (auto& c : mBuffer)
+            {
+                c = static_cast<char>(byte());
+            }
+            return mBuffer;
+        }
+
+        template <class Handler>
+        void readString(Handler& handler, std::size_t size, bool isKey)
+        {
+            const auto text = readBytes(size);
+            const auto length = static_cast<std::uint32_t>(text.size());
+            check(isKey ? handler.Key(text.data(), length, true) : handler.String(text.data(), length, true));
+        }
+
+        template <class Handler>
+        void readArray(Handler& handler, std::uint64_t size, int depth)
+        {
+            check(handler.StartArray());
+            for (std::uint64_t i = 0; i < size; ++i)
+            {
+                readValue(handler, depth + 1);
+            }
+            check(handler.EndArray(static_cast<std::uint32_t>(size)));
+        }
+
+        template <class Handler>
+        void readMap(Handler& handler, std::uint64_t size, int depth)
+        {
+            check(handler.StartObject());
+            for (std::uint64_t i = 0; i < size; ++i)
+            {
+                readKey(handler);
+                readValue(handler, depth + 1);
+            }
+            check(handler.EndObject(static_cast<std::uint32_t>(size)));
+        }
+
+        template <class Handler>
+        void readKey(Handler& handler)
+        {
+            const auto type = byte();
+            if ((type & 0xe0U) == 0xa0U)
+            {
+                return readString(handler, type & 0x1fU, true);
+            }
+            if (type >= 0xd9 && type <= 0xdb)
+            {
+                return readString(handler, readUnsigned(std::size_t{1} << (type - 0xd9U)), true);
+            }
+            fail("Map key is not a string");
+        }
+
+        template <class Handler>
+        void readExtension(Handler& handler, std::size_t size)
+        {
+            const auto type = static_cast<std::int8_t>(byte());
+            std::int64_t seconds{0};
+            std::int64_t nanoseconds{0};
+
+            if (type == 5 && size == 12)
+            {
+                /// Written by InfluxDB: seconds (int64) followed by nanoseconds (uint32)
+                seconds = readSigned(8);
+                nanoseconds = static_cast<std::int64_t>(readUnsigned(4));
+            }
+            else if (type == -1 && size == 4)
+            {
+                seconds = static_cast<std::int64_t>(readUnsigned(4));
+            }
+            else if (type == -1 && size == 8)
+            {
+                const auto value = readUnsigned(8);
+                nanoseconds = static_cast<std::int64_t>(value >> 34U);
+                seconds = static_cast<std::int64_t>(value & 0x3ffffffffULL);
+            }
+            else if (type == -1 && size == 12)
+            {
+                nanoseconds = static_cast<std::int64_t>(readUnsigned(4));
+                seconds = readSigned(8);
+            }
+            else
+            {
+                fail("Unsupported extension type " + std::to_string(type));
+            }
+
+            constexpr std::int64_t nanosecondsPerSecond{1000000000};
+            constexpr std::int64_t maxSeconds{std::numeric_limits<std::int64_t>::max() / nanosecondsPerSecond - 1};
+            if (nanoseconds >= nanosecondsPerSecond || seconds > maxSeconds || seconds < -maxSeconds)
+            {
+                fail("Timestamp out of range");
+            }
+            check(handler.Time(seconds * nanosecondsPerSecond + nanoseconds));
+        }
+
+        template <class Handler>
+        void readValue(Handler& handler, int depth)
+        {
+            if (depth > maxDepth)
+            {
+                fail("Nesting too deep");
+            }
+
+            const auto type = byte();
+            if (type <= 0x7f)
+            {
+                check(handler.Int64(type));
+                return;
+            }
+            if (type >= 0xe0)
+            {
+                check(handler.Int64(static_cast<std::int8_t>(type)));
+                return;
+            }
+            if (type <= 0x8f)
+            {
+                return readMap(handler, type & 0x0fU, depth);
+            }
+            if (type <= 0x9f)
+            {
+                return readArray(handler, type & 0x0fU, depth);
+            }
+            if (type <= 0xbf)
+            {
+                return readString(handler, type & 0x1fU, false);
+            }
+
+            switch (type)
+            {
+                case 0xc0:
+                    check(handler.Null());
+                    break;
+                case 0xc2:
+                case 0xc3:
+                    check(handler.Bool(type == 0xc3));
+                    break;
+                case 0xc4:
+                case 0xc5:
+                case 0xc6:
+                    readString(handler, readUnsigned(std::size_t{1} << (type - 0xc4U)), false);
+                    break;
+                case 0xc7:
+                case 0xc8:
+                case 0xc9:
+                    readExtension(handler, readUnsigned(std::size_t{1} << (type - 0xc7U)));
+                    break;
+                case 0xca:
+                {
+                    const auto bits = static_cast<std::uint32_t>(readUnsigned(4));
+                    float value{0.0F};
+                    std::memcpy(&value, &bits, sizeof(value));
+                    check(handler.Double(value));
+                    break;
+                }
+                case 0xcb:
+                {
+                    const auto bits = readUnsigned(8);
+                    double value{0.0};
+                    std::memcpy(&value, &bits, sizeof(value));
+                    check(handler.Double(value));
+                    break;
+                }
+                case 0xcc:
+                case 0xcd:
+                case 0xce:
+                case 0xcf:
+                {
+                    const auto value = readUnsigned(std::size_t{1} << (type - 0xccU));
+                    check(value <= static_cast<std::uint64_t>(std::numeric_limits<std::int64_t>::max())
+                              ? handler.Int64(static_cast<std::int64_t>(value))
+                              : handler.Uint64(value));
+                    break;
+                }
+                case 0xd0:
+                case 0xd1:
+                case 0xd2:
+                case 0xd3:
+                    check(handler.Int64(readSigned(std::size_t{1} << (type - 0xd0U))));
+                    break;
+                case 0xd4:
+                case 0xd5:
+                case 0xd6:
+                case 0xd7:
+                case 0xd8:
+                    readExtension(handler, std::size_t{1} << (type - 0xd4U));
+                    break;
+                case 0xd9:
+                case 0xda:
+                case 0xdb:
+                    readString(handler, readUnsigned(std::size_t{1} << (type - 0xd9U)), false);
+                    break;
+                case 0xdc:
+                case 0xdd:
+                    readArray(handler, readUnsigned(std::size_t{2} << (type - 0xdcU)), depth);
+                    break;
+                case 0xde:
+                case 0xdf:
+                    readMap(handler, readUnsigned(std::size_t{2} << (type - 0xdeU)), depth);
+                    break;
+                default:
+                    fail("Invalid type " + std::to_string(type));
+            }
+        }
+
+        Stream& mStream;
+        std::string mBuffer;
+    };
+}
@@ -0,0 +1,106 @@
+// MIT License
+//
+// Copyright (c) 2022 TOSHIBA CORPORATION
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#pragma once
+
+#include <atomic>
+#include <optional>
+#include <thread>
+#include <utility>
+
+namespace influxdb::internal
+{
+    /// \brief Unbounded lock-free queue for many producers and a single consumer
+    ///
+    /// Producers link their node with a single atomic exchange, the consumer
+    /// owns the tail. Based on the node based MPSC queue by Dmitry Vyukov.
+    template <class T>
+    class MpscQueue
+    {
+    public:
+        MpscQueue()
+            : mHead{new Node{}},
+              mTail{mHead.load(std::memory_order_relaxed)}
+        {
+        }
+
+        ~MpscQueue()
+        {
+            while (mTail != nullptr)
+            {
+                delete std::exchange(mTail, mTail->next.load(std::memory_order_relaxed));
+            }
+        }
+
+        MpscQueue(const MpscQueue&) = delete;
+        MpscQueue& operator=(const MpscQueue&) = delete;
+
+        /// Appends a value, safe to call from any thread
+        void push(T&& value)
+        {
+            auto* node = new Node{};
+            node->value.emplace(std::move(value));
+            Node* previous = mHead.exchange(node, std::memory_order_seq_cst);
+            previous->next.store(node, std::memory_order_seq_cst);
+        }
+
+        /// Removes the oldest value, consumer thread only
+        std::optional<T> pop()
+        {
+            Node* next = mTail->next.load(std::memory_order_acquire);
+
+            /// A producer may be between exchanging the head and linking its node
+            while (next == nullptr && mHead.load(std::memory_order_acquire) != mTail)
+            {
+                std::this_thread::yield();
+                next = mTail->next.load(std::memory_order_acquire);
+            }
+            if (next == nullptr)
+            {
+                return std::nullopt;
+            }
+
+            std::optional<T> value{std::move(next->value)};
+            next->value.reset();
+            delete std::exchange(mTail, next);
+            return value;
+        }
+
+        /// Returns whether values are available, consumer thread only
+        bool empty() const
+        {
+            return mTail->next.load(std::memory_order_seq_cst) == nullptr && mHead.load(std::memory_order_seq_cst) == mTail;
+        }
+
+    private:
+        struct Node
+        {
+            std::atomic<Node*> next{nullptr};
+            std::optional<T> value{};
+        };
+
+        std::atomic<Node*> mHead;
+        Node* mTail;
+    };
+}
@@ -0,0 +1,166 @@
+// MIT License
+//
+// Copyright (c) 2022 TOSHIBA CORPORATION
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "NativeSocket.h"
+#include "InfluxDBException.h"
+#include <climits>
+#include <string>
+#include <system_error>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace influxdb::internal
+{
+    namespace
+    {
+#ifdef _WIN32
+        constexpr NativeSocket::Handle invalidHandle{INVALID_SOCKET};
+
+        int lastError()
+        {
+            return WSAGetLastError();
+        }
+
+        const std::error_category& errorCategory()
+        {
+            return std::system_category();
+        }
+
+        void closeSocket(NativeSocket::Handle handle)
+        {
+            closesocket(handle);
+            WSACleanup();
+        }
+#else
+        constexpr NativeSocket::Handle invalidHandle{-1};
+
+        int lastError()
+        {
+            return errno;
+        }
+
+        const std::error_category& errorCategory()
+        {
+            return std::generic_category();
+        }
+
+        void closeSocket(NativeSocket::Handle handle)
+        {
+            close(handle);
+        }
+#endif
+    }
+
+    NativeSocket::NativeSocket(int family, int type)
+    {
+#ifdef _WIN32
+        WSADATA data;
+        if (const int error = WSAStartup(MAKEWORD(2, 2), &data); error != 0)
+        {
+            throw InfluxDBException{"socket", std::system_category().message(error)};
+        }
+#endif
+        mHandle = ::socket(family, type, 0);
+        if (mHandle == invalidHandle)
+        {
+            const int error = lastError();
+#ifdef _WIN32
+            WSACleanup();
+#endif
+            throw InfluxDBException{"socket", errorCategory().message(error)};
+        }
+
+#ifdef _WIN32
+        u_long nonBlocking{1};
+        const bool configured = (ioctlsocket(mHandle, FIONBIO, &nonBlocking) == 0);
+#else
+        const bool configured = (fcntl(mHandle, F_SETFD, FD_CLOEXEC) == 0 && fcntl(mHandle, F_SETFL, fcntl(mHandle, F_GETFL) | O_NONBLOCK) == 0);
+#endif
+        if (!configured)
+        {
+            const int error = lastError();
+            closeSocket(mHandle);
+            throw InfluxDBException{"socket", errorCategory().message(error)};
+        }
+    }
+
+    NativeSocket::~NativeSocket()
+    {
+        closeSocket(mHandle);
+    }
+
+    NativeSocket::Handle NativeSocket::handle() const
+    {
+        return mHandle;
+    }
+
+    void NativeSocket::setSendBufferSize(std::size_t bytes)
+    {
+        if (bytes == 0 || bytes > static_cast<std::size_t>(INT_MAX))
+        {
+            throw InfluxDBException{__func__, "Send buffer size must be within 1 and " + std::to_string(INT_MAX) + " bytes"};
+        }
+        const int size = static_cast<int>(bytes);
+        if (setsockopt(mHandle, SOL_SOCKET, SO_SNDBUF, reinterpret_cast<const char*>(&size), sizeof(size)) != 0)
+        {
+            throwLastError(__func__);
+        }
+    }
+
+    bool NativeSocket::sendTo(const char* data, std::size_t size, const sockaddr* address, socklen_t addressLength)
+    {
+#ifdef _WIN32
+        const bool sent = (::sendto(mHandle, data, static_cast<int>(size), 0, address, addressLength) >= 0);
+#else
+        ssize_t result{0};
+        do
+        {
+            result = ::sendto(mHandle, data, size, 0, address, addressLength);
+        } while (result < 0 && errno == EINTR);
+        const bool sent = (result >= 0);
+#endif
+        if (!sent && !wouldBlock())
+        {
+            throwLastError("send");
+        }
+        return sent;
+    }
+
+    bool NativeSocket::wouldBlock()
+    {
+#ifdef _WIN32
+        return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+        return errno == EAGAIN || errno == EWOULDBLOCK;
+#endif
+    }
+
+    void NativeSocket::throwLastError(const char* function)
+    {
+        throw InfluxDBException{function, errorCategory().message(lastError())};
+    }
+}
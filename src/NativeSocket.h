@@ -0,0 +1,78 @@
+// MIT License
+//
+// Copyright (c) 2022 TOSHIBA CORPORATION
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <netinet/in.h>
+#include <sys/socket.h>
+#endif
+
+#include <cstddef>
+
+namespace influxdb::internal
+{
+    /// \brief Non-blocking socket of the operating system, closed on destruction
+    class NativeSocket
+    {
+    public:
+#ifdef _WIN32
+        using Handle = SOCKET;
+#else
+        using Handle = int;
+#endif
+
+        /// Opens a socket of the address family, a datagram socket by default
+        /// \throw InfluxDBException	if the socket can't be opened
+        explicit NativeSocket(int family, int type = SOCK_DGRAM);
+        ~NativeSocket();
+
+        NativeSocket(const NativeSocket&) = delete;
+        NativeSocket& operator=(const NativeSocket&) = delete;
+
+        Handle handle() const;
+
+        /// Sets the size of the send buffer of the kernel, which absorbs bursts of datagrams
+        /// \throw InfluxDBException	if the size is 0 or rejected by the system
+        void setSendBufferSize(std::size_t bytes);
+
+        /// Sends a datagram, returns false if it was dropped as the send buffer is full
+        /// \throw InfluxDBException	if sending fails otherwise
+        bool sendTo(const char* data, std::size_t size, const sockaddr* address, socklen_t addressLength);
+
+        /// Whether the last call failed as it would have blocked
+        static bool wouldBlock();
+
+        /// Throws the error of the last call
+        [[noreturn]] static void throwLastError(const char* function);
+
+    private:
+        Handle mHandle;
+    };
+}
@@ -30,86 +30,21 @@
 #include "LineProtocol.h"
 #include <chrono>
 #include <memory>
-#include <sstream>
-#include <iomanip>
-#include <stdio.h>
 
 namespace influxdb
 {
 
-  namespace
-  {
-    /// Escape for tag keys, tag values and field keys
-    std::string escapeKey(const std::string &key)
-    {
-      std::string ret = {};
-      /// Set the maximum length equal to the length when all characters
-      /// need escaping.
-      ret.reserve(key.length() * 2);
-      for (char c: key)
-      {
-        switch (c)
-        {
-          case ',':
-          case '=':
-          case ' ':
-              ret += '\\';
-          break;
-        }
-        ret += c;
-      }
-      return ret;
-    }
-
-    /// Escape for measurement name
-    std::string escapeMeasurement(const std::string &key)
-    {
-      std::string ret = {};
-      /// Set the maximum length equal to the length when all characters
-      /// need escaping.
-      ret.reserve(key.length() * 2);
-      for (char c: key)
-      {
-        switch (c)
-        {
-          case ',':
-          case ' ':
-              ret += '\\';
-          break;
-        }
-        ret += c;
-      }
-      return ret;
-    }
-
-    /// Escape for string field
-    std::string escapeStringValue(const std::string &value) {
-      std::string ret;
-      /// Set the maximum length equal to the length when all characters
-      /// need escaping. String field must be in double quotes.
-      ret.reserve(value.length() * 2 + 2);
-      ret += '"';
-      for(char c: value)
-      {
-        switch (c)
-        {
-            case '\\':
-            case '\"':
-                ret += '\\';
-                break;
-        }
-        ret += c;
-      }
-      ret += '"';
-      return ret;
-    }
-  }
+namespace
+{
+  /// Arena capacity reserved on first use, fits the keys and values of typical points
+  constexpr std::size_t initialArenaCapacity{128};
 
-template<class... Ts> struct overloaded : Ts... { using Ts::operator()...; };
-template<class... Ts> overloaded(Ts...) -> overloaded<Ts...>;
+  template<class... Ts> struct overloaded : Ts... { using Ts::operator()...; };
+  template<class... Ts> overloaded(Ts...) -> overloaded<Ts...>;
+}
 
 Point::Point(const std::string& measurement) :
-  mMeasurement(measurement), mTimestamp(Point::getCurrentTimestamp()), mTags({}), mFields({})
+  mMeasurement(measurement), mTimestamp(Point::getCurrentTimestamp()), mArena{}, mTags{}, mFields{}
 {
 }
 
@@ -120,9 +55,30 @@ Point&& Point::addField(std::string_view name, const std::variant<bool, int, lon
     return std::move(*this);
   }
 
-  mFields.emplace_back(std::make_pair(name, value));
+  Field field{};
+  field.offset = appendToArena(name);
+  field.keyLength = static_cast<std::uint32_t>(name.size());
+
+  std::visit(overloaded {
+    [&field](bool v) { field.type = Field::Type::Boolean; field.value.boolean = v; },
+    [&field](int v) { field.type = Field::Type::Integer; field.value.integer = v; },
+    [&field](long long int v) { field.type = Field::Type::Integer; field.value.integer = v; },
+    [&field](double v) { field.type = Field::Type::Double; field.value.floating = v; },
+    [this, &field](const std::string& v) {
+        field.type = Field::Type::String;
+        field.value.stringLength = static_cast<std::uint32_t>(v.size());
+        appendToArena(v);
+      },
+    [this, &field](const char *v) {
+        const std::string_view str{v};
+        field.type = Field::Type::String;
+        field.value.stringLength = static_cast<std::uint32_t>(str.size());
+        appendToArena(str);
+      },
+  }, value);
+
+  mFields.push_back(field);
   return std::move(*this);
-
 }
 
 Point&& Point::addTag(std::string_view key, std::string_view value)
@@ -132,10 +88,28 @@ Point&& Point::addTag(std::string_view key, std::string_view value)
     return std::move(*this);
   }
 
-  mTags.emplace_back(std::make_pair(key,value));
+  Tag tag{};
+  tag.offset = appendToArena(key);
+  tag.keyLength = static_cast<std::uint32_t>(key.size());
+  tag.valueLength = static_cast<std::uint32_t>(value.size());
+  appendToArena(value);
+
+  mTags.push_back(tag);
   return std::move(*this);
 }
 
+std::uint32_t Point::appendToArena(std::string_view data)
+{
+  if (mArena.capacity() < initialArenaCapacity)
+  {
+    mArena.reserve(initialArenaCapacity);
+  }
+
+  const auto offset = static_cast<std::uint32_t>(mArena.size());
+  mArena.append(data);
+  return offset;
+}
+
 Point&& Point::setTimestamp(std::chrono::time_point<std::chrono::system_clock> timestamp)
 {
   mTimestamp = timestamp;
@@ -162,7 +136,9 @@ std::string Point::toLineProtocol() const
 
 std::string Point::getName() const
 {
-  return escapeMeasurement(mMeasurement);
+  std::string name;
+  LineProtocol::appendName(name, *this);
+  return name;
 }
 
 std::chrono::time_point<std::chrono::system_clock> Point::getTimestamp() const
@@ -172,50 +148,21 @@ std::chrono::time_point<std::chrono::system_clock> Point::getTimestamp() const
 
 std::string Point::getFields() const
 {
-  std::string fields = "";
-
-  for (const auto& field : mFields)
-  {
-    if (!fields.empty())
-    {
-      fields += ",";
-    }
-
-    fields += escapeKey(field.first) + "=";
-    std::visit(overloaded {
-      [&fields](bool v) { fields += (v == true ? "true" : "false"); },
-      [&fields](int v) { fields += std::to_string(v) + 'i'; },
-      [&fields](long long int v) { fields += std::to_string(v) + 'i'; },
-      [&fields](double v) {
-          char s[128];
-          sprintf(s, "%.*f", floatsPrecision, v);
-          fields += std::string(s);
-        },
-      [&fields](const std::string& v) { fields += escapeStringValue(v); },
-      [&fields](const char *v) { fields += escapeStringValue(std::string(v)); },
-    }, field.second);
-  }
-
+  std::string fields;
+  LineProtocol::appendFields(fields, *this);
   return fields;
 }
 
 std::string Point::getTags() const
 {
-    if (mTags.empty())
-    {
-        return "";
-    }
-
-    std::string tags;
-    for (const auto& tag : mTags)
-    {
-        tags += ",";
-        tags += escapeKey(tag.first);
-        tags += "=";
-        tags += escapeKey(tag.second);
-    }
-
-    return tags.substr(1, tags.size());
+  std::string tags;
+  LineProtocol::appendTags(tags, *this);
+
+  if (!tags.empty())
+  {
+    tags.erase(0, 1);
+  }
+  return tags;
 }
 
 } // namespace influxdb
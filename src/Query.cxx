@@ -21,12 +21,21 @@
 // SOFTWARE.
 
 #include <rapidjson/document.h>
-#include <rapidjson/reader.h>
 #include <rapidjson/stringbuffer.h>
 #include <rapidjson/writer.h>
 #include <rapidjson/error/en.h>
 #include "Query.h"
+#include "CsvResponseParser.h"
+#include "MessagePackReader.h"
+#include "QueryResponseParser.h"
 #include "InfluxDBParams.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <future>
+#include <iterator>
+#include <map>
+#include <unordered_map>
 
 namespace influxdb::internal
 {
@@ -64,139 +73,314 @@ namespace influxdb::internal
 
         }
 
-        /// parse InfluxQL JSON response
-        std::vector<InfluxDBTable> parseJsonResponse(const std::string &response)
+        /// Collects the scalar members of a MessagePack object as text, nested values are skipped
+        class ErrorMembersHandler
         {
-            std::vector<InfluxDBTable> resultSet;
-            rapidjson::Document responseDoc;
+        public:
+            bool Null()
+            {
+                return member({});
+            }
 
-            /// Parse json string to RapidJSON document,
-            /// all numbers are parsed as strings to avoid loss of precision.
-            if (responseDoc.Parse<rapidjson::kParseNumbersAsStringsFlag>(response.c_str()).HasParseError())
-                throw InfluxDBException("Query", "Parse json false: " + responseDoc.GetParseError());
+            bool Bool(bool b)
+            {
+                return member(b ? "true" : "false");
+            }
 
-            if (!responseDoc.IsObject())
-                throw InfluxDBException("Query", "Unsupported json structure");
+            bool Int64(std::int64_t i)
+            {
+                return member(std::to_string(i));
+            }
 
-            if (!responseDoc.HasMember("results"))
-                return resultSet;
+            bool Uint64(std::uint64_t u)
+            {
+                return member(std::to_string(u));
+            }
 
-            /// Results element must be a JSON array
-            auto &results = responseDoc["results"];
-            if (!results.IsArray())
-                throw InfluxDBException("Query", "Unsupported json structure");
+            bool Double(double d)
+            {
+                return member(formatFloat(d));
+            }
 
-            /* Parser result */
-            for (rapidjson::SizeType resultIdx = 0; resultIdx < results.Size(); resultIdx++)
+            bool Time(std::int64_t nanoseconds)
             {
-                InfluxDBTable statementResult;
-                statementResult.series = {};
-                auto &iResult = results[resultIdx];
+                return member(formatTimestamp(nanoseconds));
+            }
 
-                /// Elements of resutls array must be a JSON object
-                if (!iResult.IsObject())
-                    throw InfluxDBException("Query", "Unsupported json structure");
+            bool String(const char* str, std::uint32_t length, [[maybe_unused]] bool copy)
+            {
+                return member(std::string{str, length});
+            }
 
-                /// Get error message if existed
-                if (iResult.HasMember("error"))
+            bool Key(const char* str, std::uint32_t length, [[maybe_unused]] bool copy)
+            {
+                if (mDepth == 1)
                 {
-                    /// Error message existed, do not parse other element.
-                    statementResult.error = jsonToString(&iResult["error"]);
-                    resultSet.push_back(std::move(statementResult));
-                    continue;
+                    mKey.assign(str, length);
                 }
+                return true;
+            }
 
-                /// Get statement ID if existed
-                if (iResult.HasMember("statement_id"))
+            bool StartObject()
+            {
+                return ++mDepth > 0;
+            }
+
+            bool EndObject([[maybe_unused]] std::uint32_t memberCount)
+            {
+                return --mDepth >= 0;
+            }
+
+            bool StartArray()
+            {
+                if (mDepth == 0)
                 {
-                    statementResult.statementId = std::stoi(jsonToString(&iResult["statement_id"]));
+                    throw InfluxDBException("Query", "Unsupported msgpack structure");
                 }
+                return ++mDepth > 0;
+            }
 
-                /// Get series if existed
-                if (iResult.HasMember("series"))
+            bool EndArray([[maybe_unused]] std::uint32_t elementCount)
+            {
+                return --mDepth >= 0;
+            }
+
+            std::map<std::string, std::string> members;
+
+        private:
+            bool member(std::string text)
+            {
+                if (mDepth == 0)
+                {
+                    throw InfluxDBException("Query", "Unsupported msgpack structure");
+                }
+                if (mDepth == 1)
                 {
-                    auto &series = iResult["series"];
-                    /// series must be a JSON array
-                    if (!series.IsArray())
-                        throw InfluxDBException("Query", "Unsupported json structure");
+                    members[mKey] = std::move(text);
+                }
+                return true;
+            }
 
-                    for (rapidjson::SizeType seriesIdx = 0; seriesIdx < series.Size(); seriesIdx++)
-                    {
-                        InfluxDBSeries resultSeries;
-                        auto &iSeries = series[seriesIdx];
-
-                        if (!iSeries.IsObject())
-                            throw InfluxDBException("Query", "Unsupported json structure");
-
-                        /// Get name
-                        if (iSeries.HasMember("name"))
-                            resultSeries.name = jsonToString(&iSeries["name"]);
-
-                        /// get tags
-                        if (iSeries.HasMember("tags"))
-                        {
-                            if (const auto &tags = iSeries["tags"]; tags.IsObject())
-                            {
-                                if (!tags.IsNull())
-                                {
-                                    for (auto iTags = tags.MemberBegin(); iTags != tags.MemberEnd(); iTags++)
-                                    {
-                                        resultSeries.tagKeys.push_back(jsonToString(&iTags->name));
-                                        resultSeries.tagValues.push_back(jsonToString(&iTags->value));
-                                    }
-                                }
-                            }
-                        }
-
-                        /// Get column name
-                        if (iSeries.HasMember("columns"))
-                        {
-                            auto &columns = iSeries["columns"];
-                            std::vector<std::string> colnames;
-                            for (rapidjson::SizeType columnIdx = 0; columnIdx != columns.Size(); ++columnIdx)
-                            {
-                                colnames.push_back(jsonToString(&columns[columnIdx]));
-                            }
-                            resultSeries.columnNames = std::move(colnames);
-                        }
-
-                        /// Get rows value
-                        if (iSeries.HasMember("values"))
-                        {
-                            const auto &values = iSeries["values"];
-                            /// values must be an JSON array
-                            if (!values.IsArray())
-                                throw InfluxDBException("Query", "Unsupported json structure");
-
-                            for (rapidjson::SizeType valuesIdx = 0; valuesIdx < values.Size(); ++valuesIdx)
-                            {
-                                InfluxDBRow row;
-                                auto &iValue = values[valuesIdx];
-                                /// Get a tuple
-                                for (rapidjson::SizeType columnIdx = 0; columnIdx != iValue.Size(); ++columnIdx)
-                                {
-                                    row.tuple.push_back(jsonToString(&iValue[columnIdx]));
-                                }
-                                resultSeries.rows.push_back(std::move(row));
-                            }
-                        }
-                        statementResult.series.push_back(std::move(resultSeries));
-                    }
+            int mDepth{0};
+            std::string mKey;
+        };
+
+        /// Message of an error block of a CSV response, the field following the "error" header
+        std::string parseCsvErrorMessage(std::string field)
+        {
+            while (!field.empty() && (field.back() == '\n' || field.back() == '\r'))
+            {
+                field.pop_back();
+            }
+            if (field.size() < 2 || field.front() != '"' || field.back() != '"')
+            {
+                return field;
+            }
+
+            std::string message;
+            for (std::size_t i = 1; i + 1 < field.size(); ++i)
+            {
+                message += field[i];
+                if (field[i] == '"')
+                {
+                    ++i;
                 }
-                resultSet.push_back(std::move(statementResult));
             }
-            return resultSet;
+            return message;
+        }
+
+        std::string parseMessagePackErrorMessage(const std::string& buffer)
+        {
+            MessagePackStringStream stream{buffer};
+            ErrorMembersHandler handler;
+            MessagePackReader<MessagePackStringStream>{stream}.read(handler);
+            const auto& members = handler.members;
+
+            /// error message for InfluxDB 1.x
+            if (const auto error = members.find("error"); error != members.end())
+            {
+                return "ERROR: " + error->second;
+            }
+
+            /// error message for InfluxDB 2.x
+            std::string errMsg;
+            if (const auto code = members.find("code"); code != members.end())
+            {
+                errMsg += "CODE: " + code->second;
+            }
+            if (const auto message = members.find("message"); message != members.end())
+            {
+                if (errMsg.length() > 0)
+                    errMsg += ", ";
+                errMsg += "MESSAGE: " + message->second;
+            }
+            return errMsg;
         }
     }
 
+    void queryInto(QueryResultBuilder& builder, Transport* transport, const std::string& query, const InfluxDBParams &params)
+    {
+        QueryResponseParser parser{builder};
+        transport->streamQuery(query, params, [&parser](std::string_view chunk) { parser.feed(chunk); });
+        parser.finish();
+    }
+
     std::vector<InfluxDBTable> queryImpl(Transport* transport, const std::string& query, const InfluxDBParams &param)
     {
-        const auto response = transport->query(query, param);
-        return parseJsonResponse(response);
+        RowResultBuilder builder;
+        queryInto(builder, transport, query, param);
+        return builder.takeResult();
+    }
+
+    std::vector<InfluxDBColumnarTable> queryColumnarImpl(Transport* transport, const std::string& query, const InfluxDBParams &params)
+    {
+        ColumnarResultBuilder builder;
+        queryInto(builder, transport, query, params);
+        return builder.takeResult();
+    }
+
+    std::vector<InfluxDBTable> queryCsvImpl(Transport* transport, const std::string& query, const InfluxDBParams &params)
+    {
+        RowResultBuilder builder;
+        CsvResponseParser parser{builder};
+        transport->streamCsvQuery(query, params, [&parser](std::string_view chunk) { parser.feed(chunk); });
+        parser.finish();
+        return builder.takeResult();
+    }
+
+    std::vector<InfluxDBTable> queryTimeRangeImpl(Transport* transport, const std::string& query, std::int64_t start, std::int64_t end,
+                                                  std::size_t parts, const InfluxDBParams &params, std::size_t maxConcurrency)
+    {
+        const auto boundaries = splitTimeRange(start, end, parts);
+        auto partParams = [&params, &boundaries](std::size_t part) {
+            InfluxDBParams result{params};
+            result.addParam("start", formatTimestamp(boundaries[part])).addParam("end", formatTimestamp(boundaries[part + 1]));
+            return result;
+        };
+
+        /// Workers take the next part until all are queried, this thread is one of them
+        const std::size_t count = boundaries.size() - 1;
+        std::vector<std::vector<InfluxDBTable>> results(count);
+        std::atomic<std::size_t> nextPart{0};
+        auto queryParts = [transport, &query, &partParams, &results, &nextPart, count] {
+            for (std::size_t part = nextPart++; part < count; part = nextPart++)
+            {
+                results[part] = queryImpl(transport, query, partParams(part));
+            }
+        };
+
+        /// Pending workers are awaited even if this thread fails
+        std::vector<std::future<void>> pending;
+        const std::size_t workers = std::min(count, std::max<std::size_t>(maxConcurrency, 1));
+        for (std::size_t worker = 1; worker < workers; ++worker)
+        {
+            pending.push_back(std::async(std::launch::async, queryParts));
+        }
+        queryParts();
+        for (auto& worker : pending)
+        {
+            worker.get();
+        }
+        return mergeResults(std::move(results));
+    }
+
+    std::vector<std::int64_t> splitTimeRange(std::int64_t start, std::int64_t end, std::size_t parts)
+    {
+        if (end <= start)
+        {
+            throw InfluxDBException("Query", "Time range must not be empty");
+        }
+        if (parts == 0)
+        {
+            throw InfluxDBException("Query", "Number of parts must not be 0");
+        }
+
+        const auto length = static_cast<std::uint64_t>(end) - static_cast<std::uint64_t>(start);
+        const auto count = std::min<std::uint64_t>(parts, length);
+        const std::uint64_t partLength = length / count;
+        const std::uint64_t remainder = length % count;
+
+        /// The remainder is spread over the first parts
+        std::vector<std::int64_t> boundaries;
+        boundaries.reserve(static_cast<std::size_t>(count) + 1);
+        for (std::uint64_t part = 0; part <= count; ++part)
+        {
+            const auto offset = partLength * part + std::min(part, remainder);
+            boundaries.push_back(static_cast<std::int64_t>(static_cast<std::uint64_t>(start) + offset));
+        }
+        return boundaries;
+    }
+
+    std::vector<InfluxDBTable> mergeResults(std::vector<std::vector<InfluxDBTable>>&& parts)
+    {
+        auto seriesKey = [](const InfluxDBSeries& series) {
+            std::string key{series.name};
+            for (std::size_t i = 0; i < series.tagKeys.size() && i < series.tagValues.size(); ++i)
+            {
+                key.append(1, '\0').append(series.tagKeys[i]).append(1, '=').append(series.tagValues[i]);
+            }
+            key += '\n';
+            for (const auto& column : series.columnNames)
+            {
+                key.append(1, '\0').append(column);
+            }
+            return key;
+        };
+
+        std::vector<InfluxDBTable> merged;
+        std::vector<std::unordered_map<std::string, std::size_t>> seriesIndices;
+        for (auto& part : parts)
+        {
+            for (std::size_t statement = 0; statement < part.size(); ++statement)
+            {
+                auto& table = part[statement];
+                if (statement == merged.size())
+                {
+                    merged.emplace_back().statementId = table.statementId;
+                    seriesIndices.emplace_back();
+                }
+
+                auto& target = merged[statement];
+                if (!target.error.empty())
+                {
+                    continue;
+                }
+                if (!table.error.empty())
+                {
+                    /// A statement failing for any part fails as a whole
+                    target.statementId = table.statementId;
+                    target.error = std::move(table.error);
+                    target.series.clear();
+                    continue;
+                }
+
+                for (auto& series : table.series)
+                {
+                    const auto [index, inserted] = seriesIndices[statement].try_emplace(seriesKey(series), target.series.size());
+                    if (inserted)
+                    {
+                        target.series.push_back(std::move(series));
+                        continue;
+                    }
+                    auto& rows = target.series[index->second].rows;
+                    rows.insert(rows.end(), std::make_move_iterator(series.rows.begin()), std::make_move_iterator(series.rows.end()));
+                }
+            }
+        }
+        return merged;
     }
 
     std::string parseErrorMessage(const std::string& buffer)
     {
+        if (!buffer.empty() && isMessagePack(buffer.front()))
+        {
+            return parseMessagePackErrorMessage(buffer);
+        }
+        if (buffer.rfind("error\n", 0) == 0)
+        {
+            return "ERROR: " + parseCsvErrorMessage(buffer.substr(6));
+        }
+
         rapidjson::Document js;
         std::string errMsg = {};
         if (js.Parse(buffer.c_str()).HasParseError())
@@ -226,4 +410,18 @@ namespace influxdb::internal
 
         return errMsg;
     }
+
+    std::string tryParseErrorMessage(const std::string& buffer)
+    {
+        try
+        {
+            return parseErrorMessage(buffer);
+        }
+        catch (const InfluxDBException&)
+        {
+            /// Proxies answer with empty or HTML bodies, which are passed on as they are
+            constexpr std::size_t maxLength{256};
+            return buffer.empty() ? std::string{"no error message"} : buffer.substr(0, maxLength);
+        }
+    }
 }
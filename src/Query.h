@@ -24,6 +24,10 @@
 
 #include "Transport.h"
 #include "InfluxDBTable.h"
+#include "InfluxDBColumnarTable.h"
+#include "QueryResultBuilder.h"
+#include <cstddef>
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -31,6 +35,25 @@ namespace influxdb::internal
 {
     /// Implementation of HTTP query
     std::vector<InfluxDBTable> queryImpl(Transport* transport, const std::string& query, const InfluxDBParams &params = InfluxDBParams());
+    /// Implementation of HTTP query with typed columns
+    std::vector<InfluxDBColumnarTable> queryColumnarImpl(Transport* transport, const std::string& query, const InfluxDBParams &params = InfluxDBParams());
+    /// Implementation of HTTP query requesting a CSV response
+    std::vector<InfluxDBTable> queryCsvImpl(Transport* transport, const std::string& query, const InfluxDBParams &params = InfluxDBParams());
+    /// Maximum number of parts of a time range queried at once
+    constexpr std::size_t maxConcurrentQueries{8};
+    /// Implementation of a query over a time range split into parts, which are queried concurrently by at most
+    /// maxConcurrency threads. The parts are passed as the parameters $start and $end, the end is exclusive.
+    std::vector<InfluxDBTable> queryTimeRangeImpl(Transport* transport, const std::string& query, std::int64_t start, std::int64_t end,
+                                                  std::size_t parts, const InfluxDBParams &params = InfluxDBParams(),
+                                                  std::size_t maxConcurrency = maxConcurrentQueries);
+    /// Returns the boundaries of a time range split into parts of equal length, at most one part per nanosecond
+    std::vector<std::int64_t> splitTimeRange(std::int64_t start, std::int64_t end, std::size_t parts);
+    /// Merges the results of a query over consecutive time ranges, appending rows of the same series in order
+    std::vector<InfluxDBTable> mergeResults(std::vector<std::vector<InfluxDBTable>>&& parts);
+    /// Passes the response of a query to the builder while it is received
+    void queryInto(QueryResultBuilder& builder, Transport* transport, const std::string& query, const InfluxDBParams &params);
     /// Parse InfluxDB error in JSON response
     std::string parseErrorMessage(const std::string& buffer);
+    /// Parse InfluxDB error in the response, returns the response itself if it's no InfluxDB error
+    std::string tryParseErrorMessage(const std::string& buffer);
 } // namespace influxdb::internal
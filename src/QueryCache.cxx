@@ -0,0 +1,167 @@
+// MIT License
+//
+// Copyright (c) 2022 TOSHIBA CORPORATION
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "QueryCache.h"
+#include <exception>
+#include <iterator>
+
+namespace influxdb::internal
+{
+    namespace
+    {
+        std::size_t textBytes(const std::string& text)
+        {
+            return sizeof(text) + text.capacity();
+        }
+
+        std::size_t textBytes(const std::vector<std::string>& texts)
+        {
+            std::size_t bytes{sizeof(texts)};
+            for (const auto& text : texts)
+            {
+                bytes += textBytes(text);
+            }
+            return bytes;
+        }
+    }
+
+    QueryCache::QueryCache(std::chrono::milliseconds ttl, std::size_t maxBytes, std::function<Clock::time_point()> now)
+        : mTtl(ttl), mMaxBytes(maxBytes), mNow(std::move(now)), mStatistics{}
+    {
+    }
+
+    QueryCache::Result QueryCache::get(const std::string& key, const std::function<Result()>& query)
+    {
+        std::unique_lock lock{mMutex};
+        if (const auto cached = mIndex.find(key); cached != mIndex.end())
+        {
+            if (cached->second->expiry > mNow())
+            {
+                ++mStatistics.hits;
+                mEntries.splice(mEntries.begin(), mEntries, cached->second);
+                const auto result = cached->second->result;
+                lock.unlock();
+                return *result;
+            }
+            erase(cached->second);
+        }
+
+        if (const auto inFlight = mInFlight.find(key); inFlight != mInFlight.end())
+        {
+            ++mStatistics.coalesced;
+            const auto pending = inFlight->second;
+            lock.unlock();
+            return *pending.get();
+        }
+
+        ++mStatistics.misses;
+        std::promise<std::shared_ptr<const Result>> promise;
+        mInFlight.emplace(key, promise.get_future().share());
+        lock.unlock();
+
+        std::shared_ptr<const Result> result;
+        try
+        {
+            result = std::make_shared<const Result>(query());
+        }
+        catch (...)
+        {
+            lock.lock();
+            mInFlight.erase(key);
+            promise.set_exception(std::current_exception());
+            throw;
+        }
+
+        lock.lock();
+        mInFlight.erase(key);
+        insert(key, result);
+        lock.unlock();
+        promise.set_value(result);
+        return *result;
+    }
+
+    void QueryCache::clear()
+    {
+        std::lock_guard lock{mMutex};
+        mEntries.clear();
+        mIndex.clear();
+        mStatistics.entries = 0;
+        mStatistics.bytes = 0;
+    }
+
+    QueryCacheStatistics QueryCache::statistics() const
+    {
+        std::lock_guard lock{mMutex};
+        return mStatistics;
+    }
+
+    std::size_t QueryCache::estimateBytes(const Result& result)
+    {
+        std::size_t bytes{sizeof(result)};
+        for (const auto& table : result)
+        {
+            bytes += sizeof(table) + textBytes(table.error);
+            for (const auto& series : table.series)
+            {
+                bytes += sizeof(series) + textBytes(series.name) + textBytes(series.tagKeys)
+                         + textBytes(series.tagValues) + textBytes(series.columnNames);
+                for (const auto& row : series.rows)
+                {
+                    bytes += textBytes(row.tuple);
+                }
+            }
+        }
+        return bytes;
+    }
+
+    void QueryCache::insert(const std::string& key, std::shared_ptr<const Result> result)
+    {
+        const std::size_t bytes = estimateBytes(*result) + 2 * textBytes(key);
+        if (mTtl <= std::chrono::milliseconds::zero() || bytes > mMaxBytes)
+        {
+            return;
+        }
+        if (const auto cached = mIndex.find(key); cached != mIndex.end())
+        {
+            erase(cached->second);
+        }
+
+        while (!mEntries.empty() && mStatistics.bytes + bytes > mMaxBytes)
+        {
+            ++mStatistics.evictions;
+            erase(std::prev(mEntries.end()));
+        }
+        mEntries.push_front(Entry{key, std::move(result), mNow() + mTtl, bytes});
+        mIndex.emplace(key, mEntries.begin());
+        ++mStatistics.entries;
+        mStatistics.bytes += bytes;
+    }
+
+    void QueryCache::erase(std::list<Entry>::iterator entry)
+    {
+        --mStatistics.entries;
+        mStatistics.bytes -= entry->bytes;
+        mIndex.erase(entry->key);
+        mEntries.erase(entry);
+    }
+}
@@ -0,0 +1,94 @@
+// MIT License
+//
+// Copyright (c) 2022 TOSHIBA CORPORATION
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+
+#include "InfluxDB.h"
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace influxdb::internal
+{
+    /// \brief Least recently used cache of query results, limited by age and memory
+    ///
+    /// Concurrent lookups of a key not cached are coalesced into a single query,
+    /// whose result (or error) is shared by all of them. Errors are not cached.
+    class QueryCache
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+        using Result = std::vector<InfluxDBTable>;
+
+        /// \param ttl        age after which results are queried again, zero only coalesces concurrent queries
+        /// \param maxBytes   estimated memory of all cached results, results exceeding it alone aren't cached
+        /// \param now        returns the current time
+        QueryCache(std::chrono::milliseconds ttl, std::size_t maxBytes, std::function<Clock::time_point()> now = Clock::now);
+
+        QueryCache(const QueryCache&) = delete;
+        QueryCache& operator=(const QueryCache&) = delete;
+
+        /// Returns the cached result of the key, or the result of query which is cached
+        /// \throw InfluxDBException   the error of query, shared with concurrent lookups of the key
+        Result get(const std::string& key, const std::function<Result()>& query);
+
+        /// Drops all cached results, queries in flight are cached when finished
+        void clear();
+
+        /// Returns the counters of lookups and the size of the cache
+        QueryCacheStatistics statistics() const;
+
+        /// Returns the estimated memory of a result
+        static std::size_t estimateBytes(const Result& result);
+
+    private:
+        struct Entry
+        {
+            std::string key;
+            std::shared_ptr<const Result> result;
+            Clock::time_point expiry;
+            std::size_t bytes;
+        };
+
+        void insert(const std::string& key, std::shared_ptr<const Result> result);
+        void erase(std::list<Entry>::iterator entry);
+
+        const std::chrono::milliseconds mTtl;
+        const std::size_t mMaxBytes;
+        const std::function<Clock::time_point()> mNow;
+
+        mutable std::mutex mMutex;
+        /// Entries by recent use, most recent first
+        std::list<Entry> mEntries;
+        std::unordered_map<std::string, std::list<Entry>::iterator> mIndex;
+        std::unordered_map<std::string, std::shared_future<std::shared_ptr<const Result>>> mInFlight;
+        QueryCacheStatistics mStatistics;
+    };
+}
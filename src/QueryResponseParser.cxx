@@ -0,0 +1,618 @@
+// MIT License
+//
+// Copyright (c) 2022 TOSHIBA CORPORATION
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "QueryResponseParser.h"
+#include "InfluxDBException.h"
+#include "MessagePackReader.h"
+#include <rapidjson/reader.h>
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
+#include <rapidjson/error/en.h>
+#include <cassert>
+#include <stdexcept>
+#include <utility>
+
+namespace influxdb::internal
+{
+    namespace
+    {
+        [[noreturn]] void throwUnsupportedStructure()
+        {
+            throw InfluxDBException("Query", "Unsupported response structure");
+        }
+    }
+
+    /// \brief SAX handler passing the elements of a response to a builder
+    ///
+    /// Follows the structure {"results":[{"statement_id":0,"series":[{"name":"",
+    /// "tags":{},"columns":[],"values":[[]]}]}]}, unknown members are skipped.
+    /// Each JSON object of a chunked response starts again at the root.
+    /// All numbers of JSON are received as strings to avoid loss of precision,
+    /// typed values of MessagePack are passed to the builder as they are.
+    class QueryResponseParser::Handler
+    {
+    public:
+        using ValueType = QueryResultBuilder::ValueType;
+
+        explicit Handler(QueryResultBuilder& builder) : mBuilder(builder)
+        {
+        }
+
+        bool Null()
+        {
+            return nested([](auto& writer) { writer.Null(); }) || scalar(ValueType::Null, {});
+        }
+
+        bool Bool(bool b)
+        {
+            return nested([b](auto& writer) { writer.Bool(b); }) || scalar(ValueType::Boolean, b ? "true" : "false");
+        }
+
+        bool Int(int i)
+        {
+            return RawNumber(std::to_string(i));
+        }
+
+        bool Uint(unsigned u)
+        {
+            return RawNumber(std::to_string(u));
+        }
+
+        bool Int64(int64_t i)
+        {
+            return nested([i](auto& writer) { writer.Int64(i); })
+                || typed(ValueType::Number, std::to_string(i), [this, i] { mBuilder.addInteger(i); });
+        }
+
+        bool Uint64(uint64_t u)
+        {
+            return RawNumber(std::to_string(u));
+        }
+
+        bool Double(double d)
+        {
+            const auto text = formatFloat(d);
+            return nested([&text](auto& writer) { writer.RawValue(text.data(), text.size(), rapidjson::kNumberType); })
+                || typed(ValueType::Number, text, [this, d] { mBuilder.addFloat(d); });
+        }
+
+        /// Timestamps of MessagePack, passed as RFC3339 string unless part of a row
+        bool Time(int64_t nanoseconds)
+        {
+            const auto text = formatTimestamp(nanoseconds);
+            return nested([&text](auto& writer) { writer.String(text.data(), static_cast<rapidjson::SizeType>(text.size())); })
+                || typed(ValueType::String, text, [this, nanoseconds] { mBuilder.addTime(nanoseconds); });
+        }
+
+        bool RawNumber(const char* str, rapidjson::SizeType length, [[maybe_unused]] bool copy)
+        {
+            return RawNumber(std::string_view{str, length});
+        }
+
+        bool String(const char* str, rapidjson::SizeType length, [[maybe_unused]] bool copy)
+        {
+            const std::string_view text{str, length};
+            return nested([text](auto& writer) { writer.String(text.data(), static_cast<rapidjson::SizeType>(text.size())); })
+                || scalar(ValueType::String, text);
+        }
+
+        bool Key(const char* str, rapidjson::SizeType length, [[maybe_unused]] bool copy)
+        {
+            if (nested([str, length](auto& writer) { writer.Key(str, length); }))
+            {
+                return true;
+            }
+            mKey.assign(str, length);
+            return true;
+        }
+
+        bool StartObject()
+        {
+            return nested([](auto& writer) { writer.StartObject(); }, 1) || start(true);
+        }
+
+        bool EndObject([[maybe_unused]] rapidjson::SizeType memberCount)
+        {
+            return nested([](auto& writer) { writer.EndObject(); }, -1) || end();
+        }
+
+        bool StartArray()
+        {
+            return nested([](auto& writer) { writer.StartArray(); }, 1) || start(false);
+        }
+
+        bool EndArray([[maybe_unused]] rapidjson::SizeType elementCount)
+        {
+            return nested([](auto& writer) { writer.EndArray(); }, -1) || end();
+        }
+
+    private:
+        /// Containers of the response structure
+        enum class Level
+        {
+            Root,
+            Response,
+            Results,
+            Result,
+            SeriesList,
+            Series,
+            Tags,
+            Columns,
+            Values,
+            Row
+        };
+
+        Level level() const
+        {
+            return mLevels.empty() ? Level::Root : mLevels.back();
+        }
+
+        bool RawNumber(std::string_view text)
+        {
+            return nested([text](auto& writer) { writer.RawValue(text.data(), text.size(), rapidjson::kNumberType); })
+                || scalar(ValueType::Number, text);
+        }
+
+        /// Passes a typed value of a row to the builder, other values as text
+        template <class AddValue>
+        bool typed(ValueType type, std::string_view text, AddValue&& addValue)
+        {
+            if (level() != Level::Row)
+            {
+                return scalar(type, text);
+            }
+            addValue();
+            return true;
+        }
+
+        /// Handles events of values nested into elements or members that are skipped,
+        /// returns false if no such value is being parsed
+        template <class WriteEvent>
+        bool nested(WriteEvent&& writeEvent, int depthChange = 0)
+        {
+            if (mNestedDepth == 0)
+            {
+                return false;
+            }
+            if (mNestedLevel != Level::Root)
+            {
+                writeEvent(mWriter);
+            }
+
+            mNestedDepth += depthChange;
+            if (mNestedDepth == 0 && mNestedLevel != Level::Root)
+            {
+                const std::string_view text{mBuffer.GetString(), mBuffer.GetSize()};
+                element(mNestedLevel, ValueType::Nested, text);
+            }
+            return true;
+        }
+
+        /// Starts a nested value, serialized to an element of the current level or skipped
+        bool beginNested(bool isObject, bool isSkipped = false)
+        {
+            mNestedDepth = 1;
+            mNestedLevel = (isSkipped ? Level::Root : level());
+
+            if (!isSkipped)
+            {
+                mBuffer.Clear();
+                mWriter.Reset(mBuffer);
+                if (isObject)
+                {
+                    mWriter.StartObject();
+                }
+                else
+                {
+                    mWriter.StartArray();
+                }
+            }
+            return true;
+        }
+
+        /// Passes a value of an element of the level to the builder
+        void element(Level at, ValueType type, std::string_view text)
+        {
+            switch (at)
+            {
+                case Level::Result:
+                    mBuilder.setError(text);
+                    break;
+                case Level::Series:
+                    mBuilder.setName(text);
+                    break;
+                case Level::Tags:
+                    mBuilder.addTag(mKey, text);
+                    break;
+                case Level::Columns:
+                    mBuilder.addColumn(text);
+                    break;
+                case Level::Row:
+                    mBuilder.addValue(type, text);
+                    break;
+                default:
+                    throwUnsupportedStructure();
+            }
+        }
+
+        bool scalar(ValueType type, std::string_view text)
+        {
+            switch (level())
+            {
+                case Level::Response:
+                    if (mKey == "results")
+                    {
+                        throwUnsupportedStructure();
+                    }
+                    if (mKey == "error")
+                    {
+                        /// Errors occurring after the first chunk was sent are reported in the response
+                        throw InfluxDBException("Query", "ERROR: " + std::string{text});
+                    }
+                    break;
+                case Level::Result:
+                    if (mKey == "error")
+                    {
+                        mHasError = true;
+                        element(Level::Result, type, text);
+                    }
+                    else if (mKey == "statement_id")
+                    {
+                        mBuilder.setStatementId(toStatementId(type, text));
+                    }
+                    else if (mKey == "series")
+                    {
+                        throwUnsupportedStructure();
+                    }
+                    break;
+                case Level::Series:
+                    if (mKey == "name")
+                    {
+                        element(Level::Series, type, text);
+                    }
+                    else if (mKey == "columns" || mKey == "values")
+                    {
+                        throwUnsupportedStructure();
+                    }
+                    break;
+                case Level::Tags:
+                case Level::Columns:
+                case Level::Row:
+                    element(level(), type, text);
+                    break;
+                default:
+                    throwUnsupportedStructure();
+            }
+            return true;
+        }
+
+        bool start(bool isObject)
+        {
+            switch (level())
+            {
+                case Level::Root:
+                    return enter(isObject, Level::Response);
+                case Level::Response:
+                    if (mKey == "results")
+                    {
+                        return enter(!isObject, Level::Results);
+                    }
+                    return beginNested(isObject, true);
+                case Level::Results:
+                    mBuilder.beginResult();
+                    mHasError = false;
+                    return enter(isObject, Level::Result);
+                case Level::Result:
+                    if (mKey == "error")
+                    {
+                        mHasError = true;
+                        return beginNested(isObject);
+                    }
+                    if (mKey == "series")
+                    {
+                        return enter(!isObject, Level::SeriesList);
+                    }
+                    if (mKey == "statement_id")
+                    {
+                        throwUnsupportedStructure();
+                    }
+                    return beginNested(isObject, true);
+                case Level::SeriesList:
+                    mBuilder.beginSeries();
+                    return enter(isObject, Level::Series);
+                case Level::Series:
+                    if (mKey == "name")
+                    {
+                        return beginNested(isObject);
+                    }
+                    if (mKey == "tags" && isObject)
+                    {
+                        return enter(true, Level::Tags);
+                    }
+                    if (mKey == "columns")
+                    {
+                        return enter(!isObject, Level::Columns);
+                    }
+                    if (mKey == "values")
+                    {
+                        return enter(!isObject, Level::Values);
+                    }
+                    return beginNested(isObject, true);
+                case Level::Tags:
+                case Level::Columns:
+                case Level::Row:
+                    return beginNested(isObject);
+                case Level::Values:
+                    mBuilder.beginRow();
+                    return enter(!isObject, Level::Row);
+            }
+            return false;
+        }
+
+        /// Enters the container if it has the expected type
+        bool enter(bool isExpectedType, Level next)
+        {
+            if (!isExpectedType)
+            {
+                throwUnsupportedStructure();
+            }
+            mLevels.push_back(next);
+            return true;
+        }
+
+        bool end()
+        {
+            if (level() == Level::Result)
+            {
+                mBuilder.endResult(mHasError);
+            }
+            else if (level() == Level::Row)
+            {
+                mBuilder.endRow();
+            }
+            mLevels.pop_back();
+            return true;
+        }
+
+        static int toStatementId(ValueType type, std::string_view text)
+        {
+            try
+            {
+                if (type == ValueType::Number || type == ValueType::String)
+                {
+                    return std::stoi(std::string{text});
+                }
+            }
+            catch (const std::logic_error&)
+            {
+            }
+            throwUnsupportedStructure();
+        }
+
+        QueryResultBuilder& mBuilder;
+        std::vector<Level> mLevels;
+        std::string mKey;
+        bool mHasError{false};
+
+        /// Depth of the value being skipped or serialized, zero if none
+        int mNestedDepth{0};
+        /// Level of the element the nested value belongs to, Root if skipped
+        Level mNestedLevel{Level::Root};
+        rapidjson::StringBuffer mBuffer;
+        rapidjson::Writer<rapidjson::StringBuffer> mWriter{mBuffer};
+    };
+
+    /// \brief Input stream of the SAX parser reading the received chunks
+    class QueryResponseParser::ChunkStream
+    {
+    public:
+        using Ch = char;
+
+        explicit ChunkStream(QueryResponseParser& parser) : mParser(parser)
+        {
+        }
+
+        Ch Peek()
+        {
+            return (mPosition < mChunk.size() || refill()) ? mChunk[mPosition] : '\0';
+        }
+
+        Ch Take()
+        {
+            return (mPosition < mChunk.size() || refill()) ? mChunk[mPosition++] : '\0';
+        }
+
+        /// Whether the response is consumed, as '\0' is a valid byte of binary responses
+        bool AtEnd()
+        {
+            return mPosition >= mChunk.size() && !refill();
+        }
+
+        std::size_t Tell() const
+        {
+            return mConsumed + mPosition;
+        }
+
+        Ch* PutBegin()
+        {
+            assert(false);
+            return nullptr;
+        }
+
+        void Put(Ch)
+        {
+            assert(false);
+        }
+
+        void Flush()
+        {
+            assert(false);
+        }
+
+        std::size_t PutEnd(Ch*)
+        {
+            assert(false);
+            return 0;
+        }
+
+    private:
+        bool refill()
+        {
+            mConsumed += mChunk.size();
+            mChunk = mParser.nextChunk(std::move(mChunk));
+            mPosition = 0;
+            return !mChunk.empty();
+        }
+
+        QueryResponseParser& mParser;
+        std::string mChunk;
+        std::size_t mPosition{0};
+        std::size_t mConsumed{0};
+    };
+
+
+    QueryResponseParser::QueryResponseParser(QueryResultBuilder& builder) : mBuilder(builder), mThread{[this] { run(); }}
+    {
+    }
+
+    QueryResponseParser::~QueryResponseParser()
+    {
+        if (mThread.joinable())
+        {
+            {
+                std::lock_guard lock{mMutex};
+                mEndOfInput = true;
+                mChunks.clear();
+            }
+            mChanged.notify_all();
+            mThread.join();
+        }
+    }
+
+    void QueryResponseParser::feed(std::string_view chunk)
+    {
+        if (chunk.empty())
+        {
+            return;
+        }
+
+        std::string data;
+        {
+            std::unique_lock lock{mMutex};
+            mChanged.wait(lock, [this] { return mBufferedBytes < maxBufferedBytes || mDone; });
+            if (mError)
+            {
+                std::rethrow_exception(mError);
+            }
+            data = std::move(mSpare);
+        }
+
+        /// Copied without holding the lock, so the parser continues meanwhile
+        data.assign(chunk.data(), chunk.size());
+        {
+            std::lock_guard lock{mMutex};
+            mBufferedBytes += data.size();
+            mChunks.push_back(std::move(data));
+        }
+        mChanged.notify_all();
+    }
+
+    void QueryResponseParser::finish()
+    {
+        {
+            std::lock_guard lock{mMutex};
+            mEndOfInput = true;
+        }
+        mChanged.notify_all();
+        mThread.join();
+
+        if (mError)
+        {
+            std::rethrow_exception(mError);
+        }
+    }
+
+    std::string QueryResponseParser::nextChunk(std::string&& consumed)
+    {
+        std::unique_lock lock{mMutex};
+        mSpare = std::move(consumed);
+        mChanged.wait(lock, [this] { return !mChunks.empty() || mEndOfInput; });
+
+        if (mChunks.empty())
+        {
+            return {};
+        }
+
+        std::string chunk = std::move(mChunks.front());
+        mChunks.pop_front();
+        mBufferedBytes -= chunk.size();
+        lock.unlock();
+        mChanged.notify_all();
+        return chunk;
+    }
+
+    void QueryResponseParser::run()
+    {
+        std::exception_ptr error;
+        try
+        {
+            Handler handler{mBuilder};
+            ChunkStream stream{*this};
+
+            /// Chunked responses consist of a sequence of objects
+            if (!stream.AtEnd() && isMessagePack(stream.Peek()))
+            {
+                MessagePackReader<ChunkStream> reader{stream};
+                do
+                {
+                    reader.read(handler);
+                } while (!stream.AtEnd());
+            }
+            else
+            {
+                rapidjson::Reader reader;
+                do
+                {
+                    constexpr unsigned flags = rapidjson::kParseNumbersAsStringsFlag | rapidjson::kParseStopWhenDoneFlag;
+                    if (const auto result = reader.Parse<flags>(stream, handler); result.IsError())
+                    {
+                        throw InfluxDBException("Query", "Parse json error: " + std::string(rapidjson::GetParseError_En(result.Code())));
+                    }
+                    rapidjson::SkipWhitespace(stream);
+                } while (!stream.AtEnd());
+            }
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+
+        {
+            std::lock_guard lock{mMutex};
+            mDone = true;
+            mError = error;
+            mChunks.clear();
+            mBufferedBytes = 0;
+        }
+        mChanged.notify_all();
+    }
+}
@@ -0,0 +1,93 @@
+// MIT License
+//
+// Copyright (c) 2022 TOSHIBA CORPORATION
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "QueryResultBuilder.h"
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace influxdb::internal
+{
+    /// \brief Incremental parser of InfluxQL JSON or MessagePack responses
+    ///
+    /// Chunks passed to feed() are parsed by a SAX parser on a background thread
+    /// while the next ones are received, so the response is never held completely
+    /// and no DOM is built. The elements of the response are passed to a builder.
+    /// Chunked responses, a sequence of objects, are passed as a single response.
+    /// The format is detected by the first byte, MessagePack responses start with a map.
+    class QueryResponseParser
+    {
+    public:
+        /// Maximum number of bytes buffered ahead of the parser, feed() blocks above
+        static constexpr std::size_t maxBufferedBytes{1024 * 1024};
+
+        /// \param builder   receives the elements of the response on the background thread
+        explicit QueryResponseParser(QueryResultBuilder& builder);
+
+        /// Stops parsing if the response wasn't finished
+        ~QueryResponseParser();
+
+        QueryResponseParser(const QueryResponseParser&) = delete;
+        QueryResponseParser& operator=(const QueryResponseParser&) = delete;
+
+        /// Passes the next chunk of the response
+        /// \throw InfluxDBException   if the response received so far is invalid
+        void feed(std::string_view chunk);
+
+        /// Waits until the complete response is parsed
+        /// \throw InfluxDBException   if the response is invalid
+        void finish();
+
+    private:
+        class Handler;
+        class ChunkStream;
+
+        /// Parses the response, executed by the background thread
+        void run();
+
+        /// Returns the next chunk to parse, empty at the end of the response
+        std::string nextChunk(std::string&& consumed);
+
+        QueryResultBuilder& mBuilder;
+        std::mutex mMutex;
+        std::condition_variable mChanged;
+
+        /// Received chunks not parsed yet
+        std::deque<std::string> mChunks;
+
+        /// Chunk to reuse for the next feed()
+        std::string mSpare;
+
+        std::size_t mBufferedBytes{0};
+        bool mEndOfInput{false};
+        bool mDone{false};
+        std::exception_ptr mError;
+        std::thread mThread;
+    };
+}
@@ -0,0 +1,710 @@
+// MIT License
+//
+// Copyright (c) 2022 TOSHIBA CORPORATION
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "QueryResultBuilder.h"
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <optional>
+#include <utility>
+
+namespace influxdb::internal
+{
+    namespace
+    {
+        using ValueType = QueryResultBuilder::ValueType;
+
+        constexpr std::int64_t nanosecondsPerSecond{1000000000};
+        constexpr std::int64_t secondsPerDay{86400};
+
+        /// Days since 1970-01-01 of a date of the proleptic Gregorian calendar
+        constexpr std::int64_t daysFromCivil(std::int64_t year, unsigned month, unsigned day)
+        {
+            year -= (month <= 2 ? 1 : 0);
+            const std::int64_t era = (year >= 0 ? year : year - 399) / 400;
+            const auto yearOfEra = static_cast<unsigned>(year - era * 400);
+            const unsigned dayOfYear = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+            const unsigned dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+            return era * 146097 + static_cast<std::int64_t>(dayOfEra) - 719468;
+        }
+
+        /// Writes the value zero padded to the number of digits
+        char* writeDigits(char* out, std::uint64_t value, int digits)
+        {
+            for (int i = digits - 1; i >= 0; --i)
+            {
+                out[i] = static_cast<char>('0' + value % 10);
+                value /= 10;
+            }
+            return out + digits;
+        }
+
+        std::optional<unsigned> parseDigits(std::string_view text, std::size_t offset, std::size_t count)
+        {
+            unsigned value{0};
+            for (std::size_t i = offset; i < offset + count; ++i)
+            {
+                if (i >= text.size() || text[i] < '0' || text[i] > '9')
+                {
+                    return std::nullopt;
+                }
+                value = value * 10 + static_cast<unsigned>(text[i] - '0');
+            }
+            return value;
+        }
+
+        /// Parses an RFC3339 UTC timestamp as returned by InfluxDB, 2006-01-02T15:04:05.999999999Z
+        std::optional<std::int64_t> parseTimestamp(std::string_view text)
+        {
+            const auto year = parseDigits(text, 0, 4);
+            const auto month = parseDigits(text, 5, 2);
+            const auto day = parseDigits(text, 8, 2);
+            const auto hour = parseDigits(text, 11, 2);
+            const auto minute = parseDigits(text, 14, 2);
+            const auto second = parseDigits(text, 17, 2);
+
+            if (!year || !month || !day || !hour || !minute || !second
+                || text[4] != '-' || text[7] != '-' || text[10] != 'T' || text[13] != ':' || text[16] != ':'
+                || *month < 1 || *month > 12 || *day < 1 || *day > 31 || *hour > 23 || *minute > 59 || *second > 59)
+            {
+                return std::nullopt;
+            }
+
+            std::size_t position{19};
+            std::int64_t fraction{0};
+            if (position < text.size() && text[position] == '.')
+            {
+                const std::size_t digits = text.size() - position - 2;
+                const auto value = parseDigits(text, position + 1, digits);
+                if (digits == 0 || digits > 9 || !value)
+                {
+                    return std::nullopt;
+                }
+                fraction = *value;
+                for (std::size_t i = digits; i < 9; ++i)
+                {
+                    fraction *= 10;
+                }
+                position += digits + 1;
+            }
+            if (position + 1 != text.size() || text[position] != 'Z')
+            {
+                return std::nullopt;
+            }
+
+            /// Nanoseconds since epoch cover the years 1678 to 2261
+            if (*year < 1678 || *year > 2261)
+            {
+                return std::nullopt;
+            }
+            const std::int64_t seconds = daysFromCivil(*year, *month, *day) * secondsPerDay + *hour * 3600 + *minute * 60 + *second;
+            return seconds * nanosecondsPerSecond + fraction;
+        }
+
+        /// Parses a number token if it's an integer within range
+        std::optional<std::int64_t> parseInteger(std::string_view text)
+        {
+            std::int64_t value{0};
+            const auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+            if (result.ec != std::errc{} || result.ptr != text.data() + text.size())
+            {
+                return std::nullopt;
+            }
+            return value;
+        }
+
+        double parseFloat(std::string_view text)
+        {
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+            double value{0.0};
+            std::from_chars(text.data(), text.data() + text.size(), value);
+            return value;
+#else
+            /// No floating point from_chars() available, strtod() requires a terminated string
+            return std::strtod(std::string{text}.c_str(), nullptr);
+#endif
+        }
+
+        /// Returns whether a number token has no fraction or exponent
+        bool isIntegerToken(std::string_view text)
+        {
+            return text.find_first_of(".eE") == std::string_view::npos;
+        }
+
+        /// Returns whether the integer is exactly representable by a double
+        bool isExactFloat(std::int64_t value)
+        {
+            constexpr std::int64_t maxExact{std::int64_t{1} << std::numeric_limits<double>::digits};
+            if (value >= -maxExact && value <= maxExact)
+            {
+                return true;
+            }
+            /// Larger integers are if they only differ in bits below the mantissa; 2^63 is out of range
+            const auto converted = static_cast<double>(value);
+            return converted < 0x1p63 && static_cast<std::int64_t>(converted) == value;
+        }
+
+        /// Returns whether the value of an integer token is exactly representable by a double
+        bool isExactFloat(std::string_view text)
+        {
+            if (const auto value = parseInteger(text); value)
+            {
+                return isExactFloat(*value);
+            }
+            /// Integers beyond 64 bits are compared to the exact decimal value of the double they're parsed to
+            char buffer[320];
+            std::snprintf(buffer, sizeof(buffer), "%.0f", parseFloat(text));
+            return text == buffer;
+        }
+
+        InfluxDBColumn::Type inferType(const InfluxDBColumn& column, ValueType type, std::string_view text)
+        {
+            switch (type)
+            {
+                case ValueType::Boolean:
+                    return InfluxDBColumn::Type::Boolean;
+                case ValueType::Number:
+                    if (parseInteger(text))
+                    {
+                        return InfluxDBColumn::Type::Integer;
+                    }
+                    /// Integers which a double can't hold exactly, like unsigned integers beyond int64, are kept as text
+                    return isIntegerToken(text) && !isExactFloat(text) ? InfluxDBColumn::Type::String : InfluxDBColumn::Type::Float;
+                case ValueType::String:
+                    if (column.name == "time" && parseTimestamp(text))
+                    {
+                        return InfluxDBColumn::Type::Time;
+                    }
+                    return InfluxDBColumn::Type::String;
+                default:
+                    return InfluxDBColumn::Type::String;
+            }
+        }
+
+        /// Appends the zero value of the column type, without changing the validity
+        void appendDefault(InfluxDBColumn& column)
+        {
+            switch (column.type)
+            {
+                case InfluxDBColumn::Type::Boolean:
+                    column.booleans.push_back(0);
+                    break;
+                case InfluxDBColumn::Type::Integer:
+                case InfluxDBColumn::Type::Time:
+                    column.integers.push_back(0);
+                    break;
+                case InfluxDBColumn::Type::Float:
+                    column.floats.push_back(0.0);
+                    break;
+                case InfluxDBColumn::Type::String:
+                    column.strings.emplace_back();
+                    break;
+                case InfluxDBColumn::Type::Null:
+                    break;
+            }
+        }
+
+        /// Float fields with integral values are returned without fraction,
+        /// so a column of integers may turn out to be a float column; returns
+        /// false if an integer can't be converted to a double exactly
+        bool promoteToFloat(InfluxDBColumn& column)
+        {
+            if (!std::all_of(column.integers.begin(), column.integers.end(), [](std::int64_t value) { return isExactFloat(value); }))
+            {
+                return false;
+            }
+            column.floats.assign(column.integers.begin(), column.integers.end());
+            column.integers = {};
+            column.type = InfluxDBColumn::Type::Float;
+            return true;
+        }
+
+        /// Changes the type of an all null column to the type of its first value
+        void initializeType(InfluxDBColumn& column, std::size_t row, ValueType type, std::string_view text)
+        {
+            column.type = inferType(column, type, text);
+            for (std::size_t i = 0; i < row; ++i)
+            {
+                appendDefault(column);
+            }
+        }
+
+        /// Appends a value if it fits to the type of the column, returns false otherwise
+        bool appendTyped(InfluxDBColumn& column, ValueType type, std::string_view text)
+        {
+            switch (column.type)
+            {
+                case InfluxDBColumn::Type::Boolean:
+                    if (type == ValueType::Boolean)
+                    {
+                        column.booleans.push_back(text == "true" ? 1 : 0);
+                        return true;
+                    }
+                    return false;
+                case InfluxDBColumn::Type::Integer:
+                    if (type == ValueType::Number)
+                    {
+                        if (const auto value = parseInteger(text); value)
+                        {
+                            column.integers.push_back(*value);
+                            return true;
+                        }
+                        if ((isIntegerToken(text) && !isExactFloat(text)) || !promoteToFloat(column))
+                        {
+                            return false;
+                        }
+                        column.floats.push_back(parseFloat(text));
+                        return true;
+                    }
+                    return false;
+                case InfluxDBColumn::Type::Float:
+                    if (type == ValueType::Number && (!isIntegerToken(text) || isExactFloat(text)))
+                    {
+                        column.floats.push_back(parseFloat(text));
+                        return true;
+                    }
+                    return false;
+                case InfluxDBColumn::Type::Time:
+                    if (type == ValueType::String)
+                    {
+                        if (const auto value = parseTimestamp(text); value)
+                        {
+                            column.integers.push_back(*value);
+                            return true;
+                        }
+                    }
+                    return false;
+                default:
+                    return false;
+            }
+        }
+
+        void setValid(InfluxDBColumn& column, std::size_t row)
+        {
+            column.validity[row / 64] |= (std::uint64_t{1} << (row % 64));
+        }
+    }
+
+    std::string formatTimestamp(std::int64_t nanoseconds)
+    {
+        std::int64_t days = nanoseconds / (secondsPerDay * nanosecondsPerSecond);
+        std::int64_t remainder = nanoseconds % (secondsPerDay * nanosecondsPerSecond);
+        if (remainder < 0)
+        {
+            remainder += secondsPerDay * nanosecondsPerSecond;
+            --days;
+        }
+
+        const std::int64_t z = days + 719468;
+        const std::int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+        const auto dayOfEra = static_cast<unsigned>(z - era * 146097);
+        const unsigned yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+        const unsigned dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+        const unsigned mp = (5 * dayOfYear + 2) / 153;
+        const unsigned day = dayOfYear - (153 * mp + 2) / 5 + 1;
+        const unsigned month = (mp < 10 ? mp + 3 : mp - 9);
+        const std::int64_t year = static_cast<std::int64_t>(yearOfEra) + era * 400 + (month <= 2 ? 1 : 0);
+
+        const std::int64_t seconds = remainder / nanosecondsPerSecond;
+        std::int64_t fraction = remainder % nanosecondsPerSecond;
+
+        /// Years of int64 nanoseconds are within 1677 and 2262
+        char buffer[32];
+        char* out = writeDigits(buffer, static_cast<std::uint64_t>(year), 4);
+        *out++ = '-';
+        out = writeDigits(out, month, 2);
+        *out++ = '-';
+        out = writeDigits(out, day, 2);
+        *out++ = 'T';
+        out = writeDigits(out, static_cast<std::uint64_t>(seconds / 3600), 2);
+        *out++ = ':';
+        out = writeDigits(out, static_cast<std::uint64_t>(seconds / 60 % 60), 2);
+        *out++ = ':';
+        out = writeDigits(out, static_cast<std::uint64_t>(seconds % 60), 2);
+        if (fraction > 0)
+        {
+            int digits{9};
+            while (fraction % 10 == 0)
+            {
+                fraction /= 10;
+                --digits;
+            }
+            *out++ = '.';
+            out = writeDigits(out, static_cast<std::uint64_t>(fraction), digits);
+        }
+        *out++ = 'Z';
+        return std::string{buffer, out};
+    }
+
+    std::string formatFloat(double value)
+    {
+        char buffer[32];
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+        const auto result = std::to_chars(std::begin(buffer), std::end(buffer), value);
+        return std::string{buffer, result.ptr};
+#else
+        const int length = std::snprintf(buffer, sizeof(buffer), "%.17g", value);
+        return std::string{buffer, static_cast<std::size_t>(length)};
+#endif
+    }
+
+    void QueryResultBuilder::addInteger(std::int64_t value)
+    {
+        addValue(ValueType::Number, std::to_string(value));
+    }
+
+    void QueryResultBuilder::addFloat(double value)
+    {
+        addValue(ValueType::Number, formatFloat(value));
+    }
+
+    void QueryResultBuilder::addTime(std::int64_t nanoseconds)
+    {
+        addValue(ValueType::String, formatTimestamp(nanoseconds));
+    }
+
+
+    void RowResultBuilder::beginResult()
+    {
+        mResult.emplace_back();
+    }
+
+    void RowResultBuilder::setStatementId(int statementId)
+    {
+        mResult.back().statementId = statementId;
+    }
+
+    void RowResultBuilder::setError(std::string_view error)
+    {
+        mResult.back().error = error;
+    }
+
+    void RowResultBuilder::endResult(bool failed)
+    {
+        if (failed)
+        {
+            /// Results of failed statements only consist of the error message
+            mResult.back().statementId = -1;
+            mResult.back().series.clear();
+        }
+    }
+
+    void RowResultBuilder::beginSeries()
+    {
+        mResult.back().series.emplace_back();
+    }
+
+    void RowResultBuilder::setName(std::string_view name)
+    {
+        mResult.back().series.back().name = name;
+    }
+
+    void RowResultBuilder::addTag(std::string_view key, std::string_view value)
+    {
+        auto& series = mResult.back().series.back();
+        series.tagKeys.emplace_back(key);
+        series.tagValues.emplace_back(value);
+    }
+
+    void RowResultBuilder::addColumn(std::string_view name)
+    {
+        mResult.back().series.back().columnNames.emplace_back(name);
+    }
+
+    void RowResultBuilder::beginRow()
+    {
+        mResult.back().series.back().rows.emplace_back();
+    }
+
+    void RowResultBuilder::addValue([[maybe_unused]] ValueType type, std::string_view text)
+    {
+        mResult.back().series.back().rows.back().tuple.emplace_back(text);
+    }
+
+    void RowResultBuilder::endRow()
+    {
+    }
+
+    std::vector<InfluxDBTable> RowResultBuilder::takeResult()
+    {
+        return std::move(mResult);
+    }
+
+
+    void ColumnarResultBuilder::beginResult()
+    {
+        mResult.emplace_back();
+        mBlockPosition = nullptr;
+        mBlockAvailable = 0;
+    }
+
+    void ColumnarResultBuilder::setStatementId(int statementId)
+    {
+        mResult.back().statementId = statementId;
+    }
+
+    void ColumnarResultBuilder::setError(std::string_view error)
+    {
+        mResult.back().error = error;
+    }
+
+    void ColumnarResultBuilder::endResult(bool failed)
+    {
+        if (failed)
+        {
+            auto& table = mResult.back();
+            table.statementId = -1;
+            table.series.clear();
+            table.stringStorage.clear();
+        }
+    }
+
+    void ColumnarResultBuilder::beginSeries()
+    {
+        mResult.back().series.emplace_back();
+    }
+
+    void ColumnarResultBuilder::setName(std::string_view name)
+    {
+        series().name = name;
+    }
+
+    void ColumnarResultBuilder::addTag(std::string_view key, std::string_view value)
+    {
+        series().tagKeys.emplace_back(key);
+        series().tagValues.emplace_back(value);
+    }
+
+    void ColumnarResultBuilder::addColumn(std::string_view name)
+    {
+        series().columns.emplace_back().name = name;
+    }
+
+    void ColumnarResultBuilder::beginRow()
+    {
+        mColumnIndex = 0;
+
+        if (const auto row = series().rowCount; row % 64 == 0)
+        {
+            for (auto& column : series().columns)
+            {
+                column.validity.push_back(0);
+            }
+        }
+    }
+
+    void ColumnarResultBuilder::addValue(ValueType type, std::string_view text)
+    {
+        const auto row = series().rowCount;
+        auto& column = nextColumn();
+        if (type == ValueType::Null)
+        {
+            appendDefault(column);
+            return;
+        }
+
+        if (column.type == InfluxDBColumn::Type::Null)
+        {
+            initializeType(column, row, type, text);
+        }
+        if (!appendTyped(column, type, text))
+        {
+            appendString(column, text);
+        }
+        setValid(column, row);
+    }
+
+    void ColumnarResultBuilder::endRow()
+    {
+        for (auto& columns = series().columns; mColumnIndex < columns.size(); ++mColumnIndex)
+        {
+            appendDefault(columns[mColumnIndex]);
+        }
+        ++series().rowCount;
+    }
+
+    void ColumnarResultBuilder::addInteger(std::int64_t value)
+    {
+        auto& column = nextColumn(InfluxDBColumn::Type::Integer);
+        switch (column.type)
+        {
+            case InfluxDBColumn::Type::Integer:
+                column.integers.push_back(value);
+                break;
+            case InfluxDBColumn::Type::Float:
+                if (isExactFloat(value))
+                {
+                    column.floats.push_back(static_cast<double>(value));
+                    break;
+                }
+                [[fallthrough]];
+            default:
+                appendString(column, std::to_string(value));
+                break;
+        }
+        setValid(column, series().rowCount);
+    }
+
+    void ColumnarResultBuilder::addFloat(double value)
+    {
+        auto& column = nextColumn(InfluxDBColumn::Type::Float);
+        switch (column.type)
+        {
+            case InfluxDBColumn::Type::Integer:
+                if (promoteToFloat(column))
+                {
+                    column.floats.push_back(value);
+                    break;
+                }
+                appendString(column, formatFloat(value));
+                break;
+            case InfluxDBColumn::Type::Float:
+                column.floats.push_back(value);
+                break;
+            default:
+                appendString(column, formatFloat(value));
+                break;
+        }
+        setValid(column, series().rowCount);
+    }
+
+    void ColumnarResultBuilder::addTime(std::int64_t nanoseconds)
+    {
+        auto& column = nextColumn(InfluxDBColumn::Type::Time);
+        if (column.type == InfluxDBColumn::Type::Time)
+        {
+            column.integers.push_back(nanoseconds);
+        }
+        else
+        {
+            appendString(column, formatTimestamp(nanoseconds));
+        }
+        setValid(column, series().rowCount);
+    }
+
+    std::vector<InfluxDBColumnarTable> ColumnarResultBuilder::takeResult()
+    {
+        return std::move(mResult);
+    }
+
+    InfluxDBColumnarSeries& ColumnarResultBuilder::series()
+    {
+        return mResult.back().series.back();
+    }
+
+    InfluxDBColumn& ColumnarResultBuilder::nextColumn(InfluxDBColumn::Type type)
+    {
+        const auto row = series().rowCount;
+        auto& columns = series().columns;
+        if (mColumnIndex == columns.size())
+        {
+            /// More values than column names, previous rows are null
+            columns.emplace_back().validity.resize(row / 64 + 1);
+        }
+
+        auto& column = columns[mColumnIndex++];
+        if (column.type == InfluxDBColumn::Type::Null && type != InfluxDBColumn::Type::Null)
+        {
+            column.type = type;
+            for (std::size_t i = 0; i < row; ++i)
+            {
+                appendDefault(column);
+            }
+        }
+        return column;
+    }
+
+    void ColumnarResultBuilder::appendString(InfluxDBColumn& column, std::string_view text)
+    {
+        if (column.type != InfluxDBColumn::Type::String)
+        {
+            convertToString(column);
+        }
+        column.strings.push_back(store(text));
+    }
+
+    std::string_view ColumnarResultBuilder::store(std::string_view text)
+    {
+        if (text.empty())
+        {
+            return {};
+        }
+        if (text.size() > mBlockAvailable)
+        {
+            const std::size_t size = std::max(stringBlockSize, text.size());
+            auto& block = mResult.back().stringStorage.emplace_back(new char[size]);
+            mBlockPosition = block.get();
+            mBlockAvailable = size;
+        }
+
+        std::memcpy(mBlockPosition, text.data(), text.size());
+        const std::string_view stored{mBlockPosition, text.size()};
+        mBlockPosition += text.size();
+        mBlockAvailable -= text.size();
+        return stored;
+    }
+
+    void ColumnarResultBuilder::convertToString(InfluxDBColumn& column)
+    {
+        const auto row = series().rowCount;
+        std::vector<std::string_view> strings;
+        strings.reserve(row + 1);
+
+        for (std::size_t i = 0; i < row; ++i)
+        {
+            if (column.isNull(i))
+            {
+                strings.emplace_back();
+                continue;
+            }
+
+            switch (column.type)
+            {
+                case InfluxDBColumn::Type::Boolean:
+                    strings.push_back(column.booleans[i] != 0 ? "true" : "false");
+                    break;
+                case InfluxDBColumn::Type::Integer:
+                    strings.push_back(store(std::to_string(column.integers[i])));
+                    break;
+                case InfluxDBColumn::Type::Float:
+                    strings.push_back(store(formatFloat(column.floats[i])));
+                    break;
+                case InfluxDBColumn::Type::Time:
+                    strings.push_back(store(formatTimestamp(column.integers[i])));
+                    break;
+                default:
+                    strings.emplace_back();
+                    break;
+            }
+        }
+
+        column.type = InfluxDBColumn::Type::String;
+        column.strings = std::move(strings);
+        column.integers = {};
+        column.floats = {};
+        column.booleans = {};
+    }
+}
@@ -0,0 +1,159 @@
+// MIT License
+//
+// Copyright (c) 2022 TOSHIBA CORPORATION
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "InfluxDBTable.h"
+#include "InfluxDBColumnarTable.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace influxdb::internal
+{
+    /// \brief Receives the elements of a query response in order of appearance
+    ///
+    /// Strings passed are only valid during the call.
+    class QueryResultBuilder
+    {
+    public:
+        /// Type of a value as found in the response
+        enum class ValueType
+        {
+            Null,
+            Boolean,
+            /// Number as received, without conversion
+            Number,
+            String,
+            /// Array or object, serialized to JSON
+            Nested
+        };
+
+        virtual ~QueryResultBuilder() = default;
+
+        virtual void beginResult() = 0;
+        virtual void setStatementId(int statementId) = 0;
+        virtual void setError(std::string_view error) = 0;
+
+        /// Ends a statement result, failed if it contains an error
+        virtual void endResult(bool failed) = 0;
+
+        virtual void beginSeries() = 0;
+        virtual void setName(std::string_view name) = 0;
+        virtual void addTag(std::string_view key, std::string_view value) = 0;
+        virtual void addColumn(std::string_view name) = 0;
+        virtual void beginRow() = 0;
+        virtual void addValue(ValueType type, std::string_view text) = 0;
+        virtual void endRow() = 0;
+
+        /// Values of binary responses, passed to addValue() as they would appear in JSON by default
+        virtual void addInteger(std::int64_t value);
+        virtual void addFloat(double value);
+        virtual void addTime(std::int64_t nanoseconds);
+    };
+
+    /// Formats nanoseconds since epoch as RFC3339 timestamp, like InfluxDB does in JSON responses
+    std::string formatTimestamp(std::int64_t nanoseconds);
+
+    /// Formats a float with the shortest representation that parses to the same value
+    std::string formatFloat(double value);
+
+
+    /// \brief Builds results with rows of values as strings
+    class RowResultBuilder : public QueryResultBuilder
+    {
+    public:
+        void beginResult() override;
+        void setStatementId(int statementId) override;
+        void setError(std::string_view error) override;
+        void endResult(bool failed) override;
+        void beginSeries() override;
+        void setName(std::string_view name) override;
+        void addTag(std::string_view key, std::string_view value) override;
+        void addColumn(std::string_view name) override;
+        void beginRow() override;
+        void addValue(ValueType type, std::string_view text) override;
+        void endRow() override;
+
+        std::vector<InfluxDBTable> takeResult();
+
+    private:
+        std::vector<InfluxDBTable> mResult;
+    };
+
+
+    /// \brief Builds results with typed columns
+    ///
+    /// Column types are inferred from the values. Integers are promoted to
+    /// floats if a column contains both, and conflicting types turn a column
+    /// into strings. A column named "time" holding RFC3339 timestamps is
+    /// converted to nanoseconds since epoch.
+    class ColumnarResultBuilder : public QueryResultBuilder
+    {
+    public:
+        /// Size of the blocks string values are stored in
+        static constexpr std::size_t stringBlockSize{64 * 1024};
+
+        void beginResult() override;
+        void setStatementId(int statementId) override;
+        void setError(std::string_view error) override;
+        void endResult(bool failed) override;
+        void beginSeries() override;
+        void setName(std::string_view name) override;
+        void addTag(std::string_view key, std::string_view value) override;
+        void addColumn(std::string_view name) override;
+        void beginRow() override;
+        void addValue(ValueType type, std::string_view text) override;
+        void endRow() override;
+        void addInteger(std::int64_t value) override;
+        void addFloat(double value) override;
+        void addTime(std::int64_t nanoseconds) override;
+
+        std::vector<InfluxDBColumnarTable> takeResult();
+
+    private:
+        InfluxDBColumnarSeries& series();
+
+        /// Column of the next value, its type is set to the given one if all values are null
+        InfluxDBColumn& nextColumn(InfluxDBColumn::Type type = InfluxDBColumn::Type::Null);
+
+        /// Appends a value to a column, which is converted to strings before if necessary
+        void appendString(InfluxDBColumn& column, std::string_view text);
+
+        /// Copies a string into the storage of the current result
+        std::string_view store(std::string_view text);
+
+        /// Turns the values of a column into strings
+        void convertToString(InfluxDBColumn& column);
+
+        std::vector<InfluxDBColumnarTable> mResult;
+
+        /// Column of the next value of the current row
+        std::size_t mColumnIndex{0};
+
+        /// Free space of the current string block
+        char* mBlockPosition{nullptr};
+        std::size_t mBlockAvailable{0};
+    };
+}
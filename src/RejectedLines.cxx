@@ -0,0 +1,268 @@
+// MIT License
+//
+// Copyright (c) 2022 TOSHIBA CORPORATION
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "RejectedLines.h"
+#include <algorithm>
+#include <cctype>
+#include <string>
+#include <unordered_map>
+
+namespace influxdb::internal
+{
+    namespace
+    {
+        using LineIndex = std::unordered_map<std::string_view, std::vector<std::size_t>>;
+
+        /// Adds the lines quoted by parse errors, e.g. "unable to parse 'cpu value=': missing field value"
+        void addQuotedLines(const LineIndex& index, std::string_view error, std::vector<std::size_t>& rejected)
+        {
+            /// Matches both "unable to parse" (InfluxDB 1.x) and "Unable to parse"
+            constexpr std::string_view prefix{"nable to parse '"};
+            constexpr std::string_view suffix{"': "};
+
+            for (auto start = error.find(prefix); start != std::string_view::npos; start = error.find(prefix, start))
+            {
+                start += prefix.size();
+                /// The quoted line may contain the suffix itself, the first match of a line is taken
+                for (auto end = error.find(suffix, start); end != std::string_view::npos; end = error.find(suffix, end + 1))
+                {
+                    if (const auto match = index.find(error.substr(start, end - start)); match != index.end())
+                    {
+                        rejected.insert(rejected.end(), match->second.begin(), match->second.end());
+                        break;
+                    }
+                }
+            }
+        }
+
+        /// Adds the lines referred to by their number, e.g. "errors encountered on line(s): line 2: ..."
+        void addNumberedLines(std::size_t lineCount, std::string_view error, std::vector<std::size_t>& rejected)
+        {
+            constexpr std::string_view prefix{"line "};
+
+            for (auto position = error.find(prefix); position != std::string_view::npos; position = error.find(prefix, position + 1))
+            {
+                if (position > 0 && std::isalnum(static_cast<unsigned char>(error[position - 1])))
+                {
+                    continue;
+                }
+                std::size_t end = position + prefix.size();
+                std::size_t number{0};
+                while (end < error.size() && std::isdigit(static_cast<unsigned char>(error[end])) && number <= lineCount)
+                {
+                    number = number * 10 + static_cast<std::size_t>(error[end++] - '0');
+                }
+                const auto terminator = error.substr(end);
+                const bool isReference = terminator.rfind(":", 0) == 0 || terminator.rfind(" (1-based)", 0) == 0;
+                if (isReference && number >= 1 && number <= lineCount)
+                {
+                    rejected.push_back(number - 1);
+                }
+            }
+        }
+
+        /// Reads an escaped name up to one of the delimiters, returns it unescaped
+        std::string readName(std::string_view line, std::size_t& position, std::string_view delimiters)
+        {
+            std::string name;
+            while (position < line.size() && delimiters.find(line[position]) == std::string_view::npos)
+            {
+                if (line[position] == '\\' && position + 1 < line.size())
+                {
+                    ++position;
+                }
+                name += line[position++];
+            }
+            return name;
+        }
+
+        /// Returns the InfluxDB name of the type of an unquoted field value
+        std::string_view typeOf(std::string_view value)
+        {
+            constexpr std::string_view booleans[] = {"t", "T", "true", "True", "TRUE", "f", "F", "false", "False", "FALSE"};
+            if (value.empty())
+            {
+                return {};
+            }
+            if (std::find(std::begin(booleans), std::end(booleans), value) != std::end(booleans))
+            {
+                return "boolean";
+            }
+            if (value.back() == 'i')
+            {
+                return "integer";
+            }
+            if (value.back() == 'u')
+            {
+                return "unsigned";
+            }
+            return "float";
+        }
+
+        /// Returns whether the line writes the field of the measurement with a value of the type
+        bool writesField(std::string_view line, const std::string& measurement, const std::string& field, std::string_view type)
+        {
+            std::size_t position{0};
+            if (line.empty() || line.front() == '#' || readName(line, position, ", ") != measurement)
+            {
+                return false;
+            }
+            while (position < line.size() && line[position] != ' ')
+            {
+                position += (line[position] == '\\') ? 2 : 1;
+            }
+            ++position;
+
+            while (position < line.size())
+            {
+                const auto key = readName(line, position, "=");
+                ++position;
+                std::string_view valueType;
+                if (position < line.size() && line[position] == '"')
+                {
+                    for (++position; position < line.size() && line[position] != '"'; ++position)
+                    {
+                        position += (line[position] == '\\') ? 1 : 0;
+                    }
+                    ++position;
+                    valueType = "string";
+                }
+                else
+                {
+                    const auto start = position;
+                    position = std::min(line.find_first_of(", ", position), line.size());
+                    valueType = typeOf(line.substr(start, position - start));
+                }
+                if (key == field)
+                {
+                    return valueType == type;
+                }
+                if (position >= line.size() || line[position] != ',')
+                {
+                    break;
+                }
+                ++position;
+            }
+            return false;
+        }
+
+        /// Adds the lines of field type conflicts, e.g. "field type conflict: input field \"value\" on
+        /// measurement \"cpu\" is type integer, already exists as type float"
+        void addConflictingLines(const std::vector<std::string_view>& lines, std::string_view error, std::vector<std::size_t>& rejected)
+        {
+            constexpr std::string_view fieldPrefix{"input field \""};
+            constexpr std::string_view measurementPrefix{"\" on measurement \""};
+            constexpr std::string_view typePrefix{"\" is type "};
+
+            for (auto position = error.find(fieldPrefix); position != std::string_view::npos; position = error.find(fieldPrefix, position))
+            {
+                const auto fieldStart = position + fieldPrefix.size();
+                const auto fieldEnd = error.find(measurementPrefix, fieldStart);
+                if (fieldEnd == std::string_view::npos)
+                {
+                    break;
+                }
+                const auto measurementStart = fieldEnd + measurementPrefix.size();
+                const auto measurementEnd = error.find(typePrefix, measurementStart);
+                if (measurementEnd == std::string_view::npos)
+                {
+                    break;
+                }
+                const auto typeStart = measurementEnd + typePrefix.size();
+                auto typeEnd = typeStart;
+                while (typeEnd < error.size() && std::isalpha(static_cast<unsigned char>(error[typeEnd])))
+                {
+                    ++typeEnd;
+                }
+                position = typeEnd;
+
+                const std::string field{error.substr(fieldStart, fieldEnd - fieldStart)};
+                const std::string measurement{error.substr(measurementStart, measurementEnd - measurementStart)};
+                const auto type = error.substr(typeStart, typeEnd - typeStart);
+                for (std::size_t i = 0; i < lines.size(); ++i)
+                {
+                    if (writesField(lines[i], measurement, field, type))
+                    {
+                        rejected.push_back(i);
+                    }
+                }
+            }
+        }
+
+        /// Returns the number of dropped lines of a partial write, e.g. "partial write: ... dropped=2",
+        /// counting stops beyond the number of lines
+        std::size_t droppedLines(std::size_t lineCount, std::string_view error)
+        {
+            constexpr std::string_view prefix{"dropped="};
+
+            const auto position = error.rfind(prefix);
+            if (position == std::string_view::npos)
+            {
+                return 0;
+            }
+            std::size_t dropped{0};
+            for (auto digit = position + prefix.size(); digit < error.size() && std::isdigit(static_cast<unsigned char>(error[digit])) && dropped <= lineCount; ++digit)
+            {
+                dropped = dropped * 10 + static_cast<std::size_t>(error[digit] - '0');
+            }
+            return dropped;
+        }
+    }
+
+    std::vector<std::string_view> splitLines(std::string_view lines)
+    {
+        std::vector<std::string_view> result;
+        for (std::size_t start = 0;;)
+        {
+            const auto end = lines.find('\n', start);
+            if (end == std::string_view::npos)
+            {
+                result.push_back(lines.substr(start));
+                return result;
+            }
+            result.push_back(lines.substr(start, end - start));
+            start = end + 1;
+        }
+    }
+
+    RejectedLines findRejectedLines(const std::vector<std::string_view>& lines, std::string_view error)
+    {
+        LineIndex index;
+        for (std::size_t i = 0; i < lines.size(); ++i)
+        {
+            if (!lines[i].empty())
+            {
+                index[lines[i]].push_back(i);
+            }
+        }
+
+        RejectedLines rejected{{}, error.find("partial write") != std::string_view::npos, droppedLines(lines.size(), error)};
+        addQuotedLines(index, error, rejected.lines);
+        addNumberedLines(lines.size(), error, rejected.lines);
+        addConflictingLines(lines, error, rejected.lines);
+
+        std::sort(rejected.lines.begin(), rejected.lines.end());
+        rejected.lines.erase(std::unique(rejected.lines.begin(), rejected.lines.end()), rejected.lines.end());
+        return rejected;
+    }
+}
@@ -0,0 +1,50 @@
+// MIT License
+//
+// Copyright (c) 2022 TOSHIBA CORPORATION
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+namespace influxdb::internal
+{
+    /// \brief Lines of a write identified as the cause of its rejection by the error message of the server
+    struct RejectedLines
+    {
+        /// Positions of the rejected lines in ascending order
+        std::vector<std::size_t> lines;
+        /// Whether the server wrote the other lines (partial write), otherwise none was written
+        bool partialWrite;
+        /// Number of lines the server reported as dropped ("dropped=N"), 0 if not reported
+        std::size_t dropped;
+    };
+
+    /// Splits line protocol into its lines, including empty ones
+    std::vector<std::string_view> splitLines(std::string_view lines);
+
+    /// Identifies the lines rejected by the server from the error message of the response. Supported are
+    /// parse errors quoting the line, errors referring to line numbers (InfluxDB 2.x) and field type conflicts,
+    /// which reject all lines writing the field with the conflicting type.
+    RejectedLines findRejectedLines(const std::vector<std::string_view>& lines, std::string_view error);
+}
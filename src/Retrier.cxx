@@ -0,0 +1,105 @@
+// MIT License
+//
+// Copyright (c) 2022 TOSHIBA CORPORATION
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "Retrier.h"
+#include "InfluxDBException.h"
+#include <algorithm>
+#include <cmath>
+#include <exception>
+
+namespace influxdb::internal
+{
+    Retrier::Retrier(const RetryPolicy& policy, std::function<void(std::chrono::milliseconds)> sleep, std::function<Clock::time_point()> now)
+        : mPolicy(policy), mSleep(std::move(sleep)), mNow(std::move(now)), mRandom(std::random_device{}())
+    {
+        if (policy.initialBackoff.count() < 0 || policy.maxBackoff < policy.initialBackoff || policy.maxElapsed.count() < 0)
+        {
+            throw InfluxDBException{"Retrier", "Backoff must be within zero and the maximum backoff, elapsed time must not be negative"};
+        }
+        if (!(policy.multiplier >= 1.0) || !(policy.jitter >= 0.0 && policy.jitter <= 1.0))
+        {
+            throw InfluxDBException{"Retrier", "Multiplier must be at least 1 and jitter within 0 and 1"};
+        }
+    }
+
+    void Retrier::run(const std::function<void()>& send)
+    {
+        const auto start = mNow();
+        for (std::size_t retries = 0;; ++retries)
+        {
+            std::exception_ptr error;
+            std::chrono::milliseconds requested{0};
+            try
+            {
+                send();
+                if (retries > 0)
+                {
+                    ++mRecovered;
+                }
+                return;
+            }
+            catch (const TooManyRequests& e)
+            {
+                error = std::current_exception();
+                requested = e.retryAfter();
+            }
+            catch (const ConnectionError&)
+            {
+                error = std::current_exception();
+            }
+            catch (const ServerError&)
+            {
+                error = std::current_exception();
+            }
+            catch (...)
+            {
+                ++mRejected;
+                throw;
+            }
+
+            const auto delay = std::max(requested, backoff(retries));
+            const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(mNow() - start);
+            if (retries >= mPolicy.maxRetries || elapsed + delay > mPolicy.maxElapsed)
+            {
+                ++mExhausted;
+                std::rethrow_exception(error);
+            }
+            mSleep(delay);
+            ++mRetries;
+        }
+    }
+
+    std::chrono::milliseconds Retrier::backoff(std::size_t retries)
+    {
+        const double exponential = static_cast<double>(mPolicy.initialBackoff.count()) * std::pow(mPolicy.multiplier, static_cast<double>(retries));
+        const double base = std::min(exponential, static_cast<double>(mPolicy.maxBackoff.count()));
+        std::uniform_real_distribution<double> random{0.0, 1.0};
+        const double delay = base * (1.0 - mPolicy.jitter * random(mRandom));
+        return std::chrono::milliseconds{std::llround(delay)};
+    }
+
+    RetryStatistics Retrier::statistics() const
+    {
+        return RetryStatistics{mRetries, mRecovered, mExhausted, mRejected};
+    }
+}
@@ -0,0 +1,78 @@
+// MIT License
+//
+// Copyright (c) 2022 TOSHIBA CORPORATION
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+
+#include "InfluxDB.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <thread>
+
+namespace influxdb::internal
+{
+    /// \brief Retries sends failing as the server is unavailable or rate limited
+    ///
+    /// Connection errors, server errors (5xx) and rate limiting (429) are retried after an exponentially
+    /// growing delay, randomized by the jitter of the policy so that clients don't retry in lockstep after
+    /// an outage. A delay requested by the server (Retry-After) is waited at least. Other errors are thrown
+    /// without retrying, as the same request would fail again.
+    class Retrier
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        /// \param sleep   waits for the delay before a retry
+        /// \param now     returns the current time
+        /// \throw InfluxDBException   if the policy is invalid
+        explicit Retrier(const RetryPolicy& policy,
+                         std::function<void(std::chrono::milliseconds)> sleep = [](std::chrono::milliseconds delay) { std::this_thread::sleep_for(delay); },
+                         std::function<Clock::time_point()> now = Clock::now);
+
+        Retrier(const Retrier&) = delete;
+        Retrier& operator=(const Retrier&) = delete;
+
+        /// Calls send until it succeeds or the policy is exhausted
+        /// \throw InfluxDBException   the error of the last attempt
+        void run(const std::function<void()>& send);
+
+        /// Returns the delay before the retry following the given number of retries
+        std::chrono::milliseconds backoff(std::size_t retries);
+
+        /// Returns the counters of retries and their outcomes
+        RetryStatistics statistics() const;
+
+    private:
+        const RetryPolicy mPolicy;
+        const std::function<void(std::chrono::milliseconds)> mSleep;
+        const std::function<Clock::time_point()> mNow;
+        std::mt19937 mRandom;
+
+        std::atomic<std::uint64_t> mRetries{0};
+        std::atomic<std::uint64_t> mRecovered{0};
+        std::atomic<std::uint64_t> mExhausted{0};
+        std::atomic<std::uint64_t> mRejected{0};
+    };
+}
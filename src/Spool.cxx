@@ -0,0 +1,386 @@
+// MIT License
+//
+// Copyright (c) 2022 TOSHIBA CORPORATION
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "Spool.h"
+#include "InfluxDBException.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <system_error>
+#include <vector>
+#include <zlib.h>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace influxdb::internal
+{
+#ifndef _WIN32
+
+    namespace
+    {
+        /// Identifies segment files, followed by the format version
+        constexpr std::uint32_t magic{0x4C505349};
+        constexpr std::uint32_t version{1};
+        constexpr std::size_t fileHeaderSize{2 * sizeof(std::uint32_t)};
+
+        /// Precedes the batch of a record, the size is written last and commits the record
+        struct RecordHeader
+        {
+            std::uint32_t size;
+            std::uint32_t checksum;
+            std::uint32_t consumed;
+            std::uint32_t reserved;
+        };
+
+        constexpr std::size_t recordHeaderSize{sizeof(RecordHeader)};
+        constexpr std::string_view suffix{".spool"};
+        constexpr std::size_t sequenceDigits{20};
+
+        [[noreturn]] void throwSystemError(const char* function)
+        {
+            throw InfluxDBException{function, std::generic_category().message(errno)};
+        }
+
+        RecordHeader readHeader(const char* data)
+        {
+            RecordHeader header;
+            std::memcpy(&header, data, sizeof(header));
+            return header;
+        }
+
+        std::uint32_t checksumOf(const char* data, std::size_t size)
+        {
+            return static_cast<std::uint32_t>(crc32(0, reinterpret_cast<const Bytef*>(data), static_cast<uInt>(size)));
+        }
+    }
+
+    Spool::Spool(const std::string& directory, std::size_t maxBytes, std::size_t segmentSize)
+        : mDirectory(directory), mMaxBytes(maxBytes), mSegmentSize(std::max(segmentSize, fileHeaderSize + recordHeaderSize)), mLockHandle(-1), mSegments{}, mStatistics{}
+    {
+        if (mkdir(mDirectory.c_str(), 0755) != 0 && errno != EEXIST)
+        {
+            throwSystemError("Spool");
+        }
+        mLockHandle = open((mDirectory + "/lock").c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (mLockHandle < 0)
+        {
+            throwSystemError("Spool");
+        }
+        if (flock(mLockHandle, LOCK_EX | LOCK_NB) != 0)
+        {
+            close(mLockHandle);
+            throw InfluxDBException{"Spool", "Directory is in use by another spool: " + mDirectory};
+        }
+
+        std::vector<std::uint64_t> sequences;
+        if (DIR* entries = opendir(mDirectory.c_str()); entries != nullptr)
+        {
+            while (const dirent* entry = readdir(entries))
+            {
+                const std::string_view name{entry->d_name};
+                if (name.size() == sequenceDigits + suffix.size() && name.substr(sequenceDigits) == suffix
+                    && std::all_of(name.begin(), name.begin() + sequenceDigits, [](char c) { return c >= '0' && c <= '9'; }))
+                {
+                    sequences.push_back(std::stoull(std::string{name.substr(0, sequenceDigits)}));
+                }
+            }
+            closedir(entries);
+        }
+        std::sort(sequences.begin(), sequences.end());
+
+        try
+        {
+            for (const auto sequence : sequences)
+            {
+                Segment segment = openSegment(sequence);
+                if (segment.data == nullptr)
+                {
+                    continue;
+                }
+                mSegments.push_back(segment);
+                mStatistics.pending += segment.records;
+                mStatistics.bytes += segment.size;
+            }
+            /// Fully consumed segments are only kept as the newest one, to continue their sequence
+            while (mSegments.size() > 1 && mSegments.front().records == 0)
+            {
+                removeOldest();
+            }
+        }
+        catch (...)
+        {
+            release();
+            throw;
+        }
+    }
+
+    Spool::~Spool()
+    {
+        release();
+    }
+
+    void Spool::append(std::string_view batch)
+    {
+        const std::size_t recordSize = recordHeaderSize + batch.size();
+        if (fileHeaderSize + recordSize > mMaxBytes || batch.size() > UINT32_MAX)
+        {
+            ++mStatistics.evicted;
+            return;
+        }
+
+        if (mSegments.empty() || mSegments.back().writeOffset + recordSize > mSegments.back().size)
+        {
+            if (mSegments.size() == 1 && mSegments.front().records == 0)
+            {
+                removeOldest();
+            }
+            const std::size_t size = std::max(std::min(mSegmentSize, mMaxBytes), fileHeaderSize + recordSize);
+            while (!mSegments.empty() && mStatistics.bytes + size > mMaxBytes)
+            {
+                mStatistics.evicted += mSegments.front().records;
+                removeOldest();
+            }
+            createSegment(size);
+        }
+
+        Segment& segment = mSegments.back();
+        char* record = segment.data + segment.writeOffset;
+        std::memcpy(record + recordHeaderSize, batch.data(), batch.size());
+        const RecordHeader header{static_cast<std::uint32_t>(batch.size()), checksumOf(batch.data(), batch.size()), 0, 0};
+        std::memcpy(record + sizeof(header.size), &header.checksum, sizeof(header) - sizeof(header.size));
+        std::memcpy(record, &header.size, sizeof(header.size));
+
+        if (segment.records == 0)
+        {
+            segment.readOffset = segment.writeOffset;
+        }
+        segment.writeOffset += recordSize;
+        ++segment.records;
+        ++mStatistics.spooled;
+        ++mStatistics.pending;
+    }
+
+    bool Spool::empty() const
+    {
+        return mStatistics.pending == 0;
+    }
+
+    std::string_view Spool::front() const
+    {
+        const Segment& segment = mSegments.front();
+        const RecordHeader header = readHeader(segment.data + segment.readOffset);
+        return std::string_view{segment.data + segment.readOffset + recordHeaderSize, header.size};
+    }
+
+    void Spool::pop()
+    {
+        Segment& segment = mSegments.front();
+        char* record = segment.data + segment.readOffset;
+        const RecordHeader header = readHeader(record);
+        const std::uint32_t consumed{1};
+        std::memcpy(record + offsetof(RecordHeader, consumed), &consumed, sizeof(consumed));
+
+        segment.readOffset += recordHeaderSize + header.size;
+        --segment.records;
+        ++mStatistics.replayed;
+        --mStatistics.pending;
+        if (segment.records == 0 && mSegments.size() > 1)
+        {
+            removeOldest();
+        }
+    }
+
+    SpoolStatistics Spool::statistics() const
+    {
+        return mStatistics;
+    }
+
+    Spool::Segment& Spool::createSegment(std::size_t size)
+    {
+        const std::uint64_t sequence = (mSegments.empty() ? 0 : mSegments.back().sequence + 1);
+        const std::string path = segmentPath(sequence);
+        const int handle = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (handle < 0)
+        {
+            throwSystemError("Spool");
+        }
+
+        /// Allocates the blocks, writing to a mapping of a sparse file fails with SIGBUS if the disk is full
+#ifdef __linux__
+        const bool allocated = (posix_fallocate(handle, 0, static_cast<off_t>(size)) == 0);
+#else
+        const bool allocated = (ftruncate(handle, static_cast<off_t>(size)) == 0);
+#endif
+        void* data = allocated ? mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, handle, 0) : MAP_FAILED;
+        if (data == MAP_FAILED)
+        {
+            const int error = errno;
+            close(handle);
+            unlink(path.c_str());
+            throw InfluxDBException{"Spool", std::generic_category().message(error)};
+        }
+
+        char* bytes = static_cast<char*>(data);
+        std::memcpy(bytes, &magic, sizeof(magic));
+        std::memcpy(bytes + sizeof(magic), &version, sizeof(version));
+        mStatistics.bytes += size;
+        return mSegments.emplace_back(Segment{sequence, handle, bytes, size, fileHeaderSize, fileHeaderSize, 0});
+    }
+
+    Spool::Segment Spool::openSegment(std::uint64_t sequence)
+    {
+        const std::string path = segmentPath(sequence);
+        Segment segment{sequence, open(path.c_str(), O_RDWR | O_CLOEXEC), nullptr, 0, fileHeaderSize, fileHeaderSize, 0};
+        if (segment.handle < 0)
+        {
+            throwSystemError("Spool");
+        }
+
+        struct stat status{};
+        void* data = MAP_FAILED;
+        if (fstat(segment.handle, &status) == 0 && static_cast<std::size_t>(status.st_size) >= fileHeaderSize)
+        {
+            segment.size = static_cast<std::size_t>(status.st_size);
+            data = mmap(nullptr, segment.size, PROT_READ | PROT_WRITE, MAP_SHARED, segment.handle, 0);
+        }
+        std::uint32_t fileMagic{0};
+        std::uint32_t fileVersion{0};
+        if (data != MAP_FAILED)
+        {
+            std::memcpy(&fileMagic, data, sizeof(fileMagic));
+            std::memcpy(&fileVersion, static_cast<char*>(data) + sizeof(fileMagic), sizeof(fileVersion));
+        }
+        if (fileMagic != magic || fileVersion != version)
+        {
+            /// Not created completely before a crash
+            if (data != MAP_FAILED)
+            {
+                munmap(data, segment.size);
+            }
+            close(segment.handle);
+            unlink(path.c_str());
+            return Segment{sequence, -1, nullptr, 0, 0, 0, 0};
+        }
+        segment.data = static_cast<char*>(data);
+
+        bool consumed{true};
+        for (std::size_t offset = fileHeaderSize; offset + recordHeaderSize <= segment.size;)
+        {
+            const RecordHeader header = readHeader(segment.data + offset);
+            const std::size_t end = offset + recordHeaderSize + header.size;
+            if (header.size == 0 || end > segment.size || header.checksum != checksumOf(segment.data + offset + recordHeaderSize, header.size))
+            {
+                /// End of the records or a torn one, which is overwritten by the next append
+                break;
+            }
+            if (header.consumed == 0)
+            {
+                if (consumed)
+                {
+                    segment.readOffset = offset;
+                    consumed = false;
+                }
+                ++segment.records;
+            }
+            offset = end;
+            segment.writeOffset = end;
+        }
+        if (consumed)
+        {
+            segment.readOffset = segment.writeOffset;
+        }
+        return segment;
+    }
+
+    void Spool::removeOldest()
+    {
+        const Segment& segment = mSegments.front();
+        munmap(segment.data, segment.size);
+        close(segment.handle);
+        unlink(segmentPath(segment.sequence).c_str());
+        mStatistics.pending -= segment.records;
+        mStatistics.bytes -= segment.size;
+        mSegments.pop_front();
+    }
+
+    void Spool::release()
+    {
+        for (const auto& segment : mSegments)
+        {
+            munmap(segment.data, segment.size);
+            close(segment.handle);
+        }
+        close(mLockHandle);
+    }
+
+    std::string Spool::segmentPath(std::uint64_t sequence) const
+    {
+        std::string name = std::to_string(sequence);
+        name.insert(0, sequenceDigits - name.size(), '0');
+        return mDirectory + "/" + name + std::string{suffix};
+    }
+
+#else
+
+    Spool::Spool(const std::string&, std::size_t, std::size_t)
+        : mMaxBytes(0), mSegmentSize(0), mLockHandle(-1), mSegments{}, mStatistics{}
+    {
+        throw InfluxDBException{"Spool", "Spool not supported on this system"};
+    }
+
+    Spool::~Spool() = default;
+
+    void Spool::append(std::string_view)
+    {
+    }
+
+    bool Spool::empty() const
+    {
+        return true;
+    }
+
+    std::string_view Spool::front() const
+    {
+        return {};
+    }
+
+    void Spool::pop()
+    {
+    }
+
+    SpoolStatistics Spool::statistics() const
+    {
+        return {};
+    }
+
+#endif // _WIN32
+}
@@ -0,0 +1,105 @@
+// MIT License
+//
+// Copyright (c) 2022 TOSHIBA CORPORATION
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+
+#include "InfluxDB.h"
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+
+namespace influxdb::internal
+{
+    /// \brief Write-ahead spool of batches which couldn't be sent, kept in memory mapped segment files
+    ///
+    /// Batches are appended to the newest segment and consumed from the oldest one, which is deleted once
+    /// all of its batches are consumed. Batches and the state of consumption are written to the files, so
+    /// a spool opened again after a restart continues with the oldest batch not consumed. Torn records of a
+    /// crash are detected by their checksum and discarded. If the segments exceed the disk quota, the
+    /// oldest ones are evicted.
+    class Spool
+    {
+    public:
+        /// Default size of segment files, a batch exceeding it gets a segment of its own
+        static constexpr std::size_t defaultSegmentSize{16 * 1024 * 1024};
+
+        /// Opens the spool in the directory, which is created if missing
+        /// \param maxBytes      disk quota of all segment files
+        /// \param segmentSize   size of segment files
+        /// \throw InfluxDBException	if the directory can't be used or is in use by another spool
+        Spool(const std::string& directory, std::size_t maxBytes, std::size_t segmentSize = defaultSegmentSize);
+        ~Spool();
+
+        Spool(const Spool&) = delete;
+        Spool& operator=(const Spool&) = delete;
+
+        /// Appends a batch, evicting the oldest segments to stay within the quota.
+        /// A batch exceeding the quota alone is dropped and counted as evicted.
+        /// \throw InfluxDBException	if the segment file can't be created
+        void append(std::string_view batch);
+
+        /// Whether all batches are consumed
+        bool empty() const;
+
+        /// Returns the oldest batch not consumed, valid until the next call of pop() or append()
+        std::string_view front() const;
+
+        /// Consumes the oldest batch
+        void pop();
+
+        /// Returns the counters and the size of the spool
+        SpoolStatistics statistics() const;
+
+    private:
+        struct Segment
+        {
+            std::uint64_t sequence;
+            int handle;
+            char* data;
+            std::size_t size;
+            /// Offset of the oldest record not consumed
+            std::size_t readOffset;
+            /// Offset after the last record
+            std::size_t writeOffset;
+            /// Number of records not consumed
+            std::size_t records;
+        };
+
+        Segment& createSegment(std::size_t size);
+        Segment openSegment(std::uint64_t sequence);
+        void removeOldest();
+        void release();
+        std::string segmentPath(std::uint64_t sequence) const;
+
+        const std::string mDirectory;
+        const std::size_t mMaxBytes;
+        const std::size_t mSegmentSize;
+        /// Lock of the directory against other processes
+        int mLockHandle;
+        /// Segments by age, oldest first
+        std::deque<Segment> mSegments;
+        SpoolStatistics mStatistics;
+    };
+}
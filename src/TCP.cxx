@@ -0,0 +1,246 @@
+// MIT License
+//
+// Copyright (c) 2022 TOSHIBA CORPORATION
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "TCP.h"
+#include "InfluxDBException.h"
+#include <algorithm>
+#include <string>
+#include <system_error>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <cstring>
+#include <netdb.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/uio.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+#endif
+
+namespace influxdb::transports
+{
+#ifndef _WIN32
+
+namespace
+{
+  /// Waits until the socket is ready for the events, returns false on timeout
+  bool await(int handle, short events)
+  {
+    pollfd descriptor{handle, events, 0};
+    int result{0};
+    do
+    {
+      result = poll(&descriptor, 1, static_cast<int>(TCP::timeout.count()));
+    } while (result < 0 && errno == EINTR);
+    if (result < 0)
+    {
+      internal::NativeSocket::throwLastError("poll");
+    }
+    return result > 0;
+  }
+}
+
+TCP::TCP(const std::string &hostname, int port)
+{
+  addrinfo hints{};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  addrinfo *addresses{nullptr};
+  if (const int error = getaddrinfo(hostname.empty() ? nullptr : hostname.c_str(), std::to_string(port).c_str(), &hints, &addresses); error != 0)
+  {
+    throw InfluxDBException("resolve", gai_strerror(error));
+  }
+  for (const addrinfo *address = addresses; address != nullptr; address = address->ai_next)
+  {
+    sockaddr_storage storage{};
+    std::memcpy(&storage, address->ai_addr, address->ai_addrlen);
+    mAddresses.emplace_back(storage, address->ai_addrlen);
+  }
+  freeaddrinfo(addresses);
+}
+
+void TCP::send(std::string &&message)
+{
+  if (mSocket && connectionLost())
+  {
+    reset();
+  }
+  if (!mSocket)
+  {
+    connect();
+  }
+
+  if (!write(message))
+  {
+    /// The message is sent again on a new connection, as it's unknown how much of it was received
+    reset();
+    connect();
+    if (!write(message))
+    {
+      reset();
+      throw ConnectionError(__func__, "Connection lost");
+    }
+  }
+}
+
+void TCP::connect()
+{
+  const auto now = std::chrono::steady_clock::now();
+  if (now < mNextConnect)
+  {
+    const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(mNextConnect - now);
+    throw ConnectionError(__func__, "Connection failed, retrying in " + std::to_string(remaining.count()) + " ms");
+  }
+
+  std::string error{"No address"};
+  for (const auto &[address, length] : mAddresses)
+  {
+    auto socket = std::make_unique<internal::NativeSocket>(address.ss_family, SOCK_STREAM);
+    bool connected = (::connect(socket->handle(), reinterpret_cast<const sockaddr *>(&address), length) == 0);
+    if (!connected && errno == EINPROGRESS)
+    {
+      int result{ETIMEDOUT};
+      socklen_t resultLength{sizeof(result)};
+      if (await(socket->handle(), POLLOUT))
+      {
+        getsockopt(socket->handle(), SOL_SOCKET, SO_ERROR, &result, &resultLength);
+      }
+      errno = result;
+      connected = (result == 0);
+    }
+    if (!connected)
+    {
+      error = std::generic_category().message(errno);
+      continue;
+    }
+
+    /// Messages are written as a whole, waiting for more data doesn't save packets
+    int enabled{1};
+    setsockopt(socket->handle(), IPPROTO_TCP, TCP_NODELAY, &enabled, sizeof(enabled));
+#ifdef SO_NOSIGPIPE
+    setsockopt(socket->handle(), SOL_SOCKET, SO_NOSIGPIPE, &enabled, sizeof(enabled));
+#endif
+    mSocket = std::move(socket);
+    mBackoff = minBackoff;
+    ++mConnects;
+    return;
+  }
+
+  mNextConnect = now + mBackoff;
+  mBackoff = std::min(mBackoff * 2, maxBackoff);
+  throw ConnectionError(__func__, error);
+}
+
+void TCP::reset()
+{
+  mSocket.reset();
+  ++mConnectionResets;
+}
+
+bool TCP::connectionLost() const
+{
+  pollfd descriptor{mSocket->handle(), POLLIN, 0};
+  if (poll(&descriptor, 1, 0) <= 0)
+  {
+    return false;
+  }
+  char data{0};
+  const auto result = recv(mSocket->handle(), &data, sizeof(data), MSG_PEEK);
+  return result == 0 || (result < 0 && !internal::NativeSocket::wouldBlock());
+}
+
+bool TCP::write(const std::string &message)
+{
+  static char newline{'\n'};
+  iovec vectors[2] = {{const_cast<char *>(message.data()), message.size()}, {&newline, 1}};
+  msghdr header{};
+  header.msg_iov = vectors;
+  header.msg_iovlen = (message.empty() || message.back() == '\n') ? 1 : 2;
+
+  while (header.msg_iovlen > 0)
+  {
+    const auto result = sendmsg(mSocket->handle(), &header, MSG_NOSIGNAL);
+    if (result < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      if (internal::NativeSocket::wouldBlock())
+      {
+        if (!await(mSocket->handle(), POLLOUT))
+        {
+          /// A partially written line would corrupt the next message
+          reset();
+          throw ConnectionError("send", "Timed out");
+        }
+        continue;
+      }
+      return false;
+    }
+
+    mBytesSent += static_cast<std::uint64_t>(result);
+    auto written = static_cast<std::size_t>(result);
+    while (header.msg_iovlen > 0 && written >= header.msg_iov->iov_len)
+    {
+      written -= header.msg_iov->iov_len;
+      ++header.msg_iov;
+      --header.msg_iovlen;
+    }
+    if (header.msg_iovlen > 0)
+    {
+      header.msg_iov->iov_base = static_cast<char *>(header.msg_iov->iov_base) + written;
+      header.msg_iov->iov_len -= written;
+    }
+  }
+  return true;
+}
+
+StreamStatistics TCP::streamStatistics() const
+{
+  return StreamStatistics{mBytesSent, mConnects, mConnectionResets};
+}
+
+#else
+
+TCP::TCP(const std::string&, int)
+{
+  throw InfluxDBException{__func__, "TCP transport not supported on this system"};
+}
+
+void TCP::send(std::string&&)
+{
+  throw InfluxDBException{__func__, "TCP transport not supported on this system"};
+}
+
+StreamStatistics TCP::streamStatistics() const
+{
+  return StreamStatistics{};
+}
+
+#endif // _WIN32
+
+} // namespace influxdb::transports
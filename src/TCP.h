@@ -0,0 +1,109 @@
+// MIT License
+//
+// Copyright (c) 2022 TOSHIBA CORPORATION
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef INFLUXDATA_TRANSPORTS_TCP_H
+#define INFLUXDATA_TRANSPORTS_TCP_H
+
+#include "Transport.h"
+#include "NativeSocket.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace influxdb::transports
+{
+
+/// \brief TCP transport for line protocol listeners (e.g. the socket_listener of Telegraf)
+///
+/// Keeps a persistent connection, which is reestablished on the next send if it was lost. Connection
+/// attempts after a failed one are delayed by an exponential backoff. A message interrupted by a lost
+/// connection is sent again, lines may thus be delivered twice.
+class TCP : public Transport
+{
+  public:
+    /// Initial delay of connection attempts after a failed one
+    static constexpr std::chrono::milliseconds minBackoff{100};
+
+    /// Maximum delay of connection attempts after failed ones
+    static constexpr std::chrono::milliseconds maxBackoff{30000};
+
+    /// Time to wait for a connection or the send buffer to take more data
+    static constexpr std::chrono::milliseconds timeout{10000};
+
+    /// Resolves the host, the connection is established on the first send
+    /// \throw InfluxDBException	if the host can't be resolved
+    TCP(const std::string &hostname, int port);
+
+    /// Writes the newline terminated lines of the message
+    /// \throw ConnectionError	if no connection can be established or writing times out
+    void send(std::string&& message) override;
+
+    /// Returns the counters of the connection
+    StreamStatistics streamStatistics() const override;
+
+#ifndef _WIN32
+  private:
+    /// Connects to the first reachable address of the host, unless the backoff delay didn't pass yet
+    void connect();
+
+    /// Closes the connection after it was lost
+    void reset();
+
+    /// Whether the peer closed the connection or it failed, listeners don't send anything
+    bool connectionLost() const;
+
+    /// Writes the message and its terminating newline by a gathering write,
+    /// returns false if the connection was lost
+    bool write(const std::string &message);
+
+    /// Resolved addresses of the host
+    std::vector<std::pair<sockaddr_storage, socklen_t>> mAddresses;
+
+    /// Connected socket, if any
+    std::unique_ptr<internal::NativeSocket> mSocket;
+
+    /// Earliest time of the next connection attempt
+    std::chrono::steady_clock::time_point mNextConnect;
+
+    /// Delay after the next failed connection attempt
+    std::chrono::milliseconds mBackoff{minBackoff};
+
+    /// Number of bytes written
+    std::atomic<std::uint64_t> mBytesSent{0};
+
+    /// Number of established connections
+    std::atomic<std::uint64_t> mConnects{0};
+
+    /// Number of connections lost
+    std::atomic<std::uint64_t> mConnectionResets{0};
+#endif // _WIN32
+};
+
+} // namespace influxdb::transports
+
+#endif // INFLUXDATA_TRANSPORTS_TCP_H
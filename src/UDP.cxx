@@ -26,31 +26,264 @@
 ///
 
 #include "UDP.h"
+#include "DatagramPacker.h"
 #include "InfluxDBException.h"
+#include <algorithm>
+#include <cstring>
+#include <memory>
 #include <string>
 
+#ifndef _WIN32
+#include <netdb.h>
+#endif
+
+#ifdef __linux__
+#include <cerrno>
+#include <netinet/udp.h>
+#include <sys/uio.h>
+
+#ifndef SOL_UDP
+#define SOL_UDP 17
+#endif
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+#endif
+
 namespace influxdb::transports
 {
+namespace
+{
+  /// Headers of IPv4 and UDP
+  constexpr std::size_t headerSize{28};
+
+  /// Payload fitting the Ethernet MTU, used if the MTU of the route is unknown
+  constexpr std::size_t defaultDatagramSize{1500 - headerSize};
+
+  /// Resolves the IPv4 address of the host, the loopback address if empty
+  sockaddr_in resolve(const std::string &hostname, int port)
+  {
+    addrinfo hints{};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    addrinfo *addresses{nullptr};
+    if (const int error = getaddrinfo(hostname.empty() ? nullptr : hostname.c_str(), std::to_string(port).c_str(), &hints, &addresses); error != 0)
+    {
+      throw InfluxDBException("resolve", gai_strerror(error));
+    }
+    const std::unique_ptr<addrinfo, decltype(&freeaddrinfo)> owner{addresses, &freeaddrinfo};
+    sockaddr_in endpoint{};
+    std::memcpy(&endpoint, addresses->ai_addr, sizeof(endpoint));
+    return endpoint;
+  }
+
+  /// Returns the payload fitting the MTU of the route to the endpoint
+  std::size_t routeDatagramSize(const sockaddr_in &endpoint)
+  {
+#ifdef __linux__
+    /// Only a probe is connected, sends on a connected socket fail after ICMP errors
+    const internal::NativeSocket probe{AF_INET};
+    int mtu{0};
+    socklen_t length{sizeof(mtu)};
+    if (connect(probe.handle(), reinterpret_cast<const sockaddr *>(&endpoint), sizeof(endpoint)) == 0
+        && getsockopt(probe.handle(), IPPROTO_IP, IP_MTU, &mtu, &length) == 0 && mtu > static_cast<int>(headerSize))
+    {
+      return std::min(static_cast<std::size_t>(mtu) - headerSize, UDP::maxPayloadSize);
+    }
+#else
+    static_cast<void>(endpoint);
+#endif
+    return defaultDatagramSize;
+  }
+
+#ifdef __linux__
+  /// Maximum number of segments of a send with segmentation offload
+  constexpr std::size_t maxSegments{64};
+#endif
+}
 
 UDP::UDP(const std::string &hostname, int port) :
-  mSocket(mIoService, boost::asio::ip::udp::endpoint(boost::asio::ip::udp::v4(), 0))
+  mSocket(AF_INET), mEndpoint(resolve(hostname, port)), mMaxDatagramSize(routeDatagramSize(mEndpoint))
 {
-  boost::asio::ip::udp::resolver resolver(mIoService);
-  boost::asio::ip::udp::resolver::query query(boost::asio::ip::udp::v4(), hostname, std::to_string(port));
-  boost::asio::ip::udp::resolver::iterator resolverInerator = resolver.resolve(query);
-  mEndpoint = *resolverInerator;
 }
 
 void UDP::send(std::string &&message)
 {
-  try
+  mDatagramViews.clear();
+  mOversizeLines += internal::packDatagrams(message, mMaxDatagramSize, [this](std::string_view datagram) { mDatagramViews.push_back(datagram); });
+
+  std::size_t sent{0};
+#ifdef __linux__
+  if (mSegmentationOffload && maxPayloadSize / mMaxDatagramSize >= 2)
+  {
+    sent = sendSegments(mDatagramViews.data(), mDatagramViews.size());
+    mSegmentationOffload = (sent == mDatagramViews.size());
+  }
+#endif
+  sendDatagrams(mDatagramViews.data() + sent, mDatagramViews.size() - sent);
+}
+
+void UDP::setSendBufferSize(std::size_t bytes)
+{
+  mSocket.setSendBufferSize(bytes);
+}
+
+void UDP::drop(std::size_t count)
+{
+  /// The send buffer is unlikely to drain within the next calls, so the rest of the message is dropped
+  mDroppedDatagrams += count;
+}
+
+void UDP::sendDatagrams(const std::string_view *datagrams, std::size_t count)
+{
+#ifdef __linux__
+  std::vector<iovec> vectors(count);
+  std::vector<mmsghdr> headers(count);
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    vectors[i].iov_base = const_cast<char *>(datagrams[i].data());
+    vectors[i].iov_len = datagrams[i].size();
+    headers[i].msg_hdr.msg_name = &mEndpoint;
+    headers[i].msg_hdr.msg_namelen = sizeof(mEndpoint);
+    headers[i].msg_hdr.msg_iov = &vectors[i];
+    headers[i].msg_hdr.msg_iovlen = 1;
+  }
+
+  for (std::size_t sent = 0; sent < count;)
+  {
+    const auto batch = static_cast<unsigned int>(std::min<std::size_t>(count - sent, UIO_MAXIOV));
+    const int result = sendmmsg(mSocket.handle(), &headers[sent], batch, 0);
+    ++mSendCalls;
+    if (result < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      if (internal::NativeSocket::wouldBlock())
+      {
+        drop(count - sent);
+        return;
+      }
+      internal::NativeSocket::throwLastError("send");
+    }
+    sent += static_cast<std::size_t>(result);
+    mDatagrams += static_cast<std::uint64_t>(result);
+  }
+#else
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    ++mSendCalls;
+    if (!mSocket.sendTo(datagrams[i].data(), datagrams[i].size(), reinterpret_cast<const sockaddr *>(&mEndpoint), sizeof(mEndpoint)))
+    {
+      drop(count - i);
+      return;
+    }
+    ++mDatagrams;
+  }
+#endif
+}
+
+#ifdef __linux__
+std::size_t UDP::sendSegments(const std::string_view *datagrams, std::size_t count)
+{
+  const std::size_t segmentSize = mMaxDatagramSize;
+  const std::size_t segmentsPerSend = std::min(maxSegments, maxPayloadSize / segmentSize);
+
+  std::size_t next{0};
+  while (next < count)
+  {
+    /// Datagrams of the segment size are padded with empty lines, except the last one of the send
+    std::size_t segments{0};
+    mSegments.clear();
+    while (next + segments < count && segments < segmentsPerSend && datagrams[next + segments].size() <= segmentSize)
+    {
+      mSegments.resize(segments * segmentSize, '\n');
+      mSegments.append(datagrams[next + segments]);
+      ++segments;
+    }
+    if (segments < 2)
+    {
+      /// Single datagrams and oversize lines are sent as they are
+      sendDatagrams(datagrams + next, 1);
+      ++next;
+      continue;
+    }
+
+    iovec vector{mSegments.data(), mSegments.size()};
+    char control[CMSG_SPACE(sizeof(std::uint16_t))] = {};
+    msghdr header{};
+    header.msg_name = &mEndpoint;
+    header.msg_namelen = sizeof(mEndpoint);
+    header.msg_iov = &vector;
+    header.msg_iovlen = 1;
+    header.msg_control = control;
+    header.msg_controllen = sizeof(control);
+    cmsghdr *segmentation = CMSG_FIRSTHDR(&header);
+    segmentation->cmsg_level = SOL_UDP;
+    segmentation->cmsg_type = UDP_SEGMENT;
+    segmentation->cmsg_len = CMSG_LEN(sizeof(std::uint16_t));
+    const auto size = static_cast<std::uint16_t>(segmentSize);
+    std::memcpy(CMSG_DATA(segmentation), &size, sizeof(size));
+
+    ssize_t result{0};
+    do
+    {
+      result = sendmsg(mSocket.handle(), &header, 0);
+      ++mSendCalls;
+    } while (result < 0 && errno == EINTR);
+    if (result < 0)
+    {
+      if (errno == EIO)
+      {
+        /// The device of the route can't checksum segments
+        return next;
+      }
+      if (internal::NativeSocket::wouldBlock())
+      {
+        drop(count - next);
+        return count;
+      }
+      internal::NativeSocket::throwLastError("send");
+    }
+    next += segments;
+    mDatagrams += segments;
+  }
+  return count;
+}
+#endif
+
+void UDP::setMaxDatagramSize(std::size_t maxSize)
+{
+  if (maxSize == 0 || maxSize > maxPayloadSize)
   {
-    mSocket.send_to(boost::asio::buffer(message, message.size()), mEndpoint);
+    throw InfluxDBException(__func__, "Datagram size must be within 1 and " + std::to_string(maxPayloadSize) + " bytes");
   }
-  catch (const boost::system::system_error &e)
+  mMaxDatagramSize = maxSize;
+}
+
+void UDP::enableSegmentationOffload()
+{
+#ifdef __linux__
+  int disabled{0};
+  if (setsockopt(mSocket.handle(), SOL_UDP, UDP_SEGMENT, &disabled, sizeof(disabled)) != 0)
   {
-    throw InfluxDBException(__func__, e.what());
+    throw InfluxDBException(__func__, "Segmentation offload is not supported by the system");
   }
+  mSegmentationOffload = true;
+#else
+  throw InfluxDBException(__func__, "Segmentation offload requires Linux");
+#endif
+}
+
+DatagramStatistics UDP::datagramStatistics() const
+{
+  return DatagramStatistics{mDatagrams, mOversizeLines, mSendCalls, mDroppedDatagrams};
+}
+
+std::size_t UDP::maxDatagramSize() const
+{
+  return mMaxDatagramSize;
 }
 
 } // namespace influxdb::transports
@@ -29,33 +29,96 @@
 #define INFLUXDATA_TRANSPORTS_UDP_H
 
 #include "Transport.h"
+#include "NativeSocket.h"
 
-#include <boost/asio.hpp>
+#include <atomic>
 #include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <string>
+#include <string_view>
+#include <vector>
 
 namespace influxdb::transports
 {
 
-/// \brief UDP transport
+/// \brief UDP transport, packs lines into datagrams fitting the MTU of the route to the host
+///
+/// On Linux, the datagrams of a message are submitted by few system calls (sendmmsg).
+/// The socket is non-blocking, datagrams which don't fit into the send buffer are dropped and counted.
 class UDP : public Transport
 {
   public:
+    /// Maximum payload of a UDP datagram over IPv4
+    static constexpr std::size_t maxPayloadSize{65507};
+
     /// Constructor
     UDP(const std::string &hostname, int port);
 
-    /// Sends blob via UDP
+    /// Sends lines in datagrams of up to the maximum datagram size, split on line boundaries
+    /// \throw InfluxDBException	if sending fails, e.g. a single line exceeds maxPayloadSize
     void send(std::string&& message) override;
 
+    /// Sets the size of the send buffer of the socket
+    /// \throw InfluxDBException	if the size is 0 or rejected by the system
+    void setSendBufferSize(std::size_t bytes) override;
+
+    /// Sets the maximum size of datagrams
+    /// \throw InfluxDBException	if maxSize is 0 or exceeds maxPayloadSize
+    void setMaxDatagramSize(std::size_t maxSize) override;
+
+    /// Sends datagrams as segments of large buffers split by the kernel (UDP_SEGMENT, Linux 4.18+).
+    /// Datagrams are padded with empty lines to the maximum datagram size, except the last one of a send.
+    /// Falls back to sendmmsg if the route to the host doesn't support it.
+    /// \throw InfluxDBException	if unsupported by the system
+    void enableSegmentationOffload() override;
+
+    /// Returns the counters of sent datagrams
+    DatagramStatistics datagramStatistics() const override;
+
+    /// Returns the maximum size of datagrams
+    std::size_t maxDatagramSize() const;
+
   private:
-    /// Boost Asio I/O functionality
-    boost::asio::io_service mIoService;
+    /// Sends datagrams by as few system calls as possible, drops the remaining ones if the send buffer is full
+    void sendDatagrams(const std::string_view *datagrams, std::size_t count);
+
+    /// Sends datagrams as padded segments, returns the number of datagrams sent or dropped before
+    /// the route turned out not to support segmentation offload
+    std::size_t sendSegments(const std::string_view *datagrams, std::size_t count);
+
+    /// Records datagrams dropped as the send buffer is full
+    void drop(std::size_t count);
 
     /// UDP socket
-    boost::asio::ip::udp::socket mSocket;
+    internal::NativeSocket mSocket;
+
+    /// IPv4 address of the host
+    sockaddr_in mEndpoint;
+
+    /// Maximum size of datagrams, by default the MTU of the route to the endpoint
+    std::size_t mMaxDatagramSize;
+
+    /// Whether datagrams are sent as segments split by the kernel
+    bool mSegmentationOffload{false};
+
+    /// Datagrams of the message being sent
+    std::vector<std::string_view> mDatagramViews;
+
+    /// Padded segments of a send with segmentation offload
+    std::string mSegments;
+
+    /// Number of datagrams sent
+    std::atomic<std::uint64_t> mDatagrams{0};
+
+    /// Number of system calls sending datagrams
+    std::atomic<std::uint64_t> mSendCalls{0};
+
+    /// Number of lines exceeding the maximum datagram size
+    std::atomic<std::uint64_t> mOversizeLines{0};
 
-    /// UDP endpoint
-    boost::asio::ip::udp::endpoint mEndpoint;
+    /// Number of datagrams dropped as the send buffer was full
+    std::atomic<std::uint64_t> mDroppedDatagrams{0};
 
 };
 
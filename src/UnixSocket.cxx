@@ -27,30 +27,55 @@
 
 #include "UnixSocket.h"
 #include "InfluxDBException.h"
+#include <cstring>
 #include <string>
 
 namespace influxdb::transports
 {
-#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+#ifndef _WIN32
+
+namespace
+{
+  sockaddr_un endpointOf(const std::string &socketPath)
+  {
+    sockaddr_un endpoint{};
+    if (socketPath.size() >= sizeof(endpoint.sun_path))
+    {
+      throw InfluxDBException{"UnixSocket", "Socket path exceeds " + std::to_string(sizeof(endpoint.sun_path) - 1) + " characters"};
+    }
+    endpoint.sun_family = AF_UNIX;
+    std::memcpy(endpoint.sun_path, socketPath.c_str(), socketPath.size() + 1);
+    return endpoint;
+  }
+}
 
 UnixSocket::UnixSocket(const std::string &socketPath) :
-  mSocket(mIoService), mEndpoint(socketPath)
+  mSocket(AF_UNIX), mEndpoint(endpointOf(socketPath))
 {
-  mSocket.open();
 }
 
 void UnixSocket::send(std::string &&message)
 {
-  try
+  if (mSocket.sendTo(message.data(), message.size(), reinterpret_cast<const sockaddr *>(&mEndpoint), sizeof(mEndpoint)))
   {
-    mSocket.send_to(boost::asio::buffer(message, message.size()), mEndpoint);
+    ++mDatagrams;
   }
-  catch (const boost::system::system_error &e)
+  else
   {
-    throw InfluxDBException(__func__, e.what());
+    ++mDroppedDatagrams;
   }
 }
 
+void UnixSocket::setSendBufferSize(std::size_t bytes)
+{
+  mSocket.setSendBufferSize(bytes);
+}
+
+DatagramStatistics UnixSocket::datagramStatistics() const
+{
+  return DatagramStatistics{mDatagrams, 0, mDatagrams + mDroppedDatagrams, mDroppedDatagrams};
+}
+
 #else
 
 UnixSocket::UnixSocket(const std::string&)
@@ -63,6 +88,16 @@ void UnixSocket::send(std::string&&)
   throw InfluxDBException{__func__, "Unix socket not supported on this system"};
 }
 
-#endif // defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+void UnixSocket::setSendBufferSize(std::size_t)
+{
+  throw InfluxDBException{__func__, "Unix socket not supported on this system"};
+}
+
+DatagramStatistics UnixSocket::datagramStatistics() const
+{
+  return DatagramStatistics{};
+}
+
+#endif // _WIN32
 
 } // namespace influxdb::transports
@@ -29,14 +29,22 @@
 #define INFLUXDATA_TRANSPORTS_UNIX_H
 
 #include "Transport.h"
+#include "NativeSocket.h"
 
-#include <boost/asio.hpp>
+#include <atomic>
+#include <cstdint>
 #include <string>
 
+#ifndef _WIN32
+#include <sys/un.h>
+#endif
+
 namespace influxdb::transports
 {
 
 /// \brief Unix datagram socket transport
+///
+/// The socket is non-blocking, messages which don't fit into the send buffer are dropped and counted.
 class UnixSocket : public Transport
 {
   public:
@@ -45,16 +53,27 @@ class UnixSocket : public Transport
     /// \param message   r-value string formated
     void send(std::string&& message) override;
 
+    /// Sets the size of the send buffer of the socket
+    /// \throw InfluxDBException	if the size is 0 or rejected by the system
+    void setSendBufferSize(std::size_t bytes) override;
+
+    /// Returns the counters of sent and dropped datagrams
+    DatagramStatistics datagramStatistics() const override;
+
+#ifndef _WIN32
   private:
-    /// Boost Asio I/O functionality
-    boost::asio::io_service mIoService;
-#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
     /// Unix socket
-    boost::asio::local::datagram_protocol::socket mSocket;
+    internal::NativeSocket mSocket;
 
     /// Unix endpoint
-    boost::asio::local::datagram_protocol::endpoint mEndpoint;
-#endif // defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+    sockaddr_un mEndpoint;
+
+    /// Number of datagrams sent
+    std::atomic<std::uint64_t> mDatagrams{0};
+
+    /// Number of datagrams dropped as the send buffer was full
+    std::atomic<std::uint64_t> mDroppedDatagrams{0};
+#endif // _WIN32
 };
 
 } // namespace influxdb::transports
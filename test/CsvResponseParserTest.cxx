@@ -0,0 +1,176 @@
+// MIT License
+//
+// Copyright (c) 2022 TOSHIBA CORPORATION
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "CsvResponseParser.h"
+#include "QueryResponseParser.h"
+#include "InfluxDBException.h"
+#include "TestData.h"
+#include <catch2/catch.hpp>
+#include <string>
+
+namespace influxdb::test
+{
+    using internal::CsvResponseParser;
+
+    namespace
+    {
+        std::vector<InfluxDBTable> parse(std::string_view response, std::size_t chunkSize)
+        {
+            internal::RowResultBuilder builder;
+            CsvResponseParser parser{builder};
+            feedChunks(parser, response, chunkSize);
+            return builder.takeResult();
+        }
+
+        std::vector<InfluxDBTable> parse(std::string_view response)
+        {
+            return parse(response, response.size() + 1);
+        }
+
+        std::vector<InfluxDBTable> parseJson(const std::string& response)
+        {
+            internal::RowResultBuilder builder;
+            internal::QueryResponseParser parser{builder};
+            parser.feed(response);
+            parser.finish();
+            return builder.takeResult();
+        }
+    }
+
+    TEST_CASE("Parses CSV response like JSON response", "[CsvResponseParserTest]")
+    {
+        /// Results of failed statements and without series are missing in CSV
+        const auto expected = parseJson(readTestData("query_response.json")).front();
+        const auto csv = readTestData("query_response.csv");
+
+        for (std::size_t chunkSize : {csv.size(), std::size_t{1}, std::size_t{7}, std::size_t{16}, std::size_t{33}})
+        {
+            const auto result = parse(csv, chunkSize);
+            REQUIRE(result.size() == 1);
+            CHECK(result[0].statementId == 0);
+            REQUIRE(result[0].series.size() == expected.series.size());
+            for (std::size_t i = 0; i < expected.series.size(); ++i)
+            {
+                const auto& series = result[0].series[i];
+                CHECK(series.name == expected.series[i].name);
+                CHECK(series.tagKeys == expected.series[i].tagKeys);
+                CHECK(series.tagValues == expected.series[i].tagValues);
+                CHECK(series.columnNames == expected.series[i].columnNames);
+                REQUIRE(series.rows.size() == expected.series[i].rows.size());
+                for (std::size_t j = 0; j < series.rows.size(); ++j)
+                {
+                    CHECK(series.rows[j].tuple == expected.series[i].rows[j].tuple);
+                }
+            }
+        }
+    }
+
+    TEST_CASE("Parses quoted CSV fields", "[CsvResponseParserTest]")
+    {
+        const std::string response{"name,tags,time,text\r\n"
+                                   "m,,0,\"a,b\"\r\n"
+                                   "m,,1,\"line\nbreak with \"\"quotes\"\" and more than sixteen bytes\"\r\n"
+                                   "m,,2,\"\"\r\n"
+                                   "m,,3,\"\"\"\""};
+
+        for (std::size_t chunkSize = 1; chunkSize < 20; ++chunkSize)
+        {
+            const auto result = parse(response, chunkSize);
+            REQUIRE(result.size() == 1);
+            REQUIRE(result[0].series.size() == 1);
+            const auto& rows = result[0].series[0].rows;
+            REQUIRE(rows.size() == 4);
+            CHECK(rows[0].tuple == std::vector<std::string>{"1970-01-01T00:00:00Z", "a,b"});
+            CHECK(rows[1].tuple[1] == "line\nbreak with \"quotes\" and more than sixteen bytes");
+            CHECK(rows[2].tuple[1].empty());
+            CHECK(rows[3].tuple[1] == "\"");
+        }
+    }
+
+    TEST_CASE("Parses escaped CSV tags", "[CsvResponseParserTest]")
+    {
+        const auto result = parse("name,tags,v\nm,\"a\\,b=c\\=d,e=f\\ g,h=i\\j\",1\n");
+        const auto& series = result[0].series[0];
+        CHECK(series.tagKeys == std::vector<std::string>{"a,b", "e", "h"});
+        CHECK(series.tagValues == std::vector<std::string>{"c=d", "f g", "i\\j"});
+    }
+
+    TEST_CASE("Rows of other name or tags start new series", "[CsvResponseParserTest]")
+    {
+        const auto result = parse("name,tags,v\na,x=1,1\na,x=1,2\na,x=2,3\nb,x=2,4\n");
+        REQUIRE(result.size() == 1);
+        REQUIRE(result[0].series.size() == 3);
+        CHECK(result[0].series[0].rows.size() == 2);
+        CHECK(result[0].series[1].tagValues == std::vector<std::string>{"2"});
+        CHECK(result[0].series[2].name == "b");
+    }
+
+    TEST_CASE("Blocks of CSV response are results", "[CsvResponseParserTest]")
+    {
+        const auto result = parse("name,tags,v\na,,1\n\nname,tags,w,x\nb,,2,3\n");
+        REQUIRE(result.size() == 2);
+        CHECK(result[0].statementId == 0);
+        CHECK(result[0].series[0].columnNames == std::vector<std::string>{"v"});
+        CHECK(result[1].statementId == 1);
+        CHECK(result[1].series[0].columnNames == std::vector<std::string>{"w", "x"});
+        CHECK(result[1].series[0].rows[0].tuple == std::vector<std::string>{"2", "3"});
+    }
+
+    TEST_CASE("Empty CSV response has no results", "[CsvResponseParserTest]")
+    {
+        CHECK(parse("").empty());
+        CHECK(parse("\n").empty());
+    }
+
+    TEST_CASE("Parses CSV response into typed columns", "[CsvResponseParserTest]")
+    {
+        internal::ColumnarResultBuilder builder;
+        CsvResponseParser parser{builder};
+        parser.feed(readTestData("query_response.csv"));
+        parser.finish();
+        const auto result = builder.takeResult();
+
+        const auto& columns = result[0].series[0].columns;
+        CHECK(columns[0].type == InfluxDBColumn::Type::Time);
+        CHECK(columns[0].integers[2] == 1609459203000000001);
+        CHECK(columns[1].type == InfluxDBColumn::Type::Float);
+        CHECK(columns[2].type == InfluxDBColumn::Type::Integer);
+        CHECK(columns[2].integers[3] == 9007199254740993);
+        CHECK(columns[3].type == InfluxDBColumn::Type::Boolean);
+        CHECK(columns[4].type == InfluxDBColumn::Type::String);
+    }
+
+    TEST_CASE("Throws error of CSV response", "[CsvResponseParserTest]")
+    {
+        CHECK_THROWS_WITH(parse("error\n\"error parsing query: found X, expected SELECT\"\n"),
+                          Catch::Contains("ERROR: error parsing query: found X, expected SELECT"));
+        CHECK_THROWS_AS(parse("error\n"), InfluxDBException);
+    }
+
+    TEST_CASE("Throws on invalid CSV response", "[CsvResponseParserTest]")
+    {
+        CHECK_THROWS_WITH(parse("name,tags,v\nm,,\"open\n"), Catch::Contains("Unterminated quoted field"));
+        CHECK_THROWS_WITH(parse("name,tags,v\nm,,\"a\"b\n"), Catch::Contains("Unexpected character"));
+        CHECK_THROWS_WITH(parse("name,tags,v\nm,,1,2\n"), Catch::Contains("Unsupported csv structure"));
+        CHECK_THROWS_WITH(parse("time,v\n1,2\n"), Catch::Contains("Unsupported csv structure"));
+    }
+}
@@ -0,0 +1,340 @@
+// MIT License
+//
+// Copyright (c) 2022 TOSHIBA CORPORATION
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "CurlMultiWriter.h"
+#include "InfluxDBException.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include <catch2/catch.hpp>
+
+namespace influxdb::test
+{
+    namespace
+    {
+        /// Minimal HTTP/1.1 server answering each request with the status of a handler
+        class HttpServerStub
+        {
+        public:
+            using Handler = std::function<int(const std::string& body)>;
+
+            explicit HttpServerStub(Handler handler, std::chrono::milliseconds delay = std::chrono::milliseconds::zero())
+                : mHandler(std::move(handler)),
+                  mDelay(delay),
+                  mSocket(::socket(AF_INET, SOCK_STREAM, 0))
+            {
+                REQUIRE(mSocket >= 0);
+                sockaddr_in address{};
+                address.sin_family = AF_INET;
+                address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+                socklen_t length = sizeof(address);
+                REQUIRE(::bind(mSocket, reinterpret_cast<sockaddr*>(&address), length) == 0);
+                REQUIRE(::listen(mSocket, 16) == 0);
+                REQUIRE(::getsockname(mSocket, reinterpret_cast<sockaddr*>(&address), &length) == 0);
+                mPort = ntohs(address.sin_port);
+                mAcceptor = std::thread{[this] { accept(); }};
+            }
+
+            ~HttpServerStub()
+            {
+                ::shutdown(mSocket, SHUT_RDWR);
+                ::close(mSocket);
+                mAcceptor.join();
+
+                std::lock_guard lock{mMutex};
+                for (const int connection : mConnections)
+                {
+                    ::shutdown(connection, SHUT_RDWR);
+                }
+                for (auto& thread : mThreads)
+                {
+                    thread.join();
+                }
+                for (const int connection : mConnections)
+                {
+                    ::close(connection);
+                }
+            }
+
+            std::string url() const
+            {
+                return "http://127.0.0.1:" + std::to_string(mPort) + "/write";
+            }
+
+            std::vector<std::string> bodies() const
+            {
+                std::lock_guard lock{mMutex};
+                return mBodies;
+            }
+
+            int maxConcurrentRequests() const
+            {
+                return mMaxConcurrent;
+            }
+
+        private:
+            void accept()
+            {
+                while (true)
+                {
+                    const int connection = ::accept(mSocket, nullptr, nullptr);
+                    if (connection < 0)
+                    {
+                        return;
+                    }
+                    std::lock_guard lock{mMutex};
+                    mConnections.push_back(connection);
+                    mThreads.emplace_back([this, connection] { serve(connection); });
+                }
+            }
+
+            void serve(int connection)
+            {
+                std::string data;
+                char buffer[4096];
+
+                while (true)
+                {
+                    const auto headerEnd = data.find("\r\n\r\n");
+                    if (headerEnd != std::string::npos)
+                    {
+                        const auto lengthStart = data.find("Content-Length: ");
+                        const std::size_t length = (lengthStart < headerEnd ? std::stoul(data.substr(lengthStart + 16)) : 0);
+
+                        if (data.size() >= headerEnd + 4 + length)
+                        {
+                            respond(connection, data.substr(headerEnd + 4, length));
+                            data.erase(0, headerEnd + 4 + length);
+                            continue;
+                        }
+                    }
+
+                    const auto received = ::recv(connection, buffer, sizeof(buffer), 0);
+                    if (received <= 0)
+                    {
+                        return;
+                    }
+                    data.append(buffer, static_cast<std::size_t>(received));
+                }
+            }
+
+            void respond(int connection, const std::string& body)
+            {
+                const int concurrent = ++mConcurrent;
+                int expected = mMaxConcurrent;
+                while (concurrent > expected && !mMaxConcurrent.compare_exchange_weak(expected, concurrent))
+                {
+                }
+                std::this_thread::sleep_for(mDelay);
+                --mConcurrent;
+
+                const int status = mHandler(body);
+                {
+                    std::lock_guard lock{mMutex};
+                    mBodies.push_back(body);
+                }
+                const std::string content = (status < 300 ? "" : R"({"error":"stub"})");
+                const std::string response = "HTTP/1.1 " + std::to_string(status) + " Stub\r\nContent-Length: " + std::to_string(content.size()) + "\r\n\r\n" + content;
+                ::send(connection, response.data(), response.size(), MSG_NOSIGNAL);
+            }
+
+            const Handler mHandler;
+            const std::chrono::milliseconds mDelay;
+            const int mSocket;
+            std::uint16_t mPort{0};
+            std::thread mAcceptor;
+            mutable std::mutex mMutex;
+            std::vector<int> mConnections;
+            std::vector<std::thread> mThreads;
+            std::vector<std::string> mBodies;
+            std::atomic<int> mConcurrent{0};
+            std::atomic<int> mMaxConcurrent{0};
+        };
+
+        std::size_t writeResponse(void* contents, std::size_t size, std::size_t nmemb, void* userp)
+        {
+            static_cast<std::string*>(userp)->append(static_cast<char*>(contents), size * nmemb);
+            return size * nmemb;
+        }
+
+        struct Prototype
+        {
+            explicit Prototype(const std::string& url)
+                : handle(curl_easy_init())
+            {
+                curl_easy_setopt(handle, CURLOPT_URL, url.c_str());
+                curl_easy_setopt(handle, CURLOPT_POST, 1L);
+                curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, writeResponse);
+            }
+
+            ~Prototype()
+            {
+                curl_easy_cleanup(handle);
+            }
+
+            CURL* handle;
+        };
+
+        curl_slist* sendLinesAsTheyAre([[maybe_unused]] std::string_view lines, [[maybe_unused]] std::string& body)
+        {
+            return nullptr;
+        }
+
+        void throwOnError(CURLcode result, long responseCode, [[maybe_unused]] const std::string& response)
+        {
+            if (result != CURLE_OK || responseCode >= 300)
+            {
+                throw InfluxDBException{"test", "Request failed with " + std::to_string(responseCode)};
+            }
+        }
+
+        std::vector<std::string> sorted(std::vector<std::string> values)
+        {
+            std::sort(values.begin(), values.end());
+            return values;
+        }
+    }
+
+
+    TEST_CASE("Throws if max in flight is zero", "[CurlMultiWriterTest]")
+    {
+        Prototype prototype{"http://127.0.0.1:1/write"};
+        CHECK_THROWS_AS(internal::CurlMultiWriter(prototype.handle, 0, sendLinesAsTheyAre, throwOnError), InfluxDBException);
+    }
+
+    TEST_CASE("Sends requests concurrently", "[CurlMultiWriterTest]")
+    {
+        HttpServerStub server{[](const std::string&) { return 204; }, std::chrono::milliseconds{100}};
+        Prototype prototype{server.url()};
+        internal::CurlMultiWriter writer{prototype.handle, 4, sendLinesAsTheyAre, throwOnError};
+
+        std::vector<std::string> expected;
+        for (int i = 0; i < 8; ++i)
+        {
+            expected.push_back("m value=" + std::to_string(i) + "i");
+            writer.send(std::string{expected.back()});
+        }
+        writer.flush();
+
+        CHECK(sorted(server.bodies()) == sorted(expected));
+        CHECK(server.maxConcurrentRequests() > 1);
+        CHECK(server.maxConcurrentRequests() <= 4);
+    }
+
+    TEST_CASE("Reports error of each failed request", "[CurlMultiWriterTest]")
+    {
+        HttpServerStub server{[](const std::string& body) { return body.rfind("fail", 0) == 0 ? 500 : 204; }};
+        Prototype prototype{server.url()};
+        internal::CurlMultiWriter writer{prototype.handle, 1, sendLinesAsTheyAre, throwOnError};
+
+        writer.send("ok0");
+        writer.send("fail0");
+        writer.send("ok1");
+        writer.send("fail1");
+
+        CHECK_THROWS_WITH(writer.flush(), Catch::Contains("500"));
+        CHECK_THROWS_WITH(writer.flush(), Catch::Contains("500"));
+        CHECK_NOTHROW(writer.flush());
+        CHECK(server.bodies() == std::vector<std::string>{"ok0", "fail0", "ok1", "fail1"});
+    }
+
+    TEST_CASE("Splits requests rejected as too large", "[CurlMultiWriterTest]")
+    {
+        HttpServerStub server{[](const std::string& body) { return body.size() > 6 ? 413 : 204; }};
+        Prototype prototype{server.url()};
+        internal::CurlMultiWriter writer{prototype.handle, 2, sendLinesAsTheyAre, throwOnError};
+
+        writer.send("m0 f=1\nm1 f=2\nm2 f=3");
+        writer.flush();
+
+        auto accepted = server.bodies();
+        accepted.erase(std::remove_if(accepted.begin(), accepted.end(), [](const auto& body) { return body.size() > 6; }), accepted.end());
+        CHECK(sorted(accepted) == std::vector<std::string>{"m0 f=1", "m1 f=2", "m2 f=3"});
+    }
+
+    TEST_CASE("Halves of split requests don't exceed max in flight", "[CurlMultiWriterTest]")
+    {
+        HttpServerStub server{[](const std::string& body) { return body.size() > 6 ? 413 : 204; }, std::chrono::milliseconds{50}};
+        Prototype prototype{server.url()};
+        internal::CurlMultiWriter writer{prototype.handle, 1, sendLinesAsTheyAre, throwOnError};
+
+        writer.send("m0 f=1\nm1 f=2\nm2 f=3\nm3 f=4");
+        writer.send("m4 f=5");
+        writer.flush();
+
+        auto accepted = server.bodies();
+        accepted.erase(std::remove_if(accepted.begin(), accepted.end(), [](const auto& body) { return body.size() > 6; }), accepted.end());
+        CHECK(sorted(accepted) == std::vector<std::string>{"m0 f=1", "m1 f=2", "m2 f=3", "m3 f=4", "m4 f=5"});
+        CHECK(server.maxConcurrentRequests() == 1);
+    }
+
+    TEST_CASE("Reports request too large if single line", "[CurlMultiWriterTest]")
+    {
+        HttpServerStub server{[](const std::string&) { return 413; }};
+        Prototype prototype{server.url()};
+        internal::CurlMultiWriter writer{prototype.handle, 2, sendLinesAsTheyAre, throwOnError};
+
+        writer.send("m0 f=1");
+        CHECK_THROWS_WITH(writer.flush(), Catch::Contains("413"));
+    }
+
+    TEST_CASE("Sends encoded body", "[CurlMultiWriterTest]")
+    {
+        HttpServerStub server{[](const std::string&) { return 204; }};
+        Prototype prototype{server.url()};
+        const auto encoder = [](std::string_view lines, std::string& body) -> curl_slist* {
+            body = "encoded:";
+            body += lines;
+            return nullptr;
+        };
+        internal::CurlMultiWriter writer{prototype.handle, 2, encoder, throwOnError};
+
+        writer.send("m0 f=1");
+        writer.flush();
+
+        CHECK(server.bodies() == std::vector<std::string>{"encoded:m0 f=1"});
+    }
+
+    TEST_CASE("Destructor completes requests in flight", "[CurlMultiWriterTest]")
+    {
+        HttpServerStub server{[](const std::string&) { return 204; }, std::chrono::milliseconds{50}};
+        Prototype prototype{server.url()};
+        {
+            internal::CurlMultiWriter writer{prototype.handle, 2, sendLinesAsTheyAre, throwOnError};
+            writer.send("m0 f=1");
+            writer.send("m1 f=2");
+            writer.send("m2 f=3");
+        }
+
+        CHECK(server.bodies().size() == 3);
+    }
+}
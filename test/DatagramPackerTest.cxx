@@ -0,0 +1,81 @@
+// MIT License
+//
+// Copyright (c) 2022 TOSHIBA CORPORATION
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "DatagramPacker.h"
+#include <catch2/catch.hpp>
+#include <string>
+#include <vector>
+
+namespace influxdb::test
+{
+    namespace
+    {
+        struct Packed
+        {
+            std::vector<std::string> datagrams;
+            std::size_t oversizeLines;
+        };
+
+        Packed pack(std::string_view lines, std::size_t maxSize)
+        {
+            Packed result;
+            result.oversizeLines = internal::packDatagrams(lines, maxSize, [&result](std::string_view datagram) { result.datagrams.emplace_back(datagram); });
+            return result;
+        }
+    }
+
+    TEST_CASE("Lines fitting datagram are sent at once", "[DatagramPackerTest]")
+    {
+        const auto packed = pack("a 1\nb 2\nc 3", 11);
+        CHECK(packed.datagrams == std::vector<std::string>{"a 1\nb 2\nc 3"});
+        CHECK(packed.oversizeLines == 0);
+    }
+
+    TEST_CASE("Lines are split into datagrams on line boundaries", "[DatagramPackerTest]")
+    {
+        const auto packed = pack("a 1\nb 2\nc 3\nd 4", 8);
+        CHECK(packed.datagrams == std::vector<std::string>{"a 1\nb 2", "c 3\nd 4"});
+        CHECK(packed.oversizeLines == 0);
+    }
+
+    TEST_CASE("Datagrams are filled up to maximum size", "[DatagramPackerTest]")
+    {
+        const auto packed = pack("a 1\nb 2\nc 3\nd 4", 7);
+        CHECK(packed.datagrams == std::vector<std::string>{"a 1\nb 2", "c 3\nd 4"});
+        CHECK(pack("a 1\nb 2\nc 3\nd 4", 6).datagrams == std::vector<std::string>{"a 1", "b 2", "c 3", "d 4"});
+    }
+
+    TEST_CASE("Line exceeding maximum size is sent alone", "[DatagramPackerTest]")
+    {
+        const auto packed = pack("a 1\nlong 1234567\nb 2\nc 3\nlonger 1234567", 8);
+        CHECK(packed.datagrams == std::vector<std::string>{"a 1", "long 1234567", "b 2\nc 3", "longer 1234567"});
+        CHECK(packed.oversizeLines == 2);
+    }
+
+    TEST_CASE("Empty lines are not sent as datagrams", "[DatagramPackerTest]")
+    {
+        CHECK(pack("", 8).datagrams.empty());
+        CHECK(pack("\na 1\n\n\n\nb 2\n", 4).datagrams == std::vector<std::string>{"a 1\n", "b 2\n"});
+        CHECK(pack("a 1\n", 8).datagrams == std::vector<std::string>{"a 1\n"});
+    }
+}
@@ -0,0 +1,243 @@
+// MIT License
+//
+// Copyright (c) 2022 TOSHIBA CORPORATION
+// Copyright (c) 2020-2022 offa
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "DatagramSupport.h"
+#include "InfluxDBException.h"
+#include "ConnectionInfo.h"
+#include <catch2/catch.hpp>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace influxdb::test
+{
+    namespace
+    {
+        /// Datagram socket bound to a loopback address, receiving what the transports send
+        class Receiver
+        {
+        public:
+            Receiver()
+                : mHandle(socket(AF_INET, SOCK_DGRAM, 0))
+            {
+                sockaddr_in address{};
+                address.sin_family = AF_INET;
+                address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+                socklen_t length{sizeof(address)};
+                REQUIRE(bind(mHandle, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0);
+                REQUIRE(getsockname(mHandle, reinterpret_cast<sockaddr*>(&address), &length) == 0);
+                mPort = ntohs(address.sin_port);
+            }
+
+            explicit Receiver(const std::string& path)
+                : mHandle(socket(AF_UNIX, SOCK_DGRAM, 0)), mPath(path)
+            {
+                sockaddr_un address{};
+                address.sun_family = AF_UNIX;
+                std::strcpy(address.sun_path, path.c_str());
+                std::remove(path.c_str());
+                REQUIRE(bind(mHandle, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0);
+            }
+
+            ~Receiver()
+            {
+                close(mHandle);
+                if (!mPath.empty())
+                {
+                    std::remove(mPath.c_str());
+                }
+            }
+
+            int port() const
+            {
+                return mPort;
+            }
+
+            std::string receive()
+            {
+                std::string buffer(2048, '\0');
+                const auto size = recv(mHandle, buffer.data(), buffer.size(), 0);
+                REQUIRE(size >= 0);
+                buffer.resize(static_cast<std::size_t>(size));
+                return buffer;
+            }
+
+        private:
+            int mHandle;
+            std::string mPath;
+            int mPort{0};
+        };
+
+        std::string socketPath(const std::string& name)
+        {
+            return "/tmp/influxdb-cxx-" + name + "-" + std::to_string(getpid()) + ".sock";
+        }
+    }
+
+    //New tests for check connection, use ConnectionInfo
+    TEST_CASE("With UDP returns transport", "[DatagramSupportTest]")
+    {
+        auto conn = internal::ConnectionInfo::createConnectionInfoV1("", 0, "", "", "");
+        CHECK(internal::withUdpTransport(conn.host, conn.port) != nullptr);
+    }
+
+    TEST_CASE("With Unix socket returns transport", "[DatagramSupportTest]")
+    {
+        auto conn = internal::ConnectionInfo::createConnectionInfoV1("", 0, "", "", "");
+        CHECK(internal::withUnixSocketTransport(conn.host) != nullptr);
+    }
+
+    TEST_CASE("With UDP throws on unknown host", "[DatagramSupportTest]")
+    {
+        CHECK_THROWS_AS(internal::withUdpTransport("invalid.host.example.", 8089), InfluxDBException);
+    }
+
+    TEST_CASE("With Unix socket throws on too long path", "[DatagramSupportTest]")
+    {
+        CHECK_THROWS_AS(internal::withUnixSocketTransport(std::string(200, 'x')), InfluxDBException);
+    }
+
+    TEST_CASE("UDP transport throws on create database", "[DatagramSupportTest]")
+    {
+        auto conn = internal::ConnectionInfo::createConnectionInfoV1("", 0, "", "", "");
+        auto udp = internal::withUdpTransport(conn.host, conn.port);
+        CHECK_THROWS_AS(udp->createDatabase(), std::runtime_error);
+    }
+
+    TEST_CASE("Unix socket transport throws on create database", "[DatagramSupportTest]")
+    {
+        auto conn = internal::ConnectionInfo::createConnectionInfoV1("", 0, "", "", "");
+        auto udp = internal::withUnixSocketTransport(conn.host);
+        CHECK_THROWS_AS(udp->createDatabase(), std::runtime_error);
+    }
+
+    TEST_CASE("UDP transport packs lines into datagrams", "[DatagramSupportTest]")
+    {
+        Receiver receiver;
+        auto udp = internal::withUdpTransport("127.0.0.1", receiver.port());
+        udp->setMaxDatagramSize(8);
+
+        udp->send("a 1\nb 2\nc 3\nlong 1234567");
+
+        std::vector<std::string> datagrams;
+        for (std::size_t i = 0; i < 3; ++i)
+        {
+            datagrams.push_back(receiver.receive());
+        }
+        CHECK(datagrams == std::vector<std::string>{"a 1\nb 2", "c 3", "long 1234567"});
+        CHECK(udp->datagramStatistics().datagrams == 3);
+        CHECK(udp->datagramStatistics().oversizeLines == 1);
+        CHECK(udp->datagramStatistics().droppedDatagrams == 0);
+#ifdef __linux__
+        CHECK(udp->datagramStatistics().sendCalls == 1);
+#endif
+    }
+
+#ifdef __linux__
+    TEST_CASE("UDP transport sends padded segments with segmentation offload", "[DatagramSupportTest]")
+    {
+        Receiver receiver;
+        auto udp = internal::withUdpTransport("127.0.0.1", receiver.port());
+        udp->setMaxDatagramSize(8);
+        udp->enableSegmentationOffload();
+
+        udp->send("a 1\nb 2\nc 3\nd 4\ne 5");
+
+        std::vector<std::string> datagrams;
+        for (std::size_t i = 0; i < 3; ++i)
+        {
+            datagrams.push_back(receiver.receive());
+        }
+        CHECK(datagrams == std::vector<std::string>{"a 1\nb 2\n", "c 3\nd 4\n", "e 5"});
+        CHECK(udp->datagramStatistics().datagrams == 3);
+        CHECK(udp->datagramStatistics().sendCalls == 1);
+    }
+#endif
+
+    TEST_CASE("UDP transport throws on invalid datagram size", "[DatagramSupportTest]")
+    {
+        auto udp = internal::withUdpTransport("127.0.0.1", 8089);
+        CHECK_THROWS_AS(udp->setMaxDatagramSize(0), InfluxDBException);
+        CHECK_THROWS_AS(udp->setMaxDatagramSize(65508), InfluxDBException);
+        CHECK_NOTHROW(udp->setMaxDatagramSize(65507));
+    }
+
+    TEST_CASE("UDP transport sets send buffer size", "[DatagramSupportTest]")
+    {
+        auto udp = internal::withUdpTransport("127.0.0.1", 8089);
+        CHECK_NOTHROW(udp->setSendBufferSize(1024 * 1024));
+        CHECK_THROWS_AS(udp->setSendBufferSize(0), InfluxDBException);
+    }
+
+    TEST_CASE("Unix socket transport throws on datagram size", "[DatagramSupportTest]")
+    {
+        auto conn = internal::ConnectionInfo::createConnectionInfoV1("", 0, "", "", "");
+        auto unixSocket = internal::withUnixSocketTransport(conn.host);
+        CHECK_THROWS_AS(unixSocket->setMaxDatagramSize(1000), InfluxDBException);
+    }
+
+    TEST_CASE("Unix socket transport sends datagrams", "[DatagramSupportTest]")
+    {
+        const auto path = socketPath("send");
+        Receiver receiver{path};
+        auto unixSocket = internal::withUnixSocketTransport(path);
+
+        unixSocket->send("a 1\nb 2");
+        unixSocket->send("c 3");
+
+        CHECK(receiver.receive() == "a 1\nb 2");
+        CHECK(receiver.receive() == "c 3");
+        CHECK(unixSocket->datagramStatistics().datagrams == 2);
+        CHECK(unixSocket->datagramStatistics().droppedDatagrams == 0);
+    }
+
+    TEST_CASE("Unix socket transport drops datagrams if the receiver falls behind", "[DatagramSupportTest]")
+    {
+        const auto path = socketPath("drop");
+        Receiver receiver{path};
+        auto unixSocket = internal::withUnixSocketTransport(path);
+        unixSocket->setSendBufferSize(4096);
+
+        constexpr std::uint64_t count{10000};
+        for (std::uint64_t i = 0; i < count; ++i)
+        {
+            unixSocket->send(std::string(1000, 'x'));
+        }
+
+        const auto statistics = unixSocket->datagramStatistics();
+        CHECK(statistics.droppedDatagrams > 0);
+        CHECK(statistics.datagrams + statistics.droppedDatagrams == count);
+        CHECK(receiver.receive().size() == 1000);
+    }
+
+    TEST_CASE("Unix socket transport throws if nothing is bound to the path", "[DatagramSupportTest]")
+    {
+        auto unixSocket = internal::withUnixSocketTransport(socketPath("unbound"));
+        CHECK_THROWS_AS(unixSocket->send("a 1"), InfluxDBException);
+    }
+}
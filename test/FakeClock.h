@@ -0,0 +1,50 @@
+// MIT License
+//
+// Copyright (c) 2022 TOSHIBA CORPORATION
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <vector>
+
+namespace influxdb::test
+{
+    /// Clock advanced by the test, sleeping advances it instead of waiting
+    struct FakeClock
+    {
+        std::chrono::steady_clock::time_point now{};
+        std::vector<std::chrono::milliseconds> sleeps;
+
+        std::function<void(std::chrono::milliseconds)> sleep()
+        {
+            return [this](std::chrono::milliseconds delay) {
+                sleeps.push_back(delay);
+                now += delay;
+            };
+        }
+
+        std::function<std::chrono::steady_clock::time_point()> function()
+        {
+            return [this] { return now; };
+        }
+    };
+}
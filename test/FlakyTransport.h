@@ -1,8 +1,6 @@
 // MIT License
 //
 // Copyright (c) 2022 TOSHIBA CORPORATION
-// Copyright (c) 2020-2022 offa
-// Copyright (c) 2019 Adam Wegrzynek
 //
 // Permission is hereby granted, free of charge, to any person obtaining a copy
 // of this software and associated documentation files (the "Software"), to deal
@@ -22,18 +20,29 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
-#include "BoostSupport.h"
+#pragma once
+
+#include "Transport.h"
 #include "InfluxDBException.h"
+#include <string>
+#include <vector>
 
-namespace influxdb::internal
+namespace influxdb::test
 {
-    std::unique_ptr<Transport> withUdpTransport([[maybe_unused]] const std::string &hostname,[[maybe_unused]] int port)
+    /// Transport failing with connection errors while the server is unavailable, keeping the sent messages
+    class FlakyTransport : public Transport
     {
-        throw InfluxDBException("InfluxDBFactory", "UDP transport requires Boost");
-    }
+    public:
+        void send(std::string&& message) override
+        {
+            if (!available)
+            {
+                throw ConnectionError{"unit test", "Server unavailable"};
+            }
+            received.push_back(std::move(message));
+        }
 
-    std::unique_ptr<Transport> withUnixSocketTransport([[maybe_unused]] const std::string &socketPath)
-    {
-        throw InfluxDBException("InfluxDBFactory", "Unix socket transport requires Boost");
-    }
+        bool available{true};
+        std::vector<std::string> received;
+    };
 }
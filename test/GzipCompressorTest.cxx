@@ -0,0 +1,116 @@
+// MIT License
+//
+// Copyright (c) 2022 TOSHIBA CORPORATION
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "GzipCompressor.h"
+#include "InfluxDBException.h"
+#include <zlib.h>
+#include <catch2/catch.hpp>
+
+namespace influxdb::test
+{
+    namespace
+    {
+        std::string decompress(const std::string& data)
+        {
+            z_stream stream{};
+            REQUIRE(inflateInit2(&stream, 15 + 16) == Z_OK);
+
+            std::string out(data.size() * 20 + 64, '\0');
+            stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+            stream.avail_in = static_cast<uInt>(data.size());
+            stream.next_out = reinterpret_cast<Bytef*>(out.data());
+            stream.avail_out = static_cast<uInt>(out.size());
+
+            const auto result = inflate(&stream, Z_FINISH);
+            out.resize(stream.total_out);
+            inflateEnd(&stream);
+            REQUIRE(result == Z_STREAM_END);
+            return out;
+        }
+
+        std::string createLines(std::size_t count)
+        {
+            std::string lines;
+
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                lines += "cpu,host=server" + std::to_string(i % 10) + " value=" + std::to_string(i) + "i 1572830915000000000\n";
+            }
+            return lines;
+        }
+    }
+
+
+    TEST_CASE("Compressed data round-trips", "[GzipCompressorTest]")
+    {
+        const auto lines = createLines(1000);
+        internal::GzipCompressor compressor;
+        std::string compressed;
+        compressor.compress(lines, compressed);
+
+        CHECK(compressed.size() < lines.size() / 5);
+        CHECK(decompress(compressed) == lines);
+    }
+
+    TEST_CASE("Compressed data has gzip header", "[GzipCompressorTest]")
+    {
+        internal::GzipCompressor compressor;
+        std::string compressed;
+        compressor.compress("abc", compressed);
+
+        REQUIRE(compressed.size() > 2);
+        CHECK(static_cast<unsigned char>(compressed[0]) == 0x1f);
+        CHECK(static_cast<unsigned char>(compressed[1]) == 0x8b);
+    }
+
+    TEST_CASE("Compressor is reusable", "[GzipCompressorTest]")
+    {
+        internal::GzipCompressor compressor;
+        std::string compressed{"previous content"};
+
+        compressor.compress(createLines(10), compressed);
+        CHECK(decompress(compressed) == createLines(10));
+        compressor.compress("", compressed);
+        CHECK(decompress(compressed).empty());
+        compressor.compress(createLines(3), compressed);
+        CHECK(decompress(compressed) == createLines(3));
+    }
+
+    TEST_CASE("Compression levels round-trip", "[GzipCompressorTest]")
+    {
+        const auto lines = createLines(100);
+
+        for (int level = 0; level <= 9; ++level)
+        {
+            internal::GzipCompressor compressor{level};
+            std::string compressed;
+            compressor.compress(lines, compressed);
+            CHECK(decompress(compressed) == lines);
+        }
+    }
+
+    TEST_CASE("Compressor throws on invalid level", "[GzipCompressorTest]")
+    {
+        CHECK_THROWS_AS(internal::GzipCompressor{-2}, InfluxDBException);
+        CHECK_THROWS_AS(internal::GzipCompressor{10}, InfluxDBException);
+    }
+}
@@ -27,6 +27,7 @@
 #include "mock/CurlMock.h"
 #include <catch2/catch.hpp>
 #include <catch2/trompeloeil.hpp>
+#include <vector>
 
 
 namespace influxdb::test
@@ -35,6 +36,17 @@ namespace influxdb::test
     {
         CurlHandleDummy dummy;
         CURL* handle = &dummy;
+
+        /// Passes chunks to a curl write callback, returns the results of the calls
+        std::vector<std::size_t> receiveChunks(WriteCallbackFn callback, void* userdata, std::vector<std::string> chunks)
+        {
+            std::vector<std::size_t> results;
+            for (auto& chunk : chunks)
+            {
+                results.push_back(callback(chunk.data(), 1, chunk.size(), userdata));
+            }
+            return results;
+        }
     }
 
     CurlMock curlMock;
@@ -271,6 +283,391 @@ namespace influxdb::test
         REQUIRE_THROWS_AS(http.send("content"), ServerError);
     }
 
+    TEST_CASE("V1: Send throws by response code if error body isn't JSON", "[HttpTest]")
+    {
+        ALLOW_CALL(curlMock, curl_global_init(_)).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_init()).RETURN(handle);
+        ALLOW_CALL(curlMock, curl_easy_setopt_(_, _, ANY(std::string))).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_setopt_(_, _, ANY(long))).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_setopt_(_, _, ANY(WriteCallbackFn))).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_cleanup(_));
+        ALLOW_CALL(curlMock, curl_easy_escape(_, ANY(char*), ANY(int))).RETURN(&std::string(_2)[0]);
+        ALLOW_CALL(curlMock, curl_free(_));
+        ALLOW_CALL(curlMock, curl_global_cleanup());
+
+        std::string body;
+        long responseCode{0};
+        auto conn = internal::ConnectionInfo::createConnectionInfoV1("http://localhost", 8086, "test");
+        HTTP http{conn};
+
+        ALLOW_CALL(curlMock, curl_easy_setopt_(_, CURLOPT_WRITEDATA, ANY(void*)))
+            .LR_SIDE_EFFECT(*static_cast<std::string*>(_3) = body)
+            .RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_perform(_)).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_getinfo_(handle, CURLINFO_RESPONSE_CODE, _))
+            .LR_SIDE_EFFECT(*static_cast<long*>(_3) = responseCode)
+            .RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_getinfo_(handle, CURLINFO_RETRY_AFTER, _))
+            .SIDE_EFFECT(*static_cast<long*>(_3) = 0)
+            .RETURN(CURLE_OK);
+
+        responseCode = 503;
+        body = "";
+        CHECK_THROWS_AS(http.send("m0 f=1"), ServerError);
+        body = "<html><body>Service Unavailable</body></html>";
+        CHECK_THROWS_AS(http.send("m0 f=1"), ServerError);
+        CHECK_THROWS_WITH(http.send("m0 f=1"), Catch::Contains("Service Unavailable"));
+
+        responseCode = 429;
+        body = "";
+        CHECK_THROWS_AS(http.send("m0 f=1"), TooManyRequests);
+        body = "<html><body>Too Many Requests</body></html>";
+        CHECK_THROWS_AS(http.send("m0 f=1"), TooManyRequests);
+        CHECK_THROWS_WITH(http.send("m0 f=1"), Catch::Contains("Too Many Requests"));
+    }
+
+    TEST_CASE("V1: Send splits payload if too large", "[HttpTest]")
+    {
+        ALLOW_CALL(curlMock, curl_global_init(_)).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_init()).RETURN(handle);
+        ALLOW_CALL(curlMock, curl_easy_setopt_(_, _, ANY(std::string))).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_setopt_(_, _, ANY(WriteCallbackFn))).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_cleanup(_));
+        ALLOW_CALL(curlMock, curl_easy_escape(_, ANY(char*), ANY(int))).RETURN(&std::string(_2)[0]);
+        ALLOW_CALL(curlMock, curl_free(_));
+        ALLOW_CALL(curlMock, curl_global_cleanup());
+
+        auto conn = internal::ConnectionInfo::createConnectionInfoV1("http://localhost", 8086, "test");
+        HTTP http{conn};
+
+        ALLOW_CALL(curlMock, curl_easy_setopt_(_, CURLOPT_WRITEDATA, ANY(void*)))
+            .LR_SIDE_EFFECT(*static_cast<std::string*>(_3) = "")
+            .RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_setopt_(_, _, ANY(long))).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_perform(_)).RETURN(CURLE_OK);
+
+        trompeloeil::sequence seq;
+        REQUIRE_CALL(curlMock, curl_easy_setopt_(_, CURLOPT_POSTFIELDSIZE, 20L)).IN_SEQUENCE(seq).RETURN(CURLE_OK);
+        REQUIRE_CALL(curlMock, curl_easy_getinfo_(handle, CURLINFO_RESPONSE_CODE, _))
+            .IN_SEQUENCE(seq)
+            .LR_SIDE_EFFECT(*static_cast<long*>(_3) = 413)
+            .RETURN(CURLE_OK);
+        REQUIRE_CALL(curlMock, curl_easy_setopt_(_, CURLOPT_POSTFIELDSIZE, 6L)).IN_SEQUENCE(seq).RETURN(CURLE_OK);
+        REQUIRE_CALL(curlMock, curl_easy_getinfo_(handle, CURLINFO_RESPONSE_CODE, _))
+            .IN_SEQUENCE(seq)
+            .LR_SIDE_EFFECT(*static_cast<long*>(_3) = 204)
+            .RETURN(CURLE_OK);
+        REQUIRE_CALL(curlMock, curl_easy_setopt_(_, CURLOPT_POSTFIELDSIZE, 13L)).IN_SEQUENCE(seq).RETURN(CURLE_OK);
+        REQUIRE_CALL(curlMock, curl_easy_getinfo_(handle, CURLINFO_RESPONSE_CODE, _))
+            .IN_SEQUENCE(seq)
+            .LR_SIDE_EFFECT(*static_cast<long*>(_3) = 204)
+            .RETURN(CURLE_OK);
+
+        http.send("m0 f=1\nm1 f=2\nm2 f=3");
+    }
+
+    TEST_CASE("V1: Send throws if single line is too large", "[HttpTest]")
+    {
+        ALLOW_CALL(curlMock, curl_global_init(_)).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_init()).RETURN(handle);
+        ALLOW_CALL(curlMock, curl_easy_setopt_(_, _, ANY(std::string))).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_setopt_(_, _, ANY(long))).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_setopt_(_, _, ANY(WriteCallbackFn))).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_cleanup(_));
+        ALLOW_CALL(curlMock, curl_easy_escape(_, ANY(char*), ANY(int))).RETURN(&std::string(_2)[0]);
+        ALLOW_CALL(curlMock, curl_free(_));
+        ALLOW_CALL(curlMock, curl_global_cleanup());
+
+        auto conn = internal::ConnectionInfo::createConnectionInfoV1("http://localhost", 8086, "test");
+        HTTP http{conn};
+
+        ALLOW_CALL(curlMock, curl_easy_setopt_(_, CURLOPT_WRITEDATA, ANY(void*)))
+            .LR_SIDE_EFFECT(*static_cast<std::string*>(_3) = "{}")
+            .RETURN(CURLE_OK);
+        REQUIRE_CALL(curlMock, curl_easy_perform(_)).RETURN(CURLE_OK);
+        REQUIRE_CALL(curlMock, curl_easy_getinfo_(handle, CURLINFO_RESPONSE_CODE, _))
+            .LR_SIDE_EFFECT(*static_cast<long*>(_3) = 413)
+            .RETURN(CURLE_OK);
+
+        REQUIRE_THROWS_AS(http.send("m0 f=1"), PayloadTooLarge);
+    }
+
+    TEST_CASE("V1: Send passes rejected lines to handler and resends others", "[HttpTest]")
+    {
+        ALLOW_CALL(curlMock, curl_global_init(_)).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_init()).RETURN(handle);
+        ALLOW_CALL(curlMock, curl_easy_setopt_(_, _, ANY(std::string))).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_setopt_(_, _, ANY(WriteCallbackFn))).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_cleanup(_));
+        ALLOW_CALL(curlMock, curl_easy_escape(_, ANY(char*), ANY(int))).RETURN(&std::string(_2)[0]);
+        ALLOW_CALL(curlMock, curl_free(_));
+        ALLOW_CALL(curlMock, curl_global_cleanup());
+
+        auto conn = internal::ConnectionInfo::createConnectionInfoV1("http://localhost", 8086, "test");
+        HTTP http{conn};
+        std::vector<std::string> rejected;
+        http.setRejectedLineHandler([&rejected](std::string_view line, const std::string&) { rejected.emplace_back(line); });
+
+        int requests{0};
+        ALLOW_CALL(curlMock, curl_easy_setopt_(_, CURLOPT_WRITEDATA, ANY(void*)))
+            .LR_SIDE_EFFECT(*static_cast<std::string*>(_3) = (requests++ == 0) ? R"({"error":"unable to parse 'm1 f=': missing field value"})" : "")
+            .RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_setopt_(_, _, ANY(long))).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_perform(_)).RETURN(CURLE_OK);
+
+        trompeloeil::sequence seq;
+        REQUIRE_CALL(curlMock, curl_easy_setopt_(_, CURLOPT_POSTFIELDSIZE, 20L)).IN_SEQUENCE(seq).RETURN(CURLE_OK);
+        REQUIRE_CALL(curlMock, curl_easy_getinfo_(handle, CURLINFO_RESPONSE_CODE, _))
+            .IN_SEQUENCE(seq)
+            .LR_SIDE_EFFECT(*static_cast<long*>(_3) = 400)
+            .RETURN(CURLE_OK);
+        REQUIRE_CALL(curlMock, curl_easy_setopt_(_, CURLOPT_POSTFIELDSIZE, 13L)).IN_SEQUENCE(seq).RETURN(CURLE_OK);
+        REQUIRE_CALL(curlMock, curl_easy_getinfo_(handle, CURLINFO_RESPONSE_CODE, _))
+            .IN_SEQUENCE(seq)
+            .LR_SIDE_EFFECT(*static_cast<long*>(_3) = 204)
+            .RETURN(CURLE_OK);
+
+        http.send("m0 f=1\nm1 f=\nm2 f=3");
+        CHECK(rejected == std::vector<std::string>{"m1 f="});
+    }
+
+    TEST_CASE("V1: Send doesn't resend lines of partial write", "[HttpTest]")
+    {
+        ALLOW_CALL(curlMock, curl_global_init(_)).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_init()).RETURN(handle);
+        ALLOW_CALL(curlMock, curl_easy_setopt_(_, _, ANY(std::string))).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_setopt_(_, _, ANY(long))).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_setopt_(_, _, ANY(WriteCallbackFn))).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_cleanup(_));
+        ALLOW_CALL(curlMock, curl_easy_escape(_, ANY(char*), ANY(int))).RETURN(&std::string(_2)[0]);
+        ALLOW_CALL(curlMock, curl_free(_));
+        ALLOW_CALL(curlMock, curl_global_cleanup());
+
+        auto conn = internal::ConnectionInfo::createConnectionInfoV1("http://localhost", 8086, "test");
+        HTTP http{conn};
+        std::vector<std::string> rejected;
+        http.setRejectedLineHandler([&rejected](std::string_view line, const std::string&) { rejected.emplace_back(line); });
+
+        ALLOW_CALL(curlMock, curl_easy_setopt_(_, CURLOPT_WRITEDATA, ANY(void*)))
+            .LR_SIDE_EFFECT(*static_cast<std::string*>(_3) = R"({"error":"partial write: field type conflict: input field \"f\" on measurement \"m1\" is type integer, already exists as type float dropped=1"})")
+            .RETURN(CURLE_OK);
+        REQUIRE_CALL(curlMock, curl_easy_perform(_)).RETURN(CURLE_OK);
+        REQUIRE_CALL(curlMock, curl_easy_getinfo_(handle, CURLINFO_RESPONSE_CODE, _))
+            .LR_SIDE_EFFECT(*static_cast<long*>(_3) = 400)
+            .RETURN(CURLE_OK);
+
+        http.send("m0 f=1\nm1 f=2i\nm2 f=3");
+        CHECK(rejected == std::vector<std::string>{"m1 f=2i"});
+    }
+
+    TEST_CASE("V1: Send throws if dropped lines of partial write are unknown", "[HttpTest]")
+    {
+        ALLOW_CALL(curlMock, curl_global_init(_)).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_init()).RETURN(handle);
+        ALLOW_CALL(curlMock, curl_easy_setopt_(_, _, ANY(std::string))).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_setopt_(_, _, ANY(long))).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_setopt_(_, _, ANY(WriteCallbackFn))).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_cleanup(_));
+        ALLOW_CALL(curlMock, curl_easy_escape(_, ANY(char*), ANY(int))).RETURN(&std::string(_2)[0]);
+        ALLOW_CALL(curlMock, curl_free(_));
+        ALLOW_CALL(curlMock, curl_global_cleanup());
+
+        auto conn = internal::ConnectionInfo::createConnectionInfoV1("http://localhost", 8086, "test");
+        HTTP http{conn};
+        std::vector<std::string> rejected;
+        http.setRejectedLineHandler([&rejected](std::string_view line, const std::string&) { rejected.emplace_back(line); });
+
+        ALLOW_CALL(curlMock, curl_easy_setopt_(_, CURLOPT_WRITEDATA, ANY(void*)))
+            .LR_SIDE_EFFECT(*static_cast<std::string*>(_3) = R"({"error":"partial write: field type conflict: input field \"f\" on measurement \"m1\" is type integer, already exists as type float dropped=2"})")
+            .RETURN(CURLE_OK);
+        REQUIRE_CALL(curlMock, curl_easy_perform(_)).RETURN(CURLE_OK);
+        REQUIRE_CALL(curlMock, curl_easy_getinfo_(handle, CURLINFO_RESPONSE_CODE, _))
+            .LR_SIDE_EFFECT(*static_cast<long*>(_3) = 400)
+            .RETURN(CURLE_OK);
+
+        CHECK_THROWS_AS(http.send("m0 f=1\nm1 f=2i\nm2 f=3"), BadRequest);
+        CHECK(rejected.empty());
+    }
+
+    TEST_CASE("V1: Send throws if rejected lines are unknown", "[HttpTest]")
+    {
+        ALLOW_CALL(curlMock, curl_global_init(_)).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_init()).RETURN(handle);
+        ALLOW_CALL(curlMock, curl_easy_setopt_(_, _, ANY(std::string))).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_setopt_(_, _, ANY(long))).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_setopt_(_, _, ANY(WriteCallbackFn))).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_cleanup(_));
+        ALLOW_CALL(curlMock, curl_easy_escape(_, ANY(char*), ANY(int))).RETURN(&std::string(_2)[0]);
+        ALLOW_CALL(curlMock, curl_free(_));
+        ALLOW_CALL(curlMock, curl_global_cleanup());
+
+        auto conn = internal::ConnectionInfo::createConnectionInfoV1("http://localhost", 8086, "test");
+        HTTP http{conn};
+        http.setRejectedLineHandler([](std::string_view, const std::string&) { FAIL("Unexpected rejected line"); });
+
+        ALLOW_CALL(curlMock, curl_easy_setopt_(_, CURLOPT_WRITEDATA, ANY(void*)))
+            .LR_SIDE_EFFECT(*static_cast<std::string*>(_3) = R"({"error":"invalid precision"})")
+            .RETURN(CURLE_OK);
+        REQUIRE_CALL(curlMock, curl_easy_perform(_)).RETURN(CURLE_OK);
+        REQUIRE_CALL(curlMock, curl_easy_getinfo_(handle, CURLINFO_RESPONSE_CODE, _))
+            .LR_SIDE_EFFECT(*static_cast<long*>(_3) = 400)
+            .RETURN(CURLE_OK);
+
+        CHECK_THROWS_AS(http.send("m0 f=1"), BadRequest);
+    }
+
+    TEST_CASE("V1: Send throws with requested delay if rate limited", "[HttpTest]")
+    {
+        ALLOW_CALL(curlMock, curl_global_init(_)).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_init()).RETURN(handle);
+        ALLOW_CALL(curlMock, curl_easy_setopt_(_, _, ANY(std::string))).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_setopt_(_, _, ANY(long))).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_setopt_(_, _, ANY(WriteCallbackFn))).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_cleanup(_));
+        ALLOW_CALL(curlMock, curl_easy_escape(_, ANY(char*), ANY(int))).RETURN(&std::string(_2)[0]);
+        ALLOW_CALL(curlMock, curl_free(_));
+        ALLOW_CALL(curlMock, curl_global_cleanup());
+
+        auto conn = internal::ConnectionInfo::createConnectionInfoV1("http://localhost", 8086, "test");
+        HTTP http{conn};
+
+        ALLOW_CALL(curlMock, curl_easy_setopt_(_, CURLOPT_WRITEDATA, ANY(void*)))
+            .LR_SIDE_EFFECT(*static_cast<std::string*>(_3) = R"({"error":"rate limited"})")
+            .RETURN(CURLE_OK);
+        REQUIRE_CALL(curlMock, curl_easy_perform(_)).RETURN(CURLE_OK);
+        REQUIRE_CALL(curlMock, curl_easy_getinfo_(handle, CURLINFO_RESPONSE_CODE, _))
+            .LR_SIDE_EFFECT(*static_cast<long*>(_3) = 429)
+            .RETURN(CURLE_OK);
+        REQUIRE_CALL(curlMock, curl_easy_getinfo_(handle, CURLINFO_RETRY_AFTER, _))
+            .LR_SIDE_EFFECT(*static_cast<long*>(_3) = 7)
+            .RETURN(CURLE_OK);
+
+        try
+        {
+            http.send("m0 f=1");
+            FAIL("Expected TooManyRequests");
+        }
+        catch (const TooManyRequests& e)
+        {
+            CHECK(e.retryAfter() == std::chrono::seconds{7});
+            CHECK_THAT(e.what(), Catch::Contains("rate limited"));
+        }
+    }
+
+    TEST_CASE("V1: Send compresses payload if compression enabled", "[HttpTest]")
+    {
+        ALLOW_CALL(curlMock, curl_global_init(_)).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_init()).RETURN(handle);
+        ALLOW_CALL(curlMock, curl_easy_setopt_(_, _, ANY(std::string))).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_setopt_(_, _, ANY(long))).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_setopt_(_, _, ANY(WriteCallbackFn))).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_cleanup(_));
+        ALLOW_CALL(curlMock, curl_easy_escape(_, ANY(char*), ANY(int))).RETURN(&std::string(_2)[0]);
+        ALLOW_CALL(curlMock, curl_free(_));
+        ALLOW_CALL(curlMock, curl_global_cleanup());
+
+        curl_slist headers{};
+        REQUIRE_CALL(curlMock, curl_slist_free_all(&headers));
+
+        const std::string data(200, 'x');
+        auto conn = internal::ConnectionInfo::createConnectionInfoV1("http://localhost", 8086, "test");
+        HTTP http{conn};
+
+        REQUIRE_CALL(curlMock, curl_slist_append(_, _)).WITH(_1 == nullptr && std::string(_2) == "Content-Encoding: gzip").RETURN(&headers);
+        http.enableCompression(6, 100);
+
+        REQUIRE_CALL(curlMock, curl_easy_setopt_(_, CURLOPT_HTTPHEADER, &headers)).RETURN(CURLE_OK);
+        REQUIRE_CALL(curlMock, curl_easy_setopt_(_, CURLOPT_WRITEDATA, ANY(void*)))
+            .LR_SIDE_EFFECT(*static_cast<std::string*>(_3) = "")
+            .RETURN(CURLE_OK);
+        REQUIRE_CALL(curlMock, curl_easy_setopt_(_, CURLOPT_POSTFIELDS, std::string{"\x1f\x8b\x08"})).RETURN(CURLE_OK);
+        REQUIRE_CALL(curlMock, curl_easy_setopt_(_, CURLOPT_POSTFIELDSIZE, ANY(long)))
+            .WITH(_3 < static_cast<long>(data.size()))
+            .RETURN(CURLE_OK);
+        REQUIRE_CALL(curlMock, curl_easy_perform(handle)).RETURN(CURLE_OK);
+        REQUIRE_CALL(curlMock, curl_easy_getinfo_(handle, CURLINFO_RESPONSE_CODE, _))
+            .LR_SIDE_EFFECT(*static_cast<long*>(_3) = 204)
+            .RETURN(CURLE_OK);
+
+        http.send(std::string{data});
+    }
+
+    TEST_CASE("V1: Send doesn't compress payload below minimum size", "[HttpTest]")
+    {
+        ALLOW_CALL(curlMock, curl_global_init(_)).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_init()).RETURN(handle);
+        ALLOW_CALL(curlMock, curl_easy_setopt_(_, _, ANY(std::string))).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_setopt_(_, _, ANY(long))).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_setopt_(_, _, ANY(WriteCallbackFn))).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_cleanup(_));
+        ALLOW_CALL(curlMock, curl_easy_escape(_, ANY(char*), ANY(int))).RETURN(&std::string(_2)[0]);
+        ALLOW_CALL(curlMock, curl_free(_));
+        ALLOW_CALL(curlMock, curl_global_cleanup());
+
+        curl_slist headers{};
+        ALLOW_CALL(curlMock, curl_slist_append(_, _)).RETURN(&headers);
+        ALLOW_CALL(curlMock, curl_slist_free_all(&headers));
+
+        const std::string data{"content-to-send"};
+        auto conn = internal::ConnectionInfo::createConnectionInfoV1("http://localhost", 8086, "test");
+        HTTP http{conn};
+        http.enableCompression(6, 100);
+
+        REQUIRE_CALL(curlMock, curl_easy_setopt_(_, CURLOPT_HTTPHEADER, static_cast<curl_slist*>(nullptr))).RETURN(CURLE_OK);
+        REQUIRE_CALL(curlMock, curl_easy_setopt_(_, CURLOPT_WRITEDATA, ANY(void*)))
+            .LR_SIDE_EFFECT(*static_cast<std::string*>(_3) = "")
+            .RETURN(CURLE_OK);
+        REQUIRE_CALL(curlMock, curl_easy_setopt_(_, CURLOPT_POSTFIELDS, data)).RETURN(CURLE_OK);
+        REQUIRE_CALL(curlMock, curl_easy_setopt_(_, CURLOPT_POSTFIELDSIZE, static_cast<long>(data.size()))).RETURN(CURLE_OK);
+        REQUIRE_CALL(curlMock, curl_easy_perform(handle)).RETURN(CURLE_OK);
+        REQUIRE_CALL(curlMock, curl_easy_getinfo_(handle, CURLINFO_RESPONSE_CODE, _))
+            .LR_SIDE_EFFECT(*static_cast<long*>(_3) = 204)
+            .RETURN(CURLE_OK);
+
+        http.send(std::string{data});
+    }
+
+    TEST_CASE("V1: Enabling compression throws on invalid level", "[HttpTest]")
+    {
+        ALLOW_CALL(curlMock, curl_global_init(_)).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_init()).RETURN(handle);
+        ALLOW_CALL(curlMock, curl_easy_setopt_(_, _, ANY(std::string))).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_setopt_(_, _, ANY(long))).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_setopt_(_, _, ANY(WriteCallbackFn))).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_cleanup(_));
+        ALLOW_CALL(curlMock, curl_easy_escape(_, ANY(char*), ANY(int))).RETURN(&std::string(_2)[0]);
+        ALLOW_CALL(curlMock, curl_free(_));
+        ALLOW_CALL(curlMock, curl_global_cleanup());
+
+        auto conn = internal::ConnectionInfo::createConnectionInfoV1("http://localhost", 8086, "test");
+        HTTP http{conn};
+
+        CHECK_THROWS_AS(http.enableCompression(10, 100), InfluxDBException);
+    }
+
+    TEST_CASE("V1: Enabling MessagePack sets accept header of queries", "[HttpTest]")
+    {
+        ALLOW_CALL(curlMock, curl_global_init(_)).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_init()).RETURN(handle);
+        ALLOW_CALL(curlMock, curl_easy_setopt_(_, _, ANY(std::string))).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_setopt_(_, _, ANY(long))).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_setopt_(_, _, ANY(WriteCallbackFn))).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_cleanup(_));
+        ALLOW_CALL(curlMock, curl_easy_escape(_, ANY(char*), ANY(int))).RETURN(&std::string(_2)[0]);
+        ALLOW_CALL(curlMock, curl_free(_));
+        ALLOW_CALL(curlMock, curl_global_cleanup());
+
+        curl_slist headers{};
+        REQUIRE_CALL(curlMock, curl_slist_free_all(&headers));
+
+        auto conn = internal::ConnectionInfo::createConnectionInfoV1("http://localhost", 8086, "test");
+        HTTP http{conn};
+
+        REQUIRE_CALL(curlMock, curl_slist_append(nullptr, _)).WITH(std::string(_2) == "Accept: application/x-msgpack").RETURN(&headers);
+        REQUIRE_CALL(curlMock, curl_easy_setopt_(handle, CURLOPT_HTTPHEADER, &headers)).RETURN(CURLE_OK);
+        http.enableMessagePack();
+    }
+
     TEST_CASE("V1: Query configures curl", "[HttpTest]")
     {
         ALLOW_CALL(curlMock, curl_global_init(_)).RETURN(CURLE_OK);
@@ -419,6 +816,215 @@ namespace influxdb::test
         REQUIRE_THROWS_AS(http.query(query), ServerError);
     }
 
+    TEST_CASE("V1: Streamed query passes response chunks", "[HttpTest]")
+    {
+        ALLOW_CALL(curlMock, curl_global_init(_)).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_init()).RETURN(handle);
+        ALLOW_CALL(curlMock, curl_easy_setopt_(_, _, ANY(std::string))).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_setopt_(_, _, ANY(long))).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_cleanup(_));
+        ALLOW_CALL(curlMock, curl_easy_escape(_, ANY(char*), ANY(int))).RETURN(&std::string(_2)[0]);
+        ALLOW_CALL(curlMock, curl_free(_));
+        ALLOW_CALL(curlMock, curl_global_cleanup());
+
+        WriteCallbackFn writeCallback{nullptr};
+        void* writeData{nullptr};
+        std::vector<std::size_t> callbackResults;
+        ALLOW_CALL(curlMock, curl_easy_setopt_(_, CURLOPT_WRITEFUNCTION, ANY(WriteCallbackFn)))
+            .LR_SIDE_EFFECT(writeCallback = _3)
+            .RETURN(CURLE_OK);
+
+        auto conn = internal::ConnectionInfo::createConnectionInfoV1("http://localhost", 8086, "test");
+        HTTP http{conn};
+
+        const std::string query{"SELECT * FROM test"};
+        REQUIRE_CALL(curlMock, curl_easy_setopt_(_, CURLOPT_URL, "http://localhost:8086/query?db=test&q=SELECT * FROM test")).RETURN(CURLE_OK);
+        REQUIRE_CALL(curlMock, curl_easy_setopt_(_, CURLOPT_WRITEDATA, ANY(void*)))
+            .LR_SIDE_EFFECT(writeData = _3)
+            .RETURN(CURLE_OK);
+        REQUIRE_CALL(curlMock, curl_easy_perform(handle))
+            .LR_SIDE_EFFECT(callbackResults = receiveChunks(writeCallback, writeData, {"query-", "result"}))
+            .RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_getinfo_(handle, CURLINFO_RESPONSE_CODE, _))
+            .LR_SIDE_EFFECT(*static_cast<long*>(_3) = 200)
+            .RETURN(CURLE_OK);
+
+        std::vector<std::string> chunks;
+        http.streamQuery(query, {}, [&chunks](std::string_view chunk) { chunks.emplace_back(chunk); });
+        CHECK(chunks == std::vector<std::string>{"query-", "result"});
+        CHECK(callbackResults == std::vector<std::size_t>{6, 6});
+    }
+
+    TEST_CASE("V1: Streamed query doesn't pass error response", "[HttpTest]")
+    {
+        ALLOW_CALL(curlMock, curl_global_init(_)).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_init()).RETURN(handle);
+        ALLOW_CALL(curlMock, curl_easy_setopt_(_, _, ANY(std::string))).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_setopt_(_, _, ANY(long))).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_cleanup(_));
+        ALLOW_CALL(curlMock, curl_easy_escape(_, ANY(char*), ANY(int))).RETURN(&std::string(_2)[0]);
+        ALLOW_CALL(curlMock, curl_free(_));
+        ALLOW_CALL(curlMock, curl_global_cleanup());
+
+        WriteCallbackFn writeCallback{nullptr};
+        void* writeData{nullptr};
+        ALLOW_CALL(curlMock, curl_easy_setopt_(_, CURLOPT_WRITEFUNCTION, ANY(WriteCallbackFn)))
+            .LR_SIDE_EFFECT(writeCallback = _3)
+            .RETURN(CURLE_OK);
+
+        auto conn = internal::ConnectionInfo::createConnectionInfoV1("http://localhost", 8086, "test");
+        HTTP http{conn};
+
+        ALLOW_CALL(curlMock, curl_easy_setopt_(_, CURLOPT_WRITEDATA, ANY(void*)))
+            .LR_SIDE_EFFECT(writeData = _3)
+            .RETURN(CURLE_OK);
+        REQUIRE_CALL(curlMock, curl_easy_perform(handle))
+            .LR_SIDE_EFFECT(receiveChunks(writeCallback, writeData, {R"({"error":)", R"("database not found"})"}))
+            .RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_getinfo_(handle, CURLINFO_RESPONSE_CODE, _))
+            .LR_SIDE_EFFECT(*static_cast<long*>(_3) = 404)
+            .RETURN(CURLE_OK);
+
+        bool called{false};
+        REQUIRE_THROWS_AS(http.streamQuery("SELECT * FROM test", {}, [&called](std::string_view) { called = true; }), NonExistentDatabase);
+        CHECK_FALSE(called);
+    }
+
+    TEST_CASE("V1: Streamed query aborts if response handler throws", "[HttpTest]")
+    {
+        ALLOW_CALL(curlMock, curl_global_init(_)).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_init()).RETURN(handle);
+        ALLOW_CALL(curlMock, curl_easy_setopt_(_, _, ANY(std::string))).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_setopt_(_, _, ANY(long))).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_cleanup(_));
+        ALLOW_CALL(curlMock, curl_easy_escape(_, ANY(char*), ANY(int))).RETURN(&std::string(_2)[0]);
+        ALLOW_CALL(curlMock, curl_free(_));
+        ALLOW_CALL(curlMock, curl_global_cleanup());
+
+        WriteCallbackFn writeCallback{nullptr};
+        void* writeData{nullptr};
+        std::vector<std::size_t> callbackResults;
+        ALLOW_CALL(curlMock, curl_easy_setopt_(_, CURLOPT_WRITEFUNCTION, ANY(WriteCallbackFn)))
+            .LR_SIDE_EFFECT(writeCallback = _3)
+            .RETURN(CURLE_OK);
+
+        auto conn = internal::ConnectionInfo::createConnectionInfoV1("http://localhost", 8086, "test");
+        HTTP http{conn};
+
+        ALLOW_CALL(curlMock, curl_easy_setopt_(_, CURLOPT_WRITEDATA, ANY(void*)))
+            .LR_SIDE_EFFECT(writeData = _3)
+            .RETURN(CURLE_OK);
+        REQUIRE_CALL(curlMock, curl_easy_perform(handle))
+            .LR_SIDE_EFFECT(callbackResults = receiveChunks(writeCallback, writeData, {"invalid"}))
+            .RETURN(CURLE_WRITE_ERROR);
+        ALLOW_CALL(curlMock, curl_easy_getinfo_(handle, CURLINFO_RESPONSE_CODE, _))
+            .LR_SIDE_EFFECT(*static_cast<long*>(_3) = 200)
+            .RETURN(CURLE_OK);
+
+        auto throwing = [](std::string_view) { throw InfluxDBException{"unit test", "Intentional"}; };
+        REQUIRE_THROWS_WITH(http.streamQuery("SELECT * FROM test", {}, throwing), Catch::Contains("Intentional"));
+        CHECK(callbackResults == std::vector<std::size_t>{0});
+    }
+
+    TEST_CASE("V1: Chunked query requests chunked response", "[HttpTest]")
+    {
+        ALLOW_CALL(curlMock, curl_global_init(_)).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_init()).RETURN(handle);
+        ALLOW_CALL(curlMock, curl_easy_setopt_(_, _, ANY(std::string))).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_setopt_(_, _, ANY(long))).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_setopt_(_, _, ANY(void*))).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_setopt_(_, CURLOPT_WRITEFUNCTION, ANY(WriteCallbackFn))).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_cleanup(_));
+        ALLOW_CALL(curlMock, curl_easy_escape(_, ANY(char*), ANY(int))).RETURN(&std::string(_2)[0]);
+        ALLOW_CALL(curlMock, curl_free(_));
+        ALLOW_CALL(curlMock, curl_global_cleanup());
+
+        auto conn = internal::ConnectionInfo::createConnectionInfoV1("http://localhost", 8086, "test");
+        HTTP http{conn};
+
+        REQUIRE_CALL(curlMock, curl_easy_setopt_(_, CURLOPT_URL, "http://localhost:8086/query?db=test&q=SELECT * FROM test&chunked=true&chunk_size=100"))
+            .RETURN(CURLE_OK);
+        REQUIRE_CALL(curlMock, curl_easy_perform(handle)).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_getinfo_(handle, CURLINFO_RESPONSE_CODE, _))
+            .LR_SIDE_EFFECT(*static_cast<long*>(_3) = 200)
+            .RETURN(CURLE_OK);
+
+        http.streamChunkedQuery("SELECT * FROM test", {}, 100, [](std::string_view) {});
+        CHECK_THROWS_AS(http.streamChunkedQuery("SELECT * FROM test", {}, 0, [](std::string_view) {}), InfluxDBException);
+    }
+
+    TEST_CASE("V1: CSV query accepts CSV for this request only", "[HttpTest]")
+    {
+        ALLOW_CALL(curlMock, curl_global_init(_)).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_init()).RETURN(handle);
+        ALLOW_CALL(curlMock, curl_easy_setopt_(_, _, ANY(std::string))).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_setopt_(_, _, ANY(long))).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_setopt_(_, _, ANY(void*))).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_setopt_(_, CURLOPT_WRITEFUNCTION, ANY(WriteCallbackFn))).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_cleanup(_));
+        ALLOW_CALL(curlMock, curl_easy_escape(_, ANY(char*), ANY(int))).RETURN(&std::string(_2)[0]);
+        ALLOW_CALL(curlMock, curl_free(_));
+        ALLOW_CALL(curlMock, curl_global_cleanup());
+        ALLOW_CALL(curlMock, curl_easy_getinfo_(handle, CURLINFO_RESPONSE_CODE, _))
+            .LR_SIDE_EFFECT(*static_cast<long*>(_3) = 200)
+            .RETURN(CURLE_OK);
+
+        curl_slist headers{};
+        REQUIRE_CALL(curlMock, curl_slist_free_all(&headers));
+
+        auto conn = internal::ConnectionInfo::createConnectionInfoV1("http://localhost", 8086, "test");
+        HTTP http{conn};
+
+        trompeloeil::sequence seq;
+        REQUIRE_CALL(curlMock, curl_slist_append(nullptr, _)).WITH(std::string(_2) == "Accept: application/csv").RETURN(&headers);
+        REQUIRE_CALL(curlMock, curl_easy_setopt_(handle, CURLOPT_HTTPHEADER, &headers)).IN_SEQUENCE(seq).RETURN(CURLE_OK);
+        REQUIRE_CALL(curlMock, curl_easy_perform(handle)).IN_SEQUENCE(seq).RETURN(CURLE_OK);
+        REQUIRE_CALL(curlMock, curl_easy_setopt_(handle, CURLOPT_HTTPHEADER, nullptr)).IN_SEQUENCE(seq).RETURN(CURLE_OK);
+        http.streamCsvQuery("SELECT * FROM test", {}, [](std::string_view) {});
+    }
+
+    TEST_CASE("V1: Concurrent queries use additional read handles", "[HttpTest]")
+    {
+        ALLOW_CALL(curlMock, curl_global_init(_)).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_setopt_(_, _, ANY(std::string))).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_setopt_(_, _, ANY(long))).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_setopt_(_, _, ANY(void*))).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_setopt_(_, _, ANY(WriteCallbackFn))).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_escape(_, ANY(char*), ANY(int))).RETURN(&std::string(_2)[0]);
+        ALLOW_CALL(curlMock, curl_free(_));
+        ALLOW_CALL(curlMock, curl_global_cleanup());
+        ALLOW_CALL(curlMock, curl_easy_getinfo_(_, CURLINFO_RESPONSE_CODE, _))
+            .LR_SIDE_EFFECT(*static_cast<long*>(_3) = 200)
+            .RETURN(CURLE_OK);
+
+        WriteCallbackFn writeCallback{nullptr};
+        void* writeData{nullptr};
+        ALLOW_CALL(curlMock, curl_easy_setopt_(handle, CURLOPT_WRITEFUNCTION, ANY(WriteCallbackFn)))
+            .LR_SIDE_EFFECT(writeCallback = _3)
+            .RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_setopt_(handle, CURLOPT_WRITEDATA, ANY(void*)))
+            .LR_SIDE_EFFECT(writeData = _3)
+            .RETURN(CURLE_OK);
+
+        CurlHandleDummy otherDummy;
+        CURL* otherHandle = &otherDummy;
+        REQUIRE_CALL(curlMock, curl_easy_cleanup(otherHandle));
+        REQUIRE_CALL(curlMock, curl_easy_cleanup(handle)).TIMES(2);
+
+        auto initHandles = NAMED_ALLOW_CALL(curlMock, curl_easy_init()).RETURN(handle);
+        auto conn = internal::ConnectionInfo::createConnectionInfoV1("http://localhost", 8086, "test");
+        HTTP http{conn};
+        initHandles.reset();
+
+        REQUIRE_CALL(curlMock, curl_easy_init()).RETURN(otherHandle);
+        REQUIRE_CALL(curlMock, curl_easy_perform(otherHandle)).TIMES(2).RETURN(CURLE_OK);
+        REQUIRE_CALL(curlMock, curl_easy_perform(handle))
+            .LR_SIDE_EFFECT(receiveChunks(writeCallback, writeData, {"a", "b"}))
+            .RETURN(CURLE_OK);
+
+        http.streamQuery("SELECT * FROM test", {}, [&http](std::string_view) { http.query("SELECT * FROM other"); });
+    }
+
     TEST_CASE("V1: Create database configures curl", "[HttpTest]")
     {
         ALLOW_CALL(curlMock, curl_global_init(_)).RETURN(CURLE_OK);
@@ -1139,7 +1745,6 @@ namespace influxdb::test
         ALLOW_CALL(curlMock, curl_global_cleanup());
 
         auto conn = internal::ConnectionInfo::createConnectionInfoV2("http://localhost", 8086, "example-database-0", "aheifAwakjfAPWwe", "rp");
-        HTTP http{conn};
 
         std::string auth = "Authorization: Token " + conn.token;
 
@@ -1147,12 +1752,103 @@ namespace influxdb::test
         slist_obj->data = new char[auth.length() + 1];
         slist_obj->data = strcpy(slist_obj->data, auth.c_str());
 
+        REQUIRE_CALL(curlMock, curl_slist_free_all(slist_obj));
+        HTTP http{conn};
+
         REQUIRE_CALL(curlMock, curl_slist_append(_, trompeloeil::ne(nullptr))).WITH(std::string(_2) == "Authorization: Token aheifAwakjfAPWwe").RETURN(slist_obj);
         REQUIRE_CALL(curlMock, curl_easy_setopt_(_, CURLOPT_HTTPHEADER, slist_obj)).RETURN(CURLE_OK);
         REQUIRE_CALL(curlMock, curl_easy_setopt_(_, CURLOPT_HTTPHEADER, slist_obj)).RETURN(CURLE_OK);
         http.enableTokenAuth(conn.token);
     }
 
+    TEST_CASE("V2: Enabling compression keeps token auth header", "[HttpTest]")
+    {
+        ALLOW_CALL(curlMock, curl_global_init(_)).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_init()).RETURN(handle);
+        ALLOW_CALL(curlMock, curl_easy_setopt_(_, _, ANY(std::string))).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_setopt_(_, _, ANY(long))).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_setopt_(_, _, ANY(WriteCallbackFn))).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_setopt_(_, CURLOPT_HTTPHEADER, ANY(curl_slist*))).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_cleanup(_));
+        ALLOW_CALL(curlMock, curl_easy_escape(_, ANY(char*), ANY(int))).RETURN(&std::string(_2)[0]);
+        ALLOW_CALL(curlMock, curl_free(_));
+        ALLOW_CALL(curlMock, curl_global_cleanup());
+
+        curl_slist authHeaders{};
+        curl_slist compressedHeaders{};
+        REQUIRE_CALL(curlMock, curl_slist_free_all(&authHeaders));
+        REQUIRE_CALL(curlMock, curl_slist_free_all(&compressedHeaders));
+
+        auto conn = internal::ConnectionInfo::createConnectionInfoV2("http://localhost", 8086, "example-database-0", "aheifAwakjfAPWwe", "rp");
+        HTTP http{conn};
+
+        REQUIRE_CALL(curlMock, curl_slist_append(_, _)).WITH(_1 == nullptr && std::string(_2) == "Authorization: Token aheifAwakjfAPWwe").RETURN(&authHeaders);
+        http.enableTokenAuth(conn.token);
+
+        trompeloeil::sequence seq;
+        REQUIRE_CALL(curlMock, curl_slist_append(_, _))
+            .IN_SEQUENCE(seq)
+            .WITH(_1 == nullptr && std::string(_2) == "Authorization: Token aheifAwakjfAPWwe")
+            .RETURN(&compressedHeaders);
+        REQUIRE_CALL(curlMock, curl_slist_append(&compressedHeaders, _))
+            .IN_SEQUENCE(seq)
+            .WITH(std::string(_2) == "Content-Encoding: gzip")
+            .RETURN(&compressedHeaders);
+        http.enableCompression(1, 0);
+    }
+
+    TEST_CASE("V2: Enabling token auth adds token to enabled headers", "[HttpTest]")
+    {
+        ALLOW_CALL(curlMock, curl_global_init(_)).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_init()).RETURN(handle);
+        ALLOW_CALL(curlMock, curl_easy_setopt_(_, _, ANY(std::string))).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_setopt_(_, _, ANY(long))).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_setopt_(_, _, ANY(WriteCallbackFn))).RETURN(CURLE_OK);
+        ALLOW_CALL(curlMock, curl_easy_cleanup(_));
+        ALLOW_CALL(curlMock, curl_easy_escape(_, ANY(char*), ANY(int))).RETURN(&std::string(_2)[0]);
+        ALLOW_CALL(curlMock, curl_free(_));
+        ALLOW_CALL(curlMock, curl_global_cleanup());
+
+        curl_slist compressedHeaders{};
+        curl_slist messagePackHeaders{};
+        curl_slist authHeaders{};
+        curl_slist authCompressedHeaders{};
+        curl_slist authMessagePackHeaders{};
+        REQUIRE_CALL(curlMock, curl_slist_free_all(&compressedHeaders));
+        REQUIRE_CALL(curlMock, curl_slist_free_all(&messagePackHeaders));
+        REQUIRE_CALL(curlMock, curl_slist_free_all(&authHeaders));
+        REQUIRE_CALL(curlMock, curl_slist_free_all(&authCompressedHeaders));
+        REQUIRE_CALL(curlMock, curl_slist_free_all(&authMessagePackHeaders));
+
+        auto conn = internal::ConnectionInfo::createConnectionInfoV2("http://localhost", 8086, "example-database-0", "aheifAwakjfAPWwe", "rp");
+        HTTP http{conn};
+
+        {
+            REQUIRE_CALL(curlMock, curl_slist_append(nullptr, _)).WITH(std::string(_2) == "Content-Encoding: gzip").RETURN(&compressedHeaders);
+            http.enableCompression(1, 0);
+            REQUIRE_CALL(curlMock, curl_slist_append(nullptr, _)).WITH(std::string(_2) == "Accept: application/x-msgpack").RETURN(&messagePackHeaders);
+            REQUIRE_CALL(curlMock, curl_easy_setopt_(handle, CURLOPT_HTTPHEADER, &messagePackHeaders)).RETURN(CURLE_OK);
+            http.enableMessagePack();
+        }
+
+        /// Write headers first, then compressed write and MessagePack read headers
+        const std::vector<curl_slist*> authLists{&authHeaders, &authCompressedHeaders, &authMessagePackHeaders};
+        std::size_t authCalls{0};
+        REQUIRE_CALL(curlMock, curl_slist_append(nullptr, _))
+            .WITH(std::string(_2) == "Authorization: Token aheifAwakjfAPWwe")
+            .TIMES(3)
+            .LR_RETURN(authLists[authCalls++]);
+        REQUIRE_CALL(curlMock, curl_slist_append(&authCompressedHeaders, _))
+            .WITH(std::string(_2) == "Content-Encoding: gzip")
+            .RETURN(&authCompressedHeaders);
+        REQUIRE_CALL(curlMock, curl_slist_append(&authMessagePackHeaders, _))
+            .WITH(std::string(_2) == "Accept: application/x-msgpack")
+            .RETURN(&authMessagePackHeaders);
+        REQUIRE_CALL(curlMock, curl_easy_setopt_(handle, CURLOPT_HTTPHEADER, &authHeaders)).RETURN(CURLE_OK);
+        REQUIRE_CALL(curlMock, curl_easy_setopt_(handle, CURLOPT_HTTPHEADER, &authMessagePackHeaders)).RETURN(CURLE_OK);
+        http.enableTokenAuth(conn.token);
+    }
+
     TEST_CASE("V2: Database name is returned if valid", "[HttpTest]")
     {
         ALLOW_CALL(curlMock, curl_global_init(_)).RETURN(CURLE_OK);
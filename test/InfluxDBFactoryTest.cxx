@@ -39,6 +39,14 @@ namespace influxdb::test
         CHECK(InfluxDBFactory::GetV1("https://localhost", 8086, "test") != nullptr);
     }
 
+#ifndef _WIN32
+    TEST_CASE("V1: Accepts tcp urls", "[InfluxDBFactoryTest]")
+    {
+        CHECK(InfluxDBFactory::GetV1("tcp://localhost", 8094) != nullptr);
+        CHECK(InfluxDBFactory::GetV1("tcp://127.0.0.1", 8094) != nullptr);
+    }
+#endif
+
     TEST_CASE("V1: Throws on unrecognised backend", "[InfluxDBFactoryTest]")
     {
         CHECK_THROWS_AS(InfluxDBFactory::GetV1("httpX://localhost", 8086, "test"), InfluxDBException);
@@ -87,6 +95,11 @@ namespace influxdb::test
         CHECK_THROWS_AS(InfluxDBFactory::GetV2("httpX://localhost", 8086, "test", "znckeifSEW"), InfluxDBException);
     }
 
+    TEST_CASE("V2: Throws on tcp urls", "[InfluxDBFactoryTest]")
+    {
+        CHECK_THROWS_AS(InfluxDBFactory::GetV2("tcp://localhost", 8094, "test", "znckeifSEW"), InfluxDBException);
+    }
+
     TEST_CASE("V2: Throws on malformed url", "[InfluxDBFactoryTest]")
     {
         CHECK_THROWS_AS(InfluxDBFactory::GetV2("localhost", 8086, "test", "znckeifSEW"), InfluxDBException);
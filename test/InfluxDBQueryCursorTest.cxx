@@ -0,0 +1,262 @@
+// MIT License
+//
+// Copyright (c) 2022 TOSHIBA CORPORATION
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "InfluxDBQueryCursor.h"
+#include "InfluxDBException.h"
+#include <catch2/catch.hpp>
+#include <atomic>
+#include <functional>
+#include <string>
+
+namespace influxdb::test
+{
+    namespace
+    {
+        /// Transport sending the chunks produced by a generator, until it returns an empty chunk
+        class ChunkedTransport : public Transport
+        {
+        public:
+            explicit ChunkedTransport(std::function<std::string(std::size_t)> generator)
+                : mGenerator(std::move(generator))
+            {
+            }
+
+            void send([[maybe_unused]] std::string&& message) override
+            {
+            }
+
+            void streamChunkedQuery(const std::string& query, [[maybe_unused]] const InfluxDBParams& params, std::size_t chunkSize,
+                                    const std::function<void(std::string_view)>& onData) override
+            {
+                receivedQuery = query;
+                receivedChunkSize = chunkSize;
+                try
+                {
+                    for (std::string chunk = mGenerator(0); !chunk.empty(); chunk = mGenerator(++sentChunks))
+                    {
+                        onData(chunk);
+                    }
+                }
+                catch (...)
+                {
+                    aborted = true;
+                    throw;
+                }
+            }
+
+            std::string receivedQuery;
+            std::size_t receivedChunkSize{0};
+            std::atomic<std::size_t> sentChunks{0};
+            std::atomic<bool> aborted{false};
+
+        private:
+            std::function<std::string(std::size_t)> mGenerator;
+        };
+
+        /// Transport only supporting complete responses
+        class SingleResponseTransport : public Transport
+        {
+        public:
+            void send([[maybe_unused]] std::string&& message) override
+            {
+            }
+
+            std::string query([[maybe_unused]] const std::string& query, [[maybe_unused]] const InfluxDBParams& params) override
+            {
+                return R"({"results":[{"statement_id":0,"series":[{"name":"x","columns":["v"],"values":[[1],[2],[3]]}]}]})";
+            }
+        };
+
+        std::string chunk(std::size_t statementId, const std::string& series, std::size_t firstValue, std::size_t rows)
+        {
+            std::string result{R"({"results":[{"statement_id":)" + std::to_string(statementId) + R"(,"series":[{"name":")" + series
+                               + R"(","columns":["v"],"values":[)"};
+            for (std::size_t i = 0; i < rows; ++i)
+            {
+                result += "[" + std::to_string(firstValue + i) + "],";
+            }
+            result.back() = ']';
+            result += R"(,"partial":true}],"partial":true}]})";
+            result += '\n';
+            return result;
+        }
+
+        std::vector<std::string> values(const InfluxDBSeries& series)
+        {
+            std::vector<std::string> result;
+            for (const auto& row : series.rows)
+            {
+                result.push_back(row.tuple.at(0));
+            }
+            return result;
+        }
+
+        std::size_t countRows(const std::vector<InfluxDBTable>& tables)
+        {
+            std::size_t rows{0};
+            for (const auto& table : tables)
+            {
+                for (const auto& series : table.series)
+                {
+                    rows += series.rows.size();
+                }
+            }
+            return rows;
+        }
+    }
+
+    TEST_CASE("Cursor requests chunked response", "[InfluxDBQueryCursorTest]")
+    {
+        ChunkedTransport transport{[](std::size_t i) { return i == 0 ? std::string{R"({"results":[]})"} : std::string{}; }};
+        {
+            InfluxDBQueryCursor cursor{transport, "SELECT * FROM x", {}, 123};
+            CHECK(cursor.fetch(1).empty());
+        }
+        CHECK(transport.receivedQuery == "SELECT * FROM x");
+        CHECK(transport.receivedChunkSize == 123);
+    }
+
+    TEST_CASE("Cursor merges rows of chunks", "[InfluxDBQueryCursorTest]")
+    {
+        const std::vector<std::string> chunks{chunk(0, "a", 0, 2), chunk(0, "a", 2, 2), chunk(0, "b", 0, 1), chunk(1, "a", 0, 1)};
+        ChunkedTransport transport{[&chunks](std::size_t i) { return i < chunks.size() ? chunks[i] : std::string{}; }};
+        InfluxDBQueryCursor cursor{transport, "SELECT * FROM x", {}, 2};
+
+        const auto first = cursor.fetch(3);
+        REQUIRE(first.size() == 1);
+        CHECK(first[0].statementId == 0);
+        REQUIRE(first[0].series.size() == 1);
+        CHECK(first[0].series[0].name == "a");
+        CHECK(first[0].series[0].columnNames == std::vector<std::string>{"v"});
+        CHECK(values(first[0].series[0]) == std::vector<std::string>{"0", "1", "2"});
+
+        const auto second = cursor.fetch(10);
+        REQUIRE(second.size() == 2);
+        REQUIRE(second[0].series.size() == 2);
+        CHECK(values(second[0].series[0]) == std::vector<std::string>{"3"});
+        CHECK(second[0].series[1].name == "b");
+        CHECK(second[1].statementId == 1);
+        CHECK(values(second[1].series[0]) == std::vector<std::string>{"0"});
+
+        CHECK(cursor.fetch(10).empty());
+        CHECK(cursor.fetch(10).empty());
+    }
+
+    TEST_CASE("Cursor returns results without rows", "[InfluxDBQueryCursorTest]")
+    {
+        ChunkedTransport transport{[](std::size_t i) {
+            return i == 0 ? std::string{R"({"results":[{"statement_id":0,"error":"failed"},{"statement_id":1},)"
+                                        R"({"statement_id":2,"series":[{"name":"empty","columns":["v"]}]}]})"}
+                          : std::string{};
+        }};
+        InfluxDBQueryCursor cursor{transport, "SELECT * FROM x", {}, 10};
+
+        const auto result = cursor.fetch(10);
+        REQUIRE(result.size() == 3);
+        CHECK(result[0].statementId == -1);
+        CHECK(result[0].error == "failed");
+        CHECK(result[1].statementId == 1);
+        CHECK(result[1].series.empty());
+        REQUIRE(result[2].series.size() == 1);
+        CHECK(result[2].series[0].name == "empty");
+        CHECK(result[2].series[0].rows.empty());
+    }
+
+    TEST_CASE("Cursor throws error of transport", "[InfluxDBQueryCursorTest]")
+    {
+        ChunkedTransport transport{[](std::size_t i) -> std::string {
+            if (i > 0)
+            {
+                throw InfluxDBException{"unit test", "Intentional"};
+            }
+            return chunk(0, "a", 0, 2);
+        }};
+        InfluxDBQueryCursor cursor{transport, "SELECT * FROM x", {}, 10};
+
+        auto fetchAll = [&cursor] {
+            while (!cursor.fetch(10).empty())
+            {
+            }
+        };
+        CHECK_THROWS_WITH(fetchAll(), Catch::Contains("Intentional"));
+    }
+
+    TEST_CASE("Cursor throws error reported in response", "[InfluxDBQueryCursorTest]")
+    {
+        ChunkedTransport transport{[](std::size_t i) {
+            return i == 0 ? std::string{R"({"error":"max-select-series limit exceeded"})"} : std::string{};
+        }};
+        InfluxDBQueryCursor cursor{transport, "SELECT * FROM x", {}, 10};
+
+        CHECK_THROWS_WITH(cursor.fetch(1), Catch::Contains("max-select-series"));
+    }
+
+    TEST_CASE("Cursor buffers limited number of rows", "[InfluxDBQueryCursorTest]")
+    {
+        constexpr std::size_t chunks{1000};
+        const std::string padding(8 * 1024, 'x');
+        ChunkedTransport transport{[&padding](std::size_t i) {
+            return i < chunks ? std::string{R"({"results":[{"statement_id":0,"series":[{"name":"x","values":[[")"} + padding + "\"]]}]}]}"
+                              : std::string{};
+        }};
+        InfluxDBQueryCursor cursor{transport, "SELECT * FROM x", {}, 10};
+
+        CHECK(countRows(cursor.fetch(1)) == 1);
+        CHECK(transport.sentChunks < chunks);
+
+        std::size_t rows{1};
+        for (auto result = cursor.fetch(100); !result.empty(); result = cursor.fetch(100))
+        {
+            rows += countRows(result);
+        }
+        CHECK(rows == chunks);
+    }
+
+    TEST_CASE("Destroying cursor aborts unfinished response", "[InfluxDBQueryCursorTest]")
+    {
+        ChunkedTransport transport{[](std::size_t i) { return chunk(0, "a", i, 10); }};
+        {
+            InfluxDBQueryCursor cursor{transport, "SELECT * FROM x", {}, 10};
+            CHECK(countRows(cursor.fetch(5)) == 5);
+        }
+        CHECK(transport.aborted);
+    }
+
+    TEST_CASE("Cursor uses complete response if transport doesn't support chunks", "[InfluxDBQueryCursorTest]")
+    {
+        SingleResponseTransport transport;
+        InfluxDBQueryCursor cursor{transport, "SELECT * FROM x", {}, 2};
+
+        CHECK(countRows(cursor.fetch(2)) == 2);
+        CHECK(countRows(cursor.fetch(2)) == 1);
+        CHECK(cursor.fetch(2).empty());
+    }
+
+    TEST_CASE("Cursor throws on invalid sizes", "[InfluxDBQueryCursorTest]")
+    {
+        ChunkedTransport transport{[](std::size_t) { return std::string{}; }};
+        CHECK_THROWS_AS(InfluxDBQueryCursor(transport, "SELECT * FROM x", {}, 0), InfluxDBException);
+
+        InfluxDBQueryCursor cursor{transport, "SELECT * FROM x", {}, 10};
+        CHECK_THROWS_AS(cursor.fetch(0), InfluxDBException);
+    }
+}
@@ -24,6 +24,9 @@
 #include "InfluxDB.h"
 #include "InfluxDBException.h"
 #include "mock/TransportMock.h"
+#include <future>
+#include <sstream>
+#include <thread>
 #include <catch2/catch.hpp>
 #include <catch2/trompeloeil.hpp>
 
@@ -32,6 +35,57 @@ namespace influxdb::test
     namespace
     {
         constexpr std::chrono::time_point<std::chrono::system_clock> ignoreTimestamp(std::chrono::milliseconds(4567));
+
+        /// Writes points "p n=<producer * pointsPerProducer + i>i" from each producer thread
+        void writeConcurrently(InfluxDB& db, std::size_t producers, std::size_t pointsPerProducer)
+        {
+            std::vector<std::thread> threads;
+
+            for (std::size_t producer = 0; producer < producers; ++producer)
+            {
+                threads.emplace_back([&db, producer, pointsPerProducer] {
+                    for (std::size_t i = 0; i < pointsPerProducer; ++i)
+                    {
+                        const auto value = static_cast<long long>(producer * pointsPerProducer + i);
+                        db.write(Point{"p"}.addField("n", value).setTimestamp(ignoreTimestamp));
+                    }
+                });
+            }
+
+            for (auto& thread : threads)
+            {
+                thread.join();
+            }
+        }
+
+        /// Checks that all points are received once and in order per producer
+        void checkAllPointsInOrder(const std::vector<std::string>& batches, std::size_t producers, std::size_t pointsPerProducer)
+        {
+            std::vector<long long> expected;
+
+            for (std::size_t producer = 0; producer < producers; ++producer)
+            {
+                expected.push_back(static_cast<long long>(producer * pointsPerProducer));
+            }
+
+            std::size_t received{0};
+            for (const auto& batch : batches)
+            {
+                std::istringstream lines{batch};
+                std::string line;
+
+                while (std::getline(lines, line))
+                {
+                    const auto value = std::stoll(line.substr(line.find('=') + 1));
+                    const auto producer = static_cast<std::size_t>(value) / pointsPerProducer;
+                    REQUIRE(producer < producers);
+                    REQUIRE(value == expected[producer]);
+                    ++expected[producer];
+                    ++received;
+                }
+            }
+            CHECK(received == producers * pointsPerProducer);
+        }
     }
 
     TEST_CASE("Ctor throws on nullptr transport", "[InfluxDBTest]")
@@ -165,6 +219,208 @@ namespace influxdb::test
         CHECK(db.batchSize() == 0);
     }
 
+    TEST_CASE("Write with batch enabled serializes point on write", "[InfluxDBTest]")
+    {
+        auto mock = std::make_shared<TransportMock>();
+        InfluxDB db{std::make_unique<TransportAdapter>(mock)};
+        db.batchOf(10);
+        db.addGlobalTag("x", "1");
+        db.write(Point{"p0"}.setTimestamp(ignoreTimestamp));
+        db.addGlobalTag("y", "2");
+        db.write(Point{"p1"}.setTimestamp(ignoreTimestamp));
+
+        REQUIRE_CALL(*mock, send("p0,x=1 4567000000\np1,x=1,y=2 4567000000"));
+        db.flushBatch();
+        CHECK(db.batchSize() == 0);
+    }
+
+    TEST_CASE("Write with batch enabled transmits batch before exceeding byte limit", "[InfluxDBTest]")
+    {
+        auto mock = std::make_shared<TransportMock>();
+        InfluxDB db{std::make_unique<TransportAdapter>(mock)};
+        db.batchOf(10);
+        db.setMaxBatchBytes(30);
+        db.write(Point{"x"}.setTimestamp(ignoreTimestamp));
+        db.write(Point{"y"}.setTimestamp(ignoreTimestamp));
+
+        {
+            REQUIRE_CALL(*mock, send("x 4567000000\ny 4567000000"));
+            db.write(Point{"z"}.setTimestamp(ignoreTimestamp));
+        }
+        CHECK(db.batchSize() == 1);
+
+        REQUIRE_CALL(*mock, send("z 4567000000"));
+        db.flushBatch();
+    }
+
+    TEST_CASE("Write with batch enabled keeps point if transmission before byte limit fails", "[InfluxDBTest]")
+    {
+        auto mock = std::make_shared<TransportMock>();
+        InfluxDB db{std::make_unique<TransportAdapter>(mock)};
+        db.batchOf(10);
+        db.setMaxBatchBytes(30);
+        db.write(Point{"x"}.setTimestamp(ignoreTimestamp));
+        db.write(Point{"y"}.setTimestamp(ignoreTimestamp));
+
+        {
+            REQUIRE_CALL(*mock, send("x 4567000000\ny 4567000000")).THROW(std::runtime_error{"Intentional"});
+            CHECK_THROWS(db.write(Point{"z"}.setTimestamp(ignoreTimestamp)));
+        }
+        CHECK(db.batchSize() == 3);
+
+        REQUIRE_CALL(*mock, send("x 4567000000\ny 4567000000\nz 4567000000"));
+        db.flushBatch();
+    }
+
+    TEST_CASE("Write with batch enabled transmits point exceeding byte limit", "[InfluxDBTest]")
+    {
+        auto mock = std::make_shared<TransportMock>();
+        InfluxDB db{std::make_unique<TransportAdapter>(mock)};
+        db.batchOf(10);
+        db.setMaxBatchBytes(5);
+
+        REQUIRE_CALL(*mock, send("x 4567000000"));
+        db.write(Point{"x"}.setTimestamp(ignoreTimestamp));
+        CHECK(db.batchSize() == 0);
+    }
+
+    TEST_CASE("Flush batch keeps points if transmission fails", "[InfluxDBTest]")
+    {
+        auto mock = std::make_shared<TransportMock>();
+        InfluxDB db{std::make_unique<TransportAdapter>(mock)};
+        db.batchOf(10);
+        db.write(Point{"x"}.setTimestamp(ignoreTimestamp));
+
+        {
+            REQUIRE_CALL(*mock, send("x 4567000000")).THROW(std::runtime_error{"Intentional"});
+            CHECK_THROWS(db.flushBatch());
+        }
+        CHECK(db.batchSize() == 1);
+
+        REQUIRE_CALL(*mock, send("x 4567000000\ny 4567000000"));
+        db.write(Point{"y"}.setTimestamp(ignoreTimestamp));
+        db.flushBatch();
+    }
+
+    TEST_CASE("Async write transmits batch on flush", "[InfluxDBTest]")
+    {
+        auto mock = std::make_shared<TransportMock>();
+        InfluxDB db{std::make_unique<TransportAdapter>(mock)};
+        db.batchOf(100);
+        db.enableAsyncWrites(2);
+        db.write(Point{"x"}.setTimestamp(ignoreTimestamp));
+        db.write({Point{"y"}.setTimestamp(ignoreTimestamp),
+                  Point{"z"}.setTimestamp(ignoreTimestamp)});
+
+        REQUIRE_CALL(*mock, send("x 4567000000\ny 4567000000\nz 4567000000"));
+        db.flushBatch();
+        CHECK(db.batchSize() == 0);
+    }
+
+    TEST_CASE("Async write rethrows transmission error on flush", "[InfluxDBTest]")
+    {
+        auto mock = std::make_shared<TransportMock>();
+        InfluxDB db{std::make_unique<TransportAdapter>(mock)};
+        db.batchOf(100);
+        db.enableAsyncWrites();
+        db.write(Point{"x"}.setTimestamp(ignoreTimestamp));
+
+        REQUIRE_CALL(*mock, send("x 4567000000")).THROW(ServerError{"test", "Intentional"});
+        CHECK_THROWS_AS(db.flushBatch(), ServerError);
+    }
+
+    TEST_CASE("Close sends queued points and disables async writes", "[InfluxDBTest]")
+    {
+        auto mock = std::make_shared<TransportMock>();
+        InfluxDB db{std::make_unique<TransportAdapter>(mock)};
+        db.batchOf(100);
+        db.enableAsyncWrites();
+        db.write(Point{"x"}.setTimestamp(ignoreTimestamp));
+
+        {
+            REQUIRE_CALL(*mock, send("x 4567000000"));
+            db.close();
+        }
+
+        db.write(Point{"y"}.setTimestamp(ignoreTimestamp));
+        CHECK(db.batchSize() == 1);
+        db.clearBatch();
+    }
+
+    TEST_CASE("Destructor sends queued points if async writes enabled", "[InfluxDBTest]")
+    {
+        auto mock = std::make_shared<TransportMock>();
+        REQUIRE_CALL(*mock, send("x 4567000000"));
+
+        InfluxDB db{std::make_unique<TransportAdapter>(mock)};
+        db.batchOf(100);
+        db.enableAsyncWrites();
+        db.write(Point{"x"}.setTimestamp(ignoreTimestamp));
+    }
+
+    TEST_CASE("Concurrent async writes transmit all points", "[InfluxDBTest]")
+    {
+        constexpr std::size_t producers{8};
+        constexpr std::size_t pointsPerProducer{5000};
+        auto mock = std::make_shared<TransportMock>();
+        std::vector<std::string> batches;
+        ALLOW_CALL(*mock, send(_)).LR_SIDE_EFFECT(batches.push_back(_1));
+
+        InfluxDB db{std::make_unique<TransportAdapter>(mock)};
+        db.batchOf(100);
+        db.enableAsyncWrites(64);
+        writeConcurrently(db, producers, pointsPerProducer);
+        db.flushBatch();
+
+        CHECK(db.batchSize() == 0);
+        checkAllPointsInOrder(batches, producers, pointsPerProducer);
+    }
+
+    TEST_CASE("Concurrent batched writes transmit all points", "[InfluxDBTest]")
+    {
+        constexpr std::size_t producers{8};
+        constexpr std::size_t pointsPerProducer{5000};
+        auto mock = std::make_shared<TransportMock>();
+        std::vector<std::string> batches;
+        ALLOW_CALL(*mock, send(_)).LR_SIDE_EFFECT(batches.push_back(_1));
+
+        InfluxDB db{std::make_unique<TransportAdapter>(mock)};
+        db.batchOf(100);
+        writeConcurrently(db, producers, pointsPerProducer);
+        db.flushBatch();
+
+        checkAllPointsInOrder(batches, producers, pointsPerProducer);
+    }
+
+    TEST_CASE("Batch is transmitted after max linger time", "[InfluxDBTest]")
+    {
+        auto mock = std::make_shared<TransportMock>();
+        InfluxDB db{std::make_unique<TransportAdapter>(mock)};
+        db.batchOf(100, std::chrono::milliseconds{10});
+
+        std::promise<void> transmitted;
+        REQUIRE_CALL(*mock, send("x 4567000000\ny 4567000000")).LR_SIDE_EFFECT(transmitted.set_value());
+        db.write(Point{"x"}.setTimestamp(ignoreTimestamp));
+        db.write(Point{"y"}.setTimestamp(ignoreTimestamp));
+
+        CHECK(transmitted.get_future().wait_for(std::chrono::seconds{5}) == std::future_status::ready);
+    }
+
+    TEST_CASE("Flush batch rethrows error of linger flush", "[InfluxDBTest]")
+    {
+        auto mock = std::make_shared<TransportMock>();
+        InfluxDB db{std::make_unique<TransportAdapter>(mock)};
+        db.batchOf(100, std::chrono::milliseconds{50});
+
+        std::promise<void> transmitted;
+        REQUIRE_CALL(*mock, send("x 4567000000")).LR_SIDE_EFFECT(transmitted.set_value()).THROW(ServerError{"test", "Intentional"});
+        db.write(Point{"x"}.setTimestamp(ignoreTimestamp));
+        CHECK(transmitted.get_future().wait_for(std::chrono::seconds{5}) == std::future_status::ready);
+
+        db.clearBatch();
+        CHECK_THROWS_AS(db.flushBatch(), ServerError);
+    }
+
     TEST_CASE("Create database throws if unsupported by transport", "[InfluxDBTest]")
     {
         auto mock = std::make_shared<TransportMock>();
@@ -174,6 +430,13 @@ namespace influxdb::test
         CHECK_THROWS_AS(db.createDatabaseIfNotExists(), InfluxDBException);
     }
 
+    TEST_CASE("Enable compression throws if unsupported by transport", "[InfluxDBTest]")
+    {
+        auto mock = std::make_shared<TransportMock>();
+        InfluxDB db{std::make_unique<TransportAdapter>(mock)};
+        CHECK_THROWS_AS(db.enableCompression(), InfluxDBException);
+    }
+
     TEST_CASE("Create database creates database through transport", "[InfluxDBTest]")
     {
         auto mock = std::make_shared<TransportMock>();
@@ -183,6 +446,35 @@ namespace influxdb::test
         db.createDatabaseIfNotExists();
     }
 
+    TEST_CASE("Query cache answers repeated queries", "[InfluxDBTest]")
+    {
+        using trompeloeil::_;
+        auto mock = std::make_shared<TransportMock>();
+        const std::string response{R"({"results":[{"statement_id":0,"series":[{"name":"x","columns":["v"],"values":[[1]]}]}]})"};
+        REQUIRE_CALL(*mock, query("SELECT * FROM x", _)).RETURN(response).TIMES(2);
+        REQUIRE_CALL(*mock, query("SELECT * FROM y", _)).RETURN(response);
+
+        InfluxDB db{std::make_unique<TransportAdapter>(mock)};
+        db.enableQueryCache(std::chrono::minutes{1});
+        CHECK(db.query("SELECT * FROM x").at(0).series.at(0).name == "x");
+        CHECK(db.query("SELECT * FROM x").at(0).series.at(0).name == "x");
+        db.query("SELECT * FROM x", InfluxDBParams{}.addParam("p", 1));
+        db.query("SELECT * FROM y");
+
+        const auto statistics = db.queryCacheStatistics();
+        CHECK(statistics.hits == 1);
+        CHECK(statistics.misses == 3);
+        CHECK(statistics.entries == 3);
+    }
+
+    TEST_CASE("Query cache statistics are zero if disabled", "[InfluxDBTest]")
+    {
+        auto mock = std::make_shared<TransportMock>();
+        InfluxDB db{std::make_unique<TransportAdapter>(mock)};
+        CHECK(db.queryCacheStatistics().misses == 0);
+        CHECK_NOTHROW(db.clearQueryCache());
+    }
+
     TEST_CASE("Write transmits points have bool value", "[InfluxDBTest]")
     {
         auto mock = std::make_shared<TransportMock>();
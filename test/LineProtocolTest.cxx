@@ -154,4 +154,29 @@ namespace influxdb::test
         const LineProtocol lineProtocol;
         CHECK_THAT(lineProtocol.format(point), Equals(R"(escape=\ \,,test\=\ \,b=test\ \=" test\=\ a\,="test =\"" 54000000)"));
     }
+
+    TEST_CASE("Format to appends to existing buffer", "[LineProtocolTest]")
+    {
+        const auto point = Point{"p0"}
+                               .addField("n", 1)
+                               .addTag("t", "v")
+                               .setTimestamp(ignoreTimestamp);
+        const LineProtocol lineProtocol{"global=true"};
+        std::string buffer{"existing\n"};
+        lineProtocol.formatTo(buffer, point);
+        CHECK_THAT(buffer, Equals("existing\np0,global=true,t=v n=1i 54000000"));
+    }
+
+    TEST_CASE("Format to matches format", "[LineProtocolTest]")
+    {
+        const auto point = Point{"escape= ,"}
+                               .addField("test= a,", "test =\"")
+                               .addField("d", 1.5)
+                               .addTag("test= ,b", "test =\"")
+                               .setTimestamp(ignoreTimestamp);
+        const LineProtocol lineProtocol{"a=0"};
+        std::string buffer;
+        lineProtocol.formatTo(buffer, point);
+        CHECK_THAT(buffer, Equals(lineProtocol.format(point)));
+    }
 }
@@ -0,0 +1,404 @@
+// MIT License
+//
+// Copyright (c) 2022 TOSHIBA CORPORATION
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "MemoryBudget.h"
+#include "LineProtocol.h"
+#include "InfluxDBException.h"
+#include "FlakyTransport.h"
+#include <catch2/catch.hpp>
+#include <algorithm>
+#include <future>
+#include <thread>
+
+namespace influxdb::test
+{
+    using internal::MemoryBudget;
+    using namespace std::chrono_literals;
+
+    namespace
+    {
+        BackpressurePolicy policyOf(std::size_t maxBytes, OverflowPolicy overflow)
+        {
+            BackpressurePolicy policy;
+            policy.maxBytes = maxBytes;
+            policy.overflow = overflow;
+            policy.blockTimeout = 10ms;
+            return policy;
+        }
+
+        Point point(const std::string& name)
+        {
+            return Point{name}.addField("v", 1).setTimestamp(std::chrono::system_clock::time_point{});
+        }
+
+        /// Each line "x v=1i 0" is reserved with its separator
+        constexpr std::size_t lineBytes{9};
+    }
+
+    TEST_CASE("Memory is reserved within limit", "[MemoryBudgetTest]")
+    {
+        MemoryBudget budget{policyOf(100, OverflowPolicy::DropNewest)};
+
+        CHECK(budget.tryReserve(60));
+        CHECK(budget.tryReserve(40));
+        CHECK_FALSE(budget.tryReserve(1));
+        CHECK(budget.excess(10) == 10);
+        CHECK(budget.statistics().bytes == 100);
+
+        budget.release(50);
+        CHECK(budget.tryReserve(50));
+        CHECK_FALSE(budget.tryReserve(101));
+    }
+
+    TEST_CASE("Release of memory not reserved is ignored", "[MemoryBudgetTest]")
+    {
+        MemoryBudget budget{policyOf(100, OverflowPolicy::DropNewest)};
+        budget.release(10);
+
+        CHECK(budget.statistics().bytes == 0);
+        CHECK_FALSE(budget.tryReserve(101));
+    }
+
+    TEST_CASE("Blocked reservation waits for released memory", "[MemoryBudgetTest]")
+    {
+        auto policy = policyOf(100, OverflowPolicy::Block);
+        policy.blockTimeout = 10s;
+        MemoryBudget budget{policy};
+        REQUIRE(budget.tryReserve(100));
+
+        auto reserved = std::async(std::launch::async, [&budget] { return budget.reserveWithin(30); });
+        std::this_thread::sleep_for(10ms);
+        budget.release(50);
+
+        CHECK(reserved.get());
+        CHECK(budget.statistics().bytes == 80);
+        CHECK(budget.statistics().blocked == 1);
+        CHECK(budget.statistics().timedOut == 0);
+    }
+
+    TEST_CASE("Blocked reservation times out", "[MemoryBudgetTest]")
+    {
+        MemoryBudget budget{policyOf(100, OverflowPolicy::Block)};
+        REQUIRE(budget.tryReserve(100));
+
+        CHECK_FALSE(budget.reserveWithin(1));
+        CHECK(budget.statistics().blocked == 1);
+        CHECK(budget.statistics().timedOut == 1);
+    }
+
+    TEST_CASE("Sampling keeps one of interval points", "[MemoryBudgetTest]")
+    {
+        auto policy = policyOf(100, OverflowPolicy::Sample);
+        policy.sampleInterval = 3;
+        MemoryBudget budget{policy};
+
+        std::vector<bool> kept;
+        for (int i = 0; i < 7; ++i)
+        {
+            kept.push_back(budget.sample());
+        }
+
+        CHECK(kept == std::vector<bool>{true, false, false, true, false, false, true});
+        CHECK(budget.statistics().sampledOut == 4);
+    }
+
+    TEST_CASE("Memory budget throws on invalid policy", "[MemoryBudgetTest]")
+    {
+        CHECK_THROWS_AS(MemoryBudget{policyOf(0, OverflowPolicy::Block)}, InfluxDBException);
+
+        auto policy = policyOf(100, OverflowPolicy::Sample);
+        policy.sampleInterval = 0;
+        CHECK_THROWS_AS(MemoryBudget{policy}, InfluxDBException);
+    }
+
+    TEST_CASE("Newest points are dropped if batch exceeds limit", "[MemoryBudgetTest]")
+    {
+        auto transport = std::make_unique<FlakyTransport>();
+        auto& server = *transport;
+        InfluxDB db{std::move(transport)};
+        db.setBackpressurePolicy(policyOf(2 * lineBytes, OverflowPolicy::DropNewest));
+        db.batchOf(100);
+
+        db.write(point("a"));
+        db.write(point("b"));
+        db.write(point("c"));
+
+        CHECK(db.batchSize() == 2);
+        CHECK(db.backpressureStatistics().droppedNewest == 1);
+        CHECK(db.backpressureStatistics().bytes == 2 * lineBytes);
+
+        db.flushBatch();
+        CHECK(server.received == std::vector<std::string>{"a v=1i 0\nb v=1i 0"});
+        CHECK(db.backpressureStatistics().bytes == 0);
+    }
+
+    TEST_CASE("Oldest points are dropped if batch exceeds limit", "[MemoryBudgetTest]")
+    {
+        auto transport = std::make_unique<FlakyTransport>();
+        auto& server = *transport;
+        InfluxDB db{std::move(transport)};
+        db.setBackpressurePolicy(policyOf(2 * lineBytes, OverflowPolicy::DropOldest));
+        db.batchOf(100);
+
+        for (const auto* name : {"a", "b", "c", "d"})
+        {
+            db.write(point(name));
+        }
+
+        CHECK(db.batchSize() == 2);
+        CHECK(db.backpressureStatistics().droppedOldest == 2);
+
+        db.flushBatch();
+        CHECK(server.received == std::vector<std::string>{"c v=1i 0\nd v=1i 0"});
+    }
+
+    TEST_CASE("Oldest points are dropped while batch can't be sent", "[MemoryBudgetTest]")
+    {
+        auto transport = std::make_unique<FlakyTransport>();
+        auto& server = *transport;
+        server.available = false;
+        InfluxDB db{std::move(transport)};
+        db.setBackpressurePolicy(policyOf(3 * lineBytes, OverflowPolicy::DropOldest));
+        db.batchOf(2);
+
+        db.write(point("a"));
+        CHECK_THROWS_AS(db.write(point("b")), ConnectionError);
+        CHECK_THROWS_AS(db.write(point("c")), ConnectionError);
+        CHECK_THROWS_AS(db.write(point("d")), ConnectionError);
+
+        CHECK(db.batchSize() == 3);
+        CHECK(db.backpressureStatistics().droppedOldest == 1);
+        CHECK(db.backpressureStatistics().bytes == 3 * lineBytes);
+
+        server.available = true;
+        db.flushBatch();
+        CHECK(server.received == std::vector<std::string>{"b v=1i 0\nc v=1i 0\nd v=1i 0"});
+    }
+
+    TEST_CASE("Points aren't lost if batch can't be sent at byte limit", "[MemoryBudgetTest]")
+    {
+        auto transport = std::make_unique<FlakyTransport>();
+        auto& server = *transport;
+        server.available = false;
+        InfluxDB db{std::move(transport)};
+        db.setBackpressurePolicy(policyOf(10 * lineBytes, OverflowPolicy::DropNewest));
+        db.batchOf(10);
+        db.setMaxBatchBytes(2 * lineBytes);
+
+        db.write(point("a"));
+        db.write(point("b"));
+        CHECK_THROWS_AS(db.write(point("c")), ConnectionError);
+
+        CHECK(db.batchSize() == 3);
+        CHECK(db.backpressureStatistics().bytes == 3 * lineBytes);
+
+        server.available = true;
+        db.flushBatch();
+        CHECK(server.received == std::vector<std::string>{"a v=1i 0\nb v=1i 0\nc v=1i 0"});
+        CHECK(db.backpressureStatistics().bytes == 0);
+    }
+
+    TEST_CASE("Sampled points replace oldest points", "[MemoryBudgetTest]")
+    {
+        auto transport = std::make_unique<FlakyTransport>();
+        auto& server = *transport;
+        InfluxDB db{std::move(transport)};
+        auto policy = policyOf(2 * lineBytes, OverflowPolicy::Sample);
+        policy.sampleInterval = 2;
+        db.setBackpressurePolicy(policy);
+        db.batchOf(100);
+
+        for (const auto* name : {"a", "b", "c", "d", "e"})
+        {
+            db.write(point(name));
+        }
+
+        CHECK(db.backpressureStatistics().sampledOut == 1);
+        CHECK(db.backpressureStatistics().droppedOldest == 2);
+
+        db.flushBatch();
+        CHECK(server.received == std::vector<std::string>{"c v=1i 0\ne v=1i 0"});
+    }
+
+    TEST_CASE("Blocked writer sends batch itself", "[MemoryBudgetTest]")
+    {
+        auto transport = std::make_unique<FlakyTransport>();
+        auto& server = *transport;
+        InfluxDB db{std::move(transport)};
+        db.setBackpressurePolicy(policyOf(2 * lineBytes, OverflowPolicy::Block));
+        db.batchOf(100);
+
+        db.write(point("a"));
+        db.write(point("b"));
+        db.write(point("c"));
+
+        CHECK(server.received == std::vector<std::string>{"a v=1i 0\nb v=1i 0"});
+        CHECK(db.batchSize() == 1);
+        CHECK(db.backpressureStatistics().blocked == 1);
+        CHECK(db.backpressureStatistics().timedOut == 0);
+
+        server.available = false;
+        db.write(point("d"));
+        CHECK_THROWS_AS(db.write(point("e")), ConnectionError);
+        CHECK(db.batchSize() == 2);
+        CHECK(db.backpressureStatistics().timedOut == 1);
+    }
+
+    TEST_CASE("Asynchronous writes are dropped if queue exceeds limit", "[MemoryBudgetTest]")
+    {
+        auto transport = std::make_unique<FlakyTransport>();
+        auto& server = *transport;
+        InfluxDB db{std::move(transport)};
+        db.setBackpressurePolicy(policyOf(1, OverflowPolicy::DropNewest));
+        db.batchOf(100);
+        db.enableAsyncWrites();
+
+        db.write(point("a"));
+        db.write(std::vector<Point>{point("b"), point("c")});
+        db.flushBatch();
+
+        CHECK(server.received.empty());
+        CHECK(db.backpressureStatistics().droppedNewest == 3);
+    }
+
+    TEST_CASE("Asynchronous writes time out if blocked", "[MemoryBudgetTest]")
+    {
+        InfluxDB db{std::make_unique<FlakyTransport>()};
+        db.setBackpressurePolicy(policyOf(1, OverflowPolicy::Block));
+        db.enableAsyncWrites();
+
+        db.write(point("a"));
+
+        CHECK(db.backpressureStatistics().blocked == 1);
+        CHECK(db.backpressureStatistics().timedOut == 1);
+    }
+
+    TEST_CASE("Memory of asynchronous writes is released once sent", "[MemoryBudgetTest]")
+    {
+        auto transport = std::make_unique<FlakyTransport>();
+        auto& server = *transport;
+        InfluxDB db{std::move(transport)};
+        db.setBackpressurePolicy(policyOf(1024 * 1024, OverflowPolicy::DropNewest));
+        db.batchOf(100);
+        db.enableAsyncWrites();
+
+        db.write(point("a"));
+        db.write(point("b"));
+        db.flushBatch();
+
+        CHECK(server.received == std::vector<std::string>{"a v=1i 0\nb v=1i 0"});
+        CHECK(db.backpressureStatistics().bytes == 0);
+    }
+
+    TEST_CASE("Queued points aren't dropped while writers are blocked", "[MemoryBudgetTest]")
+    {
+        auto transport = std::make_unique<FlakyTransport>();
+        auto& server = *transport;
+        InfluxDB db{std::move(transport)};
+        /// The queue fills the limit, so blocked writers take any memory released by the queue
+        auto policy = policyOf(4 * LineProtocol::estimateSize(point("a")), OverflowPolicy::Block);
+        policy.blockTimeout = 10s;
+        db.setBackpressurePolicy(policy);
+        db.batchOf(1);
+        db.enableAsyncWrites();
+
+        constexpr std::size_t writers{4};
+        constexpr std::size_t pointsPerWriter{50};
+        std::vector<std::thread> threads;
+        for (std::size_t i = 0; i < writers; ++i)
+        {
+            threads.emplace_back([&db] {
+                for (std::size_t j = 0; j < pointsPerWriter; ++j)
+                {
+                    db.write(point("a"));
+                }
+            });
+        }
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+        db.flushBatch();
+
+        std::size_t lines{0};
+        for (const auto& batch : server.received)
+        {
+            lines += static_cast<std::size_t>(std::count(batch.begin(), batch.end(), '\n')) + 1;
+        }
+        CHECK(lines == writers * pointsPerWriter);
+        CHECK(db.backpressureStatistics().blocked > 0);
+        CHECK(db.backpressureStatistics().timedOut == 0);
+        CHECK(db.backpressureStatistics().droppedNewest == 0);
+        CHECK(db.backpressureStatistics().bytes == 0);
+    }
+
+    TEST_CASE("Asynchronous batches are sent if blocked writers need their memory", "[MemoryBudgetTest]")
+    {
+        auto transport = std::make_unique<FlakyTransport>();
+        auto& server = *transport;
+        InfluxDB db{std::move(transport)};
+        /// The limit holds half a batch, which only the background thread is able to send
+        auto policy = policyOf(LineProtocol::estimateSize(point("a")) + 50 * lineBytes, OverflowPolicy::Block);
+        policy.blockTimeout = 1s;
+        db.setBackpressurePolicy(policy);
+        db.batchOf(100);
+        db.enableAsyncWrites();
+
+        constexpr std::size_t points{200};
+        for (std::size_t i = 0; i < points; ++i)
+        {
+            db.write(point("a"));
+        }
+        db.flushBatch();
+
+        std::size_t lines{0};
+        for (const auto& batch : server.received)
+        {
+            lines += static_cast<std::size_t>(std::count(batch.begin(), batch.end(), '\n')) + 1;
+        }
+        CHECK(lines == points);
+        CHECK(server.received.size() > 2);
+        CHECK(db.backpressureStatistics().blocked > 0);
+        CHECK(db.backpressureStatistics().timedOut == 0);
+        CHECK(db.backpressureStatistics().bytes == 0);
+    }
+
+    TEST_CASE("Backpressure policy can't be set while asynchronous writes are enabled", "[MemoryBudgetTest]")
+    {
+        InfluxDB db{std::make_unique<FlakyTransport>()};
+        db.enableAsyncWrites();
+
+        CHECK_THROWS_AS(db.setBackpressurePolicy(policyOf(1024, OverflowPolicy::DropNewest)), InfluxDBException);
+
+        db.close();
+        CHECK_NOTHROW(db.setBackpressurePolicy(policyOf(1024, OverflowPolicy::DropNewest)));
+    }
+
+    TEST_CASE("Backpressure statistics are zero if disabled", "[MemoryBudgetTest]")
+    {
+        InfluxDB db{std::make_unique<FlakyTransport>()};
+        db.setBackpressurePolicy(BackpressurePolicy{});
+        CHECK(db.backpressureStatistics().bytes == 0);
+        CHECK(db.backpressureStatistics().droppedNewest == 0);
+    }
+}
@@ -0,0 +1,225 @@
+// MIT License
+//
+// Copyright (c) 2022 TOSHIBA CORPORATION
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "MessagePackReader.h"
+#include "Query.h"
+#include "TestData.h"
+#include <catch2/catch.hpp>
+#include <string>
+#include <vector>
+
+namespace influxdb::test
+{
+    using internal::MessagePackReader;
+    using internal::MessagePackStringStream;
+
+    namespace
+    {
+        /// Records the events of the reader as text
+        class RecordingHandler
+        {
+        public:
+            bool Null()
+            {
+                return record("null");
+            }
+
+            bool Bool(bool b)
+            {
+                return record(b ? "true" : "false");
+            }
+
+            bool Int64(std::int64_t i)
+            {
+                return record("i:" + std::to_string(i));
+            }
+
+            bool Uint64(std::uint64_t u)
+            {
+                return record("u:" + std::to_string(u));
+            }
+
+            bool Double(double d)
+            {
+                return record("d:" + std::to_string(d));
+            }
+
+            bool Time(std::int64_t nanoseconds)
+            {
+                return record("t:" + std::to_string(nanoseconds));
+            }
+
+            bool String(const char* str, std::uint32_t length, [[maybe_unused]] bool copy)
+            {
+                return record("s:" + std::string{str, length});
+            }
+
+            bool Key(const char* str, std::uint32_t length, [[maybe_unused]] bool copy)
+            {
+                return record("k:" + std::string{str, length});
+            }
+
+            bool StartObject()
+            {
+                return record("{");
+            }
+
+            bool EndObject(std::uint32_t memberCount)
+            {
+                return record("}" + std::to_string(memberCount));
+            }
+
+            bool StartArray()
+            {
+                return record("[");
+            }
+
+            bool EndArray(std::uint32_t elementCount)
+            {
+                return record("]" + std::to_string(elementCount));
+            }
+
+            std::vector<std::string> events;
+
+        private:
+            bool record(std::string event)
+            {
+                events.push_back(std::move(event));
+                return true;
+            }
+        };
+
+        std::vector<std::string> read(const std::string& data)
+        {
+            MessagePackStringStream stream{data};
+            RecordingHandler handler;
+            MessagePackReader<MessagePackStringStream>{stream}.read(handler);
+            return handler.events;
+        }
+
+        std::string bytes(std::initializer_list<unsigned> values)
+        {
+            std::string result;
+            for (auto value : values)
+            {
+                result += static_cast<char>(value);
+            }
+            return result;
+        }
+    }
+
+    TEST_CASE("Reads integers of all encodings", "[MessagePackReaderTest]")
+    {
+        CHECK(read(bytes({0x00})) == std::vector<std::string>{"i:0"});
+        CHECK(read(bytes({0x7f})) == std::vector<std::string>{"i:127"});
+        CHECK(read(bytes({0xe0})) == std::vector<std::string>{"i:-32"});
+        CHECK(read(bytes({0xcc, 0xff})) == std::vector<std::string>{"i:255"});
+        CHECK(read(bytes({0xcd, 0x01, 0x00})) == std::vector<std::string>{"i:256"});
+        CHECK(read(bytes({0xce, 0xff, 0xff, 0xff, 0xff})) == std::vector<std::string>{"i:4294967295"});
+        CHECK(read(bytes({0xcf, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff})) == std::vector<std::string>{"u:18446744073709551615"});
+        CHECK(read(bytes({0xd0, 0x80})) == std::vector<std::string>{"i:-128"});
+        CHECK(read(bytes({0xd1, 0x00, 0xc8})) == std::vector<std::string>{"i:200"});
+        CHECK(read(bytes({0xd2, 0xff, 0xfe, 0xee, 0x90})) == std::vector<std::string>{"i:-70000"});
+        CHECK(read(bytes({0xd3, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00})) == std::vector<std::string>{"i:-9223372036854775808"});
+    }
+
+    TEST_CASE("Reads floats, booleans and nil", "[MessagePackReaderTest]")
+    {
+        CHECK(read(bytes({0xca, 0x3f, 0x00, 0x00, 0x00})) == std::vector<std::string>{"d:0.500000"});
+        CHECK(read(bytes({0xcb, 0xc0, 0x09, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00})) == std::vector<std::string>{"d:-3.125000"});
+        CHECK(read(bytes({0xc3})) == std::vector<std::string>{"true"});
+        CHECK(read(bytes({0xc2})) == std::vector<std::string>{"false"});
+        CHECK(read(bytes({0xc0})) == std::vector<std::string>{"null"});
+    }
+
+    TEST_CASE("Reads strings and binary data", "[MessagePackReaderTest]")
+    {
+        CHECK(read(bytes({0xa0})) == std::vector<std::string>{"s:"});
+        CHECK(read(bytes({0xa3, 'a', '\0', 'c'})) == std::vector<std::string>{"s:" + bytes({'a', 0, 'c'})});
+        CHECK(read(bytes({0xd9, 0x02, 'a', 'b'})) == std::vector<std::string>{"s:ab"});
+        CHECK(read(bytes({0xda, 0x00, 0x01, 'a'})) == std::vector<std::string>{"s:a"});
+        CHECK(read(bytes({0xdb, 0x00, 0x00, 0x00, 0x01, 'a'})) == std::vector<std::string>{"s:a"});
+        CHECK(read(bytes({0xc4, 0x01, 'b'})) == std::vector<std::string>{"s:b"});
+    }
+
+    TEST_CASE("Reads maps and arrays", "[MessagePackReaderTest]")
+    {
+        CHECK(read(bytes({0x82, 0xa1, 'a', 0x92, 0x01, 0xc0, 0xa1, 'b', 0x80}))
+              == std::vector<std::string>{"{", "k:a", "[", "i:1", "null", "]2", "k:b", "{", "}0", "}2"});
+        CHECK(read(bytes({0xdc, 0x00, 0x01, 0x05})) == std::vector<std::string>{"[", "i:5", "]1"});
+        CHECK(read(bytes({0xdd, 0x00, 0x00, 0x00, 0x00})) == std::vector<std::string>{"[", "]0"});
+        CHECK(read(bytes({0xde, 0x00, 0x01, 0xd9, 0x01, 'k', 0xc3})) == std::vector<std::string>{"{", "k:k", "true", "}1"});
+        CHECK(read(bytes({0xdf, 0x00, 0x00, 0x00, 0x00})) == std::vector<std::string>{"{", "}0"});
+    }
+
+    TEST_CASE("Reads timestamps", "[MessagePackReaderTest]")
+    {
+        /// Extension type 5 written by InfluxDB: seconds and nanoseconds
+        CHECK(read(bytes({0xc7, 0x0c, 0x05, 0x00, 0x00, 0x00, 0x00, 0x5f, 0xee, 0x66, 0x00, 0x00, 0x00, 0x00, 0x01}))
+              == std::vector<std::string>{"t:1609459200000000001"});
+        CHECK(read(bytes({0xc7, 0x0c, 0x05, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x3b, 0x9a, 0xc9, 0xff}))
+              == std::vector<std::string>{"t:-1"});
+        /// Timestamp extension type -1 of the specification
+        CHECK(read(bytes({0xd6, 0xff, 0x5f, 0xee, 0x66, 0x00})) == std::vector<std::string>{"t:1609459200000000000"});
+        CHECK(read(bytes({0xd7, 0xff, 0x00, 0x00, 0x00, 0x04, 0x5f, 0xee, 0x66, 0x00})) == std::vector<std::string>{"t:1609459200000000001"});
+        CHECK(read(bytes({0xc7, 0x0c, 0xff, 0x00, 0x00, 0x00, 0x01, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff}))
+              == std::vector<std::string>{"t:-999999999"});
+    }
+
+    TEST_CASE("Throws on invalid data", "[MessagePackReaderTest]")
+    {
+        CHECK_THROWS_WITH(read(bytes({})), Catch::Contains("Unexpected end of data"));
+        CHECK_THROWS_WITH(read(bytes({0x92, 0x01})), Catch::Contains("Unexpected end of data"));
+        CHECK_THROWS_WITH(read(bytes({0xa2, 'a'})), Catch::Contains("Unexpected end of data"));
+        CHECK_THROWS_WITH(read(bytes({0xc1})), Catch::Contains("Invalid type"));
+        CHECK_THROWS_WITH(read(bytes({0x81, 0x01, 0x01})), Catch::Contains("Map key is not a string"));
+        CHECK_THROWS_WITH(read(bytes({0xd4, 0x01, 0x00})), Catch::Contains("Unsupported extension type"));
+        CHECK_THROWS_WITH(read(bytes({0xc7, 0x0c, 0x05, 0x7f, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x00, 0x00, 0x00, 0x00})),
+                          Catch::Contains("Timestamp out of range"));
+    }
+
+    TEST_CASE("Throws on too deep nesting", "[MessagePackReaderTest]")
+    {
+        const std::string nested(MessagePackReader<MessagePackStringStream>::maxDepth + 1, static_cast<char>(0x91));
+        CHECK_THROWS_WITH(read(nested + bytes({0x01})), Catch::Contains("Nesting too deep"));
+        CHECK_NOTHROW(read(nested.substr(1) + bytes({0x01})));
+    }
+
+    TEST_CASE("Detects MessagePack by first byte", "[MessagePackReaderTest]")
+    {
+        CHECK(internal::isMessagePack(static_cast<char>(0x81)));
+        CHECK(internal::isMessagePack(static_cast<char>(0xde)));
+        CHECK(internal::isMessagePack(static_cast<char>(0xdf)));
+        CHECK_FALSE(internal::isMessagePack('{'));
+        CHECK_FALSE(internal::isMessagePack(' '));
+    }
+
+    TEST_CASE("Error message is read from MessagePack body", "[MessagePackReaderTest]")
+    {
+        const std::string body = readTestData("error_response.msgpack");
+        REQUIRE_FALSE(body.empty());
+        CHECK(internal::parseErrorMessage(body) == "ERROR: database not found: missing");
+
+        CHECK(internal::parseErrorMessage(bytes({0x82, 0xa4, 'c', 'o', 'd', 'e', 0xa1, 'x', 0xa7, 'm', 'e', 's', 's', 'a', 'g', 'e', 0xa1, 'y'}))
+              == "CODE: x, MESSAGE: y");
+    }
+}
@@ -23,8 +23,35 @@
 
 #include "Point.h"
 #include "InfluxDBException.h"
+#include <cstdlib>
+#include <new>
 #include <catch2/catch.hpp>
 
+namespace
+{
+    std::size_t allocationCount{0};
+}
+
+void* operator new(std::size_t size)
+{
+    ++allocationCount;
+    if (void* ptr = std::malloc(size); ptr != nullptr)
+    {
+        return ptr;
+    }
+    throw std::bad_alloc{};
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
 namespace influxdb::test
 {
     using namespace Catch::Matchers;
@@ -69,7 +96,7 @@ namespace influxdb::test
                                              "int_field=3i,"
                                              "longlong_field=1234i,"
                                              "string_field=\"string value\","
-                                             "double_field=3.858999999999999986"));
+                                             "double_field=3.859"));
     }
 
     TEST_CASE("Field with empty name is not added", "[PointTest]")
@@ -156,6 +183,28 @@ namespace influxdb::test
         CHECK(point.getTimestamp() == timeStamp);
     }
 
+    TEST_CASE("Float field uses shortest round-trip representation by default", "[PointTest]")
+    {
+        Point::floatsPrecision = defaultFloatsPrecision;
+        const auto point = Point{"test"}
+                               .addField("f0", 0.1)
+                               .addField("f1", 2.0)
+                               .addField("f2", -1.5e-7)
+                               .addField("f3", 1.7976931348623157e308)
+                               .addField("f4", 0.30000000000000004);
+        CHECK_THAT(point.getFields(), Equals("f0=0.1,f1=2,f2=-1.5e-07,f3=1.7976931348623157e+308,f4=0.30000000000000004"));
+    }
+
+    TEST_CASE("Float field with shortest representation round-trips", "[PointTest]")
+    {
+        Point::floatsPrecision = shortestFloatsPrecision;
+        for (const double value : {3.141592653589793, 1.0 / 3.0, 123456789.123, 5e-324, 1e22})
+        {
+            const auto fields = Point{"test"}.addField("v", value).getFields();
+            CHECK(std::strtod(fields.c_str() + 2, nullptr) == value);
+        }
+    }
+
     TEST_CASE("Float field precision can be adjusted", "[PointTest]")
     {
         Point::floatsPrecision = 3;
@@ -257,4 +306,46 @@ namespace influxdb::test
                             .setTimestamp(ignoreTimestamp);
         CHECK_THAT(point.toLineProtocol(), Equals(R"(test x=true,y=false 1230000000)"));
     }
+
+    TEST_CASE("Measurement with more tags and fields than stored inline", "[PointTest]")
+    {
+        auto point = Point{"test"};
+        std::string expectedTags;
+        std::string expectedFields;
+
+        for (int i = 0; i < 12; ++i)
+        {
+            const auto index = std::to_string(i);
+            point.addTag("t" + index, "v" + index).addField("f" + index, i);
+            expectedTags += (i > 0 ? ",t" : "t") + index + "=v" + index;
+            expectedFields += (i > 0 ? ",f" : "f") + index + "=" + index + "i";
+        }
+
+        CHECK_THAT(point.getTags(), Equals(expectedTags));
+        CHECK_THAT(point.getFields(), Equals(expectedFields));
+    }
+
+    TEST_CASE("Copied point keeps tags and fields", "[PointTest]")
+    {
+        const auto original = Point{"test"}.addTag("t", "v").addField("s", std::string{"str"}).addField("b", false);
+        const Point copy{original};
+        CHECK_THAT(copy.getTags(), Equals("t=v"));
+        CHECK_THAT(copy.getFields(), Equals(R"(s="str",b=false)"));
+    }
+
+    TEST_CASE("Point size and allocations", "[PointTest]")
+    {
+        const auto allocationsBefore = allocationCount;
+        const auto point = Point{"cpu"}
+                               .addTag("host", "server01")
+                               .addTag("region", "eu-west")
+                               .addField("usage_user", 0.5)
+                               .addField("usage_system", 1.5)
+                               .addField("state", "ok");
+        const auto allocations = allocationCount - allocationsBefore;
+
+        INFO("sizeof(Point): " << sizeof(Point) << " bytes, allocations per Point: " << allocations);
+        CHECK(sizeof(Point) <= 512);
+        CHECK(allocations <= 1);
+    }
 }
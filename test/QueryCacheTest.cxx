@@ -0,0 +1,217 @@
+// MIT License
+//
+// Copyright (c) 2022 TOSHIBA CORPORATION
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "QueryCache.h"
+#include "FakeClock.h"
+#include "InfluxDBException.h"
+#include <catch2/catch.hpp>
+#include <atomic>
+#include <thread>
+
+namespace influxdb::test
+{
+    using internal::QueryCache;
+    using namespace std::chrono_literals;
+
+    namespace
+    {
+        QueryCache::Result result(const std::string& name, std::size_t rows = 1)
+        {
+            InfluxDBSeries series;
+            series.name = name;
+            series.columnNames = {"v"};
+            series.rows.resize(rows, InfluxDBRow{{std::string(64, 'x')}});
+            InfluxDBTable table;
+            table.statementId = 0;
+            table.series.push_back(std::move(series));
+            return {table};
+        }
+
+        /// Query returning a result named by the number of calls
+        struct CountingQuery
+        {
+            std::atomic<int> calls{0};
+
+            std::function<QueryCache::Result()> function()
+            {
+                return [this] { return result(std::to_string(++calls)); };
+            }
+        };
+    }
+
+    TEST_CASE("Cache returns result until it expires", "[QueryCacheTest]")
+    {
+        FakeClock clock;
+        CountingQuery query;
+        QueryCache cache{1000ms, 1024 * 1024, clock.function()};
+
+        CHECK(cache.get("a", query.function())[0].series[0].name == "1");
+        clock.now += 999ms;
+        CHECK(cache.get("a", query.function())[0].series[0].name == "1");
+        clock.now += 1ms;
+        CHECK(cache.get("a", query.function())[0].series[0].name == "2");
+
+        const auto statistics = cache.statistics();
+        CHECK(statistics.hits == 1);
+        CHECK(statistics.misses == 2);
+        CHECK(statistics.entries == 1);
+        CHECK(statistics.bytes > 0);
+    }
+
+    TEST_CASE("Cache distinguishes keys", "[QueryCacheTest]")
+    {
+        CountingQuery query;
+        QueryCache cache{1000ms, 1024 * 1024};
+
+        CHECK(cache.get("a", query.function())[0].series[0].name == "1");
+        CHECK(cache.get("b", query.function())[0].series[0].name == "2");
+        CHECK(cache.get("a", query.function())[0].series[0].name == "1");
+        CHECK(cache.statistics().entries == 2);
+    }
+
+    TEST_CASE("Cache evicts least recently used results", "[QueryCacheTest]")
+    {
+        const auto entryBytes = QueryCache::estimateBytes(result("1", 10)) + 256;
+        CountingQuery query;
+        QueryCache cache{1000ms, 2 * entryBytes};
+        auto tenRows = [&query] { return result(std::to_string(++query.calls), 10); };
+
+        cache.get("a", tenRows);
+        cache.get("b", tenRows);
+        cache.get("a", tenRows);
+        cache.get("c", tenRows);
+
+        CHECK(cache.statistics().evictions == 1);
+        CHECK(cache.statistics().entries == 2);
+        CHECK(cache.get("a", tenRows)[0].series[0].name == "1");
+        CHECK(cache.get("b", tenRows)[0].series[0].name == "4");
+        CHECK(cache.statistics().bytes <= 2 * entryBytes);
+    }
+
+    TEST_CASE("Cache doesn't keep result exceeding memory limit", "[QueryCacheTest]")
+    {
+        CountingQuery query;
+        QueryCache cache{1000ms, 256};
+
+        cache.get("a", query.function());
+        CHECK(cache.get("a", query.function())[0].series[0].name == "2");
+        CHECK(cache.statistics().entries == 0);
+        CHECK(cache.statistics().evictions == 0);
+    }
+
+    TEST_CASE("Cache doesn't keep errors", "[QueryCacheTest]")
+    {
+        CountingQuery query;
+        QueryCache cache{1000ms, 1024 * 1024};
+
+        CHECK_THROWS_AS(cache.get("a", [] () -> QueryCache::Result { throw InfluxDBException{"unit test", "Intentional"}; }), InfluxDBException);
+        CHECK(cache.get("a", query.function())[0].series[0].name == "1");
+        CHECK(cache.statistics().misses == 2);
+    }
+
+    TEST_CASE("Cache drops results on clear", "[QueryCacheTest]")
+    {
+        CountingQuery query;
+        QueryCache cache{1000ms, 1024 * 1024};
+
+        cache.get("a", query.function());
+        cache.clear();
+        CHECK(cache.statistics().entries == 0);
+        CHECK(cache.statistics().bytes == 0);
+        CHECK(cache.get("a", query.function())[0].series[0].name == "2");
+    }
+
+    TEST_CASE("Cache coalesces concurrent lookups of same key", "[QueryCacheTest]")
+    {
+        constexpr std::size_t waiting{4};
+        QueryCache cache{0ms, 1024 * 1024};
+        std::atomic<int> calls{0};
+        std::atomic<bool> release{false};
+        auto blockingQuery = [&calls, &release] {
+            ++calls;
+            while (!release)
+            {
+                std::this_thread::yield();
+            }
+            return result("shared");
+        };
+
+        std::vector<std::string> names(waiting + 1);
+        std::vector<std::thread> threads;
+        threads.emplace_back([&] { names[0] = cache.get("a", blockingQuery)[0].series[0].name; });
+        while (calls == 0)
+        {
+            std::this_thread::yield();
+        }
+        for (std::size_t i = 1; i <= waiting; ++i)
+        {
+            threads.emplace_back([&, i] { names[i] = cache.get("a", blockingQuery)[0].series[0].name; });
+        }
+        while (cache.statistics().coalesced < waiting)
+        {
+            std::this_thread::yield();
+        }
+        release = true;
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+
+        CHECK(calls == 1);
+        CHECK(names == std::vector<std::string>(waiting + 1, "shared"));
+        CHECK(cache.statistics().misses == 1);
+        CHECK(cache.statistics().entries == 0);
+    }
+
+    TEST_CASE("Cache shares error with coalesced lookups", "[QueryCacheTest]")
+    {
+        QueryCache cache{1000ms, 1024 * 1024};
+        std::atomic<bool> started{false};
+        std::atomic<bool> release{false};
+
+        std::thread first{[&] {
+            CHECK_THROWS_WITH(cache.get("a",
+                                        [&]() -> QueryCache::Result {
+                                            started = true;
+                                            while (!release)
+                                            {
+                                                std::this_thread::yield();
+                                            }
+                                            throw InfluxDBException{"unit test", "Intentional"};
+                                        }),
+                              Catch::Contains("Intentional"));
+        }};
+        while (!started)
+        {
+            std::this_thread::yield();
+        }
+        std::thread second{[&] { CHECK_THROWS_WITH(cache.get("a", [] { return result("x"); }), Catch::Contains("Intentional")); }};
+        while (cache.statistics().coalesced == 0)
+        {
+            std::this_thread::yield();
+        }
+        release = true;
+        first.join();
+        second.join();
+    }
+}
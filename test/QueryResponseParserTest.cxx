@@ -0,0 +1,299 @@
+// MIT License
+//
+// Copyright (c) 2022 TOSHIBA CORPORATION
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "QueryResponseParser.h"
+#include "InfluxDBException.h"
+#include "TestData.h"
+#include <catch2/catch.hpp>
+#include <algorithm>
+#include <string>
+
+namespace influxdb::test
+{
+    using internal::QueryResponseParser;
+
+    namespace
+    {
+        void parseInto(internal::QueryResultBuilder& builder, std::string_view response, std::size_t chunkSize)
+        {
+            QueryResponseParser parser{builder};
+            feedChunks(parser, response, chunkSize);
+        }
+
+        std::vector<InfluxDBTable> parse(std::string_view response, std::size_t chunkSize)
+        {
+            internal::RowResultBuilder builder;
+            parseInto(builder, response, chunkSize);
+            return builder.takeResult();
+        }
+
+        std::vector<InfluxDBTable> parse(std::string_view response)
+        {
+            return parse(response, response.size());
+        }
+
+        void checkEqual(const std::vector<InfluxDBTable>& result, const std::vector<InfluxDBTable>& expected)
+        {
+            REQUIRE(result.size() == expected.size());
+            for (std::size_t i = 0; i < result.size(); ++i)
+            {
+                CHECK(result[i].statementId == expected[i].statementId);
+                CHECK(result[i].error == expected[i].error);
+                REQUIRE(result[i].series.size() == expected[i].series.size());
+                for (std::size_t j = 0; j < result[i].series.size(); ++j)
+                {
+                    const auto& series = result[i].series[j];
+                    const auto& expectedSeries = expected[i].series[j];
+                    CHECK(series.name == expectedSeries.name);
+                    CHECK(series.tagKeys == expectedSeries.tagKeys);
+                    CHECK(series.tagValues == expectedSeries.tagValues);
+                    CHECK(series.columnNames == expectedSeries.columnNames);
+                    REQUIRE(series.rows.size() == expectedSeries.rows.size());
+                    for (std::size_t k = 0; k < series.rows.size(); ++k)
+                    {
+                        CHECK(series.rows[k].tuple == expectedSeries.rows[k].tuple);
+                    }
+                }
+            }
+        }
+
+        constexpr std::string_view response{R"({"results":[{"statement_id":0,"series":[{"name":"cpu",)"
+                                            R"("tags":{"host":"a","region":"eu"},"columns":["time","value","ok"],)"
+                                            R"("values":[["2021-01-01T00:00:00Z",0.5,true],["2021-01-01T00:00:01Z",-3,null]]}]},)"
+                                            R"({"statement_id":1,"series":[{"name":"mem","columns":["time"],"values":[["t"]]}]}]})"};
+
+        void checkResponse(const std::vector<InfluxDBTable>& result)
+        {
+            REQUIRE(result.size() == 2);
+            CHECK(result[0].statementId == 0);
+            REQUIRE(result[0].series.size() == 1);
+            const auto& series = result[0].series[0];
+            CHECK(series.name == "cpu");
+            CHECK(series.tagKeys == std::vector<std::string>{"host", "region"});
+            CHECK(series.tagValues == std::vector<std::string>{"a", "eu"});
+            CHECK(series.columnNames == std::vector<std::string>{"time", "value", "ok"});
+            REQUIRE(series.rows.size() == 2);
+            CHECK(series.rows[0].tuple == std::vector<std::string>{"2021-01-01T00:00:00Z", "0.5", "true"});
+            CHECK(series.rows[1].tuple == std::vector<std::string>{"2021-01-01T00:00:01Z", "-3", ""});
+            CHECK(result[1].statementId == 1);
+            CHECK(result[1].series[0].name == "mem");
+            CHECK(result[1].series[0].rows[0].tuple == std::vector<std::string>{"t"});
+        }
+    }
+
+    TEST_CASE("Parses complete response", "[QueryResponseParserTest]")
+    {
+        checkResponse(parse(response));
+    }
+
+    TEST_CASE("Parses response split into arbitrary chunks", "[QueryResponseParserTest]")
+    {
+        for (std::size_t chunkSize = 1; chunkSize < 16; ++chunkSize)
+        {
+            checkResponse(parse(response, chunkSize));
+        }
+    }
+
+    TEST_CASE("Parses response larger than the buffer limit", "[QueryResponseParserTest]")
+    {
+        constexpr std::size_t rows{100000};
+        std::string largeResponse{R"({"results":[{"statement_id":0,"series":[{"name":"x","columns":["time","value"],"values":[)"};
+        for (std::size_t i = 0; i < rows; ++i)
+        {
+            largeResponse += R"(["2021-01-01T00:00:00Z",)" + std::to_string(i) + "],";
+        }
+        largeResponse.back() = ']';
+        largeResponse += "}]}]}";
+        REQUIRE(largeResponse.size() > QueryResponseParser::maxBufferedBytes);
+
+        const auto result = parse(largeResponse, 16 * 1024);
+        const auto& parsedRows = result[0].series[0].rows;
+        REQUIRE(parsedRows.size() == rows);
+        CHECK(parsedRows.front().tuple[1] == "0");
+        CHECK(parsedRows.back().tuple[1] == std::to_string(rows - 1));
+    }
+
+    TEST_CASE("Keeps numbers as received", "[QueryResponseParserTest]")
+    {
+        const auto result = parse(R"({"results":[{"series":[{"values":[[18446744073709551616,1.10000000000000000001,1e-7]]}]}]})");
+        CHECK(result[0].series[0].rows[0].tuple == std::vector<std::string>{"18446744073709551616", "1.10000000000000000001", "1e-7"});
+    }
+
+    TEST_CASE("Serializes nested values of cells", "[QueryResponseParserTest]")
+    {
+        const auto result = parse(R"({"results":[{"series":[{"values":[[[1, "a"], {"k" : {"n": null}}, "x"]]}]}]})", 3);
+        CHECK(result[0].series[0].rows[0].tuple == std::vector<std::string>{R"([1,"a"])", R"({"k":{"n":null}})", "x"});
+    }
+
+    TEST_CASE("Skips unknown members", "[QueryResponseParserTest]")
+    {
+        const auto result = parse(R"({"unknown":{"results":[1]},"results":[{"partial":true,"messages":[{"level":"warning"}],)"
+                                  R"("series":[{"name":"x","tags":["a"],"other":[[1]],"columns":["time"],"values":[["t"]]}]}]})");
+        REQUIRE(result.size() == 1);
+        CHECK(result[0].statementId == -1);
+        CHECK(result[0].series[0].name == "x");
+        CHECK(result[0].series[0].tagKeys.empty());
+        CHECK(result[0].series[0].rows[0].tuple == std::vector<std::string>{"t"});
+    }
+
+    TEST_CASE("Parses sequence of chunks", "[QueryResponseParserTest]")
+    {
+        const std::string chunked{R"({"results":[{"statement_id":0,"series":[{"name":"x","values":[[1]],"partial":true}],"partial":true}]})"
+                                  "\n"
+                                  R"({"results":[{"statement_id":0,"series":[{"name":"x","values":[[2]]}]}]})"
+                                  "\n"};
+        const auto result = parse(chunked, 5);
+        REQUIRE(result.size() == 2);
+        CHECK(result[0].series[0].rows[0].tuple == std::vector<std::string>{"1"});
+        CHECK(result[1].statementId == 0);
+        CHECK(result[1].series[0].rows[0].tuple == std::vector<std::string>{"2"});
+    }
+
+    TEST_CASE("Throws on error of response", "[QueryResponseParserTest]")
+    {
+        CHECK_THROWS_WITH(parse(R"({"results":[]})" "\n" R"({"error":"timeout"})"), Catch::Contains("timeout"));
+    }
+
+    TEST_CASE("Returns empty result without results element", "[QueryResponseParserTest]")
+    {
+        CHECK(parse(R"({"invalid-results":[]})").empty());
+    }
+
+    TEST_CASE("Result of failed statement only consists of error", "[QueryResponseParserTest]")
+    {
+        const auto result = parse(R"({"results":[{"statement_id":0,"series":[{"name":"x"}],"error":"not executed"}]})");
+        REQUIRE(result.size() == 1);
+        CHECK(result[0].error == "not executed");
+        CHECK(result[0].statementId == -1);
+        CHECK(result[0].series.empty());
+    }
+
+    TEST_CASE("Throws on invalid json", "[QueryResponseParserTest]")
+    {
+        CHECK_THROWS_AS(parse(R"({"results":[{"statement_id":0})"), InfluxDBException);
+        CHECK_THROWS_AS(parse(R"({"results":[]} trailing)"), InfluxDBException);
+        CHECK_THROWS_AS(parse(""), InfluxDBException);
+    }
+
+    TEST_CASE("Throws on unsupported structure", "[QueryResponseParserTest]")
+    {
+        CHECK_THROWS_AS(parse(R"([])"), InfluxDBException);
+        CHECK_THROWS_AS(parse(R"({"results":{}})"), InfluxDBException);
+        CHECK_THROWS_AS(parse(R"({"results":[1]})"), InfluxDBException);
+        CHECK_THROWS_AS(parse(R"({"results":[{"series":{}}]})"), InfluxDBException);
+        CHECK_THROWS_AS(parse(R"({"results":[{"series":[{"values":[1]}]}]})"), InfluxDBException);
+        CHECK_THROWS_AS(parse(R"({"results":[{"statement_id":"x"}]})"), InfluxDBException);
+    }
+
+    TEST_CASE("Parses response into typed columns", "[QueryResponseParserTest]")
+    {
+        internal::ColumnarResultBuilder builder;
+        parseInto(builder, response, 7);
+        const auto result = builder.takeResult();
+
+        REQUIRE(result.size() == 2);
+        const auto& series = result[0].series[0];
+        CHECK(series.name == "cpu");
+        CHECK(series.tagValues == std::vector<std::string>{"a", "eu"});
+        REQUIRE(series.rowCount == 2);
+        REQUIRE(series.columns.size() == 3);
+        CHECK(series.columns[0].type == InfluxDBColumn::Type::Time);
+        CHECK(series.columns[0].integers == std::vector<std::int64_t>{1609459200000000000, 1609459201000000000});
+        CHECK(series.columns[1].type == InfluxDBColumn::Type::Float);
+        CHECK(series.columns[1].floats == std::vector<double>{0.5, -3.0});
+        CHECK(series.columns[2].type == InfluxDBColumn::Type::Boolean);
+        CHECK_FALSE(series.columns[2].isNull(0));
+        CHECK(series.columns[2].isNull(1));
+        CHECK(result[1].series[0].columns[0].type == InfluxDBColumn::Type::String);
+        CHECK(result[1].series[0].columns[0].strings == std::vector<std::string_view>{"t"});
+    }
+
+    TEST_CASE("Parses MessagePack response like JSON response", "[QueryResponseParserTest]")
+    {
+        const auto name = GENERATE(std::string{"query_response"}, std::string{"chunked_response"});
+        const auto expected = parse(readTestData(name + ".json"));
+        const auto msgpack = readTestData(name + ".msgpack");
+
+        checkEqual(parse(msgpack), expected);
+        for (std::size_t chunkSize = 1; chunkSize < 16; ++chunkSize)
+        {
+            checkEqual(parse(msgpack, chunkSize), expected);
+        }
+    }
+
+    TEST_CASE("Parses MessagePack response into typed columns", "[QueryResponseParserTest]")
+    {
+        internal::ColumnarResultBuilder builder;
+        parseInto(builder, readTestData("query_response.msgpack"), 5);
+        const auto result = builder.takeResult();
+
+        REQUIRE(result.size() == 3);
+        const auto& series = result[0].series[0];
+        REQUIRE(series.rowCount == 4);
+        REQUIRE(series.columns.size() == 5);
+        CHECK(series.columns[0].type == InfluxDBColumn::Type::Time);
+        CHECK(series.columns[0].integers
+              == std::vector<std::int64_t>{1609459200000000000, 1609459201500000000, 1609459203000000001, 1609459204500000000});
+        CHECK(series.columns[1].type == InfluxDBColumn::Type::Float);
+        CHECK(series.columns[1].floats[2] == -3.125);
+        CHECK(series.columns[1].isNull(3));
+        CHECK(series.columns[2].type == InfluxDBColumn::Type::Integer);
+        CHECK(series.columns[2].integers == std::vector<std::int64_t>{1, 200, -70000, 9007199254740993});
+        CHECK(series.columns[3].type == InfluxDBColumn::Type::Boolean);
+        CHECK(series.columns[4].type == InfluxDBColumn::Type::String);
+        CHECK(series.columns[4].strings[3] == "busy");
+        CHECK(result[0].series[1].columns[0].integers == std::vector<std::int64_t>{-1609459200000000000});
+        CHECK(result[1].error == "measurement not found");
+    }
+
+    TEST_CASE("Throws on invalid MessagePack", "[QueryResponseParserTest]")
+    {
+        auto msgpack = readTestData("query_response.msgpack");
+        CHECK_THROWS_WITH(parse(msgpack.substr(0, msgpack.size() - 1)), Catch::Contains("Parse msgpack error"));
+        CHECK_THROWS_WITH(parse(msgpack + '\xc1'), Catch::Contains("Parse msgpack error"));
+        CHECK_THROWS_AS(parse(std::string{"\x81\xa7results\x81"}), InfluxDBException);
+    }
+
+    TEST_CASE("Feed throws once response is invalid", "[QueryResponseParserTest]")
+    {
+        internal::RowResultBuilder builder;
+        QueryResponseParser parser{builder};
+        parser.feed("[");
+
+        const std::string filler(1024, ' ');
+        auto feedUntilThrows = [&parser, &filler] {
+            for (std::size_t i = 0; i < 2 * QueryResponseParser::maxBufferedBytes / filler.size(); ++i)
+            {
+                parser.feed(filler);
+            }
+            parser.feed("]");
+        };
+        CHECK_THROWS_AS(feedUntilThrows(), InfluxDBException);
+    }
+
+    TEST_CASE("Destruction stops parsing an unfinished response", "[QueryResponseParserTest]")
+    {
+        internal::RowResultBuilder builder;
+        QueryResponseParser parser{builder};
+        parser.feed(R"({"results":[)");
+    }
+}
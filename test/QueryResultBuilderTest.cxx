@@ -0,0 +1,365 @@
+// MIT License
+//
+// Copyright (c) 2022 TOSHIBA CORPORATION
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "QueryResultBuilder.h"
+#include <catch2/catch.hpp>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <utility>
+
+namespace influxdb::test
+{
+    using internal::ColumnarResultBuilder;
+    using internal::RowResultBuilder;
+    using ValueType = internal::QueryResultBuilder::ValueType;
+    using Value = std::pair<ValueType, std::string>;
+
+    namespace
+    {
+        /// Builds a single series with a column per value of the rows
+        std::vector<InfluxDBColumnarTable> buildColumns(const std::vector<std::string>& columns, const std::vector<std::vector<Value>>& rows)
+        {
+            ColumnarResultBuilder builder;
+            builder.beginResult();
+            builder.setStatementId(0);
+            builder.beginSeries();
+            for (const auto& column : columns)
+            {
+                builder.addColumn(column);
+            }
+            for (const auto& row : rows)
+            {
+                builder.beginRow();
+                for (const auto& [type, text] : row)
+                {
+                    builder.addValue(type, text);
+                }
+                builder.endRow();
+            }
+            builder.endResult(false);
+            return builder.takeResult();
+        }
+
+        InfluxDBColumn buildColumn(const std::vector<Value>& values, const std::string& name = "value")
+        {
+            std::vector<std::vector<Value>> rows;
+            for (const auto& value : values)
+            {
+                rows.push_back({value});
+            }
+            auto result = buildColumns({name}, rows);
+            return result[0].series[0].columns[0];
+        }
+
+        Value number(std::string text)
+        {
+            return {ValueType::Number, std::move(text)};
+        }
+
+        Value string(std::string text)
+        {
+            return {ValueType::String, std::move(text)};
+        }
+
+        const Value null{ValueType::Null, ""};
+    }
+
+    TEST_CASE("Row builder keeps values as text", "[QueryResultBuilderTest]")
+    {
+        RowResultBuilder builder;
+        builder.beginResult();
+        builder.beginSeries();
+        builder.addTag("host", "a");
+        builder.addColumn("value");
+        builder.beginRow();
+        builder.addValue(ValueType::Number, "1.50");
+        builder.addValue(ValueType::Null, "");
+        builder.endRow();
+        builder.endResult(false);
+
+        const auto result = builder.takeResult();
+        CHECK(result[0].series[0].tagKeys == std::vector<std::string>{"host"});
+        CHECK(result[0].series[0].rows[0].tuple == std::vector<std::string>{"1.50", ""});
+    }
+
+    TEST_CASE("Infers integer column", "[QueryResultBuilderTest]")
+    {
+        const auto column = buildColumn({number("1"), number("-9223372036854775808"), number("9223372036854775807")});
+        CHECK(column.type == InfluxDBColumn::Type::Integer);
+        CHECK(column.integers == std::vector<std::int64_t>{1, std::numeric_limits<std::int64_t>::min(), std::numeric_limits<std::int64_t>::max()});
+    }
+
+    TEST_CASE("Infers float column", "[QueryResultBuilderTest]")
+    {
+        const auto column = buildColumn({number("0.1"), number("1e300"), number("3")});
+        CHECK(column.type == InfluxDBColumn::Type::Float);
+        CHECK(column.floats == std::vector<double>{0.1, 1e300, 3.0});
+    }
+
+    TEST_CASE("Promotes integer column to float", "[QueryResultBuilderTest]")
+    {
+        const auto column = buildColumn({number("1"), null, number("2.5")});
+        CHECK(column.type == InfluxDBColumn::Type::Float);
+        CHECK(column.floats == std::vector<double>{1.0, 0.0, 2.5});
+        CHECK(column.integers.empty());
+        CHECK(column.isNull(1));
+    }
+
+    TEST_CASE("Integers out of range are strings unless exact floats", "[QueryResultBuilderTest]")
+    {
+        const auto unsignedColumn = buildColumn({number("18446744073709551615"), number("1")});
+        CHECK(unsignedColumn.type == InfluxDBColumn::Type::String);
+        CHECK(unsignedColumn.strings == std::vector<std::string_view>{"18446744073709551615", "1"});
+
+        const auto floatColumn = buildColumn({number("100000000000000000000"), number("1.5")});
+        CHECK(floatColumn.type == InfluxDBColumn::Type::Float);
+        CHECK(floatColumn.floats == std::vector<double>{1e20, 1.5});
+    }
+
+    TEST_CASE("Integers are only promoted to float if exact", "[QueryResultBuilderTest]")
+    {
+        const auto column = buildColumn({number("9007199254740993"), number("2.5")});
+        CHECK(column.type == InfluxDBColumn::Type::String);
+        CHECK(column.strings == std::vector<std::string_view>{"9007199254740993", "2.5"});
+
+        const auto unsignedColumn = buildColumn({number("1"), number("18446744073709551615")});
+        CHECK(unsignedColumn.type == InfluxDBColumn::Type::String);
+        CHECK(unsignedColumn.strings == std::vector<std::string_view>{"1", "18446744073709551615"});
+
+        const auto floatColumn = buildColumn({number("2.5"), number("9007199254740993")});
+        CHECK(floatColumn.type == InfluxDBColumn::Type::String);
+        CHECK(floatColumn.strings == std::vector<std::string_view>{"2.5", "9007199254740993"});
+
+        const auto exactColumn = buildColumn({number("9007199254740992"), number("2.5")});
+        CHECK(exactColumn.type == InfluxDBColumn::Type::Float);
+        CHECK(exactColumn.floats == std::vector<double>{9007199254740992.0, 2.5});
+    }
+
+    TEST_CASE("Infers boolean column", "[QueryResultBuilderTest]")
+    {
+        const auto column = buildColumn({{ValueType::Boolean, "true"}, {ValueType::Boolean, "false"}});
+        CHECK(column.type == InfluxDBColumn::Type::Boolean);
+        CHECK(column.booleans == std::vector<std::uint8_t>{1, 0});
+    }
+
+    TEST_CASE("Infers time column", "[QueryResultBuilderTest]")
+    {
+        const auto column = buildColumn({string("1970-01-01T00:00:00Z"), string("2021-01-01T00:11:22.123456789Z"),
+                                         string("1969-12-31T23:59:59.5Z"), string("1678-01-01T00:00:00Z"),
+                                         string("2261-12-31T23:59:59.999999999Z")}, "time");
+        CHECK(column.type == InfluxDBColumn::Type::Time);
+        CHECK(column.integers == std::vector<std::int64_t>{0, 1609459882123456789, -500000000, -9214560000000000000, 9214646399999999999});
+    }
+
+    TEST_CASE("Time column requires RFC3339 timestamps", "[QueryResultBuilderTest]")
+    {
+        CHECK(buildColumn({string("2021-01-01T00:11:22Z")}, "value").type == InfluxDBColumn::Type::String);
+        CHECK(buildColumn({string("2021-01-01 00:11:22Z")}, "time").type == InfluxDBColumn::Type::String);
+        CHECK(buildColumn({string("2021-01-01T00:11:22.Z")}, "time").type == InfluxDBColumn::Type::String);
+        CHECK(buildColumn({string("2021-01-01T00:11:22.1234567890Z")}, "time").type == InfluxDBColumn::Type::String);
+        CHECK(buildColumn({string("2021-01-01T00:11:22+01:00")}, "time").type == InfluxDBColumn::Type::String);
+        CHECK(buildColumn({string("2021-13-01T00:11:22Z")}, "time").type == InfluxDBColumn::Type::String);
+        CHECK(buildColumn({string("2262-01-01T00:00:00Z")}, "time").type == InfluxDBColumn::Type::String);
+        CHECK(buildColumn({number("1609460482")}, "time").type == InfluxDBColumn::Type::Integer);
+    }
+
+    TEST_CASE("Conflicting types turn column into strings", "[QueryResultBuilderTest]")
+    {
+        const auto time = buildColumn({string("2021-01-01T00:11:22.120Z"), null, string("later")}, "time");
+        CHECK(time.type == InfluxDBColumn::Type::String);
+        CHECK(time.strings == std::vector<std::string_view>{"2021-01-01T00:11:22.12Z", "", "later"});
+        CHECK(time.integers.empty());
+
+        const auto mixed = buildColumn({number("1"), number("0.25"), {ValueType::Boolean, "true"}, string("x"), {ValueType::Nested, "[1]"}});
+        CHECK(mixed.type == InfluxDBColumn::Type::String);
+        CHECK(mixed.strings == std::vector<std::string_view>{"1", "0.25", "true", "x", "[1]"});
+
+        const auto booleans = buildColumn({{ValueType::Boolean, "false"}, number("7")});
+        CHECK(booleans.strings == std::vector<std::string_view>{"false", "7"});
+    }
+
+    TEST_CASE("Tracks null values", "[QueryResultBuilderTest]")
+    {
+        std::vector<Value> values;
+        for (int i = 0; i < 130; ++i)
+        {
+            values.push_back(i % 3 == 0 ? null : number(std::to_string(i)));
+        }
+        const auto column = buildColumn(values);
+
+        REQUIRE(column.validity.size() == 3);
+        REQUIRE(column.integers.size() == 130);
+        for (std::size_t i = 0; i < 130; ++i)
+        {
+            CHECK(column.isNull(i) == (i % 3 == 0));
+        }
+        CHECK(column.integers[128] == 128);
+    }
+
+    TEST_CASE("Column of null values has no type", "[QueryResultBuilderTest]")
+    {
+        const auto column = buildColumn({null, null});
+        CHECK(column.type == InfluxDBColumn::Type::Null);
+        CHECK(column.isNull(0));
+        CHECK(column.isNull(1));
+    }
+
+    TEST_CASE("First value after nulls determines type", "[QueryResultBuilderTest]")
+    {
+        const auto column = buildColumn({null, null, string("x")});
+        CHECK(column.type == InfluxDBColumn::Type::String);
+        CHECK(column.strings == std::vector<std::string_view>{"", "", "x"});
+    }
+
+    TEST_CASE("Pads rows of different length", "[QueryResultBuilderTest]")
+    {
+        const auto result = buildColumns({"a", "b"}, {{number("1")}, {number("2"), number("3"), string("extra")}});
+        const auto& series = result[0].series[0];
+
+        REQUIRE(series.rowCount == 2);
+        REQUIRE(series.columns.size() == 3);
+        CHECK(series.columns[1].integers == std::vector<std::int64_t>{0, 3});
+        CHECK(series.columns[1].isNull(0));
+        CHECK(series.columns[2].name.empty());
+        CHECK(series.columns[2].strings == std::vector<std::string_view>{"", "extra"});
+        CHECK(series.columns[2].isNull(0));
+        CHECK_FALSE(series.columns[2].isNull(1));
+    }
+
+    TEST_CASE("Strings outlive the builder and copies of the table", "[QueryResultBuilderTest]")
+    {
+        const std::string large(ColumnarResultBuilder::stringBlockSize + 1, 'x');
+        std::vector<Value> values;
+        for (int i = 0; i < 10000; ++i)
+        {
+            values.push_back(string("value-" + std::to_string(i)));
+        }
+        values.push_back(string(large));
+
+        std::vector<InfluxDBColumnarTable> copy;
+        {
+            std::vector<std::vector<Value>> rows;
+            for (const auto& value : values)
+            {
+                rows.push_back({value});
+            }
+            copy = buildColumns({"value"}, rows);
+        }
+
+        const auto& strings = copy[0].series[0].columns[0].strings;
+        REQUIRE(strings.size() == values.size());
+        CHECK(strings[0] == "value-0");
+        CHECK(strings[9999] == "value-9999");
+        CHECK(strings.back() == large);
+        CHECK(copy[0].stringStorage.size() > 1);
+    }
+
+    TEST_CASE("Typed values are added to columns without conversion", "[QueryResultBuilderTest]")
+    {
+        ColumnarResultBuilder builder;
+        builder.beginResult();
+        builder.beginSeries();
+        builder.addColumn("time");
+        builder.addColumn("value");
+        builder.addColumn("text");
+        builder.beginRow();
+        builder.addTime(-1);
+        builder.addInteger(1);
+        builder.addValue(ValueType::String, "a");
+        builder.endRow();
+        builder.beginRow();
+        builder.addTime(1609459200000000000);
+        builder.addFloat(2.5);
+        builder.addInteger(3);
+        builder.endRow();
+        builder.endResult(false);
+
+        const auto result = builder.takeResult();
+        const auto& columns = result[0].series[0].columns;
+        CHECK(columns[0].type == InfluxDBColumn::Type::Time);
+        CHECK(columns[0].integers == std::vector<std::int64_t>{-1, 1609459200000000000});
+        CHECK(columns[1].type == InfluxDBColumn::Type::Float);
+        CHECK(columns[1].floats == std::vector<double>{1.0, 2.5});
+        CHECK(columns[2].type == InfluxDBColumn::Type::String);
+        CHECK(columns[2].strings == std::vector<std::string_view>{"a", "3"});
+    }
+
+    TEST_CASE("Typed integers are only mixed with floats if exact", "[QueryResultBuilderTest]")
+    {
+        ColumnarResultBuilder builder;
+        builder.beginResult();
+        builder.beginSeries();
+        builder.addColumn("integers");
+        builder.addColumn("floats");
+        builder.beginRow();
+        builder.addInteger(9007199254740993);
+        builder.addFloat(0.5);
+        builder.endRow();
+        builder.beginRow();
+        builder.addFloat(2.5);
+        builder.addInteger(9007199254740993);
+        builder.endRow();
+        builder.endResult(false);
+
+        const auto result = builder.takeResult();
+        const auto& columns = result[0].series[0].columns;
+        CHECK(columns[0].type == InfluxDBColumn::Type::String);
+        CHECK(columns[0].strings == std::vector<std::string_view>{"9007199254740993", "2.5"});
+        CHECK(columns[1].type == InfluxDBColumn::Type::String);
+        CHECK(columns[1].strings == std::vector<std::string_view>{"0.5", "9007199254740993"});
+    }
+
+    TEST_CASE("Row builder formats typed values like JSON", "[QueryResultBuilderTest]")
+    {
+        RowResultBuilder builder;
+        builder.beginResult();
+        builder.beginSeries();
+        builder.beginRow();
+        builder.addTime(1609459201500000000);
+        builder.addInteger(-7);
+        builder.addFloat(0.1);
+        builder.endRow();
+        builder.endResult(false);
+
+        CHECK(builder.takeResult()[0].series[0].rows[0].tuple == std::vector<std::string>{"2021-01-01T00:00:01.5Z", "-7", "0.1"});
+    }
+
+    TEST_CASE("Failed result only consists of error", "[QueryResultBuilderTest]")
+    {
+        ColumnarResultBuilder builder;
+        builder.beginResult();
+        builder.setStatementId(3);
+        builder.beginSeries();
+        builder.addColumn("value");
+        builder.beginRow();
+        builder.addValue(ValueType::String, "x");
+        builder.endRow();
+        builder.setError("failed");
+        builder.endResult(true);
+
+        const auto result = builder.takeResult();
+        CHECK(result[0].statementId == -1);
+        CHECK(result[0].error == "failed");
+        CHECK(result[0].series.empty());
+    }
+}
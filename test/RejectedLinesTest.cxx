@@ -0,0 +1,134 @@
+// MIT License
+//
+// Copyright (c) 2022 TOSHIBA CORPORATION
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "RejectedLines.h"
+#include <catch2/catch.hpp>
+#include <string>
+
+namespace influxdb::test
+{
+    using internal::findRejectedLines;
+    using internal::splitLines;
+
+    namespace
+    {
+        std::vector<std::size_t> rejected(std::string_view lines, std::string_view error)
+        {
+            return findRejectedLines(splitLines(lines), error).lines;
+        }
+    }
+
+    TEST_CASE("Lines are split on newlines", "[RejectedLinesTest]")
+    {
+        CHECK(splitLines("a\nb\n\nc") == std::vector<std::string_view>{"a", "b", "", "c"});
+        CHECK(splitLines("a") == std::vector<std::string_view>{"a"});
+        CHECK(splitLines("a\n") == std::vector<std::string_view>{"a", ""});
+    }
+
+    TEST_CASE("Lines quoted by parse errors are rejected", "[RejectedLinesTest]")
+    {
+        const std::string_view lines{"cpu value=1\ncpu value=\nmem free=2\ncpu value=\ndisk x=abc"};
+        const std::string_view error{"ERROR: partial write: unable to parse 'cpu value=': missing field value\n"
+                                     "unable to parse 'disk x=abc': invalid boolean dropped=0"};
+
+        const auto result = findRejectedLines(splitLines(lines), error);
+
+        CHECK(result.lines == std::vector<std::size_t>{1, 3, 4});
+        CHECK(result.partialWrite);
+    }
+
+    TEST_CASE("Quoted lines may contain quote and separator", "[RejectedLinesTest]")
+    {
+        const std::string_view lines{"cpu s=\"it': x\",v=\ncpu v=1"};
+        CHECK(rejected(lines, "unable to parse 'cpu s=\"it': x\",v=': missing field value") == std::vector<std::size_t>{0});
+    }
+
+    TEST_CASE("Lines referred to by number are rejected", "[RejectedLinesTest]")
+    {
+        const std::string_view lines{"a v=1\nb v=\nc v=1\nd v=x"};
+        const std::string_view error{"CODE: invalid, MESSAGE: unable to parse points: errors encountered on line(s):\n"
+                                     "line 2: missing field value\nline 4: invalid field format\nline 9: out of range"};
+
+        const auto result = findRejectedLines(splitLines(lines), error);
+
+        CHECK(result.lines == std::vector<std::size_t>{1, 3});
+        CHECK_FALSE(result.partialWrite);
+        CHECK(rejected(lines, "error parsing line 3 (1-based): invalid") == std::vector<std::size_t>{2});
+        CHECK(rejected(lines, "newline 2: x, line 2 was fine").empty());
+    }
+
+    TEST_CASE("Lines of field type conflicts are rejected", "[RejectedLinesTest]")
+    {
+        const std::string_view lines{"cpu,host=a value=1i\n"
+                                     "cpu,host=a value=1.5\n"
+                                     "cpu,host=b idle=3,value=2i 1000\n"
+                                     "mem value=4i\n"
+                                     "cpu value=\"4i\"\n"
+                                     "cpu\\ load,host=a value=5i"};
+        const std::string_view error{"ERROR: partial write: field type conflict: input field \"value\" on measurement \"cpu\" "
+                                     "is type integer, already exists as type float dropped=2"};
+
+        const auto result = findRejectedLines(splitLines(lines), error);
+
+        CHECK(result.lines == std::vector<std::size_t>{0, 2});
+        CHECK(result.partialWrite);
+        CHECK(result.dropped == 2);
+        CHECK(rejected(lines, "input field \"value\" on measurement \"cpu load\" is type integer, already exists as type float") == std::vector<std::size_t>{5});
+        CHECK(rejected(lines, "input field \"value\" on measurement \"cpu\" is type string, already exists as type float") == std::vector<std::size_t>{4});
+    }
+
+    TEST_CASE("Field types are told apart", "[RejectedLinesTest]")
+    {
+        const std::string_view lines{"m f=1\nm f=1i\nm f=1u\nm f=t\nm f=FALSE\nm f=\"a\\\"b\",g=1i"};
+        const auto conflict = [&lines](const std::string& type) {
+            return rejected(lines, "input field \"f\" on measurement \"m\" is type " + type + ", already exists as type x");
+        };
+
+        CHECK(conflict("float") == std::vector<std::size_t>{0});
+        CHECK(conflict("integer") == std::vector<std::size_t>{1});
+        CHECK(conflict("unsigned") == std::vector<std::size_t>{2});
+        CHECK(conflict("boolean") == std::vector<std::size_t>{3, 4});
+        CHECK(conflict("string") == std::vector<std::size_t>{5});
+        CHECK(rejected(lines, "input field \"g\" on measurement \"m\" is type integer, already exists as type float") == std::vector<std::size_t>{5});
+    }
+
+    TEST_CASE("Dropped lines of partial writes are counted", "[RejectedLinesTest]")
+    {
+        const auto lines = splitLines("cpu value=1i\ncpu value=2i\nmem value=3");
+        const std::string_view error{"partial write: field type conflict: input field \"value\" on measurement \"cpu\" "
+                                     "is type integer, already exists as type float dropped=3"};
+
+        const auto result = findRejectedLines(lines, error);
+
+        CHECK(result.lines == std::vector<std::size_t>{0, 1});
+        CHECK(result.dropped == 3);
+        CHECK(findRejectedLines(lines, "partial write: points beyond retention policy dropped=12345678901234567890").dropped > lines.size());
+        CHECK(findRejectedLines(lines, "unable to parse 'mem value=3': invalid").dropped == 0);
+    }
+
+    TEST_CASE("No lines are rejected for unknown errors", "[RejectedLinesTest]")
+    {
+        CHECK(rejected("cpu value=1", "ERROR: database not found").empty());
+        CHECK(rejected("cpu value=1", "unable to parse 'mem value=': missing field value").empty());
+    }
+}
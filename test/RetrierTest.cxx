@@ -0,0 +1,253 @@
+// MIT License
+//
+// Copyright (c) 2022 TOSHIBA CORPORATION
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "Retrier.h"
+#include "FakeClock.h"
+#include "InfluxDBException.h"
+#include <catch2/catch.hpp>
+#include <set>
+#include <vector>
+
+namespace influxdb::test
+{
+    using internal::Retrier;
+    using namespace std::chrono_literals;
+
+    namespace
+    {
+        /// Send failing by the given errors in turn, succeeding afterwards
+        struct FailingSend
+        {
+            std::vector<std::function<void()>> errors;
+            std::size_t calls{0};
+
+            std::function<void()> function()
+            {
+                return [this] {
+                    if (calls++ < errors.size())
+                    {
+                        errors[calls - 1]();
+                    }
+                };
+            }
+        };
+
+        void connectionError()
+        {
+            throw ConnectionError{"unit test", "Connection refused"};
+        }
+
+        void serverError()
+        {
+            throw ServerError{"unit test", "Service unavailable"};
+        }
+
+        /// Transport failing by a connection error a number of times, taking the message once it's sent
+        class FailingTransport : public Transport
+        {
+        public:
+            void send(std::string&& message) override
+            {
+                if (failures > 0)
+                {
+                    --failures;
+                    connectionError();
+                }
+                received.push_back(std::move(message));
+            }
+
+            std::size_t failures{0};
+            std::vector<std::string> received;
+        };
+
+        RetryPolicy withoutJitter()
+        {
+            RetryPolicy policy;
+            policy.jitter = 0.0;
+            return policy;
+        }
+    }
+
+    TEST_CASE("Transient errors are retried until sent", "[RetrierTest]")
+    {
+        FakeClock clock;
+        FailingSend send{{connectionError, serverError, [] { throw TooManyRequests{"unit test", "Slow down", 0s}; }}};
+        Retrier retrier{withoutJitter(), clock.sleep(), clock.function()};
+
+        retrier.run(send.function());
+
+        CHECK(send.calls == 4);
+        CHECK(clock.sleeps == std::vector<std::chrono::milliseconds>{100ms, 200ms, 400ms});
+        const auto statistics = retrier.statistics();
+        CHECK(statistics.retries == 3);
+        CHECK(statistics.recovered == 1);
+        CHECK(statistics.exhausted == 0);
+        CHECK(statistics.rejected == 0);
+    }
+
+    TEST_CASE("Successful send isn't counted as recovered", "[RetrierTest]")
+    {
+        FakeClock clock;
+        FailingSend send;
+        Retrier retrier{RetryPolicy{}, clock.sleep(), clock.function()};
+
+        retrier.run(send.function());
+
+        CHECK(send.calls == 1);
+        CHECK(clock.sleeps.empty());
+        CHECK(retrier.statistics().recovered == 0);
+    }
+
+    TEST_CASE("Bad requests are never retried", "[RetrierTest]")
+    {
+        FakeClock clock;
+        FailingSend send{{[] { throw BadRequest{"unit test", "Unable to parse"}; }}};
+        Retrier retrier{RetryPolicy{}, clock.sleep(), clock.function()};
+
+        CHECK_THROWS_AS(retrier.run(send.function()), BadRequest);
+        CHECK(send.calls == 1);
+        CHECK(clock.sleeps.empty());
+        CHECK(retrier.statistics().rejected == 1);
+        CHECK(retrier.statistics().retries == 0);
+    }
+
+    TEST_CASE("Retries are given up after maximum retries", "[RetrierTest]")
+    {
+        FakeClock clock;
+        FailingSend send{{connectionError, connectionError, connectionError, connectionError}};
+        auto policy = withoutJitter();
+        policy.maxRetries = 2;
+        Retrier retrier{policy, clock.sleep(), clock.function()};
+
+        CHECK_THROWS_AS(retrier.run(send.function()), ConnectionError);
+        CHECK(send.calls == 3);
+        CHECK(retrier.statistics().retries == 2);
+        CHECK(retrier.statistics().exhausted == 1);
+        CHECK(retrier.statistics().recovered == 0);
+    }
+
+    TEST_CASE("Retries are given up before exceeding maximum elapsed time", "[RetrierTest]")
+    {
+        FakeClock clock;
+        FailingSend send{std::vector<std::function<void()>>(10, serverError)};
+        auto policy = withoutJitter();
+        policy.maxRetries = 10;
+        policy.maxElapsed = 1000ms;
+        Retrier retrier{policy, clock.sleep(), clock.function()};
+
+        CHECK_THROWS_AS(retrier.run(send.function()), ServerError);
+        CHECK(clock.sleeps == std::vector<std::chrono::milliseconds>{100ms, 200ms, 400ms});
+        CHECK(retrier.statistics().exhausted == 1);
+    }
+
+    TEST_CASE("Delay requested by server is waited at least", "[RetrierTest]")
+    {
+        FakeClock clock;
+        FailingSend send{{[] { throw TooManyRequests{"unit test", "Slow down", 3s}; }}};
+        Retrier retrier{withoutJitter(), clock.sleep(), clock.function()};
+
+        retrier.run(send.function());
+
+        CHECK(clock.sleeps == std::vector<std::chrono::milliseconds>{3000ms});
+    }
+
+    TEST_CASE("Delay requested by server exceeding maximum elapsed time gives up", "[RetrierTest]")
+    {
+        FakeClock clock;
+        FailingSend send{{[] { throw TooManyRequests{"unit test", "Slow down", 60s}; }}};
+        Retrier retrier{RetryPolicy{}, clock.sleep(), clock.function()};
+
+        CHECK_THROWS_AS(retrier.run(send.function()), TooManyRequests);
+        CHECK(clock.sleeps.empty());
+        CHECK(retrier.statistics().exhausted == 1);
+    }
+
+    TEST_CASE("Backoff grows exponentially up to maximum", "[RetrierTest]")
+    {
+        auto policy = withoutJitter();
+        policy.initialBackoff = 50ms;
+        policy.multiplier = 3.0;
+        policy.maxBackoff = 1000ms;
+        Retrier retrier{policy};
+
+        CHECK(retrier.backoff(0) == 50ms);
+        CHECK(retrier.backoff(1) == 150ms);
+        CHECK(retrier.backoff(2) == 450ms);
+        CHECK(retrier.backoff(3) == 1000ms);
+        CHECK(retrier.backoff(1000) == 1000ms);
+    }
+
+    TEST_CASE("Jitter spreads backoff within fraction of delay", "[RetrierTest]")
+    {
+        RetryPolicy policy;
+        policy.initialBackoff = 1000ms;
+        policy.jitter = 0.5;
+        Retrier retrier{policy};
+
+        std::set<std::chrono::milliseconds::rep> delays;
+        for (int i = 0; i < 100; ++i)
+        {
+            const auto delay = retrier.backoff(0);
+            CHECK(delay >= 500ms);
+            CHECK(delay <= 1000ms);
+            delays.insert(delay.count());
+        }
+        CHECK(delays.size() > 10);
+    }
+
+    TEST_CASE("Invalid policy throws", "[RetrierTest]")
+    {
+        auto policy = RetryPolicy{};
+        policy.maxBackoff = policy.initialBackoff - 1ms;
+        CHECK_THROWS_AS(Retrier{policy}, InfluxDBException);
+
+        policy = RetryPolicy{};
+        policy.multiplier = 0.5;
+        CHECK_THROWS_AS(Retrier{policy}, InfluxDBException);
+
+        policy = RetryPolicy{};
+        policy.jitter = 1.5;
+        CHECK_THROWS_AS(Retrier{policy}, InfluxDBException);
+
+        policy = RetryPolicy{};
+        policy.maxElapsed = -1ms;
+        CHECK_THROWS_AS(Retrier{policy}, InfluxDBException);
+    }
+
+    TEST_CASE("Retried sends transmit the whole message", "[RetrierTest]")
+    {
+        auto transport = std::make_unique<FailingTransport>();
+        auto& server = *transport;
+        server.failures = 2;
+        InfluxDB db{std::move(transport)};
+        RetryPolicy policy;
+        policy.maxRetries = 2;
+        policy.initialBackoff = 0ms;
+        db.setRetryPolicy(policy);
+
+        db.write(Point{"a"}.addField("v", 1).setTimestamp(std::chrono::system_clock::time_point{}));
+
+        CHECK(server.received == std::vector<std::string>{"a v=1i 0"});
+        CHECK(db.retryStatistics().recovered == 1);
+    }
+}
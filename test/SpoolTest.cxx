@@ -0,0 +1,228 @@
+// MIT License
+//
+// Copyright (c) 2022 TOSHIBA CORPORATION
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "Spool.h"
+#include "InfluxDB.h"
+#include "InfluxDBException.h"
+#include "FlakyTransport.h"
+#include <catch2/catch.hpp>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace influxdb::test
+{
+    namespace
+    {
+        /// Temporary directory of a spool, removed with its files
+        class SpoolDirectory
+        {
+        public:
+            SpoolDirectory()
+            {
+                std::string path{"/tmp/influxdb-cxx-spool-XXXXXX"};
+                REQUIRE(mkdtemp(path.data()) != nullptr);
+                mPath = path + "/spool";
+            }
+
+            ~SpoolDirectory()
+            {
+                if (DIR* entries = opendir(mPath.c_str()); entries != nullptr)
+                {
+                    while (const dirent* entry = readdir(entries))
+                    {
+                        unlink((mPath + "/" + entry->d_name).c_str());
+                    }
+                    closedir(entries);
+                }
+                rmdir(mPath.c_str());
+                rmdir(mPath.substr(0, mPath.rfind('/')).c_str());
+            }
+
+            const std::string& path() const
+            {
+                return mPath;
+            }
+
+            std::string segment(std::size_t sequence) const
+            {
+                std::string name = std::to_string(sequence);
+                return mPath + "/" + std::string(20 - name.size(), '0') + name + ".spool";
+            }
+
+        private:
+            std::string mPath;
+        };
+
+        std::vector<std::string> drain(internal::Spool& spool)
+        {
+            std::vector<std::string> batches;
+            while (!spool.empty())
+            {
+                batches.emplace_back(spool.front());
+                spool.pop();
+            }
+            return batches;
+        }
+    }
+
+    TEST_CASE("Spool returns batches in order", "[SpoolTest]")
+    {
+        const SpoolDirectory directory;
+        internal::Spool spool{directory.path(), 1024 * 1024};
+        CHECK(spool.empty());
+
+        spool.append("a 1");
+        spool.append("b 2\nc 3");
+
+        CHECK(spool.statistics().pending == 2);
+        CHECK(drain(spool) == std::vector<std::string>{"a 1", "b 2\nc 3"});
+        CHECK(spool.statistics().spooled == 2);
+        CHECK(spool.statistics().replayed == 2);
+        CHECK(spool.empty());
+    }
+
+    TEST_CASE("Spool continues with batches not consumed after reopening", "[SpoolTest]")
+    {
+        const SpoolDirectory directory;
+        {
+            internal::Spool spool{directory.path(), 1024 * 1024};
+            spool.append("a 1");
+            spool.append("b 2");
+            spool.pop();
+        }
+
+        internal::Spool spool{directory.path(), 1024 * 1024};
+        CHECK(spool.statistics().pending == 1);
+        spool.append("c 3");
+        CHECK(drain(spool) == std::vector<std::string>{"b 2", "c 3"});
+    }
+
+    TEST_CASE("Spool evicts oldest segments beyond the quota", "[SpoolTest]")
+    {
+        const SpoolDirectory directory;
+        internal::Spool spool{directory.path(), 256, 64};
+
+        for (int i = 0; i < 20; ++i)
+        {
+            spool.append("cpu value=" + std::to_string(i));
+        }
+
+        const auto statistics = spool.statistics();
+        CHECK(statistics.bytes <= 256);
+        CHECK(statistics.evicted > 0);
+        CHECK(statistics.evicted + statistics.pending == 20);
+        const auto batches = drain(spool);
+        CHECK(batches.back() == "cpu value=19");
+        CHECK(access(directory.segment(0).c_str(), F_OK) != 0);
+    }
+
+    TEST_CASE("Spool drops batches exceeding the quota", "[SpoolTest]")
+    {
+        const SpoolDirectory directory;
+        internal::Spool spool{directory.path(), 64};
+
+        spool.append(std::string(100, 'x'));
+
+        CHECK(spool.empty());
+        CHECK(spool.statistics().evicted == 1);
+    }
+
+    TEST_CASE("Spool gives large batches a segment of their own", "[SpoolTest]")
+    {
+        const SpoolDirectory directory;
+        internal::Spool spool{directory.path(), 1024 * 1024, 64};
+        const std::string large(1000, 'x');
+
+        spool.append("a 1");
+        spool.append(large);
+        spool.append("b 2");
+
+        CHECK(drain(spool) == std::vector<std::string>{"a 1", large, "b 2"});
+    }
+
+    TEST_CASE("Spool discards torn records", "[SpoolTest]")
+    {
+        const SpoolDirectory directory;
+        {
+            internal::Spool spool{directory.path(), 1024 * 1024};
+            spool.append("a 1");
+            spool.append("b 2");
+        }
+        const int handle = open(directory.segment(0).c_str(), O_WRONLY);
+        REQUIRE(handle >= 0);
+        const char corrupted{'X'};
+        CHECK(pwrite(handle, &corrupted, 1, 8 + 16 + 3 + 16 + 2) == 1);
+        close(handle);
+
+        {
+            internal::Spool spool{directory.path(), 1024 * 1024};
+            CHECK(spool.statistics().pending == 1);
+            spool.append("c 3");
+        }
+        internal::Spool spool{directory.path(), 1024 * 1024};
+        CHECK(drain(spool) == std::vector<std::string>{"a 1", "c 3"});
+    }
+
+    TEST_CASE("Spool throws if the directory is in use", "[SpoolTest]")
+    {
+        const SpoolDirectory directory;
+        const internal::Spool spool{directory.path(), 1024};
+        CHECK_THROWS_AS(internal::Spool(directory.path(), 1024), InfluxDBException);
+    }
+
+    TEST_CASE("Spooled batches are sent in order when the server recovers", "[SpoolTest]")
+    {
+        const SpoolDirectory directory;
+        auto transport = std::make_unique<FlakyTransport>();
+        auto& server = *transport;
+        server.available = false;
+        InfluxDB db{std::move(transport)};
+        db.enableSpool(directory.path());
+        db.batchOf(2);
+
+        db.write(Point{"a"}.addField("v", 1).setTimestamp(std::chrono::system_clock::time_point{}));
+        db.write(Point{"b"}.addField("v", 2).setTimestamp(std::chrono::system_clock::time_point{}));
+        db.write(Point{"c"}.addField("v", 3).setTimestamp(std::chrono::system_clock::time_point{}));
+        CHECK_NOTHROW(db.flushBatch());
+        CHECK(db.spoolStatistics().spooled == 2);
+        CHECK(db.batchSize() == 0);
+
+        server.available = true;
+        db.flushBatch();
+
+        CHECK(server.received == std::vector<std::string>{"a v=1i 0\nb v=2i 0", "c v=3i 0"});
+        CHECK(db.spoolStatistics().replayed == 2);
+        CHECK(db.spoolStatistics().pending == 0);
+    }
+
+    TEST_CASE("Spool statistics are zero if disabled", "[SpoolTest]")
+    {
+        InfluxDB db{std::make_unique<FlakyTransport>()};
+        CHECK(db.spoolStatistics().spooled == 0);
+        CHECK(db.spoolStatistics().bytes == 0);
+    }
+}
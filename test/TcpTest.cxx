@@ -0,0 +1,172 @@
+// MIT License
+//
+// Copyright (c) 2022 TOSHIBA CORPORATION
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "TCP.h"
+#include "InfluxDBException.h"
+#include <catch2/catch.hpp>
+#include <future>
+#include <string>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace influxdb::test
+{
+    namespace
+    {
+        /// Listening socket on a loopback address, accepting the connections of the transport
+        class Listener
+        {
+        public:
+            Listener()
+                : mHandle(socket(AF_INET, SOCK_STREAM, 0))
+            {
+                sockaddr_in address{};
+                address.sin_family = AF_INET;
+                address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+                socklen_t length{sizeof(address)};
+                REQUIRE(bind(mHandle, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0);
+                REQUIRE(listen(mHandle, 4) == 0);
+                REQUIRE(getsockname(mHandle, reinterpret_cast<sockaddr*>(&address), &length) == 0);
+                mPort = ntohs(address.sin_port);
+            }
+
+            ~Listener()
+            {
+                disconnect();
+                close(mHandle);
+            }
+
+            int port() const
+            {
+                return mPort;
+            }
+
+            void accept()
+            {
+                disconnect();
+                mConnection = ::accept(mHandle, nullptr, nullptr);
+                REQUIRE(mConnection >= 0);
+            }
+
+            void disconnect()
+            {
+                if (mConnection >= 0)
+                {
+                    close(mConnection);
+                    mConnection = -1;
+                }
+            }
+
+            std::string receive(std::size_t size)
+            {
+                std::string data(size, '\0');
+                for (std::size_t received = 0; received < size;)
+                {
+                    const auto result = recv(mConnection, data.data() + received, size - received, 0);
+                    REQUIRE(result > 0);
+                    received += static_cast<std::size_t>(result);
+                }
+                return data;
+            }
+
+        private:
+            int mHandle;
+            int mConnection{-1};
+            int mPort{0};
+        };
+
+        int closedPort()
+        {
+            const Listener listener;
+            return listener.port();
+        }
+    }
+
+    TEST_CASE("TCP transport throws on unknown host", "[TcpTest]")
+    {
+        CHECK_THROWS_AS(transports::TCP("invalid.host.example.", 8094), InfluxDBException);
+    }
+
+    TEST_CASE("TCP transport connects on first send", "[TcpTest]")
+    {
+        Listener listener;
+        transports::TCP tcp{"127.0.0.1", listener.port()};
+        CHECK(tcp.streamStatistics().connects == 0);
+
+        tcp.send("a 1\nb 2");
+        tcp.send("c 3\n");
+        listener.accept();
+
+        CHECK(listener.receive(12) == "a 1\nb 2\nc 3\n");
+        CHECK(tcp.streamStatistics().connects == 1);
+        CHECK(tcp.streamStatistics().bytesSent == 12);
+        CHECK(tcp.streamStatistics().connectionResets == 0);
+    }
+
+    TEST_CASE("TCP transport writes large messages completely", "[TcpTest]")
+    {
+        Listener listener;
+        transports::TCP tcp{"127.0.0.1", listener.port()};
+        const std::string message(8 * 1024 * 1024, 'x');
+
+        tcp.send("a 1");
+        listener.accept();
+        CHECK(listener.receive(4) == "a 1\n");
+
+        auto receiving = std::async(std::launch::async, [&listener, &message] { return listener.receive(message.size() + 1); });
+        tcp.send(std::string{message});
+        const auto received = receiving.get();
+
+        CHECK(received.size() == message.size() + 1);
+        CHECK(received.back() == '\n');
+        CHECK(tcp.streamStatistics().bytesSent == 4 + message.size() + 1);
+    }
+
+    TEST_CASE("TCP transport reconnects if the connection was closed", "[TcpTest]")
+    {
+        Listener listener;
+        transports::TCP tcp{"127.0.0.1", listener.port()};
+        tcp.send("a 1");
+        listener.accept();
+        CHECK(listener.receive(4) == "a 1\n");
+
+        listener.disconnect();
+        usleep(10000);
+        tcp.send("b 2");
+        listener.accept();
+
+        CHECK(listener.receive(4) == "b 2\n");
+        CHECK(tcp.streamStatistics().connects == 2);
+        CHECK(tcp.streamStatistics().connectionResets == 1);
+    }
+
+    TEST_CASE("TCP transport delays connection attempts after failure", "[TcpTest]")
+    {
+        transports::TCP tcp{"127.0.0.1", closedPort()};
+
+        CHECK_THROWS_WITH(tcp.send("a 1"), Catch::Contains("refused"));
+        CHECK_THROWS_WITH(tcp.send("a 1"), Catch::Contains("retrying in"));
+        CHECK(tcp.streamStatistics().connects == 0);
+    }
+}
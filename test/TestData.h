@@ -1,7 +1,6 @@
 // MIT License
 //
 // Copyright (c) 2022 TOSHIBA CORPORATION
-// Copyright (c) 2020-2022 offa
 //
 // Permission is hereby granted, free of charge, to any person obtaining a copy
 // of this software and associated documentation files (the "Software"), to deal
@@ -21,35 +20,32 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
-#include "BoostSupport.h"
-#include "InfluxDBException.h"
-#include "ConnectionInfo.h"
+#pragma once
+
 #include <catch2/catch.hpp>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <string_view>
 
 namespace influxdb::test
 {
-    namespace
-    {
-        struct TransportDummy : public Transport
-        {
-            void send([[maybe_unused]] std::string&& message) override
-            {
-            }
-        };
-
-        TransportDummy dummy;
-    }
-
-    TEST_CASE("With UDP throws transport unconditionally", "[NoBoostSupportTest]")
+    inline std::string readTestData(const std::string& name)
     {
-        auto conn = internal::ConnectionInfo::createConnectionInfoV1("", 0, "", "", "");
-        CHECK_THROWS_AS(internal::withUdpTransport(conn.host, conn.port), InfluxDBException);
+        std::ifstream file{INFLUXCXX_TEST_DATA_DIR "/" + name, std::ios::binary};
+        REQUIRE(file.is_open());
+        std::ostringstream out;
+        out << file.rdbuf();
+        return out.str();
     }
 
-    TEST_CASE("With Unix socket transport throws unconditionally", "[NoBoostSupportTest]")
+    template <class Parser>
+    void feedChunks(Parser& parser, std::string_view response, std::size_t chunkSize)
     {
-        auto conn = internal::ConnectionInfo::createConnectionInfoV1("", 0, "", "", "");
-        CHECK_THROWS_AS(internal::withUnixSocketTransport(conn.host), InfluxDBException);
+        for (std::size_t pos = 0; pos < response.size(); pos += chunkSize)
+        {
+            parser.feed(response.substr(pos, chunkSize));
+        }
+        parser.finish();
     }
-
 }
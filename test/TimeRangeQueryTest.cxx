@@ -0,0 +1,214 @@
+// MIT License
+//
+// Copyright (c) 2022 TOSHIBA CORPORATION
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "Query.h"
+#include "InfluxDBException.h"
+#include <catch2/catch.hpp>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace influxdb::test
+{
+    namespace
+    {
+        constexpr std::int64_t second{1000000000};
+
+        /// Transport answering queries by the parameters passed as JSON
+        class ParamsTransport : public Transport
+        {
+        public:
+            explicit ParamsTransport(std::function<std::string(const std::string&)> respond)
+                : mRespond(std::move(respond))
+            {
+            }
+
+            void send([[maybe_unused]] std::string&& message) override
+            {
+            }
+
+            std::string query(const std::string& query, const InfluxDBParams& params) override
+            {
+                const auto json = params.toJSON();
+                {
+                    std::lock_guard lock{mutex};
+                    receivedQueries.push_back(query);
+                    receivedParams.push_back(json);
+                }
+                return mRespond(json);
+            }
+
+            std::mutex mutex;
+            std::vector<std::string> receivedQueries;
+            std::vector<std::string> receivedParams;
+
+        private:
+            std::function<std::string(const std::string&)> mRespond;
+        };
+
+        bool contains(const std::string& text, const std::string& part)
+        {
+            return text.find(part) != std::string::npos;
+        }
+
+        std::vector<std::string> times(const InfluxDBSeries& series)
+        {
+            std::vector<std::string> result;
+            for (const auto& row : series.rows)
+            {
+                result.push_back(row.tuple.at(0));
+            }
+            return result;
+        }
+    }
+
+    TEST_CASE("Time range is split into parts of equal length", "[TimeRangeQueryTest]")
+    {
+        CHECK(internal::splitTimeRange(0, 10, 1) == std::vector<std::int64_t>{0, 10});
+        CHECK(internal::splitTimeRange(0, 10, 3) == std::vector<std::int64_t>{0, 4, 7, 10});
+        CHECK(internal::splitTimeRange(-10, 10, 4) == std::vector<std::int64_t>{-10, -5, 0, 5, 10});
+        CHECK(internal::splitTimeRange(5, 7, 10) == std::vector<std::int64_t>{5, 6, 7});
+
+        const auto limits = internal::splitTimeRange(std::numeric_limits<std::int64_t>::min(), std::numeric_limits<std::int64_t>::max(), 2);
+        CHECK(limits == std::vector<std::int64_t>{std::numeric_limits<std::int64_t>::min(), 0, std::numeric_limits<std::int64_t>::max()});
+    }
+
+    TEST_CASE("Time range split throws on empty range or no parts", "[TimeRangeQueryTest]")
+    {
+        CHECK_THROWS_AS(internal::splitTimeRange(10, 10, 1), InfluxDBException);
+        CHECK_THROWS_AS(internal::splitTimeRange(10, 0, 1), InfluxDBException);
+        CHECK_THROWS_AS(internal::splitTimeRange(0, 10, 0), InfluxDBException);
+    }
+
+    TEST_CASE("Time range query passes bounds of parts as parameters", "[TimeRangeQueryTest]")
+    {
+        ParamsTransport transport{[](const std::string&) { return std::string{R"({"results":[{"statement_id":0}]})"}; }};
+        const auto params = InfluxDBParams{}.addParam("host", "a");
+
+        internal::queryTimeRangeImpl(&transport, "SELECT * FROM x WHERE time >= $start AND time < $end", 0, 2 * second, 2, params);
+
+        REQUIRE(transport.receivedParams.size() == 2);
+        CHECK(transport.receivedQueries[0] == "SELECT * FROM x WHERE time >= $start AND time < $end");
+        std::sort(transport.receivedParams.begin(), transport.receivedParams.end());
+        CHECK(contains(transport.receivedParams[0], R"("host":"a")"));
+        CHECK(contains(transport.receivedParams[0], R"("start":"1970-01-01T00:00:00Z")"));
+        CHECK(contains(transport.receivedParams[0], R"("end":"1970-01-01T00:00:01Z")"));
+        CHECK(contains(transport.receivedParams[1], R"("start":"1970-01-01T00:00:01Z")"));
+        CHECK(contains(transport.receivedParams[1], R"("end":"1970-01-01T00:00:02Z")"));
+    }
+
+    TEST_CASE("Time range parts are queried concurrently", "[TimeRangeQueryTest]")
+    {
+        constexpr std::size_t parts{4};
+        std::mutex mutex;
+        std::condition_variable allStarted;
+        std::size_t started{0};
+
+        ParamsTransport transport{[&](const std::string&) {
+            std::unique_lock lock{mutex};
+            ++started;
+            allStarted.notify_all();
+            const bool concurrent = allStarted.wait_for(lock, std::chrono::seconds{10}, [&started] { return started == parts; });
+            return concurrent ? std::string{R"({"results":[{"statement_id":0}]})"} : std::string{R"({"error":"not concurrent"})"};
+        }};
+
+        CHECK_NOTHROW(internal::queryTimeRangeImpl(&transport, "SELECT * FROM x", 0, 100 * second, parts));
+        CHECK(started == parts);
+    }
+
+    TEST_CASE("Time range parts are queried by at most max concurrency threads", "[TimeRangeQueryTest]")
+    {
+        std::mutex mutex;
+        std::size_t running{0};
+        std::size_t maxRunning{0};
+
+        ParamsTransport transport{[&](const std::string&) {
+            {
+                std::lock_guard lock{mutex};
+                maxRunning = std::max(maxRunning, ++running);
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds{10});
+            std::lock_guard lock{mutex};
+            --running;
+            return std::string{R"({"results":[{"statement_id":0}]})"};
+        }};
+
+        CHECK_NOTHROW(internal::queryTimeRangeImpl(&transport, "SELECT * FROM x", 0, 100 * second, 10, {}, 3));
+        CHECK(transport.receivedParams.size() == 10);
+        CHECK(maxRunning <= 3);
+    }
+
+    TEST_CASE("Time range results are merged in time order", "[TimeRangeQueryTest]")
+    {
+        ParamsTransport transport{[](const std::string& params) {
+            if (contains(params, R"("start":"1970-01-01T00:00:00Z")"))
+            {
+                return std::string{R"({"results":[{"statement_id":0,"series":[{"name":"a","columns":["time"],"values":[["0"],["1"]]}]},)"
+                                   R"({"statement_id":1,"series":[{"name":"c","columns":["time"],"values":[["0"]]}]}]})"};
+            }
+            if (contains(params, R"("start":"1970-01-01T00:00:02Z")"))
+            {
+                return std::string{R"({"results":[{"statement_id":0,"series":[{"name":"a","columns":["time"],"values":[["2"]]},)"
+                                   R"({"name":"a","tags":{"host":"h"},"columns":["time"],"values":[["3"]]}]},)"
+                                   R"({"statement_id":1,"error":"failed"}]})"};
+            }
+            return std::string{R"({"results":[{"statement_id":0,"series":[{"name":"a","columns":["time"],"values":[["4"],["5"]]},)"
+                               R"({"name":"b","columns":["time"],"values":[["6"]]}]},)"
+                               R"({"statement_id":1,"series":[{"name":"c","columns":["time"],"values":[["4"]]}]}]})"};
+        }};
+
+        const auto result = internal::queryTimeRangeImpl(&transport, "SELECT * FROM x", 0, 6 * second, 3);
+
+        REQUIRE(result.size() == 2);
+        CHECK(result[0].statementId == 0);
+        REQUIRE(result[0].series.size() == 3);
+        CHECK(result[0].series[0].name == "a");
+        CHECK(times(result[0].series[0]) == std::vector<std::string>{"0", "1", "2", "4", "5"});
+        CHECK(result[0].series[1].tagValues == std::vector<std::string>{"h"});
+        CHECK(times(result[0].series[1]) == std::vector<std::string>{"3"});
+        CHECK(result[0].series[2].name == "b");
+        CHECK(times(result[0].series[2]) == std::vector<std::string>{"6"});
+
+        CHECK(result[1].statementId == -1);
+        CHECK(result[1].error == "failed");
+        CHECK(result[1].series.empty());
+    }
+
+    TEST_CASE("Time range query throws error of failed part", "[TimeRangeQueryTest]")
+    {
+        ParamsTransport transport{[](const std::string& params) -> std::string {
+            if (contains(params, R"("start":"1970-01-01T00:00:01Z")"))
+            {
+                throw InfluxDBException{"unit test", "Intentional"};
+            }
+            return R"({"results":[{"statement_id":0}]})";
+        }};
+
+        CHECK_THROWS_WITH(internal::queryTimeRangeImpl(&transport, "SELECT * FROM x", 0, 3 * second, 3), Catch::Contains("Intentional"));
+        CHECK(transport.receivedParams.size() == 3);
+    }
+}
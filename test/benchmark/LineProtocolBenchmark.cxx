@@ -0,0 +1,94 @@
+// MIT License
+//
+// Copyright (c) 2022 TOSHIBA CORPORATION
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "LineProtocol.h"
+#include <iostream>
+#include <catch2/catch.hpp>
+
+namespace influxdb::test
+{
+    namespace
+    {
+        constexpr std::chrono::time_point<std::chrono::system_clock> ignoreTimestamp(std::chrono::milliseconds(1572830915));
+        constexpr std::size_t fieldsPerPoint{10};
+
+        Point createDoublePoint()
+        {
+            Point point{"cpu"};
+            point.addTag("host", "server01").addTag("region", "eu-west");
+
+            for (std::size_t i = 0; i < fieldsPerPoint; ++i)
+            {
+                point.addField("value" + std::to_string(i), 12.5 + static_cast<double>(i) * 0.37);
+            }
+            point.setTimestamp(ignoreTimestamp);
+            return point;
+        }
+
+        void reportBytesPerPoint(const std::string& mode, const Point& point)
+        {
+            std::string buffer;
+            LineProtocol{}.formatTo(buffer, point);
+            std::cout << mode << ": " << buffer.size() << " bytes per point (" << fieldsPerPoint << " double fields)\n";
+        }
+    }
+
+    TEST_CASE("Double field formatting", "[LineProtocolBenchmark]")
+    {
+        const auto point = createDoublePoint();
+        std::string buffer;
+
+        Point::floatsPrecision = defaultFloatsPrecision;
+        reportBytesPerPoint("shortest round-trip", point);
+        Point::floatsPrecision = 18;
+        reportBytesPerPoint("fixed precision 18", point);
+
+        Point::floatsPrecision = defaultFloatsPrecision;
+        BENCHMARK("shortest round-trip (10 fields)")
+        {
+            buffer.clear();
+            LineProtocol::appendFields(buffer, point);
+            return buffer.size();
+        };
+
+        Point::floatsPrecision = 18;
+        BENCHMARK("fixed precision 18 (10 fields)")
+        {
+            buffer.clear();
+            LineProtocol::appendFields(buffer, point);
+            return buffer.size();
+        };
+
+        Point::floatsPrecision = defaultFloatsPrecision;
+    }
+
+    TEST_CASE("Point construction", "[LineProtocolBenchmark]")
+    {
+        std::cout << "sizeof(Point): " << sizeof(Point) << " bytes\n";
+
+        BENCHMARK("Point with 2 tags and 10 fields")
+        {
+            return createDoublePoint();
+        };
+    }
+}
@@ -0,0 +1,138 @@
+// MIT License
+//
+// Copyright (c) 2022 TOSHIBA CORPORATION
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "CsvResponseParser.h"
+#include "QueryResponseParser.h"
+#include <iostream>
+#include <catch2/catch.hpp>
+
+namespace influxdb::test
+{
+    namespace
+    {
+        constexpr std::size_t rows{20000};
+        constexpr std::size_t fieldsPerRow{10};
+
+        std::string value(std::size_t row, std::size_t field)
+        {
+            return std::to_string(row % 1000) + "." + std::to_string(field * 37 % 100 + 1);
+        }
+
+        /// Response of a wide SELECT * as written by InfluxDB in JSON
+        std::string createJsonResponse()
+        {
+            std::string response{R"({"results":[{"statement_id":0,"series":[{"name":"cpu","tags":{"host":"server01"},"columns":["time")"};
+            for (std::size_t field = 0; field < fieldsPerRow; ++field)
+            {
+                response += ",\"value" + std::to_string(field) + "\"";
+            }
+            response += "],\"values\":[";
+            for (std::size_t row = 0; row < rows; ++row)
+            {
+                response += (row == 0 ? "[" : ",[");
+                response += "\"2021-01-01T00:00:" + std::to_string(10 + row % 50) + ".123456789Z\"";
+                for (std::size_t field = 0; field < fieldsPerRow; ++field)
+                {
+                    response += "," + value(row, field);
+                }
+                response += "]";
+            }
+            response += "]}]}]}";
+            return response;
+        }
+
+        /// Same response as written by InfluxDB in CSV
+        std::string createCsvResponse()
+        {
+            std::string response{"name,tags,time"};
+            for (std::size_t field = 0; field < fieldsPerRow; ++field)
+            {
+                response += ",value" + std::to_string(field);
+            }
+            response += "\n";
+            for (std::size_t row = 0; row < rows; ++row)
+            {
+                response += "cpu,host=server01,16094592" + std::to_string(10 + row % 50) + "123456789";
+                for (std::size_t field = 0; field < fieldsPerRow; ++field)
+                {
+                    response += "," + value(row, field);
+                }
+                response += "\n";
+            }
+            return response;
+        }
+
+        template <class Builder>
+        std::size_t parseJson(const std::string& response)
+        {
+            Builder builder;
+            internal::QueryResponseParser parser{builder};
+            for (std::size_t pos = 0; pos < response.size(); pos += 16 * 1024)
+            {
+                parser.feed(std::string_view{response}.substr(pos, 16 * 1024));
+            }
+            parser.finish();
+            return builder.takeResult().size();
+        }
+
+        template <class Builder>
+        std::size_t parseCsv(const std::string& response)
+        {
+            Builder builder;
+            internal::CsvResponseParser parser{builder};
+            for (std::size_t pos = 0; pos < response.size(); pos += 16 * 1024)
+            {
+                parser.feed(std::string_view{response}.substr(pos, 16 * 1024));
+            }
+            parser.finish();
+            return builder.takeResult().size();
+        }
+    }
+
+    TEST_CASE("Parsing wide responses", "[QueryResponseBenchmark]")
+    {
+        const auto json = createJsonResponse();
+        const auto csv = createCsvResponse();
+        std::cout << rows << " rows of " << fieldsPerRow << " float fields: " << json.size() << " bytes JSON, " << csv.size()
+                  << " bytes CSV\n";
+
+        BENCHMARK("JSON into rows")
+        {
+            return parseJson<internal::RowResultBuilder>(json);
+        };
+
+        BENCHMARK("CSV into rows")
+        {
+            return parseCsv<internal::RowResultBuilder>(csv);
+        };
+
+        BENCHMARK("JSON into columns")
+        {
+            return parseJson<internal::ColumnarResultBuilder>(json);
+        };
+
+        BENCHMARK("CSV into columns")
+        {
+            return parseCsv<internal::ColumnarResultBuilder>(csv);
+        };
+    }
+}
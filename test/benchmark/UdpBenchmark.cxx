@@ -0,0 +1,75 @@
+// MIT License
+//
+// Copyright (c) 2022 TOSHIBA CORPORATION
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "InfluxDB.h"
+#include "InfluxDBFactory.h"
+#include <catch2/catch.hpp>
+
+namespace influxdb::test
+{
+    namespace
+    {
+        constexpr std::chrono::time_point<std::chrono::system_clock> ignoreTimestamp(std::chrono::milliseconds(1572830915));
+        constexpr std::size_t points{10000};
+
+        /// Writes batches to a local port, datagrams are dropped by the kernel
+        void writePoints(InfluxDB& db)
+        {
+            for (std::size_t i = 0; i < points; ++i)
+            {
+                db.write(Point{"cpu"}.addTag("host", "server01").addField("value", 0.5 * static_cast<double>(i)).setTimestamp(ignoreTimestamp));
+            }
+            db.flushBatch();
+        }
+    }
+
+    TEST_CASE("UDP datagrams", "[UdpBenchmark]")
+    {
+        auto packed = InfluxDBFactory::GetV1("udp://127.0.0.1", 8089);
+        packed->batchOf(1000);
+        packed->setMaxDatagramSize(1472);
+
+        BENCHMARK("packed, " + std::to_string(points) + " points")
+        {
+            writePoints(*packed);
+        };
+
+#ifdef __linux__
+        auto segmented = InfluxDBFactory::GetV1("udp://127.0.0.1", 8089);
+        segmented->batchOf(1000);
+        segmented->setMaxDatagramSize(1472);
+        segmented->enableSegmentationOffload();
+
+        BENCHMARK("segmentation offload, " + std::to_string(points) + " points")
+        {
+            writePoints(*segmented);
+        };
+#endif
+
+        auto unbatched = InfluxDBFactory::GetV1("udp://127.0.0.1", 8089);
+
+        BENCHMARK("datagram per point, " + std::to_string(points) + " points")
+        {
+            writePoints(*unbatched);
+        };
+    }
+}
@@ -0,0 +1,111 @@
+// MIT License
+//
+// Copyright (c) 2022 TOSHIBA CORPORATION
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#include "InfluxDB.h"
+#include <algorithm>
+#include <thread>
+#include <catch2/catch.hpp>
+
+namespace influxdb::test
+{
+    namespace
+    {
+        constexpr std::chrono::time_point<std::chrono::system_clock> ignoreTimestamp(std::chrono::milliseconds(1572830915));
+        constexpr std::size_t pointsPerProducer{10000};
+
+        class NullTransport : public Transport
+        {
+        public:
+            void send(std::string&& message) override
+            {
+                bytes += message.size();
+            }
+
+            std::size_t bytes{0};
+        };
+
+        std::vector<std::size_t> producerCounts()
+        {
+            const std::size_t maxProducers = std::max(std::thread::hardware_concurrency(), 1u);
+            std::vector<std::size_t> counts;
+
+            for (std::size_t producers = 1; producers < maxProducers; producers *= 2)
+            {
+                counts.push_back(producers);
+            }
+            counts.push_back(maxProducers);
+            return counts;
+        }
+
+        void writeFromProducers(InfluxDB& db, std::size_t producers)
+        {
+            std::vector<std::thread> threads;
+
+            for (std::size_t producer = 0; producer < producers; ++producer)
+            {
+                threads.emplace_back([&db, producer] {
+                    for (std::size_t i = 0; i < pointsPerProducer; ++i)
+                    {
+                        db.write(Point{"cpu"}
+                                     .addTag("host", "server01")
+                                     .addField("producer", static_cast<long long>(producer))
+                                     .addField("value", 0.5 * static_cast<double>(i))
+                                     .setTimestamp(ignoreTimestamp));
+                    }
+                });
+            }
+
+            for (auto& thread : threads)
+            {
+                thread.join();
+            }
+            db.flushBatch();
+        }
+    }
+
+    TEST_CASE("Producer scalability", "[WriteBenchmark]")
+    {
+        for (const auto producers : producerCounts())
+        {
+            const auto suffix = std::to_string(producers) + " producers x " + std::to_string(pointsPerProducer) + " points";
+
+            InfluxDB batched{std::make_unique<NullTransport>()};
+            batched.batchOf(1000);
+
+            BENCHMARK("batched, " + suffix)
+            {
+                writeFromProducers(batched, producers);
+            };
+
+            InfluxDB async{std::make_unique<NullTransport>()};
+            async.batchOf(1000);
+            async.enableAsyncWrites(8192);
+
+            BENCHMARK("async, " + suffix)
+            {
+                writeFromProducers(async, producers);
+            };
+        }
+    }
+}
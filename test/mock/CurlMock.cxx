@@ -121,6 +121,17 @@ CURLcode curl_easy_getinfo(CURL* curl, CURLINFO info, ...)
         va_end(argp);
         return result;
     }
+    if (info == CURLINFO_RETRY_AFTER)
+    {
+        va_list argp;
+        va_start(argp, info);
+        curl_off_t* outValue = va_arg(argp, curl_off_t*);
+        long value{0};
+        const auto result = influxdb::test::curlMock.curl_easy_getinfo_(curl, info, &value);
+        *outValue = value;
+        va_end(argp);
+        return result;
+    }
     FAIL("Option unsupported by mock: " + std::to_string(info));
     return CURLE_UNKNOWN_OPTION;
 }
@@ -128,4 +139,68 @@ CURLcode curl_easy_getinfo(CURL* curl, CURLINFO info, ...)
 curl_slist* curl_slist_append(struct curl_slist* list, const char* string)
 {
     return influxdb::test::curlMock.curl_slist_append(list, string);
-}
\ No newline at end of file
+}
+
+void curl_slist_free_all(struct curl_slist* list)
+{
+    influxdb::test::curlMock.curl_slist_free_all(list);
+}
+
+CURL* curl_easy_duphandle(CURL* handle)
+{
+    return influxdb::test::curlMock.curl_easy_duphandle(handle);
+}
+
+CURLM* curl_multi_init()
+{
+    return influxdb::test::curlMock.curl_multi_init();
+}
+
+CURLMcode curl_multi_setopt(CURLM* multi_handle, CURLMoption option, ...)
+{
+    if (option == CURLMOPT_MAX_HOST_CONNECTIONS)
+    {
+        va_list argp;
+        va_start(argp, option);
+        const long value = va_arg(argp, long);
+        va_end(argp);
+        return influxdb::test::curlMock.curl_multi_setopt_(multi_handle, option, value);
+    }
+    FAIL("Option unsupported by mock: " + std::to_string(option));
+    return CURLM_UNKNOWN_OPTION;
+}
+
+CURLMcode curl_multi_add_handle(CURLM* multi_handle, CURL* curl_handle)
+{
+    return influxdb::test::curlMock.curl_multi_add_handle(multi_handle, curl_handle);
+}
+
+CURLMcode curl_multi_remove_handle(CURLM* multi_handle, CURL* curl_handle)
+{
+    return influxdb::test::curlMock.curl_multi_remove_handle(multi_handle, curl_handle);
+}
+
+CURLMcode curl_multi_perform(CURLM* multi_handle, int* running_handles)
+{
+    return influxdb::test::curlMock.curl_multi_perform(multi_handle, running_handles);
+}
+
+CURLMsg* curl_multi_info_read(CURLM* multi_handle, int* msgs_in_queue)
+{
+    return influxdb::test::curlMock.curl_multi_info_read(multi_handle, msgs_in_queue);
+}
+
+CURLMcode curl_multi_poll(CURLM* multi_handle, struct curl_waitfd extra_fds[], unsigned int extra_nfds, int timeout_ms, int* ret)
+{
+    return influxdb::test::curlMock.curl_multi_poll(multi_handle, extra_fds, extra_nfds, timeout_ms, ret);
+}
+
+CURLMcode curl_multi_wakeup(CURLM* multi_handle)
+{
+    return influxdb::test::curlMock.curl_multi_wakeup(multi_handle);
+}
+
+CURLMcode curl_multi_cleanup(CURLM* multi_handle)
+{
+    return influxdb::test::curlMock.curl_multi_cleanup(multi_handle);
+}
@@ -54,6 +54,17 @@ namespace influxdb::test
         MAKE_MOCK3(curl_easy_escape, char*(CURL*, const char*, int));
         MAKE_MOCK1(curl_free, void(void*));
         MAKE_MOCK2(curl_slist_append, curl_slist*(curl_slist*, const char*));
+        MAKE_MOCK1(curl_slist_free_all, void(curl_slist*));
+        MAKE_MOCK1(curl_easy_duphandle, CURL*(CURL*));
+        MAKE_MOCK0(curl_multi_init, CURLM*());
+        MAKE_MOCK3(curl_multi_setopt_, CURLMcode(CURLM*, CURLMoption, long));
+        MAKE_MOCK2(curl_multi_add_handle, CURLMcode(CURLM*, CURL*));
+        MAKE_MOCK2(curl_multi_remove_handle, CURLMcode(CURLM*, CURL*));
+        MAKE_MOCK2(curl_multi_perform, CURLMcode(CURLM*, int*));
+        MAKE_MOCK2(curl_multi_info_read, CURLMsg*(CURLM*, int*));
+        MAKE_MOCK5(curl_multi_poll, CURLMcode(CURLM*, curl_waitfd*, unsigned int, int, int*));
+        MAKE_MOCK1(curl_multi_wakeup, CURLMcode(CURLM*));
+        MAKE_MOCK1(curl_multi_cleanup, CURLMcode(CURLM*));
     };
 
     extern CurlMock curlMock;